@@ -0,0 +1,87 @@
+/*
+ * drmlist_bench - Offscreen benchmarks, no DRM device needed
+ *
+ *  drmlist_bench             run every benchmark
+ *  drmlist_bench <name>...   run one benchmark, remaining args are passed to it
+ */
+
+#include "bench.h"
+#include "drmlist.h"
+#include "drmlist_cpu.h"
+
+static const bench_t benchmarks[] = {
+    { "convert", "Pixel format conversion throughput", bench_convert },
+    { "loop",    "Event loop syscalls per frame, epoll vs io_uring", bench_loop },
+    { "clock",   "Fixed timestep simulation on virtual time, dropped frames", bench_clock },
+    { "trace",   "Trace marker overhead", bench_trace },
+    { "image",   "4K PPM/QOI decode throughput, cached copy", bench_image },
+    { "scale",   "Nearest/bilinear/box scaling between modes, threaded bands", bench_scale },
+    { "damage",  "DIRTYFB damage rects and bytes flushed per frame", bench_damage },
+    { "prefault", "Page faults and first-frame time of frame buffers by allocation", bench_prefault },
+    { "vrr",     "VRR present pacing and LFC on a simulated 48-144Hz panel", bench_vrr },
+    { "input",   "Input log replay throughput and realtime lateness", bench_input },
+    { "sprites", "Sprite stress: AVX2 step, binned tile fills, sprites/s headless", bench_sprites },
+    { "kernels", "Pixel kernels per CPU level (DRMLIST_CPU), GB/s", bench_kernels },
+    { "hash",    "Frame CRC32C per tile, SSE4.2 vs table, GB/s", bench_hash },
+    { "pattern", "4K test patterns, full and incremental frames per CPU level", bench_pattern },
+    { "color",   "Colour LUT build time and contents, no CRTC needed", bench_color },
+};
+
+#define N_BENCHMARKS (sizeof(benchmarks) / sizeof(benchmarks[0]))
+
+void* bench_alloc(size_t size)
+{
+    void* buf = aligned_alloc(64, (size + 63) & ~(size_t)63);
+
+    if (!buf)
+    {
+        perror("aligned_alloc");
+        exit(1);
+    }
+    memset(buf, 0, size);
+    return buf;
+}
+
+void bench_fill_random(void* buf, size_t size, uint32_t seed)
+{
+    uint8_t* p = buf;
+    uint32_t x = seed ? seed : 0x9E3779B9;
+
+    for (size_t i = 0; i < size; i++)
+    {
+        /* xorshift32 */
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        p[i] = x;
+    }
+}
+
+int main(int argc, const char** argv)
+{
+    int ret = 0;
+
+    if (drmlist_cpu_init(getenv(ENV_DRMLIST_CPU)) < 0)
+        return 1;
+
+    if (argc < 2)
+    {
+        for (size_t i = 0; i < N_BENCHMARKS; i++)
+        {
+            printf("== %s: %s ==\n", benchmarks[i].name, benchmarks[i].desc);
+            ret |= benchmarks[i].run(0, NULL);
+            printf("\n");
+        }
+        return ret;
+    }
+
+    for (size_t i = 0; i < N_BENCHMARKS; i++)
+        if (!strcmp(argv[1], benchmarks[i].name))
+            return benchmarks[i].run(argc - 2, argv + 2);
+
+    fprintf(stderr, "Unknown benchmark: '%s'\nAvailable:\n", argv[1]);
+    for (size_t i = 0; i < N_BENCHMARKS; i++)
+        fprintf(stderr, "\t%-10s %s\n", benchmarks[i].name, benchmarks[i].desc);
+
+    return 1;
+}
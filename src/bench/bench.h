@@ -0,0 +1,41 @@
+#ifndef _DRMLIST_BENCH_H_
+#define _DRMLIST_BENCH_H_
+
+#include "mydrm/mydrm.h"
+#include <time.h>
+
+typedef struct
+{
+    const char* name;
+    const char* desc;
+    int (*run)(int argc, const char** argv);
+} bench_t;
+
+static inline uint64_t bench_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+void* bench_alloc(size_t size);
+void bench_fill_random(void* buf, size_t size, uint32_t seed);
+
+/* Benchmarks */
+int bench_convert(int argc, const char** argv);
+int bench_loop(int argc, const char** argv);
+int bench_clock(int argc, const char** argv);
+int bench_trace(int argc, const char** argv);
+int bench_image(int argc, const char** argv);
+int bench_scale(int argc, const char** argv);
+int bench_damage(int argc, const char** argv);
+int bench_prefault(int argc, const char** argv);
+int bench_vrr(int argc, const char** argv);
+int bench_input(int argc, const char** argv);
+int bench_sprites(int argc, const char** argv);
+int bench_kernels(int argc, const char** argv);
+int bench_hash(int argc, const char** argv);
+int bench_pattern(int argc, const char** argv);
+int bench_color(int argc, const char** argv);
+
+#endif // _DRMLIST_BENCH_H_
@@ -0,0 +1,105 @@
+/*
+ * Fixed timestep clock: simulates many bouncing objects on virtual time, faster
+ * than real time, and checks that dropping frames doesn't change where objects
+ * end up.
+ */
+
+#include "bench.h"
+#include "drmlist_clock.h"
+#include "drmlist_anim.h"
+
+#define CLOCK_OBJECTS 10000
+#define CLOCK_SECONDS 60
+#define CLOCK_REFRESH_NS (1000000000ull / 60)
+#define CLOCK_SIM_HZ 240
+
+static int bench_clock_setup(drmlist_anim_t* anim)
+{
+    uint32_t r[4 * CLOCK_OBJECTS];
+
+    if (drmlist_anim_init(anim, CLOCK_OBJECTS, 1920, 1080))
+        return -1;
+
+    bench_fill_random(r, sizeof(r), 1234);
+    for (int i = 0; i < CLOCK_OBJECTS; i++)
+        drmlist_anim_add(anim, r[4 * i] % 1880, r[4 * i + 1] % 1040,
+                        (float)(r[4 * i + 2] % 1000) - 500.0f, (float)(r[4 * i + 3] % 1000) - 500.0f, 32, 32);
+
+    return 0;
+}
+
+/*
+ * Run CLOCK_SECONDS of virtual time at CLOCK_REFRESH_NS, every `drop_every`th
+ * frame is not rendered (0: render all), returns wall time in ns
+ */
+static uint64_t bench_clock_run(drmlist_anim_t* anim, int drop_every, uint64_t* steps, uint64_t* frames)
+{
+    drmlist_clock_t clk;
+    uint64_t start = bench_now_ns();
+    uint64_t end_ns = CLOCK_SECONDS * 1000000000ull;
+    float x, y;
+
+    drmlist_clock_init(&clk, CLOCK_SIM_HZ, CLOCK_REFRESH_NS, true);
+    *frames = 0;
+
+    for (uint64_t t = 0; t < end_ns; t += CLOCK_REFRESH_NS)
+    {
+        uint64_t present;
+        uint32_t n;
+        float alpha;
+
+        drmlist_clock_set_now(&clk, t);
+        drmlist_clock_flip(&clk, 0, 0);
+
+        if (drop_every && (t / CLOCK_REFRESH_NS) % drop_every == 0)
+            continue;
+
+        present = drmlist_clock_predict_present(&clk);
+        n = drmlist_clock_advance(&clk, present);
+        for (uint32_t i = 0; i < n; i++)
+            drmlist_anim_step(anim, clk.step_ns / 1e9f);
+
+        alpha = drmlist_clock_alpha(&clk, present);
+        for (size_t i = 0; i < anim->count; i++)
+            drmlist_anim_lerp(anim, i, alpha, &x, &y);
+        (*frames)++;
+    }
+
+    /* Bring both runs to the same simulation time */
+    for (uint32_t i = drmlist_clock_advance(&clk, end_ns + CLOCK_REFRESH_NS); i > 0; i--)
+        drmlist_anim_step(anim, clk.step_ns / 1e9f);
+
+    *steps = clk.steps;
+    return bench_now_ns() - start;
+}
+
+int bench_clock(int argc, const char** argv)
+{
+    drmlist_anim_t a, b;
+    uint64_t steps_a, steps_b, frames_a, frames_b;
+    uint64_t ns_a, ns_b;
+    bool same;
+
+    if (bench_clock_setup(&a) || bench_clock_setup(&b))
+    {
+        fprintf(stderr, "clock: out of memory\n");
+        return 1;
+    }
+
+    ns_a = bench_clock_run(&a, 0, &steps_a, &frames_a);
+    ns_b = bench_clock_run(&b, 3, &steps_b, &frames_b);
+
+    same = steps_a == steps_b &&
+           !memcmp(a.x, b.x, a.count * sizeof(float)) && !memcmp(a.y, b.y, a.count * sizeof(float));
+
+    printf("%d objects, %ds at 60Hz, simulation %dHz\n", CLOCK_OBJECTS, CLOCK_SECONDS, CLOCK_SIM_HZ);
+    printf("%-16s %8s %10s %12s\n", "", "frames", "steps", "x real time");
+    printf("%-16s %8lu %10lu %12.1f\n", "every frame", frames_a, steps_a, CLOCK_SECONDS * 1e9 / ns_a);
+    printf("%-16s %8lu %10lu %12.1f\n", "1/3 dropped", frames_b, steps_b, CLOCK_SECONDS * 1e9 / ns_b);
+    printf("Positions after dropped frames: %s\n", same ? "identical" : "DIFFERENT");
+
+    drmlist_anim_free(&a);
+    drmlist_anim_free(&b);
+
+    return same ? 0 : 1;
+}
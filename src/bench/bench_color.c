@@ -0,0 +1,202 @@
+/*
+ * Colour LUTs (drmlist_color) without a CRTC: time to build what a "color"
+ * change puts on the CRTC at common LUT sizes, and checks of the contents:
+ * neutral settings are bypass, DEGAMMA_LUT then GAMMA_LUT with nothing in
+ * between is an identity, negative CTM coefficients are sign-magnitude and
+ * the calibration curve hits its points.
+ *
+ *  drmlist_bench color [iterations]
+ */
+
+#include "bench.h"
+#include "drmlist_color.h"
+#include <math.h>
+
+static const uint32_t lut_sizes[] = { 256, 1024, 4096 };
+
+/* Interpolated lookup of one channel, `v` on 0-1 */
+static double lut_lookup(const struct drm_color_lut* lut, uint32_t n, int channel, double v)
+{
+    double x = v * (n - 1);
+    uint32_t i = (uint32_t)x;
+    const uint16_t* a;
+    const uint16_t* b;
+
+    if (i >= n - 1)
+        return (&lut[n - 1].red)[channel] / 65535.0;
+
+    a = &lut[i].red;
+    b = &lut[i + 1].red;
+    return (a[channel] * (1.0 - (x - i)) + b[channel] * (x - i)) / 65535.0;
+}
+
+static bool check_neutral(void)
+{
+    drmlist_color_params_t p;
+    float curve[6] = { 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f };
+    bool ok;
+
+    drmlist_color_params_init(&p);
+    ok = drmlist_color_neutral(&p);
+
+    p.temperature = 4000;
+    ok &= !drmlist_color_neutral(&p);
+    drmlist_color_params_init(&p);
+    p.saturation = 0.0f;
+    ok &= !drmlist_color_neutral(&p);
+
+    /* Even an identity curve is a curve */
+    drmlist_color_params_init(&p);
+    p.curve = curve;
+    p.curve_size = 2;
+    ok &= !drmlist_color_neutral(&p);
+
+    printf("neutral settings are bypass: %s\n", ok ? "ok" : "FAIL");
+    return ok;
+}
+
+/* Every 8-bit value through DEGAMMA_LUT and the linear GAMMA_LUT, within half a step */
+static bool check_round_trip(uint32_t n)
+{
+    drmlist_color_params_t p;
+    struct drm_color_lut* degamma = bench_alloc(n * sizeof(struct drm_color_lut));
+    struct drm_color_lut* gamma = bench_alloc(n * sizeof(struct drm_color_lut));
+    double max_err = 0.0;
+
+    drmlist_color_params_init(&p);
+    drmlist_color_degamma_lut(degamma, n);
+    drmlist_color_gamma_lut(&p, true, gamma, n);
+
+    for (int i = 0; i < 256; i++)
+        for (int ch = 0; ch < 3; ch++)
+        {
+            double v = lut_lookup(gamma, n, ch, lut_lookup(degamma, n, ch, i / 255.0));
+
+            if (fabs(v - i / 255.0) > max_err)
+                max_err = fabs(v - i / 255.0);
+        }
+
+    free(gamma);
+    free(degamma);
+
+    printf("DEGAMMA_LUT -> GAMMA_LUT %4u: max error %.2f/255 %s\n", n, max_err * 255.0, max_err <= 0.5 / 255.0 ? "ok" : "FAIL");
+    return max_err <= 0.5 / 255.0;
+}
+
+static bool check_ctm(void)
+{
+    drmlist_color_params_t p;
+    struct drm_color_ctm m;
+    bool ok = drmlist_color_ctm_fixed(1.0) == 1ull << 32 && drmlist_color_ctm_fixed(0.0) == 0 &&
+              drmlist_color_ctm_fixed(-0.5) == ((1ull << 63) | (1ull << 31)) &&
+              drmlist_color_ctm_fixed(-2.25) == ((1ull << 63) | (9ull << 30));
+
+    /* Over 1 the luma is taken out of the other channels: negative off the diagonal */
+    drmlist_color_params_init(&p);
+    p.saturation = 2.0f;
+    drmlist_color_ctm(&p, &m);
+
+    for (int row = 0; row < 3; row++)
+        for (int col = 0; col < 3; col++)
+        {
+            uint64_t v = m.matrix[row * 3 + col];
+            bool negative = v >> 63;
+            double magnitude = (v & ~(1ull << 63)) / 4294967296.0;
+
+            ok &= negative == (row != col) && magnitude > 0.0 && magnitude < 2.0;
+        }
+
+    printf("CTM sign-magnitude: %s\n", ok ? "ok" : "FAIL");
+    return ok;
+}
+
+/* Ends and points of a 3 point curve, halfway between two in between */
+static bool check_curve(void)
+{
+    const uint32_t n = 1025;
+    float curve[9] = { 0.1f, 0.0f, 0.2f,
+                       0.5f, 0.4f, 0.6f,
+                       0.9f, 1.0f, 0.8f };
+    struct drm_color_lut* lut = bench_alloc(n * sizeof(struct drm_color_lut));
+    drmlist_color_params_t p;
+    bool ok = true;
+
+    drmlist_color_params_init(&p);
+    p.curve = curve;
+    p.curve_size = 3;
+    drmlist_color_gamma_lut(&p, false, lut, n);
+
+    for (int ch = 0; ch < 3; ch++)
+    {
+        ok &= (&lut[0].red)[ch] == (uint16_t)(curve[ch] * 65535.0 + 0.5);
+        ok &= (&lut[n / 2].red)[ch] == (uint16_t)(curve[3 + ch] * 65535.0 + 0.5);
+        ok &= (&lut[n - 1].red)[ch] == (uint16_t)(curve[6 + ch] * 65535.0 + 0.5);
+        ok &= abs((&lut[n / 4].red)[ch] - (int)((curve[ch] + curve[3 + ch]) / 2.0 * 65535.0 + 0.5)) <= 1;
+    }
+
+    free(lut);
+
+    printf("calibration curve points: %s\n", ok ? "ok" : "FAIL");
+    return ok;
+}
+
+int bench_color(int argc, const char** argv)
+{
+    int iterations = argc > 0 ? atoi(argv[0]) : 200;
+    float curve[3 * 16];
+    drmlist_color_params_t p;
+    struct drm_color_ctm m;
+    bool ok = true;
+
+    /* Night mode with a calibration curve, the most a change computes */
+    drmlist_color_params_init(&p);
+    p.temperature = 3400;
+    p.saturation = 1.2f;
+    p.gamma = 1.1f;
+    for (int i = 0; i < 16; i++)
+        curve[i * 3] = curve[i * 3 + 1] = curve[i * 3 + 2] = i / 15.0f;
+    p.curve = curve;
+    p.curve_size = 16;
+
+    printf("%d iterations, us per LUT, night mode with a 16 point curve\n", iterations);
+    printf("%-6s %12s %12s %12s %12s\n", "size", "DEGAMMA_LUT", "CTM", "GAMMA_LUT", "no CTM");
+
+    for (size_t s = 0; s < sizeof(lut_sizes) / sizeof(lut_sizes[0]); s++)
+    {
+        uint32_t n = lut_sizes[s];
+        struct drm_color_lut* lut = bench_alloc(n * sizeof(struct drm_color_lut));
+        uint64_t start, degamma_ns, ctm_ns, gamma_ns, encoded_ns;
+
+        start = bench_now_ns();
+        for (int i = 0; i < iterations; i++)
+            drmlist_color_degamma_lut(lut, n);
+        degamma_ns = (bench_now_ns() - start) / iterations;
+
+        start = bench_now_ns();
+        for (int i = 0; i < iterations; i++)
+            drmlist_color_ctm(&p, &m);
+        ctm_ns = (bench_now_ns() - start) / iterations;
+
+        start = bench_now_ns();
+        for (int i = 0; i < iterations; i++)
+            drmlist_color_gamma_lut(&p, true, lut, n);
+        gamma_ns = (bench_now_ns() - start) / iterations;
+
+        /* No CTM: the temperature folded into the gamma LUT */
+        start = bench_now_ns();
+        for (int i = 0; i < iterations; i++)
+            drmlist_color_gamma_lut(&p, false, lut, n);
+        encoded_ns = (bench_now_ns() - start) / iterations;
+
+        printf("%-6u %12.1f %12.2f %12.1f %12.1f\n", n, degamma_ns / 1e3, ctm_ns / 1e3, gamma_ns / 1e3, encoded_ns / 1e3);
+        free(lut);
+    }
+
+    ok &= check_neutral();
+    for (size_t s = 0; s < sizeof(lut_sizes) / sizeof(lut_sizes[0]); s++)
+        ok &= check_round_trip(lut_sizes[s]);
+    ok &= check_ctm();
+    ok &= check_curve();
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,121 @@
+/*
+ * Pixel format conversion throughput: scalar reference vs every kernel level
+ * the CPU supports, MPix/s, speedup of the bound level
+ */
+
+#include "bench.h"
+#include "drmlist_convert.h"
+#include "drmlist_cpu.h"
+
+#define CONVERT_W 1920
+#define CONVERT_H 1080
+
+static const uint32_t bench_formats[] = {
+    DRM_FORMAT_ARGB8888,
+    DRM_FORMAT_XRGB8888,
+    DRM_FORMAT_RGB565,
+    DRM_FORMAT_XRGB2101010,
+    DRM_FORMAT_RGB888,
+};
+
+#define N_FORMATS (sizeof(bench_formats) / sizeof(bench_formats[0]))
+
+static double bench_convert_one(void* dst, uint32_t dst_format, const void* src, uint32_t src_format, uint32_t flags)
+{
+    const int iterations = 20;
+    uint32_t dst_stride = CONVERT_W * drmlist_convert_cpp(dst_format);
+    uint32_t src_stride = CONVERT_W * drmlist_convert_cpp(src_format);
+    uint64_t start;
+
+    /* Warm up */
+    drmlist_convert(dst, dst_format, dst_stride, src, src_format, src_stride, CONVERT_W, CONVERT_H, flags);
+
+    start = bench_now_ns();
+    for (int i = 0; i < iterations; i++)
+        drmlist_convert(dst, dst_format, dst_stride, src, src_format, src_stride, CONVERT_W, CONVERT_H, flags);
+
+    return (double)CONVERT_W * CONVERT_H * iterations * 1e3 / (bench_now_ns() - start);
+}
+
+static bool bench_convert_check(void* a, void* b, uint32_t dst_format, const void* src, uint32_t src_format, uint32_t flags)
+{
+    uint32_t dst_stride = CONVERT_W * drmlist_convert_cpp(dst_format);
+    uint32_t src_stride = CONVERT_W * drmlist_convert_cpp(src_format);
+
+    drmlist_convert(a, dst_format, dst_stride, src, src_format, src_stride, CONVERT_W, CONVERT_H, flags | DRMLIST_CONVERT_SCALAR);
+    drmlist_convert(b, dst_format, dst_stride, src, src_format, src_stride, CONVERT_W, CONVERT_H, flags);
+
+    return !memcmp(a, b, (size_t)dst_stride * CONVERT_H);
+}
+
+int bench_convert(int argc, const char** argv)
+{
+    static const struct { uint32_t flags; const char* name; } variants[] = {
+        { 0,                                "" },
+        { DRMLIST_CONVERT_DITHER,           " +dither" },
+        { DRMLIST_CONVERT_PREMULTIPLY,      " +premul" },
+        { DRMLIST_CONVERT_UNPREMULTIPLY,    " +unpremul" },
+    };
+    size_t size = (size_t)CONVERT_W * CONVERT_H * 4;
+    uint8_t* src = bench_alloc(size);
+    uint8_t* dst = bench_alloc(size);
+    uint8_t* ref = bench_alloc(size);
+    int bound = drmlist_cpu_level;
+    int ret = 0;
+
+    bench_fill_random(src, size, 1);
+
+    printf("%dx%d, MPix/s\n", CONVERT_W, CONVERT_H);
+    printf("%-36s %10s", "conversion", "scalar");
+    for (int l = 0; l <= bound; l++)
+        printf(" %10s", drmlist_cpu_level_name(l));
+    printf(" %8s %s\n", "speedup", "check");
+
+    for (size_t s = 0; s < N_FORMATS; s++)
+    {
+        for (size_t d = 0; d < N_FORMATS; d++)
+        {
+            for (size_t v = 0; v < sizeof(variants) / sizeof(variants[0]); v++)
+            {
+                uint32_t flags = variants[v].flags;
+                char name[64];
+
+                if (s == d && !flags)
+                    continue;
+                if ((flags & DRMLIST_CONVERT_DITHER) && bench_formats[d] != DRM_FORMAT_RGB565)
+                    continue;
+                if ((flags & (DRMLIST_CONVERT_PREMULTIPLY | DRMLIST_CONVERT_UNPREMULTIPLY)) && bench_formats[s] != DRM_FORMAT_ARGB8888)
+                    continue;
+
+                snprintf(name, sizeof(name), "%s -> %s%s", drmlist_convert_format_name(bench_formats[s]),
+                         drmlist_convert_format_name(bench_formats[d]), variants[v].name);
+
+                double scalar = bench_convert_one(dst, bench_formats[d], src, bench_formats[s], flags | DRMLIST_CONVERT_SCALAR);
+                double simd = 0.0;
+                bool ok = true;
+
+                printf("%-36s %10.1f", name, scalar);
+
+                /* The conversion dispatches on the bound level, step through them */
+                for (int l = 0; l <= bound; l++)
+                {
+                    drmlist_cpu_level = l;
+                    simd = bench_convert_one(dst, bench_formats[d], src, bench_formats[s], flags);
+                    ok &= bench_convert_check(ref, dst, bench_formats[d], src, bench_formats[s], flags);
+                    printf(" %10.1f", simd);
+                }
+                drmlist_cpu_level = bound;
+
+                printf(" %7.2fx %s\n", simd / scalar, ok ? "ok" : "MISMATCH");
+                if (!ok)
+                    ret = 1;
+            }
+        }
+    }
+
+    free(src);
+    free(dst);
+    free(ref);
+
+    return ret;
+}
@@ -0,0 +1,78 @@
+/*
+ * DIRTYFB damage: replays drmlist's frame (moving box, HUD, software cursor)
+ * at a few mode sizes, reports bytes flushed per frame against full-frame
+ * flushes and the cost of merging the rects
+ */
+
+#include "bench.h"
+#include "drmlist.h"
+#include "drmlist_damage.h"
+
+#define DAMAGE_FRAMES 6000
+#define DAMAGE_REFRESH 60
+#define DAMAGE_HUD_W 420
+#define DAMAGE_HUD_H 36
+#define DAMAGE_CURSOR 32
+
+static void bench_damage_frame(struct drm_clip_rect* rects, uint32_t* n, uint32_t w, uint32_t h, uint32_t frame)
+{
+    float t = (float)frame / DAMAGE_REFRESH;
+    uint32_t span = w - DRMLIST_BOX_WIDTH;
+    uint32_t pos = (uint32_t)(t * DRMLIST_BOX_SPEED) % (2 * span);
+    uint32_t box_x = pos < span ? pos : 2 * span - pos;
+    uint32_t cursor_x = (w / 2) + (frame * 7) % (w / 3);
+    uint32_t cursor_y = (h / 2) + (frame * 3) % (h / 3);
+
+    rects[0] = (struct drm_clip_rect){ box_x, 0, box_x + DRMLIST_BOX_WIDTH, h };
+    rects[1] = (struct drm_clip_rect){ 8, 8, 8 + DAMAGE_HUD_W, 8 + DAMAGE_HUD_H };
+    rects[2] = (struct drm_clip_rect){ cursor_x, cursor_y, cursor_x + DAMAGE_CURSOR, cursor_y + DAMAGE_CURSOR };
+    *n = 3;
+}
+
+int bench_damage(int argc, const char** argv)
+{
+    static const uint32_t sizes[][2] = { { 1024, 768 }, { 1920, 1080 }, { 3840, 2160 } };
+    drmlist_damage_t d;
+
+    printf("%d frames @ %dHz, box + HUD + software cursor\n", DAMAGE_FRAMES, DAMAGE_REFRESH);
+    printf("%-12s %10s %12s %12s %10s %10s\n", "mode", "rects", "KiB/frame", "full KiB", "flushed", "ns/frame");
+
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+    {
+        uint32_t w = sizes[s][0], h = sizes[s][1];
+        struct drm_clip_rect prev[3], cur[3];
+        uint32_t n_prev = 0, n_cur;
+        uint64_t start;
+        char name[16];
+
+        memset(&d, 0, sizeof(drmlist_damage_t));
+        start = bench_now_ns();
+
+        for (uint32_t f = 0; f < DAMAGE_FRAMES; f++)
+        {
+            bench_damage_frame(cur, &n_cur, w, h, f);
+
+            drmlist_damage_reset(&d, w, h);
+            if (f == 0)
+                drmlist_damage_full(&d);
+            for (uint32_t i = 0; i < n_prev; i++)
+                drmlist_damage_add_rect(&d, &prev[i]);
+            for (uint32_t i = 0; i < n_cur; i++)
+                drmlist_damage_add_rect(&d, &cur[i]);
+            drmlist_damage_account(&d, 4);
+
+            memcpy(prev, cur, sizeof(cur));
+            n_prev = n_cur;
+        }
+
+        double ns = (double)(bench_now_ns() - start) / DAMAGE_FRAMES;
+        double full = (double)w * h * 4 / 1024;
+        double avg = d.bytes / 1024.0 / d.frames;
+
+        snprintf(name, sizeof(name), "%ux%u", w, h);
+        printf("%-12s %10.2f %12.1f %12.1f %9.1f%% %10.1f\n", name, (double)d.rects_total / d.frames, avg, full,
+               100.0 * avg / full, ns);
+    }
+
+    return 0;
+}
@@ -0,0 +1,105 @@
+/*
+ * Frame hashes (drmlist_hash) at every CPU level up to the bound one,
+ * 1920x1080, GB/s hashed by tile size. Every level must give the same hashes
+ * as the table, and a one-pixel change must change exactly one tile.
+ *
+ *  drmlist_bench hash [iterations]
+ */
+
+#include "bench.h"
+#include "drmlist_hash.h"
+#include "drmlist_cpu.h"
+
+#define HASH_W 1920
+#define HASH_H 1080
+#define HASH_STRIDE (HASH_W * 4)
+
+static const uint32_t hash_tiles[] = { 0, 16, 64, 256 };
+
+#define N_HASH_TILES (sizeof(hash_tiles) / sizeof(hash_tiles[0]))
+
+int bench_hash(int argc, const char** argv)
+{
+    size_t size = (size_t)HASH_STRIDE * HASH_H;
+    int iterations = argc > 0 ? atoi(argv[0]) : 50;
+    uint8_t* pixels = bench_alloc(size);
+    uint32_t* tiles = bench_alloc((size_t)HASH_W * HASH_H / 64 * sizeof(uint32_t));
+    uint32_t* ref = bench_alloc((size_t)HASH_W * HASH_H / 64 * sizeof(uint32_t));
+    int bound = drmlist_cpu_level;
+    int ret = 0;
+
+    /* Check value of the CRC-32C catalogue */
+    if (drmlist_crc32c(0, "123456789", 9) != 0xE3069283 || drmlist_crc32c_scalar(0, "123456789", 9) != 0xE3069283)
+    {
+        fprintf(stderr, "CRC32C check value mismatch\n");
+        ret = 1;
+    }
+
+    bench_fill_random(pixels, size, 8);
+
+    printf("%dx%d, %d iterations, GB/s hashed\n", HASH_W, HASH_H, iterations);
+    printf("%-12s", "tile");
+    for (int l = 0; l <= bound; l++)
+        printf(" %10s", drmlist_cpu_level_name(l));
+    printf(" %8s %s\n", "speedup", "check");
+
+    for (size_t t = 0; t < N_HASH_TILES; t++)
+    {
+        uint32_t tile = hash_tiles[t];
+        uint32_t tiles_x, tiles_y, n;
+        uint32_t frame = 0, ref_frame = 0;
+        double table = 0.0, gbs = 0.0;
+        bool ok = true;
+
+        drmlist_hash_grid(HASH_W, HASH_H, tile, &tiles_x, &tiles_y);
+        n = tiles_x * tiles_y;
+
+        if (tile)
+            printf("%-12u", tile);
+        else
+            printf("%-12s", "frame");
+
+        for (int l = 0; l <= bound; l++)
+        {
+            uint64_t start = bench_now_ns();
+
+            drmlist_cpu_level = l;
+            for (int i = 0; i < iterations; i++)
+                frame = drmlist_hash_tiles(pixels, HASH_W, HASH_H, HASH_STRIDE, tile, tiles);
+            gbs = (double)size * iterations / (bench_now_ns() - start);
+
+            if (l == 0)
+            {
+                table = gbs;
+                ref_frame = frame;
+                memcpy(ref, tiles, n * sizeof(uint32_t));
+            }
+            else
+                ok &= frame == ref_frame && !memcmp(ref, tiles, n * sizeof(uint32_t));
+
+            printf(" %10.2f", gbs);
+        }
+
+        /* One pixel in the middle of the last row of tiles */
+        pixels[(size_t)(HASH_H - 1) * HASH_STRIDE + HASH_W / 2 * 4] ^= 1;
+        frame = drmlist_hash_tiles(pixels, HASH_W, HASH_H, HASH_STRIDE, tile, tiles);
+        pixels[(size_t)(HASH_H - 1) * HASH_STRIDE + HASH_W / 2 * 4] ^= 1;
+
+        uint32_t changed = 0;
+        for (uint32_t i = 0; i < n; i++)
+            changed += tiles[i] != ref[i];
+        ok &= frame != ref_frame && changed == 1;
+
+        printf(" %7.2fx %s\n", gbs / table, ok ? "ok" : "MISMATCH");
+        if (!ok)
+            ret = 1;
+    }
+
+    drmlist_cpu_level = bound;
+
+    free(pixels);
+    free(tiles);
+    free(ref);
+
+    return ret;
+}
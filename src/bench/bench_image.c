@@ -0,0 +1,231 @@
+/*
+ * Image decode throughput on a 4K picture: PPM and QOI into framebuffer
+ * formats, and the cached per-mode copy
+ */
+
+#include "bench.h"
+#include "drmlist_image.h"
+#include "drmlist_convert.h"
+
+#define IMAGE_W 3840
+#define IMAGE_H 2160
+#define IMAGE_ITERATIONS 10
+
+/*
+ * Gradients with noisy blocks, so QOI sees both runs/diffs and literal pixels
+ */
+static void bench_image_fill(uint8_t* rgb)
+{
+    uint32_t x_rand = 0x12345678;
+
+    for (uint32_t y = 0; y < IMAGE_H; y++)
+    {
+        for (uint32_t x = 0; x < IMAGE_W; x++)
+        {
+            uint8_t* p = rgb + ((size_t)y * IMAGE_W + x) * 3;
+
+            p[0] = x * 255 / IMAGE_W;
+            p[1] = y * 255 / IMAGE_H;
+            p[2] = (x / 64 + y / 64) & 1 ? 0x40 : 0xC0;
+
+            if (((x / 256) ^ (y / 256)) & 1)
+            {
+                x_rand ^= x_rand << 13;
+                x_rand ^= x_rand >> 17;
+                x_rand ^= x_rand << 5;
+                p[0] ^= x_rand & 0x0F;
+                p[1] ^= (x_rand >> 8) & 0x3F;
+                p[2] ^= x_rand >> 24;
+            }
+        }
+    }
+}
+
+static size_t bench_image_ppm(uint8_t* out, const uint8_t* rgb)
+{
+    int len = sprintf((char*)out, "P6\n# drmlist_bench\n%u %u\n255\n", IMAGE_W, IMAGE_H);
+
+    memcpy(out + len, rgb, (size_t)IMAGE_W * IMAGE_H * 3);
+    return len + (size_t)IMAGE_W * IMAGE_H * 3;
+}
+
+/*
+ * Minimal QOI encoder (RGB, no alpha changes)
+ */
+static size_t bench_image_qoi(uint8_t* out, const uint8_t* rgb)
+{
+    uint32_t index[64] = { 0 };
+    uint8_t pr = 0, pg = 0, pb = 0;
+    uint32_t run = 0;
+    size_t n = (size_t)IMAGE_W * IMAGE_H;
+    uint8_t* p = out;
+
+    memcpy(p, "qoif", 4);
+    p[4] = IMAGE_W >> 24; p[5] = IMAGE_W >> 16; p[6] = IMAGE_W >> 8; p[7] = IMAGE_W & 0xFF;
+    p[8] = IMAGE_H >> 24; p[9] = IMAGE_H >> 16; p[10] = IMAGE_H >> 8; p[11] = IMAGE_H & 0xFF;
+    p[12] = 3;
+    p[13] = 0;
+    p += 14;
+
+    for (size_t i = 0; i < n; i++)
+    {
+        uint8_t r = rgb[i * 3], g = rgb[i * 3 + 1], b = rgb[i * 3 + 2];
+        uint32_t px = 0xFF000000 | ((uint32_t)r << 16) | ((uint32_t)g << 8) | b;
+        uint32_t hash = (r * 3 + g * 5 + b * 7 + 255 * 11) & 63;
+
+        if (r == pr && g == pg && b == pb)
+        {
+            if (++run == 62 || i == n - 1)
+            {
+                *p++ = 0xC0 | (run - 1);
+                run = 0;
+            }
+            continue;
+        }
+
+        if (run)
+        {
+            *p++ = 0xC0 | (run - 1);
+            run = 0;
+        }
+
+        if (index[hash] == px)
+        {
+            *p++ = hash;
+        }
+        else
+        {
+            int8_t dr = r - pr, dg = g - pg, db = b - pb;
+            int8_t dr_dg = dr - dg, db_dg = db - dg;
+
+            index[hash] = px;
+
+            if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1)
+            {
+                *p++ = 0x40 | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2);
+            }
+            else if (dg >= -32 && dg <= 31 && dr_dg >= -8 && dr_dg <= 7 && db_dg >= -8 && db_dg <= 7)
+            {
+                *p++ = 0x80 | (dg + 32);
+                *p++ = (dr_dg + 8) << 4 | (db_dg + 8);
+            }
+            else
+            {
+                *p++ = 0xFE;
+                *p++ = r;
+                *p++ = g;
+                *p++ = b;
+            }
+        }
+
+        pr = r;
+        pg = g;
+        pb = b;
+    }
+
+    memcpy(p, "\0\0\0\0\0\0\0\1", 8);
+    return p + 8 - out;
+}
+
+static double bench_image_decode(drmlist_image_t* img, void* dst, uint32_t format)
+{
+    uint32_t stride = IMAGE_W * drmlist_convert_cpp(format);
+    uint64_t start;
+
+    /* Warm up */
+    drmlist_image_decode(img, dst, format, stride, IMAGE_W, IMAGE_H, 0);
+
+    start = bench_now_ns();
+    for (int i = 0; i < IMAGE_ITERATIONS; i++)
+        drmlist_image_decode(img, dst, format, stride, IMAGE_W, IMAGE_H, 0);
+
+    return (double)IMAGE_W * IMAGE_H * IMAGE_ITERATIONS * 1e3 / (bench_now_ns() - start);
+}
+
+/*
+ * Cached path: decoded once per mode, then streamed into the framebuffer
+ */
+static double bench_image_blit(const uint8_t* file, size_t size, uint8_t* pixels)
+{
+    char path[] = "/tmp/drmlist-bench-XXXXXX";
+    drmlist_image_cache_t cache;
+    mydrm_fb_t fb = { .pixels = pixels, .width = IMAGE_W, .height = IMAGE_H, .bpp = 32, .stride = IMAGE_W * 4 };
+    uint64_t start;
+    int fd;
+
+    if ((fd = mkstemp(path)) == -1 || write(fd, file, size) != (ssize_t)size)
+    {
+        perror("bench image file");
+        return 0;
+    }
+    close(fd);
+
+    if (drmlist_image_cache_init(&cache, path, 0))
+    {
+        unlink(path);
+        return 0;
+    }
+
+    drmlist_image_cache_blit(&cache, &fb);
+
+    start = bench_now_ns();
+    for (int i = 0; i < IMAGE_ITERATIONS; i++)
+        drmlist_image_cache_blit(&cache, &fb);
+
+    double mpix = (double)IMAGE_W * IMAGE_H * IMAGE_ITERATIONS * 1e3 / (bench_now_ns() - start);
+
+    drmlist_image_cache_print_stats(&cache);
+    drmlist_image_cache_cleanup(&cache);
+    unlink(path);
+
+    return mpix;
+}
+
+int bench_image(int argc, const char** argv)
+{
+    static const uint32_t formats[] = { DRM_FORMAT_XRGB8888, DRM_FORMAT_RGB565, DRM_FORMAT_XRGB2101010 };
+    size_t n = (size_t)IMAGE_W * IMAGE_H;
+    uint8_t* rgb = bench_alloc(n * 3);
+    uint8_t* ppm = bench_alloc(n * 3 + 64);
+    uint8_t* qoi = bench_alloc(n * 5 + 64);
+    uint8_t* dst = bench_alloc(n * 4);
+    uint8_t* ref = bench_alloc(n * 4);
+    drmlist_image_t ppm_img, qoi_img;
+    size_t ppm_size, qoi_size;
+    int ret = 0;
+
+    bench_image_fill(rgb);
+    ppm_size = bench_image_ppm(ppm, rgb);
+    qoi_size = bench_image_qoi(qoi, rgb);
+
+    if (drmlist_image_open_buffer(&ppm_img, ppm, ppm_size) || drmlist_image_open_buffer(&qoi_img, qoi, qoi_size))
+    {
+        fprintf(stderr, "Failed to parse generated images\n");
+        return 1;
+    }
+
+    printf("%dx%d, PPM %.1f MB, QOI %.1f MB, MPix/s\n", IMAGE_W, IMAGE_H, ppm_size / 1e6, qoi_size / 1e6);
+    printf("%-24s %10s %10s %s\n", "target", "ppm", "qoi", "check");
+
+    for (size_t f = 0; f < sizeof(formats) / sizeof(formats[0]); f++)
+    {
+        uint32_t stride = IMAGE_W * drmlist_convert_cpp(formats[f]);
+        double ppm_mpix = bench_image_decode(&ppm_img, ref, formats[f]);
+        double qoi_mpix = bench_image_decode(&qoi_img, dst, formats[f]);
+        bool ok = !memcmp(ref, dst, (size_t)stride * IMAGE_H);
+
+        printf("%-24s %10.1f %10.1f %s\n", drmlist_convert_format_name(formats[f]), ppm_mpix, qoi_mpix, ok ? "ok" : "MISMATCH");
+        if (!ok)
+            ret = 1;
+    }
+
+    printf("cached copy (XRGB8888): %.1f MPix/s\n", bench_image_blit(qoi, qoi_size, dst));
+
+    free(rgb);
+    free(ppm);
+    free(qoi);
+    free(dst);
+    free(ref);
+
+    return ret;
+}
@@ -0,0 +1,120 @@
+/*
+ * Input replay: records a synthetic mouse trace (1 kHz, a circle with button
+ * presses), replays it as fast as possible and at its recorded times through
+ * the replay pipe, and checks both end where the trace does
+ */
+
+#include "bench.h"
+#include "drmlist_input.h"
+
+#define INPUT_FAST_PACKETS 200000
+#define INPUT_REALTIME_PACKETS 2000
+#define INPUT_INTERVAL_NS 1000000ull
+
+typedef struct
+{
+    int x;
+    int y;
+    uint32_t buttons;
+    uint64_t packets;
+} bench_input_state_t;
+
+static void bench_input_packet(uint32_t i, uint8_t* p)
+{
+    /* Octagon-ish circle, left button held for every other lap */
+    static const int8_t dx[8] = { 3, 2, 0, -2, -3, -2, 0, 2 };
+    static const int8_t dy[8] = { 0, 2, 3, 2, 0, -2, -3, -2 };
+    uint32_t step = (i / 16) % 8;
+
+    p[0] = 0x08 | (((i / 128) & 1) ? 1 : 0);
+    p[1] = (uint8_t)dx[step];
+    p[2] = (uint8_t)dy[step];
+}
+
+static void bench_input_apply(bench_input_state_t* s, const uint8_t* p)
+{
+    s->x += (int8_t)p[1];
+    s->y -= (int8_t)p[2];
+    s->buttons += p[0] & 1;
+    s->packets++;
+}
+
+static int bench_input_write(const char* path, uint32_t n, bench_input_state_t* expect)
+{
+    drmlist_input_recorder_t rec;
+    uint8_t p[3];
+
+    if (drmlist_input_record_open(&rec, path, 0))
+        return -1;
+
+    memset(expect, 0, sizeof(bench_input_state_t));
+    for (uint32_t i = 0; i < n; i++)
+    {
+        bench_input_packet(i, p);
+        drmlist_input_record(&rec, (i + 1) * INPUT_INTERVAL_NS, i / 16, p, sizeof(p));
+        bench_input_apply(expect, p);
+    }
+
+    fclose(rec.file);
+
+    return 0;
+}
+
+static int bench_input_replay(const char* path, bool fast, const bench_input_state_t* expect)
+{
+    drmlist_input_replay_t r;
+    bench_input_state_t got;
+    uint64_t start, done;
+    uint8_t p[3];
+    ssize_t len;
+
+    if (drmlist_input_replay_open(&r, path, fast))
+    {
+        perror("drmlist_input_replay_open");
+        return -1;
+    }
+
+    memset(&got, 0, sizeof(bench_input_state_t));
+    start = bench_now_ns();
+    drmlist_input_replay_start(&r);
+
+    while (got.packets < r.n_packets && (len = read(r.read_fd, p, sizeof(p))) == sizeof(p))
+        bench_input_apply(&got, p);
+
+    printf("%-9s %8lu packets in %8.2f ms, %6.2f Mpackets/s, end %d,%d %s\n", fast ? "fast" : "realtime",
+                    got.packets, (bench_now_ns() - start) / 1e6, got.packets * 1e3 / (bench_now_ns() - start),
+                    got.x, got.y, got.x == expect->x && got.y == expect->y && got.buttons == expect->buttons ? "(matches)" : "(MISMATCH)");
+
+    /* Realtime replay: how far the thread got behind the recorded times */
+    if (read(r.done_fd, &done, sizeof(done)) == sizeof(done))
+        drmlist_input_replay_print_stats(&r);
+    drmlist_input_replay_close(&r);
+
+    return 0;
+}
+
+int bench_input(int argc, const char** argv)
+{
+    char path[] = "/tmp/drmlist-bench-input-XXXXXX";
+    bench_input_state_t expect;
+    int fd;
+
+    if ((fd = mkstemp(path)) == -1)
+    {
+        perror("mkstemp");
+        return -1;
+    }
+    close(fd);
+
+    printf("Log: %zu bytes per packet\n", sizeof(drmlist_input_packet_t));
+
+    if (bench_input_write(path, INPUT_FAST_PACKETS, &expect) == 0)
+        bench_input_replay(path, true, &expect);
+
+    if (bench_input_write(path, INPUT_REALTIME_PACKETS, &expect) == 0)
+        bench_input_replay(path, false, &expect);
+
+    unlink(path);
+
+    return 0;
+}
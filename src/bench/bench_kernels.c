@@ -0,0 +1,171 @@
+/*
+ * Pixel kernels (drmlist_kernels) at every CPU level up to the bound one,
+ * 1920x1080, GB/s of destination written. Every level must produce the same
+ * pixels as SSE2.
+ *
+ *  drmlist_bench kernels [iterations]
+ *  DRMLIST_CPU=avx2 drmlist_bench kernels      caps the levels compared
+ */
+
+#include "bench.h"
+#include "drmlist_kernels.h"
+#include "drmlist_convert.h"
+
+#define KERNELS_W 1920
+#define KERNELS_H 1080
+#define KERNELS_STRIDE (KERNELS_W * 4)
+#define KERNELS_RECTS 4096
+#define KERNELS_COLOR 0xFF336699
+
+typedef struct
+{
+    uint16_t x;
+    uint16_t y;
+    uint16_t w;
+    uint16_t h;
+} bench_rect_t;
+
+typedef struct
+{
+    uint8_t* dst;
+    const uint8_t* src;         // random pixels
+    const uint32_t* premul;     // random premultiplied ARGB
+    const uint32_t* keyed;      // random, half of them 0
+    const bench_rect_t* rects;
+} bench_kernels_data_t;
+
+enum { KERNEL_CLEAR, KERNEL_FILL, KERNEL_BLIT, KERNEL_STREAM, KERNEL_OVER, KERNEL_KEYED, N_KERNELS };
+
+static const char* kernel_names[N_KERNELS] = { "clear", "fill 4-64px", "blit", "stream", "over", "keyed" };
+
+/* Bytes written */
+static size_t bench_kernels_run(const drmlist_kernels_t* k, int kernel, bench_kernels_data_t* d)
+{
+    size_t bytes = 0;
+
+    switch (kernel)
+    {
+        case KERNEL_CLEAR:
+            k->clear((uint32_t*)d->dst, KERNELS_COLOR, KERNELS_W * KERNELS_H);
+            return (size_t)KERNELS_STRIDE * KERNELS_H;
+
+        case KERNEL_FILL:
+            for (int i = 0; i < KERNELS_RECTS; i++)
+            {
+                const bench_rect_t* r = &d->rects[i];
+
+                k->fill(d->dst + (size_t)r->y * KERNELS_STRIDE + r->x * 4, KERNELS_STRIDE, r->w, r->h, KERNELS_COLOR + i);
+                bytes += (size_t)r->w * r->h * 4;
+            }
+            return bytes;
+
+        case KERNEL_BLIT:
+            k->blit(d->dst, KERNELS_STRIDE, d->src, KERNELS_STRIDE, KERNELS_W, KERNELS_H);
+            return (size_t)KERNELS_STRIDE * KERNELS_H;
+
+        case KERNEL_STREAM:
+            k->stream(d->dst, d->src, (size_t)KERNELS_STRIDE * KERNELS_H);
+            return (size_t)KERNELS_STRIDE * KERNELS_H;
+
+        case KERNEL_OVER:
+            /* Odd width, the tails go through every path */
+            k->over(d->dst, KERNELS_STRIDE, d->premul, KERNELS_STRIDE, KERNELS_W - 3, KERNELS_H);
+            return (size_t)(KERNELS_W - 3) * 4 * KERNELS_H;
+
+        default:
+            k->keyed(d->dst, KERNELS_STRIDE, d->keyed, KERNELS_STRIDE, KERNELS_W - 5, KERNELS_H);
+            return (size_t)(KERNELS_W - 5) * 4 * KERNELS_H;
+    }
+}
+
+int bench_kernels(int argc, const char** argv)
+{
+    size_t size = (size_t)KERNELS_STRIDE * KERNELS_H;
+    int iterations = argc > 0 ? atoi(argv[0]) : 50;
+    uint8_t* dst = bench_alloc(size);
+    uint8_t* ref = bench_alloc(size);
+    uint8_t* bg = bench_alloc(size);
+    uint8_t* src = bench_alloc(size);
+    uint32_t* premul = bench_alloc(size);
+    uint32_t* keyed = bench_alloc(size);
+    bench_rect_t* rects = bench_alloc(KERNELS_RECTS * sizeof(bench_rect_t));
+    bench_kernels_data_t data = { dst, src, premul, keyed, rects };
+    int bound = drmlist_cpu_level;
+    int ret = 0;
+
+    bench_fill_random(bg, size, 3);
+    bench_fill_random(src, size, 4);
+    bench_fill_random(premul, size, 5);
+    drmlist_convert(premul, DRM_FORMAT_ARGB8888, KERNELS_STRIDE, premul, DRM_FORMAT_ARGB8888, KERNELS_STRIDE,
+                    KERNELS_W, KERNELS_H, DRMLIST_CONVERT_PREMULTIPLY);
+    bench_fill_random(keyed, size, 6);
+    for (size_t i = 0; i < size / 4; i++)
+        if (keyed[i] & 0x100)
+            keyed[i] = 0;
+
+    bench_fill_random(rects, KERNELS_RECTS * sizeof(bench_rect_t), 7);
+    for (int i = 0; i < KERNELS_RECTS; i++)
+    {
+        uint8_t r[4];
+
+        memcpy(r, &rects[i], sizeof(r));
+        rects[i].w = 4 + r[0] % 61;
+        rects[i].h = 4 + r[1] % 61;
+        rects[i].x = (uint32_t)(r[2] << 8 | r[3]) % (KERNELS_W - rects[i].w);
+        rects[i].y = (uint32_t)(r[3] << 8 | r[2]) % (KERNELS_H - rects[i].h);
+    }
+
+    printf("%dx%d, %d iterations, GB/s written\n", KERNELS_W, KERNELS_H, iterations);
+    printf("%-12s", "kernel");
+    for (int l = 0; l <= bound; l++)
+        printf(" %10s", drmlist_cpu_level_name(l));
+    printf(" %8s %s\n", "speedup", "check");
+
+    for (int kernel = 0; kernel < N_KERNELS; kernel++)
+    {
+        double sse2 = 0.0, gbs = 0.0;
+        bool ok = true;
+
+        printf("%-12s", kernel_names[kernel]);
+
+        for (int l = 0; l <= bound; l++)
+        {
+            const drmlist_kernels_t* k = drmlist_kernels_get(l);
+            uint64_t start, ns = 0;
+            size_t bytes = 0;
+
+            for (int i = 0; i < iterations; i++)
+            {
+                memcpy(dst, bg, size);
+                start = bench_now_ns();
+                bytes += bench_kernels_run(k, kernel, &data);
+                ns += bench_now_ns() - start;
+            }
+
+            /* Every run starts from the same background, the last one is compared with SSE2's */
+            if (l == 0)
+                memcpy(ref, dst, size);
+            else
+                ok &= !memcmp(ref, dst, size);
+
+            gbs = (double)bytes / ns;
+            if (l == 0)
+                sse2 = gbs;
+            printf(" %10.2f", gbs);
+        }
+
+        printf(" %7.2fx %s\n", gbs / sse2, ok ? "ok" : "MISMATCH");
+        if (!ok)
+            ret = 1;
+    }
+
+    free(dst);
+    free(ref);
+    free(bg);
+    free(src);
+    free(premul);
+    free(keyed);
+    free(rects);
+
+    return ret;
+}
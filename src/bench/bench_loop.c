@@ -0,0 +1,110 @@
+/*
+ * Event loop backends: syscalls and time per frame
+ *
+ * Pipes stand in for the DRM fd (one flip event per frame), the mouse (one
+ * packet per frame) and stdin (quiet).
+ */
+
+#include "bench.h"
+#include "drmlist_loop.h"
+
+#define LOOP_FRAMES 100000
+
+typedef struct
+{
+    uint64_t bytes;
+    uint64_t reads;
+} loop_counter_t;
+
+static void bench_loop_read(void* user, const uint8_t* buf, ssize_t len)
+{
+    loop_counter_t* c = user;
+
+    if (len > 0)
+        c->bytes += len;
+    c->reads++;
+}
+
+static int bench_loop_backend(int backend)
+{
+    struct drm_event_vblank flip;
+    uint8_t mouse_packet[3] = { 0x08, 1, 1 };
+    int drm_pipe[2], mouse_pipe[2], stdin_pipe[2];
+    loop_counter_t drm = { 0 }, mouse = { 0 }, input = { 0 };
+    drmlist_loop_t loop;
+    uint64_t start, elapsed;
+    int ret = 0;
+
+    if (pipe(drm_pipe) || pipe(mouse_pipe) || pipe(stdin_pipe))
+    {
+        perror("pipe");
+        return 1;
+    }
+
+    memset(&flip, 0, sizeof(flip));
+    flip.base.type = DRM_EVENT_FLIP_COMPLETE;
+    flip.base.length = sizeof(flip);
+
+    if (drmlist_loop_init(&loop, backend))
+        return 1;
+
+    if (loop.backend != backend)
+    {
+        printf("%-10s unavailable\n", drmlist_loop_backend_name(backend));
+        goto out;
+    }
+
+    drmlist_loop_add_read(&loop, stdin_pipe[0], 255, bench_loop_read, &input);
+    drmlist_loop_add_read(&loop, drm_pipe[0], DRMLIST_LOOP_READ_MAX, bench_loop_read, &drm);
+    drmlist_loop_add_read(&loop, mouse_pipe[0], 3, bench_loop_read, &mouse);
+
+    start = bench_now_ns();
+
+    for (uint64_t frame = 0; frame < LOOP_FRAMES; frame++)
+    {
+        if (write(drm_pipe[1], &flip, sizeof(flip)) != sizeof(flip) ||
+            write(mouse_pipe[1], mouse_packet, 3) != 3)
+        {
+            perror("write");
+            ret = 1;
+            goto out;
+        }
+
+        while (drm.bytes < (frame + 1) * sizeof(flip) || mouse.bytes < (frame + 1) * 3)
+            if (drmlist_loop_run_once(&loop) == -1)
+            {
+                ret = 1;
+                goto out;
+            }
+    }
+
+    elapsed = bench_now_ns() - start;
+
+    printf("%-10s %10.2f %10.2f %10.2f %10.0f\n", drmlist_loop_backend_name(backend),
+                    (double)loop.syscalls / LOOP_FRAMES, (double)loop.wakeups / LOOP_FRAMES,
+                    (double)loop.events / LOOP_FRAMES, (double)elapsed / LOOP_FRAMES);
+
+out:
+    drmlist_loop_cleanup(&loop);
+    close(drm_pipe[0]);
+    close(drm_pipe[1]);
+    close(mouse_pipe[0]);
+    close(mouse_pipe[1]);
+    close(stdin_pipe[0]);
+    close(stdin_pipe[1]);
+
+    return ret;
+}
+
+int bench_loop(int argc, const char** argv)
+{
+    int ret = 0;
+
+    printf("%d frames, per frame (loop syscalls only, the writes feeding it are not counted)\n", LOOP_FRAMES);
+    printf("%-10s %10s %10s %10s %10s\n", "backend", "syscalls", "wakeups", "events", "ns");
+
+    ret |= bench_loop_backend(DRMLIST_LOOP_EPOLL);
+    ret |= bench_loop_backend(DRMLIST_LOOP_IO_URING);
+
+    return ret;
+}
@@ -0,0 +1,92 @@
+/*
+ * Test patterns (drmlist_pattern) at 3840x2160 for every CPU level up to the
+ * bound one: a full generation, as after switching pattern or mode, and a
+ * frame after that (the moving bar, a HUD-sized rect restored). Every level
+ * must produce the same pixels as SSE2.
+ *
+ *  drmlist_bench pattern [iterations]
+ */
+
+#include "bench.h"
+#include "drmlist_pattern.h"
+#include "drmlist_kernels.h"
+
+#define PATTERN_W 3840
+#define PATTERN_H 2160
+#define PATTERN_STRIDE (PATTERN_W * 4)
+
+int bench_pattern(int argc, const char** argv)
+{
+    size_t size = (size_t)PATTERN_STRIDE * PATTERN_H;
+    int iterations = argc > 0 ? atoi(argv[0]) : 20;
+    uint8_t* ref = bench_alloc(size);
+    mydrm_fb_t fb = { .width = PATTERN_W, .height = PATTERN_H, .stride = PATTERN_STRIDE, .size = size };
+    struct drm_clip_rect hud = { 8, 8, 8 + 400, 8 + 40 };
+    drmlist_pattern_t p;
+    int bound = drmlist_cpu_level;
+    int ret = 0;
+
+    fb.pixels = bench_alloc(size);
+
+    printf("%dx%d, %d iterations, full ms / next frame us, one refresh at 60Hz is 16.7 ms\n", PATTERN_W, PATTERN_H, iterations);
+    printf("%-10s", "pattern");
+    for (int l = 0; l <= bound; l++)
+        printf(" %18s", drmlist_cpu_level_name(l));
+    printf(" %s\n", "check");
+
+    for (int kind = 1; kind < DRMLIST_PATTERNS; kind++)
+    {
+        bool ok = true;
+
+        printf("%-10s", drmlist_pattern_name(kind));
+
+        for (int l = 0; l <= bound; l++)
+        {
+            struct drm_clip_rect bar;
+            uint64_t start, full_ns, frame_ns;
+
+            drmlist_kernels_bind(l);
+            if (drmlist_pattern_init(&p, kind, PATTERN_W, PATTERN_H))
+            {
+                perror("pattern");
+                return 1;
+            }
+
+            start = bench_now_ns();
+            for (int i = 0; i < iterations; i++)
+            {
+                drmlist_pattern_invalidate(&p, &fb);
+                drmlist_pattern_draw(&p, &fb, true, &bar);
+            }
+            full_ns = (bench_now_ns() - start) / iterations;
+
+            start = bench_now_ns();
+            for (int i = 0; i < iterations; i++)
+            {
+                drmlist_pattern_drawn_over(&p, &fb, &hud);
+                drmlist_pattern_draw(&p, &fb, true, &bar);
+            }
+            frame_ns = (bench_now_ns() - start) / iterations;
+
+            /* Same frame count on every level, so the bar is in the same place */
+            if (l == 0)
+                memcpy(ref, fb.pixels, size);
+            else
+                ok &= !memcmp(ref, fb.pixels, size);
+
+            printf("   %7.2f / %6.1f", full_ns / 1e6, frame_ns / 1e3);
+            drmlist_pattern_cleanup(&p);
+        }
+
+        printf(" %s\n", ok ? "ok" : "MISMATCH");
+        if (!ok)
+            ret = 1;
+    }
+
+    drmlist_kernels_bind(bound);
+
+    free(fb.pixels);
+    free(ref);
+
+    return ret;
+}
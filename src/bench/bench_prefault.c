@@ -0,0 +1,96 @@
+/*
+ * Page faults of a frame-sized staging buffer: aligned_alloc + memset (what
+ * capture used to do) against drmlist_huge_alloc, then the first full-frame
+ * write into it, which is where an unpopulated buffer takes its faults
+ */
+
+#include "bench.h"
+#include "drmlist_mem.h"
+
+#define PREFAULT_W 3840
+#define PREFAULT_H 2160
+#define PREFAULT_ROUNDS 8
+
+typedef struct
+{
+    const char* name;
+    void* (*alloc)(size_t size);
+    void (*release)(void* ptr, size_t size);
+} bench_prefault_alloc_t;
+
+static void* bench_prefault_malloc(size_t size)
+{
+    void* p = aligned_alloc(64, size);
+
+    if (p)
+        memset(p, 0, size);
+
+    return p;
+}
+
+static void* bench_prefault_lazy(size_t size)
+{
+    return aligned_alloc(64, size);
+}
+
+static void bench_prefault_free(void* ptr, size_t size)
+{
+    (void)size;
+    free(ptr);
+}
+
+int bench_prefault(int argc, const char** argv)
+{
+    static const bench_prefault_alloc_t allocs[] = {
+        { "lazy",         bench_prefault_lazy,   bench_prefault_free },
+        { "memset",       bench_prefault_malloc, bench_prefault_free },
+        { "huge",         drmlist_huge_alloc,    drmlist_huge_free },
+    };
+    size_t size = (size_t)PREFAULT_W * PREFAULT_H * 4;
+    uint32_t* src = aligned_alloc(64, size);
+
+    if (!src)
+        return -1;
+
+    memset(src, 0x5a, size);
+
+    printf("%dx%d XRGB8888 (%.1f MiB), %d rounds\n", PREFAULT_W, PREFAULT_H, size / 1048576.0, PREFAULT_ROUNDS);
+    printf("%-10s %12s %12s %12s %12s\n", "alloc", "alloc ms", "faults", "1st frame ms", "faults");
+
+    for (size_t a = 0; a < sizeof(allocs) / sizeof(allocs[0]); a++)
+    {
+        uint64_t alloc_ns = 0, alloc_faults = 0, frame_ns = 0, frame_faults = 0;
+
+        for (int r = 0; r < PREFAULT_ROUNDS; r++)
+        {
+            uint64_t faults = drmlist_mem_faults();
+            uint64_t start = bench_now_ns();
+            void* p = allocs[a].alloc(size);
+
+            if (!p)
+            {
+                printf("%-10s failed\n", allocs[a].name);
+                break;
+            }
+
+            alloc_ns += bench_now_ns() - start;
+            alloc_faults += drmlist_mem_faults() - faults;
+
+            faults = drmlist_mem_faults();
+            start = bench_now_ns();
+            memcpy(p, src, size);
+            frame_ns += bench_now_ns() - start;
+            frame_faults += drmlist_mem_faults() - faults;
+
+            allocs[a].release(p, size);
+        }
+
+        printf("%-10s %12.2f %12lu %12.2f %12lu\n", allocs[a].name, alloc_ns / 1e6 / PREFAULT_ROUNDS,
+               alloc_faults / PREFAULT_ROUNDS, frame_ns / 1e6 / PREFAULT_ROUNDS, frame_faults / PREFAULT_ROUNDS);
+    }
+
+    drmlist_mem_print_stats();
+    free(src);
+
+    return 0;
+}
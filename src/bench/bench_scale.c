@@ -0,0 +1,81 @@
+/*
+ * Scaling throughput between common mode sizes, output MPix/s, single
+ * threaded and in row bands
+ */
+
+#include "bench.h"
+#include "drmlist_scale.h"
+
+#define SCALE_ITERATIONS 5
+
+static const struct
+{
+    uint32_t src_w, src_h;
+    uint32_t dst_w, dst_h;
+} scale_cases[] = {
+    { 3840, 2160, 1920, 1080 },
+    { 3840, 2160,  640,  480 },
+    { 1920, 1080, 3840, 2160 },
+    { 1920, 1080, 1280,  720 },
+};
+
+#define N_CASES (sizeof(scale_cases) / sizeof(scale_cases[0]))
+
+static double bench_scale_one(mydrm_fb_t* fb, const uint32_t* src, uint32_t src_w, uint32_t src_h, uint32_t filter, uint32_t threads)
+{
+    uint64_t start;
+
+    drmlist_scale_to_fb(fb, NULL, 0, 0, fb->width, fb->height, src, src_w * 4, src_w, src_h, filter, threads);
+
+    start = bench_now_ns();
+    for (int i = 0; i < SCALE_ITERATIONS; i++)
+        drmlist_scale_to_fb(fb, NULL, 0, 0, fb->width, fb->height, src, src_w * 4, src_w, src_h, filter, threads);
+
+    return (double)fb->width * fb->height * SCALE_ITERATIONS * 1e3 / (bench_now_ns() - start);
+}
+
+int bench_scale(int argc, const char** argv)
+{
+    uint32_t threads = argc > 0 ? atoi(argv[0]) : sysconf(_SC_NPROCESSORS_ONLN);
+    uint32_t* src = bench_alloc((size_t)3840 * 2160 * 4);
+    uint32_t* a = bench_alloc((size_t)3840 * 2160 * 4);
+    uint32_t* b = bench_alloc((size_t)3840 * 2160 * 4);
+    int ret = 0;
+
+    if (threads > DRMLIST_SCALE_MAX_THREADS)
+        threads = DRMLIST_SCALE_MAX_THREADS;
+
+    bench_fill_random(src, (size_t)3840 * 2160 * 4, 7);
+
+    printf("MPix/s (output), %u threads\n", threads);
+    printf("%-24s %-9s %10s %10s %s\n", "scale", "filter", "1 thread", "threaded", "check");
+
+    for (size_t c = 0; c < N_CASES; c++)
+    {
+        for (uint32_t filter = DRMLIST_SCALE_NEAREST; filter <= DRMLIST_SCALE_BOX; filter++)
+        {
+            mydrm_fb_t fa = { .pixels = (uint8_t*)a, .width = scale_cases[c].dst_w, .height = scale_cases[c].dst_h,
+                              .bpp = 32, .stride = scale_cases[c].dst_w * 4 };
+            mydrm_fb_t fb = fa;
+            char name[32];
+
+            fb.pixels = (uint8_t*)b;
+            snprintf(name, sizeof(name), "%ux%u -> %ux%u", scale_cases[c].src_w, scale_cases[c].src_h,
+                     scale_cases[c].dst_w, scale_cases[c].dst_h);
+
+            double single = bench_scale_one(&fa, src, scale_cases[c].src_w, scale_cases[c].src_h, filter, 1);
+            double banded = bench_scale_one(&fb, src, scale_cases[c].src_w, scale_cases[c].src_h, filter, threads);
+            bool ok = !memcmp(a, b, (size_t)fa.stride * fa.height);
+
+            printf("%-24s %-9s %10.1f %10.1f %s\n", name, drmlist_scale_filter_name(filter), single, banded, ok ? "ok" : "MISMATCH");
+            if (!ok)
+                ret = 1;
+        }
+    }
+
+    free(src);
+    free(a);
+    free(b);
+
+    return ret;
+}
@@ -0,0 +1,109 @@
+/*
+ * Sprite stress, headless: steps and draws N sprites into a 1920x1080
+ * offscreen frame at 60 frames per second of simulated time (4 steps of the
+ * 240 Hz simulation each). Compares the AVX2 step against the scalar one and
+ * the binned tile fill against drawing sprite after sprite, both must produce
+ * the same state/pixels.
+ *
+ *  drmlist_bench sprites [count] [frames]
+ */
+
+#include "bench.h"
+#include "drmlist_sprites.h"
+
+#define SPRITES_W 1920
+#define SPRITES_H 1080
+#define SPRITES_STEPS 4
+#define SPRITES_DT (1.0f / 240.0f)
+#define SPRITES_BG 0xFF111111
+
+static bool bench_sprites_same_state(drmlist_anim_t* a, drmlist_anim_t* b)
+{
+    size_t size = a->count * sizeof(float);
+
+    return !memcmp(a->x, b->x, size) && !memcmp(a->y, b->y, size) &&
+           !memcmp(a->vx, b->vx, size) && !memcmp(a->vy, b->vy, size);
+}
+
+static void bench_sprites_run(size_t count, uint32_t frames, mydrm_fb_t* fb, mydrm_fb_t* ref)
+{
+    drmlist_sprites_t s, check;
+    uint64_t start, simd_ns = 0, scalar_ns = 0, naive_ns = 0, wall_ns;
+    bool same_state, same_pixels = true;
+
+    if (drmlist_sprites_init(&s, count, SPRITES_W, SPRITES_H, 1234) ||
+        drmlist_sprites_init(&check, count, SPRITES_W, SPRITES_H, 1234))
+    {
+        fprintf(stderr, "Failed to allocate %zu sprites\n", count);
+        return;
+    }
+
+    wall_ns = bench_now_ns();
+    for (uint32_t f = 0; f < frames; f++)
+    {
+        for (int i = 0; i < SPRITES_STEPS; i++)
+        {
+            drmlist_sprites_step(&s, SPRITES_DT);
+
+            start = bench_now_ns();
+            drmlist_anim_step_scalar(&check.anim, SPRITES_DT);
+            scalar_ns += bench_now_ns() - start;
+        }
+
+        drmlist_sprites_draw(&s, fb, 0.5f, true, SPRITES_BG);
+
+        /* The reference draw is slow with many sprites, every 8th frame is enough to compare */
+        if (f % 8 == 0)
+        {
+            start = bench_now_ns();
+            drmlist_sprites_draw_naive(&check, ref, 0.5f, true, SPRITES_BG);
+            naive_ns += bench_now_ns() - start;
+            same_pixels &= !memcmp(fb->pixels, ref->pixels, fb->size);
+        }
+    }
+    wall_ns = bench_now_ns() - wall_ns - scalar_ns - naive_ns;
+    simd_ns = s.step_ns;
+    same_state = bench_sprites_same_state(&s.anim, &check.anim);
+
+    printf("%9zu sprites: %7.2f ms/frame, %7.1f M sprites/s | step AVX2 %6.3f ms, scalar %6.3f ms %s | "
+           "tiled draw %6.3f ms, naive %6.3f ms %s\n",
+                    count, wall_ns / 1e6 / frames, (double)count * frames / wall_ns * 1e3,
+                    simd_ns / 1e6 / frames, scalar_ns / 1e6 / frames, same_state ? "(same)" : "(DIFFERENT)",
+                    (s.lerp_ns + s.bin_ns + s.draw_ns) / 1e6 / frames, naive_ns / 1e6 / ((frames + 7) / 8),
+                    same_pixels ? "(same)" : "(DIFFERENT)");
+    drmlist_sprites_print_stats(&s);
+
+    drmlist_sprites_cleanup(&s);
+    drmlist_sprites_cleanup(&check);
+}
+
+int bench_sprites(int argc, const char** argv)
+{
+    static const size_t counts[] = { 1000, 10000, 100000, 1000000 };
+    mydrm_fb_t fb, ref;
+    uint32_t frames = argc > 1 ? (uint32_t)atoi(argv[1]) : 120;
+
+    memset(&fb, 0, sizeof(mydrm_fb_t));
+    fb.width = SPRITES_W;
+    fb.height = SPRITES_H;
+    fb.bpp = 32;
+    fb.stride = SPRITES_W * 4;
+    fb.size = fb.stride * SPRITES_H;
+    ref = fb;
+    fb.pixels = bench_alloc(fb.size);
+    ref.pixels = bench_alloc(ref.size);
+
+    printf("%dx%d, %d steps per frame, sprites %d-%d px, %d px tiles\n", SPRITES_W, SPRITES_H, SPRITES_STEPS,
+                    DRMLIST_SPRITES_MIN_SIZE, DRMLIST_SPRITES_MAX_SIZE, DRMLIST_SPRITES_TILE);
+
+    if (argc > 0)
+        bench_sprites_run(strtoull(argv[0], NULL, 10), frames, &fb, &ref);
+    else
+        for (size_t i = 0; i < sizeof(counts) / sizeof(counts[0]); i++)
+            bench_sprites_run(counts[i], counts[i] >= 1000000 ? 16 : frames, &fb, &ref);
+
+    free(fb.pixels);
+    free(ref.pixels);
+
+    return 0;
+}
@@ -0,0 +1,57 @@
+/*
+ * Trace marker overhead: ns per scope with tracing off and on, and what ten
+ * scopes per frame cost at 60Hz
+ */
+
+#include "bench.h"
+#include "drmlist_trace.h"
+
+#define TRACE_BATCH 4096            // half a ring, so the flusher keeps up
+#define TRACE_BATCHES 64
+#define TRACE_SCOPES_PER_FRAME 10
+
+static volatile uint64_t sink;
+
+static double bench_trace_batches(void)
+{
+    struct timespec pause = { 0, (DRMLIST_TRACE_FLUSH_MS + 5) * 1000000l };
+    uint64_t total = 0;
+
+    for (int b = 0; b < TRACE_BATCHES; b++)
+    {
+        uint64_t start = bench_now_ns();
+
+        for (int i = 0; i < TRACE_BATCH; i++)
+        {
+            DRMLIST_TRACE_SCOPE("bench");
+            sink += i;
+        }
+
+        total += bench_now_ns() - start;
+
+        if (drmlist_trace_enabled)
+            nanosleep(&pause, NULL);
+    }
+
+    return (double)total / (TRACE_BATCHES * TRACE_BATCH);
+}
+
+int bench_trace(int argc, const char** argv)
+{
+    const char* path = argc > 0 ? argv[0] : "/dev/null";
+    double off, on;
+
+    off = bench_trace_batches();
+
+    if (drmlist_trace_init(path))
+        return 1;
+
+    on = bench_trace_batches();
+    drmlist_trace_cleanup();
+
+    printf("%-12s %10s %20s\n", "", "ns/scope", "% of a 60Hz frame");
+    printf("%-12s %10.1f %20.4f\n", "tracing off", off, off * TRACE_SCOPES_PER_FRAME * 100.0 / 16.667e6);
+    printf("%-12s %10.1f %20.4f\n", "tracing on", on, on * TRACE_SCOPES_PER_FRAME * 100.0 / 16.667e6);
+
+    return 0;
+}
@@ -0,0 +1,95 @@
+/*
+ * VRR present policy on a simulated 48-144 Hz panel: frame costs just under,
+ * just over the refresh interval and below the panel's range, flipped when
+ * ready with and without low framerate compensation. The panel refreshes on
+ * its own when nothing was flipped for its longest frame, a flip landing
+ * during a refresh waits for it to finish.
+ */
+
+#include "bench.h"
+#include "drmlist_vrr.h"
+
+#define VRR_FRAMES 20000
+#define VRR_MIN_HZ 48
+#define VRR_MAX_HZ 144
+
+typedef struct
+{
+    const char* name;
+    uint32_t cost_min_us;
+    uint32_t cost_max_us;
+} bench_vrr_case_t;
+
+static void bench_vrr_run(const bench_vrr_case_t* c, bool lfc, uint32_t seed)
+{
+    drmlist_vrr_t v;
+    uint64_t refresh_ns = 1000000000ull / VRR_MAX_HZ;
+    uint64_t last_refresh = 0, frame_start = 0, self_refreshes = 0;
+    uint32_t r[VRR_FRAMES];
+
+    bench_fill_random(r, sizeof(r), seed);
+
+    drmlist_vrr_init(&v, VRR_MIN_HZ, VRR_MAX_HZ, refresh_ns);
+    v.enabled = true;
+
+    for (uint32_t f = 0; f < VRR_FRAMES; f++)
+    {
+        uint64_t cost = (c->cost_min_us + r[f] % (c->cost_max_us - c->cost_min_us + 1)) * 1000ull;
+        uint64_t ready = frame_start + cost;
+        uint64_t flip;
+
+        /* Repeats and panel self refreshes while the frame renders */
+        for (;;)
+        {
+            uint64_t repeat_at = lfc ? drmlist_vrr_repeat_at(&v) : 0;
+            uint64_t timeout = last_refresh + v.max_ns;
+
+            if (repeat_at && repeat_at <= timeout && repeat_at < ready)
+            {
+                flip = repeat_at > last_refresh + v.min_ns ? repeat_at : last_refresh + v.min_ns;
+                drmlist_vrr_present(&v, flip, true);
+                last_refresh = flip;
+            }
+            else if (timeout < ready)
+            {
+                last_refresh = timeout;
+                self_refreshes++;
+            }
+            else
+            {
+                break;
+            }
+        }
+
+        drmlist_vrr_frame_ready(&v, ready);
+        flip = ready > last_refresh + v.min_ns ? ready : last_refresh + v.min_ns;
+        drmlist_vrr_present(&v, flip, false);
+        last_refresh = frame_start = flip;
+    }
+
+    printf("%s, %s, %lu panel self refreshes\n", c->name, lfc ? "LFC" : "no LFC", self_refreshes);
+    drmlist_vrr_print_stats(&v);
+}
+
+int bench_vrr(int argc, const char** argv)
+{
+    static const bench_vrr_case_t cases[] = {
+        { "5.5-6.5 ms (over 144 Hz, capped)", 5500,  6500 },
+        { "7-8 ms (in range, near 144 Hz)",   7000,  8000 },
+        { "11-15 ms (70-90 fps)",             11000, 15000 },
+        { "25-30 ms (below 48 Hz)",           25000, 30000 },
+        { "40-45 ms (below 24 Hz)",           40000, 45000 },
+    };
+
+    printf("%d frames on a %d-%d Hz panel\n\n", VRR_FRAMES, VRR_MIN_HZ, VRR_MAX_HZ);
+
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+    {
+        bench_vrr_run(&cases[i], true, 42 + i);
+        if (cases[i].cost_min_us * 1000ull > 1000000000ull / VRR_MIN_HZ * DRMLIST_VRR_LFC_MARGIN_PERCENT / 100)
+            bench_vrr_run(&cases[i], false, 42 + i);
+        printf("\n");
+    }
+
+    return 0;
+}
@@ -1,6 +1,31 @@
 #include "drmlist.h"
 #include <immintrin.h>
 #include "drmlist_draw_box.h"
+#include "drmlist_ingest.h"
+#include "drmlist_capture.h"
+#include "drmlist_loop.h"
+#include "drmlist_clock.h"
+#include "drmlist_anim.h"
+#include "drmlist_fbpool.h"
+#include "drmlist_trace.h"
+#include "drmlist_stats.h"
+#include "drmlist_text.h"
+#include "drmlist_image.h"
+#include "drmlist_scale.h"
+#include "drmlist_damage.h"
+#include "drmlist_mem.h"
+#include "drmlist_vrr.h"
+#include "drmlist_input.h"
+#include "drmlist_sprites.h"
+#include "drmlist_cpu.h"
+#include "drmlist_kernels.h"
+#include "drmlist_idle.h"
+#include "drmlist_hash.h"
+#include "drmlist_pattern.h"
+#include "drmlist_color.h"
+#include <signal.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
 
 static int hres = -1;
 static int vres = -1;
@@ -10,7 +35,97 @@ static const char* drm_path = NULL;
 static const char* connector_str = NULL;
 
 static mydrm_data_t* data = NULL;
-static struct drm_mode_card_res* res = NULL;
+/* Two arenas, a pass goes into the spare one so a failed probe keeps the last snapshot */
+static mydrm_arena_t query_arenas[2];
+static mydrm_arena_t* query_arena = &query_arenas[0];   // the current snapshot's
+static struct drm_mode_card_res* res = NULL;           // from query_arena
+static struct drm_mode_get_connector* conns = NULL;    // from query_arena, res->count_connectors
+static uint64_t pass_heap_allocs = 0;
+static mydrm_props_t props;                            // from query_arena, rebuilt with every pass
+
+/* Mode switching */
+static drmlist_fbpool_t fbpool;
+static uint32_t connector_id = 0;
+static struct drm_mode_modeinfo current_mode;
+static struct drm_mode_modeinfo switch_mode;
+static bool switch_pending = false;
+static uint64_t switch_start_ns = 0;
+static drmlist_ingest_t* ingest = NULL;
+static drmlist_capture_t* capture = NULL;
+static drmlist_hash_t* frame_hash = NULL;
+
+/* Test pattern in place of the scene, from the command line or "pattern" */
+static drmlist_pattern_t pattern;
+static int pattern_kind = DRMLIST_PATTERN_NONE;
+
+/* Colour management on the CRTC's LUTs, restored at cleanup */
+static drmlist_color_t color;
+static uint64_t frame_seq = 0;
+static int signal_fd = -1;
+static drmlist_stats_t stats;
+
+/* HUD */
+static drmlist_text_t hud_text;
+static bool hud_enabled = false;
+static char hud_str[DRMLIST_TEXT_MAX_LEN];
+static uint64_t hud_updated_ns = 0;
+
+/* Background and splash images, decoded once per mode */
+static drmlist_image_cache_t background;
+static drmlist_image_cache_t splash;
+static uint64_t splash_until_ns = 0;
+
+/* What drmlist_render() drew over the background this frame: box, HUD, cursor */
+static struct drm_clip_rect frame_rects[3];
+static uint32_t n_frame_rects = 0;
+static bool frame_full = false;
+
+/* DIRTYFB flushing: scanout stays on framebuffer[0], frames are rendered into
+ * framebuffer[1] and only the damage is copied over and flushed */
+static bool dirtyfb = false;
+static drmlist_damage_t damage;
+static struct drm_clip_rect prev_rects[3];
+static uint32_t n_prev_rects = 0;
+static bool damage_full_next = true;
+static int flush_timer_fd = -1;
+static uint32_t flush_sequence = 0;
+
+/* Startup cost, reported on the first flip and after DRMLIST_STARTUP_FRAMES */
+static const char* fb_map_str = DRMLIST_FB_MAP_DEFAULT;
+static uint64_t startup_ns = 0;
+static uint64_t startup_faults = 0;
+static uint64_t first_flip_faults = 0;
+static uint32_t startup_flips = 0;
+
+/* Variable refresh: frames are flipped as soon as they're ready. The present
+ * timer holds back frames with a simulated cost (DRMLIST_FRAME_COST_US) and
+ * re-presents the front buffer for low framerate compensation. */
+static drmlist_vrr_t vrr;
+static uint32_t vrr_prop_id = 0;        // VRR_ENABLED, 0 unless we set it
+static int present_timer_fd = -1;
+static uint64_t frame_cost_min_ns = 0;
+static uint64_t frame_cost_max_ns = 0;
+static uint64_t render_start_ns = 0;
+static uint64_t frame_ready_ns = 0;
+static bool frame_waiting = false;      // rendered into the back buffer, not flipped yet
+static bool repeat_pending = false;     // the pending flip re-presents the front buffer
+
+/* Mouse packets recorded to / replayed from a log, the replay pipe stands in for /dev/input/mice */
+static drmlist_input_recorder_t input_rec;
+static drmlist_input_replay_t input_replay;
+static bool replay_done = false;
+
+static drmlist_clock_t anim_clock;
+static drmlist_anim_t anim;
+static drmlist_sprites_t sprites;       // DRMLIST_SPRITES stress mode, count 0 when off
+static bool running = false;
+
+/* DRMLIST_ON_DEMAND, frames only when something changed */
+static drmlist_idle_t idle;
+static bool frame_requested = false;    // a change not rendered yet
+static bool anim_paused = false;
+static drmlist_loop_t* main_loop = NULL;
+static uint64_t run_start_ns = 0;
 
 struct drm_mode_crtc saved_crtc;
 
@@ -53,14 +168,112 @@ static void print_drm_info(int fd)
     free(version);
 }
 
+/*
+ * One enumeration pass, resources and every connector (props, modes, encoders)
+ * all come from the spare query arena. Only a complete pass replaces `res`,
+ * `conns` and `props`, which stay valid until the pass after next.
+ */
+static int drmlist_enumerate(int fd)
+{
+    mydrm_arena_t* arena = query_arena == &query_arenas[0] ? &query_arenas[1] : &query_arenas[0];
+    uint64_t heap_allocs = arena->heap_allocs;
+    struct drm_mode_card_res* new_res;
+    struct drm_mode_get_connector* new_conns = NULL;
+    mydrm_props_t new_props = props;
+    uint32_t* connectors;
+    int ret;
+
+    mydrm_arena_reset(arena);
+
+    if ((new_res = mydrm_arena_alloc(arena, sizeof(struct drm_mode_card_res))) == NULL)
+        return -ENOMEM;
+
+    if ((ret = mydrm_get_res(fd, new_res, arena)))
+        return ret;
+
+    if (new_res->count_connectors &&
+        (new_conns = mydrm_arena_alloc(arena, new_res->count_connectors * sizeof(struct drm_mode_get_connector))) == NULL)
+        return -ENOMEM;
+
+    connectors = (uint32_t*)new_res->connector_id_ptr;
+    for (size_t i = 0; i < new_res->count_connectors; i++)
+        if ((ret = mydrm_get_connector(fd, connectors[i], &new_conns[i], arena)))
+            return ret;
+
+    if ((ret = mydrm_props_build(fd, &new_props, new_res, new_conns, arena)))
+        return ret;
+
+    res = new_res;
+    conns = new_conns;
+    props = new_props;
+    query_arena = arena;
+    pass_heap_allocs = arena->heap_allocs - heap_allocs;
+
+    return 0;
+}
+
+static void drmlist_print_props(void)
+{
+    printf("Properties: %u objects, %u connector/%u crtc/%u plane names, %lu ioctls (generation %lu)\n",
+                    props.n_objs, props.types[MYDRM_PROP_TYPE_CONNECTOR].n_names, props.types[MYDRM_PROP_TYPE_CRTC].n_names,
+                    props.types[MYDRM_PROP_TYPE_PLANE].n_names, props.ioctls, props.generation);
+}
+
+static void drmlist_print_arena_stats(void)
+{
+    printf("Query arena: %zu bytes used, high-water %zu, block %zu, %lu heap allocations (%lu last pass, %lu passes)\n",
+                    query_arena->pass_used, query_arena->high_water, query_arena->size,
+                    query_arena->heap_allocs, pass_heap_allocs, query_arena->passes);
+}
+
+/*
+ * SIGUSR1 dumps the ioctl stats. Blocked before any thread is started and
+ * read through a signalfd in the event loop, so the dump never runs in a
+ * signal handler.
+ */
+static int drmlist_init_signals(void)
+{
+    sigset_t mask;
+
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGUSR1);
+
+    if (sigprocmask(SIG_BLOCK, &mask, NULL) == -1)
+    {
+        perror("sigprocmask");
+        return -1;
+    }
+
+    if ((signal_fd = signalfd(-1, &mask, SFD_CLOEXEC)) == -1)
+    {
+        perror("signalfd");
+        return -1;
+    }
+
+    return 0;
+}
+
 int drmlist_init(int argc, const char** argv)
 {
     int fd;
     int ret;
+    const char* trace_path;
     char* cursor_size_str;
     char* no_hw_cursor_str;
     char mode_str[64];
 
+    startup_ns = drmlist_clock_now(&anim_clock);
+    startup_faults = drmlist_mem_faults();
+
+    if ((ret = drmlist_cpu_init(getenv(ENV_DRMLIST_CPU))) < 0)
+        return ret;
+
+    if ((ret = drmlist_init_signals()))
+        return ret;
+
+    if ((trace_path = getenv(ENV_DRMLIST_TRACE)) && (ret = drmlist_trace_init(trace_path)))
+        return ret;
+
     drm_path = getenv(ENV_DRMLIST_DRM_PATH);
     if (!drm_path)
         drm_path = DRMLIST_DRM_DEFAULT;
@@ -81,7 +294,7 @@ int drmlist_init(int argc, const char** argv)
 
     print_drm_info(fd);
 
-    if (argc == 3)
+    if (argc == 3 || argc == 4)
     {
         connector_str = argv[1];
         strncpy(mode_str, argv[2], 64);
@@ -108,20 +321,29 @@ int drmlist_init(int argc, const char** argv)
 
         printf("Mode: %dx%d @ %dHz\n", hres, vres, hrz);
 
+        if (argc == 4 && (pattern_kind = drmlist_pattern_find(argv[3])) == -1)
+        {
+            printf("Invalid pattern: '%s' (%s)\n", argv[3], drmlist_pattern_names());
+            return -1;
+        }
+
         if ((ret = mydrm_set_master(fd)) == -1)
             perror("Set Master");
         else
             is_master = true;
     }
 
-    if ((res = malloc(sizeof(struct drm_mode_card_res))) == NULL)
-        return -ENOMEM;
+    if ((ret = mydrm_arena_init(&query_arenas[0], MYDRM_ARENA_DEFAULT_SIZE)) ||
+        (ret = mydrm_arena_init(&query_arenas[1], MYDRM_ARENA_DEFAULT_SIZE)))
+        return ret;
 
-    if ((ret = mydrm_get_res(fd, res)))
+    if ((ret = drmlist_enumerate(fd)))
     {
-        perror("Failed to get res");
+        perror("Failed to enumerate connectors");
         return ret;
     }
+    drmlist_print_props();
+    drmlist_print_arena_stats();
 
     if ((data = malloc(sizeof(mydrm_data_t))) == NULL)
         return -ENOMEM;
@@ -164,7 +386,16 @@ static bool drmlist_print_connector(int i, uint32_t* connectors, struct drm_mode
     switch (conn->connection)
     {
         case DRM_MODE_CONNECTED:
+        {
+            uint64_t dpms, vrr_capable;
+
+            if (mydrm_props_value(&props, MYDRM_PROP_TYPE_CONNECTOR, connectors[i], "DPMS", &dpms))
+                printf("\tDPMS: %lu", dpms);
+            if (mydrm_props_value(&props, MYDRM_PROP_TYPE_CONNECTOR, connectors[i], "vrr_capable", &vrr_capable))
+                printf("\tvrr_capable: %lu", vrr_capable);
+            printf("\n");
             return true;
+        }
         case DRM_MODE_DISCONNECTED:
             printf("\tDisconnected\n");
             break;
@@ -197,23 +428,22 @@ static struct drm_mode_modeinfo* drmlist_print_modes_and_get(const char* conn_st
 
 static bool drmlist_create_fbs(struct drm_mode_modeinfo* mode)
 {
-    data->framebuffer[0].width = mode->hdisplay;
-    data->framebuffer[0].height = mode->vdisplay;
+    mydrm_fb_t* fbs[2];
 
-    data->framebuffer[1].width = mode->hdisplay;
-    data->framebuffer[1].height = mode->vdisplay;
-
-    if (!mydrm_create_framebuffer(data->fd, &data->framebuffer[0]))
+    for (int i = 0; i < 2; i++)
     {
-        fprintf(stderr, "Failed to create framebuffer[0]\n");
-        return false;
+        if ((fbs[i] = drmlist_fbpool_acquire(&fbpool, mode->hdisplay, mode->vdisplay, DRM_FORMAT_XRGB8888)) == NULL)
+        {
+            fprintf(stderr, "Failed to create framebuffer[%d]\n", i);
+            if (i)
+                drmlist_fbpool_release(&fbpool, fbs[0]->fb);
+            return false;
+        }
     }
 
-    if (!mydrm_create_framebuffer(data->fd, &data->framebuffer[1]))
-    {
-        fprintf(stderr, "Failed to create framebuffer[1]\n");
-        return false;
-    }
+    /* Only copies, the pool owns the buffers (the asm box drawer relies on this layout) */
+    data->framebuffer[0] = *fbs[0];
+    data->framebuffer[1] = *fbs[1];
 
     printf("FrameBuffer created with size: %d bytes\n", data->framebuffer[0].size);
 
@@ -271,35 +501,31 @@ static void drmlist_mv_sw_cursor(mydrm_data_t* data, mydrm_fb_t* fb)
     mouse_t* mouse = data->mouse;
     int start_x = mouse->x;
     int start_y = mouse->y;
+    uint32_t color = mouse->color;
 
-    // draw cursor
-    for (int x = 0; x < mouse->size; x++)
-    {
-        for (int y = 0; y < mouse->size; y++)
-        {
-            int pos = (start_x + x) + ((start_y + y) * data->width);
+    if (mouse->left_down)
+        color |= 0x00FF0000;
 
-            if (pos * 4 >= fb->size)
-                 break; // dont draw past the end buffer
+    if (mouse->right_down)
+        color |= 0x0000FF00;
 
-            uint32_t color = mouse->color;
+    // draw cursor, clipped to the buffer
+    int width = start_x + mouse->size > (int)fb->width ? (int)fb->width - start_x : mouse->size;
+    int height = start_y + mouse->size > (int)fb->height ? (int)fb->height - start_y : mouse->size;
+    uint8_t* dst = fb->pixels + (size_t)start_y * fb->stride + (size_t)start_x * 4;
 
+    if (width <= 0 || height <= 0)
+        return;
 
-            if (mouse->left_down)
-                color |= 0x00FF0000;
-            
-            if (mouse->right_down)
-                color |= 0x0000FF00;
-            
-            fb->pixels[pos] = color;
-        }
-    }
+    drmlist_kernels.fill(dst, fb->stride, width, height, color);
 }
 
 static int drmlist_mouse_init(struct drm_mode_modeinfo* mode)
 {
     int ret = 0;
     mouse_t* mouse = data->mouse;
+    const char* replay_path;
+    const char* replay_mode;
 
     // Begin the mouse at the middle of the screen
     mouse->x = (mode->hdisplay / 2) - mouse->size;
@@ -310,7 +536,19 @@ static int drmlist_mouse_init(struct drm_mode_modeinfo* mode)
 
     mouse->color = 0xFF0000FF;
 
-    if ((mouse->fd = open("/dev/input/mice", O_RDONLY)) == -1)
+    if ((replay_path = getenv(ENV_DRMLIST_INPUT_REPLAY)))
+    {
+        bool fast = (replay_mode = getenv(ENV_DRMLIST_INPUT_REPLAY_MODE)) && !strcmp(replay_mode, "fast");
+
+        if (drmlist_input_replay_open(&input_replay, replay_path, fast))
+        {
+            perror("FAILED to open input replay");
+            return -1;
+        }
+        mouse->fd = input_replay.read_fd;
+        printf("Replaying %zu input packets from %s (%s)\n", input_replay.n_packets, replay_path, fast ? "fast" : "realtime");
+    }
+    else if ((mouse->fd = open("/dev/input/mice", O_RDONLY)) == -1)
     {
         perror("FAILED to open /dev/input/mice");
         return -1;
@@ -387,277 +625,1674 @@ static int drmlist_set_crtc(mydrm_data_t* data, struct drm_mode_crtc* crtc, stru
     return 0;
 }
 
-static int drmlist_init_mode(struct drm_mode_get_connector* conn, struct drm_mode_modeinfo* mode)
+static int drmlist_init_ingest(void)
 {
-    struct drm_mode_get_encoder enc;
-    struct drm_mode_crtc crtc;
-    int ret;
+    const char* path;
+    const char* n_buffers_str;
+    int n_buffers = DRMLIST_INGEST_DEFAULT_BUFFERS;
 
-    if ((ret = drmlist_get_encoder(conn, &enc))) 
-        return ret;
+    if ((path = getenv(ENV_DRMLIST_INGEST)) == NULL)
+        return 0;
 
-    if (!drmlist_create_fbs(mode))
-        return -1;
+    if ((n_buffers_str = getenv(ENV_DRMLIST_INGEST_BUFFERS)))
+        n_buffers = atoi(n_buffers_str);
 
-    if ((ret = drmlist_mouse_init(mode)))
-        return ret;
+    if ((ingest = malloc(sizeof(drmlist_ingest_t))) == NULL)
+        return -ENOMEM;
 
-    if ((ret = drmlist_save_crtc(&enc)))
-        return ret;
+    return drmlist_ingest_init(ingest, data, path, n_buffers);
+}
 
-    /* Set Mode */
-    if ((ret = drmlist_set_crtc(data, &crtc, &enc, mode, conn)) == -1)
-        return ret;
+static int drmlist_init_capture(struct drm_mode_modeinfo* mode)
+{
+    const char* dir;
+    const char* format_str;
+    const char* n_buffers_str;
+    uint32_t format = DRMLIST_CAPTURE_Y4M;
+    int n_buffers = DRMLIST_CAPTURE_DEFAULT_BUFFERS;
 
-    return ret;
+    if ((dir = getenv(ENV_DRMLIST_CAPTURE_DIR)) == NULL)
+        dir = ".";
+
+    if ((format_str = getenv(ENV_DRMLIST_RECORD_FORMAT)) && !strcmp(format_str, "raw"))
+        format = DRMLIST_CAPTURE_RAW;
+
+    if ((n_buffers_str = getenv(ENV_DRMLIST_CAPTURE_BUFFERS)))
+        n_buffers = atoi(n_buffers_str);
+
+    if (!capture && (capture = malloc(sizeof(drmlist_capture_t))) == NULL)
+        return -ENOMEM;
+
+    return drmlist_capture_init(capture, &data->framebuffer[0], mode->vrefresh, dir, format, n_buffers);
 }
 
-static int drmlist_init_epoll(int* epfd, struct epoll_event* event)
+static int drmlist_init_hash(void)
 {
-    if ((*epfd = epoll_create1(0)) == -1)
-    {
-        perror("FAILED epoll_create1");
-        return -1;
-    }
+    const char* path;
+    const char* tile_str;
+    uint32_t tile = DRMLIST_HASH_DEFAULT_TILE;
+
+    if ((path = getenv(ENV_DRMLIST_HASH)) == NULL)
+        return 0;
 
-    event->events = EPOLLIN;
-    event->data.fd = 0;     // stdin
-    if (epoll_ctl(*epfd, EPOLL_CTL_ADD, 0, event) == -1)
+    if (ingest)
     {
-        perror("FAILED EPOLL_CTL_ADD 0");
-        return -1;
+        fprintf(stderr, "Frame hashes aren't supported while ingesting, the producer owns the buffers\n");
+        return 0;
     }
 
-    event->data.fd = data->fd;
+    if ((tile_str = getenv(ENV_DRMLIST_HASH_TILE)))
+        tile = strtoul(tile_str, NULL, 10);
 
-    if (epoll_ctl(*epfd, EPOLL_CTL_ADD, data->fd, event) == -1)
-    {
-        perror("FAILED EPOLL_CTL_ADD data->fd");
-        return -1;
-    }
+    if ((frame_hash = malloc(sizeof(drmlist_hash_t))) == NULL)
+        return -ENOMEM;
+
+    return drmlist_hash_init(frame_hash, path, tile);
+}
 
-    event->data.fd = data->mouse->fd;
+/*
+ * Finds the CRTC's colour properties (or its gamma ramp) for "color", then
+ * DRMLIST_COLOR_FILE and DRMLIST_COLOR. DRMLIST_COLOR is the only thing
+ * layered, its keys override the file's. Without either nothing is set.
+ */
+static void drmlist_init_color(void)
+{
+    const char* path = getenv(ENV_DRMLIST_COLOR_FILE);
+    const char* str = getenv(ENV_DRMLIST_COLOR);
+    int ret;
 
-    if (epoll_ctl(*epfd, EPOLL_CTL_ADD, data->mouse->fd, event) == -1)
+    if ((ret = drmlist_color_init(&color, data->fd, data->crt_id, &props, saved_crtc.gamma_size)))
     {
-        perror("FAILED EPOLL_CTL_ADD data->mouse->fd");
-        return -1;
+        if (path || str)
+            fprintf(stderr, "CRTC %u has no colour management: %s\n", data->crt_id, strerror(-ret));
+        return;
     }
 
-    return 0;
+    if ((path && drmlist_color_load(&color.params, path)) || (str && drmlist_color_parse(&color.params, str)))
+        return;
+
+    if ((path || str) && (ret = drmlist_color_apply(&color)) == 0)
+        drmlist_color_print(&color);
 }
 
-static bool go_right = true;
-static size_t start_x = 0;
-static const size_t start_y = 0; 
-static const size_t box_width = 32;
-static const size_t box_height = 32;
-static const size_t speed = 5;
+static int drmlist_init_pattern(struct drm_mode_modeinfo* mode)
+{
+    if (pattern_kind != DRMLIST_PATTERN_NONE && ingest)
+    {
+        fprintf(stderr, "Test patterns don't apply while ingesting, the producer provides the frames\n");
+        pattern_kind = DRMLIST_PATTERN_NONE;
+    }
 
+    if (pattern_kind != DRMLIST_PATTERN_NONE)
+        printf("Test pattern: %s\n", drmlist_pattern_name(pattern_kind));
 
-static void drmlist_draw_box_avx2(uint32_t* pixels, mydrm_data_t* data, uint32_t color)
+    return drmlist_pattern_init(&pattern, pattern_kind, mode->hdisplay, mode->vdisplay);
+}
+
+static int drmlist_init_anim(struct drm_mode_modeinfo* mode)
 {
-    const size_t box_height = data->height;
+    uint64_t cap = 0;
+    int ret;
 
-    __m256i color_vec = _mm256_set1_epi32(color);
+    drmlist_clock_init(&anim_clock, DRMLIST_SIM_HZ, drmlist_clock_mode_refresh_ns(mode), false);
+    if (mydrm_get_cap(data->fd, DRM_CAP_TIMESTAMP_MONOTONIC, &cap) == 0 && cap)
+        anim_clock.flip_timestamps = true;
 
-    if (go_right)
-        start_x += speed;
-    else
-        start_x -= speed;
+    if ((ret = drmlist_anim_init(&anim, 1, mode->hdisplay, mode->vdisplay)))
+        return ret;
 
-    if (start_x + box_width >= data->width || start_x <= 0)
-        go_right = !go_right;
+    /* The box, full height, bouncing left and right */
+    drmlist_anim_add(&anim, 0.0f, 0.0f, DRMLIST_BOX_SPEED, 0.0f, DRMLIST_BOX_WIDTH, mode->vdisplay);
 
-    for (size_t y = 0; y < box_height; y++)
+    /* Sprite stress, drawn under the box instead of clearing to the background color */
+    if (getenv(ENV_DRMLIST_SPRITES) && atoi(getenv(ENV_DRMLIST_SPRITES)) > 0)
     {
-        for (size_t x = 0; x < box_width; x += 8)
-        {
-            size_t pos = (x + start_x) + ((y + start_y) * data->width);
+        if ((ret = drmlist_sprites_init(&sprites, atoi(getenv(ENV_DRMLIST_SPRITES)), mode->hdisplay, mode->vdisplay, 1)))
+            return ret;
+        printf("Sprites: %zu\n", sprites.anim.count);
+    }
 
-            __m256i pixels_vec = _mm256_loadu_si256((__m256i*)&pixels[pos]);
+    return 0;
+}
 
-            pixels_vec = _mm256_blendv_epi8(pixels_vec, color_vec, _mm256_set1_epi32(0xFFFFFFFF));
+/*
+ * Live stats page, on unless DRMLIST_STATS=0. Monitoring is optional, so
+ * failing to create the page isn't fatal, the counters are then kept in a
+ * private page for the HUD.
+ */
+static int drmlist_init_stats(struct drm_mode_modeinfo* mode)
+{
+    const char* path = getenv(ENV_DRMLIST_STATS);
 
-            _mm256_storeu_si256((__m256i*)&pixels[pos], pixels_vec);
-        }
+    if (!path || strcmp(path, "0"))
+    {
+        if (drmlist_stats_init(&stats, path, mode) == 0)
+            return 0;
+        fprintf(stderr, "Stats page disabled\n");
     }
+
+    return drmlist_stats_init_private(&stats, mode);
 }
 
-static void drmlist_draw_box(uint32_t* pixels, mydrm_data_t* data, uint32_t color)
+/*
+ * Images are optional, one that fails to load falls back to the plain background
+ */
+static void drmlist_init_images(void)
 {
-    const size_t box_height = data->height;
-
-    if (go_right)
-        start_x += speed;
-    else
-        start_x -= speed;
+    const char* path;
+    const char* ms_str;
+    const char* str;
+    uint64_t ms = DRMLIST_SPLASH_DEFAULT_MS;
+    uint32_t threads = 1;
+    int filter = DRMLIST_SCALE_NONE;
+
+    if ((str = getenv(ENV_DRMLIST_IMAGE_SCALE)) && (filter = drmlist_scale_filter_parse(str)) < 0)
+    {
+        fprintf(stderr, "Unknown %s '%s', images won't be scaled\n", ENV_DRMLIST_IMAGE_SCALE, str);
+        filter = DRMLIST_SCALE_NONE;
+    }
 
-    if (start_x + box_width >= data->width || start_x <= 0)
-        go_right = !go_right;
+    if ((str = getenv(ENV_DRMLIST_SCALE_THREADS)))
+        threads = atoi(str);
 
-    for (size_t y = 0; y < box_height; y++)
+    if ((path = getenv(ENV_DRMLIST_BACKGROUND)))
     {
-        for (size_t x = 0; x < box_width; x++)
-        {
-            size_t pos = (x + start_x) + ((y + start_y) * data->width);
+        drmlist_image_cache_init(&background, path, DRMLIST_BACKGROUND_COLOR);
+        drmlist_image_cache_set_scale(&background, filter, threads);
+    }
 
-            if (pos * 4 >= data->framebuffer[data->front_buf].size)
-                break;
+    if ((path = getenv(ENV_DRMLIST_SPLASH)) && drmlist_image_cache_init(&splash, path, DRMLIST_BACKGROUND_COLOR) == 0)
+    {
+        drmlist_image_cache_set_scale(&splash, filter, threads);
 
-            pixels[pos] = color;
-        }
+        if ((ms_str = getenv(ENV_DRMLIST_SPLASH_MS)))
+            ms = strtoull(ms_str, NULL, 10);
+        splash_until_ns = drmlist_clock_now(&anim_clock) + ms * 1000000ull;
     }
 }
 
-static void drmlist_flip_page(mydrm_data_t* data, mydrm_fb_t* fb)
+static void drmlist_set_flush_timer(struct drm_mode_modeinfo* mode)
 {
-    int ret;
-    struct drm_mode_crtc_page_flip flip;
-    flip.fb_id = fb->fb;
-    flip.crtc_id = data->crt_id; 
-    flip.user_data = (uint64_t)data;
-    flip.flags = DRM_MODE_PAGE_FLIP_EVENT;
-    flip.reserved = 0;
+    uint64_t refresh_ns = drmlist_clock_mode_refresh_ns(mode);
+    struct itimerspec its;
 
-    ret = mydrm_ioctl(data->fd, DRM_IOCTL_MODE_PAGE_FLIP, &flip);
+    its.it_interval.tv_sec = refresh_ns / 1000000000ull;
+    its.it_interval.tv_nsec = refresh_ns % 1000000000ull;
+    its.it_value = its.it_interval;
 
-    if (!ret)
+    if (timerfd_settime(flush_timer_fd, 0, &its, NULL) == -1)
+        perror("timerfd_settime");
+}
+
+/*
+ * DRMLIST_DIRTYFB=1: no page flips, frames are paced by a timer at the mode's
+ * refresh rate and pushed to the display with DIRTYFB. For drivers that
+ * upload on flush (virtio-gpu, udl, gud), where a flip uploads the whole frame.
+ */
+static int drmlist_init_dirtyfb(struct drm_mode_modeinfo* mode)
+{
+    const char* str = getenv(ENV_DRMLIST_DIRTYFB);
+
+    if (!str || !atoi(str))
+        return 0;
+
+    if (ingest)
     {
-        data->pflip_pending = true;
-        data->front_buf ^= 1;
+        fprintf(stderr, "DIRTYFB flushing isn't supported while ingesting, using page flips\n");
+        return 0;
     }
-    else
+
+    /* Drivers without a dirty hook return ENOSYS, their scanout needs no flushing */
+    if (mydrm_dirty_fb(data->fd, data->framebuffer[0].fb, NULL, 0) == -1)
     {
-        perror("FAILED ioctl DRM_IOCTL_MODE_PAGE_FLIP");
+        perror("ioctl DRM_IOCTL_MODE_DIRTYFB, using page flips");
+        return 0;
     }
-}
 
-static void drmlist_draw_data(int fd, mydrm_data_t* data)
-{
-    mydrm_fb_t* fb = &data->framebuffer[data->front_buf ^ 1];
-    uint32_t* pixels = (uint32_t*)fb->pixels;
-    uint32_t box_color = 0xFFFF0000;
+    if ((flush_timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC)) == -1)
+    {
+        perror("timerfd_create");
+        return -1;
+    }
 
-    /* Make all pixels backgroud color */
-    memset(pixels, data->bg_color, fb->size) ;
+    dirtyfb = true;
+    drmlist_set_flush_timer(mode);
+    printf("Flushing damage with DIRTYFB, up to %d rects per frame\n", DRMLIST_DAMAGE_MAX_RECTS);
 
-    /* Update box */
-    if (data->mouse->left_down)
-        box_color |= 0x000000FF;
-    if (data->mouse->right_down)
-        box_color |= 0x0000FF00;
+    return 0;
+}
 
-    drmlist_draw_box_asm(pixels, data, box_color);
-    
-    /* Update cursor */
-    data->mouse->move_cursor_callback(data, fb);
+static int drmlist_init_hud(void)
+{
+    const char* scale_str = getenv(ENV_DRMLIST_HUD);
 
-    /* Flip buffers */
-    drmlist_flip_page(data, fb);
+    hud_enabled = scale_str && atoi(scale_str) > 0;
+
+    return drmlist_text_init(&hud_text, scale_str ? atoi(scale_str) : DRMLIST_HUD_DEFAULT_SCALE);
 }
 
-static void drmlist_page_flip_event(int fd, uint32_t sequence, uint32_t tv_sec, uint32_t tv_usec, void* user_data)
+/*
+ * DRMLIST_FB_MAP: comma separated populate, willneed, prefault, clear
+ */
+static uint32_t drmlist_fb_map_flags(void)
 {
-    data->pflip_pending = false;
+    static const struct { const char* name; uint32_t flag; } names[] = {
+        { "populate", MYDRM_MAP_POPULATE },
+        { "willneed", MYDRM_MAP_WILLNEED },
+        { "prefault", MYDRM_MAP_PREFAULT },
+        { "clear",    MYDRM_MAP_CLEAR },
+    };
+    char buf[64];
+    char* save = NULL;
+    uint32_t flags = 0;
+
+    if (getenv(ENV_DRMLIST_FB_MAP))
+        fb_map_str = getenv(ENV_DRMLIST_FB_MAP);
+
+    strncpy(buf, fb_map_str, sizeof(buf) - 1);
+    buf[sizeof(buf) - 1] = '\0';
+
+    for (char* tok = strtok_r(buf, ",", &save); tok; tok = strtok_r(NULL, ",", &save))
+    {
+        size_t i = 0;
 
-    if (!data->cleanup)
-        drmlist_draw_data(fd, data);
+        while (i < sizeof(names) / sizeof(names[0]) && strcmp(tok, names[i].name))
+            i++;
+
+        if (i < sizeof(names) / sizeof(names[0]))
+            flags |= names[i].flag;
+        else
+            fprintf(stderr, "Unknown %s option '%s'\n", ENV_DRMLIST_FB_MAP, tok);
+    }
+
+    return flags;
 }
 
-static int drmlist_epoll_wait(int epfd, struct epoll_event* events, size_t n_events)
+static void drmlist_startup_flip(void)
 {
-    int ret;
-    if ((ret = epoll_wait(epfd, events, n_events, -1)) == -1)
-        perror("epoll_wait");
-    return ret;
+    if (startup_flips > DRMLIST_STARTUP_FRAMES)
+        return;
+
+    if (startup_flips++ == 0)
+    {
+        first_flip_faults = drmlist_mem_faults();
+        printf("First flip: %.2f ms after start, %lu page faults (framebuffer map: %s)\n",
+                        (drmlist_clock_now(&anim_clock) - startup_ns) / 1e6, first_flip_faults - startup_faults, fb_map_str);
+    }
+    else if (startup_flips == DRMLIST_STARTUP_FRAMES + 1)
+    {
+        printf("Page faults during the first %d frames: %lu\n", DRMLIST_STARTUP_FRAMES,
+                        drmlist_mem_faults() - first_flip_faults);
+    }
 }
 
-static void drmlist_handle_mouse_event(mydrm_data_t* data)
+/*
+ * DRMLIST_VRR_RANGE=<min>-<max>, otherwise the EDID's range limits, otherwise
+ * DRMLIST_VRR_DEFAULT_MIN_HZ up to the mode
+ */
+static void drmlist_vrr_range(struct drm_mode_get_connector* conn, uint32_t* min_hz, uint32_t* max_hz)
 {
-    mouse_t* mouse = data->mouse;
-    char buffer[3];
+    const char* str = getenv(ENV_DRMLIST_VRR_RANGE);
+    uint64_t blob_id = 0;
+    uint32_t len = 0;
+    uint8_t* edid;
 
-    if (read(data->mouse->fd, buffer, 3) == -1)
-        perror("read data->mouse->fd");
+    *min_hz = 0;
+    *max_hz = 0;
 
-    mouse->x += buffer[1];
-    mouse->y -= buffer[2];
-    mouse->left_down = buffer[0] & 1;
-    mouse->right_down = buffer[0] & 2;
+    if (str && sscanf(str, "%u-%u", min_hz, max_hz) == 2 && *min_hz && *max_hz > *min_hz)
+        return;
+    *min_hz = 0;
+    *max_hz = 0;
 
-    if (mouse->x > mouse->max_x - 1)
-        mouse->x = mouse->max_x - 1;
-    else if (mouse->x < 0)
-        mouse->x = 0;
+    if (!mydrm_props_value(&props, MYDRM_PROP_TYPE_CONNECTOR, conn->connector_id, "EDID", &blob_id) || !blob_id ||
+        mydrm_get_blob(data->fd, blob_id, NULL, &len) || !len || (edid = malloc(len)) == NULL)
+        return;
 
-    if (mouse->y > mouse->max_y - 1)
-        mouse->y = mouse->max_y - 1;
-    else if (mouse->y < 0)
-        mouse->y = 0;
+    if (mydrm_get_blob(data->fd, blob_id, edid, &len) || !drmlist_vrr_parse_edid(edid, len, min_hz, max_hz))
+    {
+        *min_hz = 0;
+        *max_hz = 0;
+    }
 
-    mouse->moved = true;
+    free(edid);
 }
 
-static int drmlist_mainloop(mydrm_data_t* data)
+static void drmlist_arm_present_timer(void)
 {
-    bool running = true;
-    int ret;
-    int epfd; // epoll fd
-    int nfds;
-    struct epoll_event event; 
-    struct epoll_event events[3];
-    mydrm_event_context_t ev;
+    uint64_t deadline = frame_waiting ? frame_ready_ns : 0;
+    uint64_t repeat_at = idle.idle ? 0 : drmlist_vrr_repeat_at(&vrr);
+    struct itimerspec its;
 
-    if ((ret = drmlist_init_epoll(&epfd, &event)))
-        return ret;
+    if (repeat_at && (!deadline || repeat_at < deadline))
+        deadline = repeat_at;
 
-    memset(&ev, 0, sizeof(mydrm_event_context_t));
-    ev.version = 2;
-    ev.page_flip_handler = drmlist_page_flip_event;
+    /* Zero disarms, a deadline in the past fires right away */
+    memset(&its, 0, sizeof(struct itimerspec));
+    its.it_value.tv_sec = deadline / 1000000000ull;
+    its.it_value.tv_nsec = deadline % 1000000000ull;
 
-    drmlist_draw_data(data->fd, data);
+    if (timerfd_settime(present_timer_fd, TFD_TIMER_ABSTIME, &its, NULL) == -1)
+        perror("timerfd_settime");
+}
 
-    while (running)
+/*
+ * DRMLIST_VRR=1: set VRR_ENABLED on the CRTC if the connector is vrr_capable.
+ * Pacing is reported either way, against what fixed-rate vsync would do.
+ */
+static int drmlist_init_vrr(struct drm_mode_get_connector* conn, struct drm_mode_modeinfo* mode)
+{
+    const char* str;
+    uint64_t capable = 0;
+    uint32_t min_hz, max_hz, cost_min = 0, cost_max = 0;
+    uint32_t prop_id;
+
+    if ((str = getenv(ENV_DRMLIST_FRAME_COST)) && !ingest && !dirtyfb)
     {
-        if ((nfds = drmlist_epoll_wait(epfd, events, 3)) == -1)
-            return -1;
+        int n = sscanf(str, "%u-%u", &cost_min, &cost_max);
 
-        for (int i = 0; i < nfds; i++)
+        if (n == 1)
+            cost_max = cost_min;
+        if (n < 1 || cost_max < cost_min)
+            fprintf(stderr, "%s: <us>[-<us>], not simulating a frame cost\n", ENV_DRMLIST_FRAME_COST);
+        else
         {
-            int ready_fd = events[i].data.fd;
+            frame_cost_min_ns = cost_min * 1000ull;
+            frame_cost_max_ns = cost_max * 1000ull;
+        }
+    }
 
+    drmlist_vrr_range(conn, &min_hz, &max_hz);
+    drmlist_vrr_init(&vrr, min_hz, max_hz, drmlist_clock_mode_refresh_ns(mode));
 
-            if (ready_fd == 0)
-                running = false;
-            else if (ready_fd == data->fd)
-                mydrm_handle_event(data->fd, &ev);
-            else if (ready_fd == data->mouse->fd)
-                drmlist_handle_mouse_event(data);
+    if ((str = getenv(ENV_DRMLIST_VRR)) && atoi(str))
+    {
+        if (ingest || dirtyfb)
+            fprintf(stderr, "VRR needs page flips of our own frames, presenting at the fixed rate\n");
+        else if (!mydrm_props_value(&props, MYDRM_PROP_TYPE_CONNECTOR, conn->connector_id, "vrr_capable", &capable) || !capable)
+            fprintf(stderr, "Connector isn't vrr_capable, presenting at the fixed rate\n");
+        else if (!(prop_id = mydrm_props_id(&props, MYDRM_PROP_TYPE_CRTC, data->crt_id, "VRR_ENABLED")))
+            fprintf(stderr, "CRTC %u has no VRR_ENABLED property, presenting at the fixed rate\n", data->crt_id);
+        else if (mydrm_set_property(data->fd, data->crt_id, DRM_MODE_OBJECT_CRTC, prop_id, 1) == -1)
+            perror("ioctl DRM_IOCTL_MODE_OBJ_SETPROPERTY VRR_ENABLED");
+        else
+        {
+            vrr_prop_id = prop_id;
+            vrr.enabled = true;
         }
     }
 
-    return ret;
-}
-
-int drmlist_run(void)
-{
-    int ret;
-    bool did_set_mode = false;
+    if (vrr.enabled)
+        printf("VRR: %u-%u Hz%s, frames flipped when ready, LFC below %.1f Hz\n", vrr.min_hz,
+                        (uint32_t)(1e9 / vrr.min_ns + 0.5), max_hz ? "" : " (no EDID range)",
+                        1e9 / vrr.max_ns * 100 / DRMLIST_VRR_LFC_MARGIN_PERCENT);
 
-    printf("DRM Connectors: %d\n", res->count_connectors);
+    if (!vrr.enabled && !frame_cost_max_ns)
+        return 0;
 
-    for (size_t i = 0; i < res->count_connectors; i++)
+    if ((present_timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC)) == -1)
     {
-        struct drm_mode_get_connector conn;
-        struct drm_mode_modeinfo* mode = NULL;
-        uint32_t* connectors = (uint32_t*)res->connector_id_ptr;
-        const char* conn_type;
+        perror("timerfd_create");
+        return -1;
+    }
 
-        if ((ret = mydrm_get_connector(data->fd, connectors[i], &conn)))
-            return ret;
+    if (frame_cost_max_ns)
+        printf("Simulated frame cost: %.2f-%.2f ms\n", frame_cost_min_ns / 1e6, frame_cost_max_ns / 1e6);
 
-        if (drmlist_print_connector(i, connectors, &conn, &conn_type))
+    return 0;
+}
+
+/*
+ * DRMLIST_ON_DEMAND=1: render only when the scene changes, otherwise no flip
+ * is pending and the event loop sleeps. The box bounces for ever, "pause"
+ * stops it for a static scene.
+ */
+static void drmlist_init_idle(void)
+{
+    const char* str = getenv(ENV_DRMLIST_ON_DEMAND);
+    bool enabled = str && atoi(str);
+
+    if (enabled && ingest)
+    {
+        fprintf(stderr, "On-demand rendering doesn't apply while ingesting, the producer paces the frames\n");
+        enabled = false;
+    }
+
+    drmlist_idle_init(&idle, enabled);
+    if (enabled)
+        printf("On-demand rendering, frames only on changes\n");
+}
+
+static int drmlist_init_mode(struct drm_mode_get_connector* conn, struct drm_mode_modeinfo* mode)
+{
+    struct drm_mode_get_encoder enc;
+    struct drm_mode_crtc crtc;
+    const char* budget_str;
+    uint64_t budget = DRMLIST_FBPOOL_DEFAULT_BUDGET_MB;
+    int ret;
+
+    if ((ret = drmlist_get_encoder(conn, &enc))) 
+        return ret;
+
+    if ((budget_str = getenv(ENV_DRMLIST_FB_BUDGET)))
+        budget = strtoull(budget_str, NULL, 10);
+    drmlist_fbpool_init(&fbpool, data->fd, budget << 20, drmlist_fb_map_flags());
+
+    if (!drmlist_create_fbs(mode))
+        return -1;
+
+    printf("Framebuffers (map: %s): %.2f ms, %lu page faults\n", fb_map_str, fbpool.create_ns / 1e6, fbpool.create_faults);
+
+    if ((ret = drmlist_mouse_init(mode)))
+        return ret;
+
+    if ((ret = drmlist_save_crtc(&enc)))
+        return ret;
+
+    /* Set Mode */
+    if ((ret = drmlist_set_crtc(data, &crtc, &enc, mode, conn)) == -1)
+        return ret;
+
+    if ((ret = drmlist_init_ingest()))
+        return ret;
+
+    if ((ret = drmlist_init_capture(mode)))
+        return ret;
+
+    if ((ret = drmlist_init_hash()))
+        return ret;
+
+    drmlist_init_color();
+
+    if ((ret = drmlist_init_anim(mode)))
+        return ret;
+
+    drmlist_init_images();
+
+    if ((ret = drmlist_init_pattern(mode)))
+        return ret;
+
+    if ((ret = drmlist_init_stats(mode)))
+        return ret;
+
+    if ((ret = drmlist_init_hud()))
+        return ret;
+
+    if ((ret = drmlist_init_dirtyfb(mode)))
+        return ret;
+
+    if ((ret = drmlist_init_vrr(conn, mode)))
+        return ret;
+
+    drmlist_init_idle();
+
+    connector_id = conn->connector_id;
+    current_mode = *mode;
+
+    return ret;
+}
+
+static const size_t start_y = 0; 
+static const size_t box_width = DRMLIST_BOX_WIDTH;
+
+
+DRMLIST_TARGET_AVX2 static void drmlist_draw_box_avx2(uint32_t* pixels, mydrm_data_t* data, uint32_t color, size_t start_x)
+{
+    const size_t box_height = data->height;
+
+    __m256i color_vec = _mm256_set1_epi32(color);
+    for (size_t y = 0; y < box_height; y++)
+    {
+        for (size_t x = 0; x < box_width; x += 8)
+        {
+            size_t pos = (x + start_x) + ((y + start_y) * data->width);
+
+            __m256i pixels_vec = _mm256_loadu_si256((__m256i*)&pixels[pos]);
+
+            pixels_vec = _mm256_blendv_epi8(pixels_vec, color_vec, _mm256_set1_epi32(0xFFFFFFFF));
+
+            _mm256_storeu_si256((__m256i*)&pixels[pos], pixels_vec);
+        }
+    }
+}
+
+static void drmlist_draw_box(uint32_t* pixels, mydrm_data_t* data, uint32_t color, size_t start_x)
+{
+    const size_t box_height = data->height;
+
+    for (size_t y = 0; y < box_height; y++)
+    {
+        for (size_t x = 0; x < box_width; x++)
+        {
+            size_t pos = (x + start_x) + ((y + start_y) * data->width);
+
+            if (pos * 4 >= data->framebuffer[data->front_buf].size)
+                break;
+
+            pixels[pos] = color;
+        }
+    }
+}
+
+static void drmlist_flip_page(mydrm_data_t* data, mydrm_fb_t* fb)
+{
+    int ret;
+
+    DRMLIST_TRACE_SCOPE("page_flip ioctl");
+    ret = mydrm_page_flip(data->fd, data->crt_id, fb->fb, DRM_MODE_PAGE_FLIP_EVENT, data);
+
+    if (!ret)
+    {
+        data->pflip_pending = true;
+        data->front_buf ^= 1;
+    }
+    else
+    {
+        perror("FAILED ioctl DRM_IOCTL_MODE_PAGE_FLIP");
+    }
+}
+
+/*
+ * Text only changes every DRMLIST_HUD_INTERVAL_NS, the frames in between are
+ * string cache hits
+ */
+static void drmlist_draw_hud(mydrm_fb_t* fb, struct drm_clip_rect* rect)
+{
+    drmlist_stats_page_t* s = stats.page;
+    uint64_t now = drmlist_clock_now(&anim_clock);
+    uint32_t w, h;
+
+    if (!hud_str[0] || now - hud_updated_ns >= DRMLIST_HUD_INTERVAL_NS)
+    {
+        snprintf(hud_str, sizeof(hud_str), "FPS %.1f  FRAME %.2f MS  MISSED %lu\n%ux%u @ %.2fHZ",
+                        s->fps_milli / 1e3, s->render_ns_avg / 1e6, s->missed_vblanks,
+                        s->width, s->height, s->refresh_mhz / 1e3);
+        hud_updated_ns = now;
+    }
+
+    drmlist_text_draw_cached(&hud_text, fb, NULL, DRMLIST_HUD_MARGIN, DRMLIST_HUD_MARGIN, hud_str, DRMLIST_HUD_FG, DRMLIST_HUD_BG);
+
+    drmlist_text_measure(&hud_text, hud_str, &w, &h);
+    rect->x1 = DRMLIST_HUD_MARGIN;
+    rect->y1 = DRMLIST_HUD_MARGIN;
+    rect->x2 = DRMLIST_HUD_MARGIN + w;
+    rect->y2 = DRMLIST_HUD_MARGIN + h;
+}
+
+static void drmlist_frame_rect(int x, int y, int w, int h)
+{
+    frame_rects[n_frame_rects].x1 = x < 0 ? 0 : x;
+    frame_rects[n_frame_rects].y1 = y < 0 ? 0 : y;
+    frame_rects[n_frame_rects].x2 = x + w;
+    frame_rects[n_frame_rects].y2 = y + h;
+    n_frame_rects++;
+}
+
+static void drmlist_render(mydrm_data_t* data, mydrm_fb_t* fb)
+{
+    uint32_t* pixels = (uint32_t*)fb->pixels;
+    uint32_t box_color = 0xFFFF0000;
+    uint64_t present_ns;
+    uint32_t steps;
+    uint32_t pattern_rects = 0;
+    float box_x, box_y;
+
+    n_frame_rects = 0;
+    frame_full = false;
+
+    /* Step the simulation up to when this frame will be on screen */
+    {
+        DRMLIST_TRACE_SCOPE("simulate");
+        present_ns = drmlist_clock_predict_present(&anim_clock);
+        steps = drmlist_clock_advance(&anim_clock, present_ns);
+        for (uint32_t i = 0; i < steps && !anim_paused; i++)
+        {
+            drmlist_anim_step(&anim, anim_clock.step_ns / 1e9f);
+            if (sprites.anim.count)
+                drmlist_sprites_step(&sprites, anim_clock.step_ns / 1e9f);
+        }
+        drmlist_anim_lerp(&anim, 0, drmlist_clock_alpha(&anim_clock, present_ns), &box_x, &box_y);
+    }
+
+    /* Splash screen replaces the whole frame until it times out */
+    if (splash.image.data)
+    {
+        DRMLIST_TRACE_SCOPE("splash");
+
+        frame_full = true;
+
+        if (drmlist_clock_now(&anim_clock) < splash_until_ns && drmlist_image_cache_blit(&splash, fb) == 0)
+        {
+            drmlist_pattern_invalidate(&pattern, fb);
+            drmlist_capture_frame(capture, fb, frame_seq++);
+            return;
+        }
+        drmlist_image_cache_cleanup(&splash);
+    }
+
+    /* A test pattern replaces the background, sprites and box, only what changed is drawn */
+    if (pattern.kind != DRMLIST_PATTERN_NONE)
+    {
+        struct drm_clip_rect bar;
+
+        DRMLIST_TRACE_SCOPE("pattern");
+        if (drmlist_pattern_draw(&pattern, fb, !anim_paused, &bar))
+            frame_full = true;
+        if (bar.x2 > bar.x1)
+            frame_rects[n_frame_rects++] = bar;
+        pattern_rects = n_frame_rects;
+    }
+    else
+    {
+        /* Make all pixels backgroud color */
+        {
+            DRMLIST_TRACE_SCOPE("clear");
+            if (background.image.data && drmlist_image_cache_blit(&background, fb))
+            {
+                drmlist_image_cache_cleanup(&background);
+                frame_full = true;
+            }
+
+            if (!background.image.data && !sprites.anim.count)
+                drmlist_kernels.clear(pixels, data->bg_color, fb->size / 4);
+        }
+
+        /* Sprites move everywhere, the whole frame is damaged */
+        if (sprites.anim.count)
+        {
+            DRMLIST_TRACE_SCOPE("sprites");
+            drmlist_sprites_draw(&sprites, fb, drmlist_clock_alpha(&anim_clock, present_ns), !background.image.data, data->bg_color);
+            frame_full = true;
+        }
+
+        /* Update box */
+        if (data->mouse->left_down)
+            box_color |= 0x000000FF;
+        if (data->mouse->right_down)
+            box_color |= 0x0000FF00;
+
+        {
+            DRMLIST_TRACE_SCOPE("box");
+            drmlist_draw_box_asm(pixels, data, box_color, (uint64_t)box_x);
+            drmlist_frame_rect(box_x, start_y, box_width, data->height);
+        }
+    }
+
+    if (hud_enabled)
+    {
+        DRMLIST_TRACE_SCOPE("hud");
+        drmlist_draw_hud(fb, &frame_rects[n_frame_rects++]);
+    }
+
+    /* Update cursor */
+    {
+        DRMLIST_TRACE_SCOPE("cursor");
+        data->mouse->move_cursor_callback(data, fb);
+        if (!data->mouse->is_hardware_cursor)
+            drmlist_frame_rect(data->mouse->x, data->mouse->y, data->mouse->size, data->mouse->size);
+    }
+
+    /* Restored from the pattern next time this buffer is drawn */
+    for (uint32_t i = pattern_rects; pattern.kind != DRMLIST_PATTERN_NONE && i < n_frame_rects; i++)
+        drmlist_pattern_drawn_over(&pattern, fb, &frame_rects[i]);
+
+    /* Screenshot/recording, only queues a copy for the writer thread */
+    {
+        DRMLIST_TRACE_SCOPE("capture");
+        drmlist_capture_frame(capture, fb, frame_seq++);
+    }
+}
+
+/*
+ * Copy this and the previous frame's rects (what the front buffer still shows)
+ * from the back buffer and flush them
+ */
+static void drmlist_draw_dirty(mydrm_data_t* data)
+{
+    mydrm_fb_t* front = &data->framebuffer[0];
+    mydrm_fb_t* back = &data->framebuffer[1];
+    uint64_t start = drmlist_clock_now(&anim_clock);
+
+    DRMLIST_TRACE_SCOPE("draw_dirty");
+    drmlist_render(data, back);
+
+    drmlist_damage_reset(&damage, back->width, back->height);
+    if (damage_full_next || frame_full)
+        drmlist_damage_full(&damage);
+
+    for (uint32_t i = 0; i < n_prev_rects; i++)
+        drmlist_damage_add_rect(&damage, &prev_rects[i]);
+    for (uint32_t i = 0; i < n_frame_rects; i++)
+        drmlist_damage_add_rect(&damage, &frame_rects[i]);
+
+    /* No clips would flush everything */
+    if (damage.n)
+    {
+        DRMLIST_TRACE_SCOPE("dirtyfb");
+
+        if (frame_hash)
+            drmlist_hash_wait(frame_hash, front->pixels);
+
+        for (uint32_t i = 0; i < damage.n; i++)
+        {
+            struct drm_clip_rect* r = &damage.rects[i];
+
+            for (uint32_t y = r->y1; y < r->y2; y++)
+                memcpy(front->pixels + (size_t)y * front->stride + r->x1 * 4,
+                       back->pixels + (size_t)y * back->stride + r->x1 * 4, (r->x2 - r->x1) * 4);
+        }
+
+        if (mydrm_dirty_fb(data->fd, front->fb, damage.rects, damage.n) == -1)
+            perror("ioctl DRM_IOCTL_MODE_DIRTYFB");
+    }
+    if (frame_hash)
+        drmlist_hash_frame(frame_hash, front, frame_seq - 1);
+    drmlist_damage_account(&damage, 4);
+
+    memcpy(prev_rects, frame_rects, sizeof(prev_rects));
+    n_prev_rects = n_frame_rects;
+    damage_full_next = false;
+
+    drmlist_stats_render(&stats, drmlist_clock_now(&anim_clock) - start);
+}
+
+/*
+ * Flip the frame in the back buffer
+ */
+static void drmlist_present(mydrm_data_t* data)
+{
+    uint64_t now = drmlist_clock_now(&anim_clock);
+    mydrm_fb_t* fb = &data->framebuffer[data->front_buf ^ 1];
+
+    frame_waiting = false;
+    drmlist_vrr_frame_ready(&vrr, now);
+    drmlist_flip_page(data, fb);
+
+    /* Hashed off the render path, stays untouched until drmlist_draw_data() comes back to it */
+    if (frame_hash)
+        drmlist_hash_frame(frame_hash, fb, frame_seq - 1);
+
+    drmlist_stats_render(&stats, now - render_start_ns);
+}
+
+/*
+ * Re-present the front buffer so the panel doesn't time out and repeat it
+ * on its own just before the next frame is ready
+ */
+static void drmlist_repeat_page(mydrm_data_t* data)
+{
+    DRMLIST_TRACE_SCOPE("repeat flip");
+
+    if (mydrm_page_flip(data->fd, data->crt_id, data->framebuffer[data->front_buf].fb, DRM_MODE_PAGE_FLIP_EVENT, data) == -1)
+    {
+        perror("FAILED ioctl DRM_IOCTL_MODE_PAGE_FLIP (repeat)");
+        return;
+    }
+
+    data->pflip_pending = true;
+    repeat_pending = true;
+}
+
+static void drmlist_draw_data(int fd, mydrm_data_t* data)
+{
+    mydrm_fb_t* fb = &data->framebuffer[data->front_buf ^ 1];
+
+    render_start_ns = drmlist_clock_now(&anim_clock);
+    frame_requested = false;
+    if (idle.idle)
+        drmlist_idle_leave(&idle, render_start_ns, main_loop ? main_loop->wakeups : 0);
+
+    if (dirtyfb)
+    {
+        drmlist_draw_dirty(data);
+        return;
+    }
+
+    DRMLIST_TRACE_SCOPE("draw_data");
+    if (frame_hash)
+        drmlist_hash_wait(frame_hash, fb->pixels);
+    drmlist_render(data, fb);
+
+    /* Like a GPU still busy with the frame, the loop is free until it's done */
+    if (frame_cost_max_ns)
+    {
+        frame_ready_ns = render_start_ns + frame_cost_min_ns;
+        if (frame_cost_max_ns > frame_cost_min_ns)
+            frame_ready_ns += (uint64_t)rand() % (frame_cost_max_ns - frame_cost_min_ns + 1);
+        frame_waiting = true;
+        drmlist_arm_present_timer();
+        return;
+    }
+
+    /* Flip buffers */
+    drmlist_present(data);
+}
+
+/* Anything moving on its own keeps the frames coming */
+static bool drmlist_frame_wanted(void)
+{
+    if (!idle.enabled || frame_requested || splash.image.data)
+        return true;
+
+    if (pattern.kind != DRMLIST_PATTERN_NONE)
+        return !anim_paused && drmlist_pattern_animated(&pattern);
+
+    return !anim_paused && (anim.count || sprites.anim.count);
+}
+
+/*
+ * Nothing changed since the last frame: no flip, flush tick or repeat is
+ * queued, the loop sleeps until the next change
+ */
+static void drmlist_go_idle(void)
+{
+    struct itimerspec its;
+
+    drmlist_idle_enter(&idle, drmlist_clock_now(&anim_clock), main_loop ? main_loop->wakeups : 0);
+    drmlist_stats_idle(&stats);
+    drmlist_trace_instant("idle");
+
+    if (dirtyfb)
+    {
+        memset(&its, 0, sizeof(struct itimerspec));
+        if (timerfd_settime(flush_timer_fd, 0, &its, NULL) == -1)
+            perror("timerfd_settime");
+    }
+
+    if (present_timer_fd != -1)
+        drmlist_arm_present_timer();
+}
+
+/*
+ * Something changed. A frame in flight picks it up when its flip completes,
+ * when idle it's rendered right away and on screen with the next vblank.
+ */
+static void drmlist_request_frame(mydrm_data_t* data)
+{
+    frame_requested = true;
+
+    if (!idle.idle || data->cleanup)
+        return;
+
+    drmlist_draw_data(data->fd, data);
+
+    /* Flushed already, the ticks resume from here */
+    if (dirtyfb)
+    {
+        drmlist_set_flush_timer(&current_mode);
+        drmlist_idle_presented(&idle, drmlist_clock_now(&anim_clock), anim_clock.refresh_ns);
+    }
+}
+
+/*
+ * Switch to `switch_mode`, called with no page flip pending. The first frame is
+ * rendered before SETCRTC, so the modeset itself puts it on screen.
+ */
+/*
+ * `revert_fbs` are the old mode's buffers when switching back after a failed
+ * SETCRTC, they never left the pool's use and are scanned out again as they are
+ */
+static void drmlist_switch_mode_fbs(mydrm_data_t* data, const mydrm_fb_t* revert_fbs)
+{
+    struct drm_mode_modeinfo* mode = &switch_mode;
+    struct drm_mode_crtc crtc;
+    mydrm_fb_t old_fbs[2] = { data->framebuffer[0], data->framebuffer[1] };
+    uint64_t misses = fbpool.misses;
+    uint64_t fbs_ns, done_ns;
+
+    switch_pending = false;
+    damage_full_next = true;
+    frame_waiting = false;
+
+    /* The buffers may go back to the pool or be rendered into */
+    if (frame_hash)
+        drmlist_hash_wait(frame_hash, NULL);
+
+    if (revert_fbs)
+    {
+        data->framebuffer[0] = revert_fbs[0];
+        data->framebuffer[1] = revert_fbs[1];
+    }
+    else if (!drmlist_create_fbs(mode))
+    {
+        /* Keep going in the old mode */
+        drmlist_draw_data(data->fd, data);
+        return;
+    }
+    fbs_ns = drmlist_clock_now(&anim_clock);
+
+    data->width = mode->hdisplay;
+    data->height = mode->vdisplay;
+    data->front_buf = 0;
+
+    data->mouse->max_x = mode->hdisplay;
+    data->mouse->max_y = mode->vdisplay;
+    if (data->mouse->x > data->mouse->max_x - 1)
+        data->mouse->x = data->mouse->max_x - 1;
+    if (data->mouse->y > data->mouse->max_y - 1)
+        data->mouse->y = data->mouse->max_y - 1;
+
+    anim.max_x = mode->hdisplay;
+    anim.max_y = mode->vdisplay;
+    anim.h[0] = mode->vdisplay;
+    if (anim.x[0] + anim.w[0] > anim.max_x)
+        anim.x[0] = anim.prev_x[0] = anim.max_x - anim.w[0];
+
+    if (sprites.anim.count && drmlist_sprites_resize(&sprites, mode->hdisplay, mode->vdisplay))
+        drmlist_sprites_cleanup(&sprites);
+
+    if (drmlist_pattern_resize(&pattern, mode->hdisplay, mode->vdisplay))
+    {
+        fprintf(stderr, "Test pattern disabled after mode switch\n");
+        drmlist_pattern_set(&pattern, DRMLIST_PATTERN_NONE);
+    }
+
+    anim_clock.refresh_ns = drmlist_clock_mode_refresh_ns(mode);
+    anim_clock.last_flip_ns = 0;
+
+    /* Staging buffers are sized for the old mode */
+    if (capture->width != mode->hdisplay || capture->height != mode->vdisplay || capture->refresh != mode->vrefresh)
+    {
+        drmlist_capture_cleanup(capture);
+        if (drmlist_init_capture(mode))
+            fprintf(stderr, "Capture disabled after mode switch\n");
+    }
+
+    drmlist_render(data, &data->framebuffer[0]);
+
+    memset(&crtc, 0, sizeof(struct drm_mode_crtc));
+    crtc.crtc_id = data->crt_id;
+    crtc.fb_id = data->framebuffer[0].fb;
+    crtc.count_connectors = 1;
+    crtc.set_connectors_ptr = (uint64_t)&connector_id;
+    crtc.mode = *mode;
+    crtc.mode_valid = 1;
+
+    /* The old buffers are still scanned out until SETCRTC returns */
+    if (mydrm_set_crtc(data->fd, &crtc))
+    {
+        perror("ioctl DRM_IOCTL_MODE_SETCRTC");
+
+        /* Nothing else to go back to, the old buffers stay where they are */
+        if (revert_fbs)
+            return;
+
+        /*
+         * Only the new buffers go back to the pool, the old ones are still
+         * scanned out and releasing them could evict them under the budget
+         */
+        drmlist_fbpool_release(&fbpool, data->framebuffer[0].fb);
+        drmlist_fbpool_release(&fbpool, data->framebuffer[1].fb);
+
+        fprintf(stderr, "Switching back to %dx%d @ %dHz\n", current_mode.hdisplay, current_mode.vdisplay, current_mode.vrefresh);
+        switch_mode = current_mode;
+        drmlist_switch_mode_fbs(data, old_fbs);
+        return;
+    }
+    done_ns = drmlist_clock_now(&anim_clock);
+    current_mode = *mode;
+    if (frame_hash)
+        drmlist_hash_frame(frame_hash, &data->framebuffer[0], frame_seq - 1);
+    drmlist_stats_mode(&stats, mode);
+    if (dirtyfb)
+        drmlist_set_flush_timer(mode);
+    drmlist_vrr_set_mode(&vrr, drmlist_clock_mode_refresh_ns(mode));
+
+    /* Off screen now */
+    if (!revert_fbs)
+    {
+        drmlist_fbpool_release(&fbpool, old_fbs[0].fb);
+        drmlist_fbpool_release(&fbpool, old_fbs[1].fb);
+    }
+
+    printf("Mode switch to %dx%d @ %dHz: %.2f ms to first frame (buffers %.2f ms, %s, modeset %.2f ms)\n",
+                    mode->hdisplay, mode->vdisplay, mode->vrefresh, (done_ns - switch_start_ns) / 1e6,
+                    (fbs_ns - switch_start_ns) / 1e6, fbpool.misses == misses ? "pooled" : "new",
+                    (done_ns - fbs_ns) / 1e6);
+    drmlist_fbpool_print_stats(&fbpool);
+
+    drmlist_draw_data(data->fd, data);
+}
+
+static void drmlist_switch_mode(mydrm_data_t* data)
+{
+    drmlist_switch_mode_fbs(data, NULL);
+}
+
+static void drmlist_request_switch(mydrm_data_t* data, struct drm_mode_modeinfo* mode)
+{
+    switch_mode = *mode;
+    switch_pending = true;
+    switch_start_ns = drmlist_clock_now(&anim_clock);
+
+    if (!data->pflip_pending)
+        drmlist_switch_mode(data);
+}
+
+/*
+ * "WxH", "WxH@R" or "next" on the current connector, switches once no flip is pending
+ */
+static void drmlist_request_mode(mydrm_data_t* data, const char* arg)
+{
+    struct drm_mode_get_connector* conn = NULL;
+    struct drm_mode_modeinfo* modes;
+    bool next = !strcmp(arg, "next");
+    int w = 0, h = 0, r = -1;
+
+    if (ingest)
+    {
+        fprintf(stderr, "Mode switching isn't supported while ingesting, the producer's buffers are fixed\n");
+        return;
+    }
+
+    if (!next && sscanf(arg, "%dx%d@%d", &w, &h, &r) < 2)
+    {
+        fprintf(stderr, "Usage: mode <width>x<height>[@<refresh>] | next\n");
+        return;
+    }
+
+    for (size_t i = 0; i < res->count_connectors; i++)
+        if (conns[i].connector_id == connector_id)
+            conn = &conns[i];
+
+    if (!conn)
+    {
+        fprintf(stderr, "Connector %u is gone\n", connector_id);
+        return;
+    }
+
+    modes = (struct drm_mode_modeinfo*)conn->modes_ptr;
+
+    /* The one after the current mode in the connector's list, for going through all of them */
+    if (next && conn->count_modes)
+    {
+        size_t m = 0;
+
+        while (m < conn->count_modes && memcmp(&modes[m], &current_mode, sizeof(struct drm_mode_modeinfo)))
+            m++;
+        m = m < conn->count_modes ? (m + 1) % conn->count_modes : 0;
+
+        printf("Next mode: %dx%d @ %dHz\n", modes[m].hdisplay, modes[m].vdisplay, modes[m].vrefresh);
+        drmlist_request_switch(data, &modes[m]);
+        return;
+    }
+
+    for (size_t m = 0; m < conn->count_modes; m++)
+    {
+        if (modes[m].hdisplay == w && modes[m].vdisplay == h && (r == -1 || modes[m].vrefresh == r))
+        {
+            drmlist_request_switch(data, &modes[m]);
+            return;
+        }
+    }
+
+    fprintf(stderr, "No such mode: %dx%d\n", w, h);
+}
+
+/*
+ * "pattern <name>", "pattern next" or "pattern off". Every buffer is drawn in
+ * full once, then only the overlays (and the moving bar) change.
+ */
+static void drmlist_request_pattern(mydrm_data_t* data, const char* arg)
+{
+    int kind;
+
+    if (ingest)
+    {
+        fprintf(stderr, "Test patterns don't apply while ingesting, the producer provides the frames\n");
+        return;
+    }
+
+    if (!strcmp(arg, "next"))
+        kind = pattern.kind % (DRMLIST_PATTERNS - 1) + 1;
+    else if ((kind = drmlist_pattern_find(arg)) == -1)
+    {
+        fprintf(stderr, "Usage: pattern [next | %s]\n", drmlist_pattern_names());
+        return;
+    }
+
+    if (drmlist_pattern_set(&pattern, kind))
+    {
+        perror("pattern");
+        drmlist_pattern_set(&pattern, DRMLIST_PATTERN_NONE);
+    }
+    printf("Test pattern: %s\n", drmlist_pattern_name(pattern.kind));
+
+    /* DIRTYFB: the front buffer only gets the damage, the old pattern goes too */
+    damage_full_next = true;
+    drmlist_request_frame(data);
+}
+
+/*
+ * "color k=v,...", "color file <path>", "color reset" or just "color". The
+ * pixels aren't touched, only the CRTC's LUTs, so no frame is needed.
+ */
+static void drmlist_request_color(const char* arg)
+{
+    drmlist_color_params_t params;
+    uint64_t ioctls = color.ioctls;
+    uint64_t update_ns = color.update_ns;
+    int ret;
+
+    if (color.path == DRMLIST_COLOR_NONE)
+    {
+        fprintf(stderr, "CRTC %u has no GAMMA_LUT or gamma ramp\n", data->crt_id);
+        return;
+    }
+
+    if (!*arg)
+    {
+        drmlist_color_print(&color);
+        return;
+    }
+
+    /*
+     * Parsed into a copy, a bad setting leaves the current ones. A file
+     * replaces them all (keys it doesn't have are neutral, no curve unless it
+     * has one), settings change only their keys.
+     */
+    if (!strncmp(arg, "file ", 5))
+    {
+        drmlist_color_params_init(&params);
+        if (drmlist_color_load(&params, arg + 5))
+        {
+            drmlist_color_params_free(&params);
+            return;
+        }
+        drmlist_color_params_free(&color.params);
+    }
+    else
+        params = color.params;
+
+    if (!strcmp(arg, "reset"))
+        drmlist_color_restore(&color);
+    else if (strncmp(arg, "file ", 5) && drmlist_color_parse(&params, arg))
+    {
+        fprintf(stderr, "Usage: color [reset | file <path> | brightness=..,contrast=..,gamma=..,temperature=..,saturation=..]\n");
+        return;
+    }
+    else
+    {
+        color.params = params;
+        if ((ret = drmlist_color_apply(&color)))
+            fprintf(stderr, "color: %s\n", strerror(-ret));
+    }
+
+    drmlist_color_print(&color);
+    printf("Colour: %lu ioctls, %.1f us\n", color.ioctls - ioctls, (color.update_ns - update_ns) / 1e3);
+}
+
+/*
+ * A repeat only keeps the panel in range, the frame waiting for it goes next
+ */
+static void drmlist_repeat_done(mydrm_data_t* data, uint32_t tv_sec, uint32_t tv_usec)
+{
+    uint64_t now = drmlist_clock_now(&anim_clock);
+
+    repeat_pending = false;
+    drmlist_vrr_present(&vrr, anim_clock.flip_timestamps ? (uint64_t)tv_sec * 1000000000ull + tv_usec * 1000ull : now, true);
+    drmlist_trace_instant("repeat complete");
+
+    if (data->cleanup)
+        return;
+
+    if (switch_pending)
+        drmlist_switch_mode(data);
+    else if (frame_waiting && now >= frame_ready_ns)
+        drmlist_present(data);
+    else
+        drmlist_arm_present_timer();
+}
+
+static void drmlist_page_flip_event(int fd, uint32_t sequence, uint32_t tv_sec, uint32_t tv_usec, void* user_data)
+{
+    data->pflip_pending = false;
+
+    if (repeat_pending)
+    {
+        drmlist_repeat_done(data, tv_sec, tv_usec);
+        return;
+    }
+
+    drmlist_startup_flip();
+    drmlist_clock_flip(&anim_clock, tv_sec, tv_usec);
+    drmlist_stats_flip(&stats, sequence);
+    drmlist_idle_presented(&idle, anim_clock.last_flip_ns, anim_clock.refresh_ns);
+    drmlist_trace_instant("flip complete");
+
+    /* With VRR the next frame is on screen when it's ready, not on the next vblank */
+    drmlist_vrr_present(&vrr, anim_clock.last_flip_ns, false);
+    if (vrr.enabled)
+        anim_clock.refresh_ns = drmlist_vrr_predict_ns(&vrr);
+
+    if (data->cleanup)
+        return;
+
+    if (switch_pending)
+        drmlist_switch_mode(data);
+    else if (ingest)
+        drmlist_ingest_flip_done(ingest, data);
+    else if (drmlist_frame_wanted())
+        drmlist_draw_data(fd, data);
+    else
+        drmlist_go_idle();
+}
+
+static void drmlist_handle_mouse_event(mydrm_data_t* data, const int8_t* buffer)
+{
+    mouse_t* mouse = data->mouse;
+
+    mouse->x += buffer[1];
+    mouse->y -= buffer[2];
+    mouse->left_down = buffer[0] & 1;
+    mouse->right_down = buffer[0] & 2;
+
+    if (mouse->x > mouse->max_x - 1)
+        mouse->x = mouse->max_x - 1;
+    else if (mouse->x < 0)
+        mouse->x = 0;
+
+    if (mouse->y > mouse->max_y - 1)
+        mouse->y = mouse->max_y - 1;
+    else if (mouse->y < 0)
+        mouse->y = 0;
+
+    mouse->moved = true;
+}
+
+/*
+ * Re-enumerate connectors (e.g. after a hotplug), reuses the query arena
+ */
+static void drmlist_probe(mydrm_data_t* data)
+{
+    const char* conn_type;
+    uint64_t start = drmlist_clock_now(&anim_clock);
+
+    if (drmlist_enumerate(data->fd))
+    {
+        perror("Failed to enumerate connectors");
+        return;
+    }
+
+    for (size_t i = 0; i < res->count_connectors; i++)
+        drmlist_print_connector(i, (uint32_t*)res->connector_id_ptr, &conns[i], &conn_type);
+
+    printf("Probe took %.2f ms\n", (drmlist_clock_now(&anim_clock) - start) / 1e6);
+    drmlist_print_props();
+    drmlist_print_arena_stats();
+}
+
+/*
+ * Commands on stdin, one per line. Anything else (like just <enter>) quits.
+ */
+static bool drmlist_handle_stdin(mydrm_data_t* data, const uint8_t* input, ssize_t len)
+{
+    char buffer[256];
+    char* line;
+    char* saveptr;
+    bool handled = false;
+
+    if (len <= 0)
+        return false;
+    if (len > (ssize_t)sizeof(buffer) - 1)
+        len = sizeof(buffer) - 1;
+    memcpy(buffer, input, len);
+    buffer[len] = '\0';
+
+    for (line = strtok_r(buffer, "\n", &saveptr); line; line = strtok_r(NULL, "\n", &saveptr))
+    {
+        int ret;
+
+        if (!strcmp(line, "screenshot") || !strcmp(line, "s"))
+        {
+            if ((ret = drmlist_capture_screenshot(capture)))
+                fprintf(stderr, "screenshot: %s\n", strerror(-ret));
+            else
+                drmlist_request_frame(data);
+        }
+        else if (!strcmp(line, "record") || !strcmp(line, "r"))
+        {
+            if (capture->recording)
+                drmlist_capture_record_stop(capture);
+            else if ((ret = drmlist_capture_record_start(capture)))
+                fprintf(stderr, "record: %s\n", strerror(-ret));
+        }
+        else if (!strcmp(line, "stats"))
+        {
+            drmlist_capture_print_stats(capture);
+            if (frame_hash)
+                drmlist_hash_print_stats(frame_hash);
+            drmlist_print_arena_stats();
+            drmlist_fbpool_print_stats(&fbpool);
+            drmlist_trace_print_stats();
+            drmlist_image_cache_print_stats(&background);
+            drmlist_damage_print_stats(&damage, 4);
+            drmlist_mem_print_stats();
+            drmlist_vrr_print_stats(&vrr);
+            drmlist_input_replay_print_stats(&input_replay);
+            drmlist_sprites_print_stats(&sprites);
+            drmlist_pattern_print_stats(&pattern);
+            if (color.updates)
+                drmlist_color_print(&color);
+            drmlist_idle_print_stats(&idle, drmlist_clock_now(&anim_clock), drmlist_clock_now(&anim_clock) - run_start_ns,
+                                     main_loop ? main_loop->wakeups : 0);
+            printf("HUD text cache: %lu hits, %lu misses\n", hud_text.hits, hud_text.misses);
+        }
+        else if (!strcmp(line, "probe"))
+        {
+            drmlist_probe(data);
+        }
+        else if (!strcmp(line, "hud"))
+        {
+            hud_enabled = !hud_enabled;
+            drmlist_request_frame(data);
+        }
+        else if (!strcmp(line, "pause"))
+        {
+            anim_paused = !anim_paused;
+            drmlist_request_frame(data);
+        }
+        else if (!strncmp(line, "mode ", 5))
+        {
+            drmlist_request_mode(data, line + 5);
+        }
+        else if (!strcmp(line, "pattern") || !strncmp(line, "pattern ", 8))
+        {
+            drmlist_request_pattern(data, line[7] ? line + 8 : "next");
+        }
+        else if (!strcmp(line, "color") || !strncmp(line, "color ", 6))
+        {
+            drmlist_request_color(line[5] ? line + 6 : "");
+        }
+        else
+        {
+            return false;
+        }
+        handled = true;
+    }
+
+    /* Just <enter> */
+    return handled;
+}
+
+/*
+ * Event loop callbacks
+ */
+static void drmlist_stdin_read(void* user, const uint8_t* buf, ssize_t len)
+{
+    running = drmlist_handle_stdin(data, buf, len);
+}
+
+static void drmlist_signal_read(void* user, const uint8_t* buf, ssize_t len)
+{
+    if (len < (ssize_t)sizeof(struct signalfd_siginfo))
+        return;
+
+    if (mydrm_ioctl_stats_dump(stdout) == -1)
+        printf("ioctl stats not compiled in (configure with -DDRMLIST_IOCTL_STATS=ON)\n");
+}
+
+/*
+ * Stands in for the flip event with DIRTYFB flushing, missed ticks count as
+ * missed vblanks
+ */
+static void drmlist_flush_timer_read(void* user, const uint8_t* buf, ssize_t len)
+{
+    uint64_t expirations;
+    uint64_t now = drmlist_clock_now(&anim_clock);
+
+    if (len != sizeof(uint64_t))
+        return;
+
+    memcpy(&expirations, buf, sizeof(uint64_t));
+    flush_sequence += expirations;
+    drmlist_startup_flip();
+
+    drmlist_clock_flip(&anim_clock, now / 1000000000ull, (now % 1000000000ull) / 1000);
+    drmlist_stats_flip(&stats, flush_sequence);
+
+    if (data->cleanup)
+        return;
+
+    if (drmlist_frame_wanted())
+        drmlist_draw_data(data->fd, data);
+    else
+        drmlist_go_idle();
+}
+
+/*
+ * A simulated frame cost ran out or a repeat is due. Either waits for a
+ * pending flip, its event picks up from there.
+ */
+static void drmlist_present_timer_read(void* user, const uint8_t* buf, ssize_t len)
+{
+    uint64_t now = drmlist_clock_now(&anim_clock);
+    uint64_t repeat_at;
+
+    if (len != sizeof(uint64_t) || data->cleanup || data->pflip_pending)
+        return;
+
+    if (frame_waiting && now >= frame_ready_ns)
+    {
+        drmlist_present(data);
+        return;
+    }
+
+    if (!idle.idle && (repeat_at = drmlist_vrr_repeat_at(&vrr)) && now >= repeat_at)
+    {
+        drmlist_repeat_page(data);
+        return;
+    }
+
+    drmlist_arm_present_timer();
+}
+
+static void drmlist_drm_read(void* user, const uint8_t* buf, ssize_t len)
+{
+    if (len < 0)
+    {
+        errno = -len;
+        perror("read data->fd");
+        return;
+    }
+
+    DRMLIST_TRACE_SCOPE("handle_event");
+    mydrm_dispatch_events(data->fd, user, buf, len);
+}
+
+/*
+ * Every packet of the log went through the handler. The final cursor position
+ * and frame count tell two runs of the same log apart.
+ */
+static void drmlist_replay_finished(void)
+{
+    const char* exit_str = getenv(ENV_DRMLIST_INPUT_REPLAY_EXIT);
+
+    drmlist_input_replay_print_stats(&input_replay);
+    printf("Input replay done after %lu frames, cursor at %d,%d\n", frame_seq, data->mouse->x, data->mouse->y);
+
+    replay_done = false;
+    if (exit_str && atoi(exit_str))
+        running = false;
+}
+
+static void drmlist_mouse_read(void* user, const uint8_t* buf, ssize_t len)
+{
+    bool left_down = data->mouse->left_down;
+    bool right_down = data->mouse->right_down;
+
+    if (len < 3)
+    {
+        if (len < 0)
+        {
+            errno = -len;
+            perror("read data->mouse->fd");
+        }
+        return;
+    }
+
+    if (input_rec.file)
+        drmlist_input_record(&input_rec, drmlist_clock_now(&anim_clock), frame_seq, buf, len);
+
+    drmlist_handle_mouse_event(data, (const int8_t*)buf);
+    drmlist_stats_input(&stats);
+
+    /* Ingested frames are not ours to draw on, only the hardware cursor can follow */
+    if (ingest && data->mouse->is_hardware_cursor)
+        data->mouse->move_cursor_callback(data, NULL);
+    /* On demand the hardware cursor moves without a frame, the box only changes color with the buttons */
+    else if (idle.enabled && data->mouse->is_hardware_cursor &&
+             left_down == data->mouse->left_down && right_down == data->mouse->right_down)
+        data->mouse->move_cursor_callback(data, NULL);
+    else if (!ingest)
+        drmlist_request_frame(data);
+
+    if (replay_done && !drmlist_input_replay_pending(&input_replay))
+        drmlist_replay_finished();
+}
+
+/*
+ * The last packet is in the pipe, it may not have been read yet
+ */
+static void drmlist_replay_done_read(void* user, const uint8_t* buf, ssize_t len)
+{
+    replay_done = true;
+
+    if (!drmlist_input_replay_pending(&input_replay))
+        drmlist_replay_finished();
+}
+
+static void drmlist_ingest_doorbell_read(void* user, const uint8_t* buf, ssize_t len)
+{
+    drmlist_ingest_doorbell(ingest, data);
+}
+
+static void drmlist_ingest_client_ready(void* user)
+{
+    int client_fd = ingest->client_fd;
+
+    drmlist_ingest_client_event(ingest);
+
+    if (ingest->client_fd == -1)
+        drmlist_loop_remove(user, client_fd);
+}
+
+static void drmlist_ingest_listen_ready(void* user)
+{
+    int client_fd = drmlist_ingest_accept(ingest);
+
+    if (client_fd != -1)
+        drmlist_loop_add_ready(user, client_fd, drmlist_ingest_client_ready, user);
+}
+
+static int drmlist_init_loop(drmlist_loop_t* loop, mydrm_event_context_t* ev)
+{
+    const char* backend_str;
+    int backend = DRMLIST_LOOP_EPOLL;
+
+    if ((backend_str = getenv(ENV_DRMLIST_LOOP)) && !strcmp(backend_str, "io_uring"))
+        backend = DRMLIST_LOOP_IO_URING;
+
+    if (drmlist_loop_init(loop, backend))
+        return -1;
+
+    printf("Event loop: %s\n", drmlist_loop_backend_name(loop->backend));
+
+    if (drmlist_loop_add_read(loop, 0, 255, drmlist_stdin_read, NULL) ||
+        drmlist_loop_add_read(loop, data->fd, DRMLIST_LOOP_READ_MAX, drmlist_drm_read, ev) ||
+        drmlist_loop_add_read(loop, data->mouse->fd, 3, drmlist_mouse_read, NULL) ||
+        drmlist_loop_add_read(loop, signal_fd, sizeof(struct signalfd_siginfo), drmlist_signal_read, NULL))
+        return -1;
+
+    if (dirtyfb && drmlist_loop_add_read(loop, flush_timer_fd, sizeof(uint64_t), drmlist_flush_timer_read, NULL))
+        return -1;
+
+    if (present_timer_fd != -1 && drmlist_loop_add_read(loop, present_timer_fd, sizeof(uint64_t), drmlist_present_timer_read, NULL))
+        return -1;
+
+    if (input_replay.map && drmlist_loop_add_read(loop, input_replay.done_fd, sizeof(uint64_t), drmlist_replay_done_read, NULL))
+        return -1;
+
+    if (ingest && (drmlist_loop_add_read(loop, ingest->event_fd, sizeof(uint64_t), drmlist_ingest_doorbell_read, NULL) ||
+                   drmlist_loop_add_ready(loop, ingest->listen_fd, drmlist_ingest_listen_ready, loop)))
+        return -1;
+
+    return 0;
+}
+
+static int drmlist_mainloop(mydrm_data_t* data)
+{
+    int ret;
+    drmlist_loop_t loop;
+    mydrm_event_context_t ev;
+    const char* record_path;
+
+    memset(&ev, 0, sizeof(mydrm_event_context_t));
+    ev.version = 2;
+    ev.page_flip_handler = drmlist_page_flip_event;
+
+    if ((ret = drmlist_init_loop(&loop, &ev)))
+    {
+        drmlist_loop_cleanup(&loop);
+        return ret;
+    }
+
+    printf("Commands: screenshot (s), record (r), stats, probe, hud, pause, mode WxH[@R]|next, pattern [name|next|off], color [k=v,..|file <path>|reset], anything else quits\n");
+
+    /* Input times count from the first frame */
+    if ((record_path = getenv(ENV_DRMLIST_INPUT_RECORD)) &&
+        drmlist_input_record_open(&input_rec, record_path, drmlist_clock_now(&anim_clock)))
+        perror("FAILED to open input recording");
+
+    if (input_replay.map && (ret = drmlist_input_replay_start(&input_replay)))
+    {
+        drmlist_loop_cleanup(&loop);
+        return ret;
+    }
+
+    main_loop = &loop;
+    run_start_ns = drmlist_clock_now(&anim_clock);
+
+    /* With ingestion the producer provides every frame */
+    if (!ingest)
+        drmlist_draw_data(data->fd, data);
+
+    running = true;
+    while (running)
+    {
+        DRMLIST_TRACE_SCOPE("mainloop");
+
+        if ((ret = drmlist_loop_run_once(&loop)) == -1)
+            break;
+        ret = 0;
+    }
+
+    printf("Event loop (%s): %lu wakeups, %lu syscalls, %lu events, %lu frames, %.2f syscalls/frame\n",
+                    drmlist_loop_backend_name(loop.backend), loop.wakeups, loop.syscalls, loop.events,
+                    frame_seq, frame_seq ? (double)loop.syscalls / frame_seq : 0.0);
+    drmlist_idle_print_stats(&idle, drmlist_clock_now(&anim_clock), drmlist_clock_now(&anim_clock) - run_start_ns, loop.wakeups);
+
+    main_loop = NULL;
+    drmlist_loop_cleanup(&loop);
+
+    return ret;
+}
+
+int drmlist_run(void)
+{
+    int ret = 0;            // just listing without a connector
+    bool did_set_mode = false;
+
+    printf("DRM Connectors: %d\n", res->count_connectors);
+
+    for (size_t i = 0; i < res->count_connectors; i++)
+    {
+        struct drm_mode_get_connector conn = conns[i];
+        struct drm_mode_modeinfo* mode = NULL;
+        uint32_t* connectors = (uint32_t*)res->connector_id_ptr;
+        const char* conn_type;
+
+        if (drmlist_print_connector(i, connectors, &conn, &conn_type))
             mode = drmlist_print_modes_and_get(connector_str, conn_type, &conn);
         
         if (mode)
@@ -666,12 +2301,8 @@ int drmlist_run(void)
             if (ret == 0) 
                 ret = drmlist_mainloop(data);
             did_set_mode = true;
-
-            mydrm_free_connector(&conn);
             break;
         }
-
-        mydrm_free_connector(&conn);
     }
 
     if (!did_set_mode && (hres != -1 && vres != 1))
@@ -682,13 +2313,67 @@ int drmlist_run(void)
             printf("No such mode: %dx%d!\n", hres, vres);
         ret = -1;
     }
+    else if (!did_set_mode && connector_str)
+    {
+        fprintf(stderr, "No connected connector matching %s\n", connector_str);
+        ret = -ENODEV;
+    }
 
     return ret;
 }
 
 void drmlist_cleanup(void)
 {
-
-    free(res);
+    mydrm_ioctl_stats_dump(stdout);
+
+    if (signal_fd != -1)
+        close(signal_fd);
+
+    if (flush_timer_fd != -1)
+        close(flush_timer_fd);
+    drmlist_damage_print_stats(&damage, 4);
+
+    if (present_timer_fd != -1)
+        close(present_timer_fd);
+    if (vrr_prop_id && mydrm_set_property(data->fd, data->crt_id, DRM_MODE_OBJECT_CRTC, vrr_prop_id, 0) == -1)
+        perror("ioctl DRM_IOCTL_MODE_OBJ_SETPROPERTY VRR_ENABLED");
+    drmlist_vrr_print_stats(&vrr);
+
+    if (color.updates)
+        drmlist_color_print(&color);
+    drmlist_color_cleanup(&color);
+
+    drmlist_input_record_close(&input_rec);
+    drmlist_input_replay_close(&input_replay);
+
+    if (capture)
+        drmlist_capture_cleanup(capture);
+    free(capture);
+
+    /* Before the buffers are unmapped */
+    if (frame_hash)
+        drmlist_hash_cleanup(frame_hash);
+    free(frame_hash);
+
+    if (ingest)
+        drmlist_ingest_cleanup(ingest, data);
+    free(ingest);
+
+    drmlist_anim_free(&anim);
+    drmlist_sprites_print_stats(&sprites);
+    drmlist_sprites_cleanup(&sprites);
+    drmlist_pattern_print_stats(&pattern);
+    drmlist_pattern_cleanup(&pattern);
+
+    drmlist_image_cache_cleanup(&splash);
+    drmlist_image_cache_cleanup(&background);
+    drmlist_text_cleanup(&hud_text);
+    drmlist_stats_cleanup(&stats);
+    drmlist_fbpool_cleanup(&fbpool);
+    mydrm_arena_free(&query_arenas[0]);
+    mydrm_arena_free(&query_arenas[1]);
+
+    /* Last, every other thread is gone */
+    drmlist_trace_cleanup();
     free(data);
 }
@@ -6,10 +6,54 @@
 #define ENV_DRMLIST_DRM_PATH "DRMLIST_PATH"
 #define ENV_DRMLIST_CURSOR_SIZE "DRMLIST_CURSOR_SIZE"
 #define ENV_DRMLIST_HARDWARE_CURSOR "DRMLIST_NO_HW_CURSOR"
+#define ENV_DRMLIST_INGEST "DRMLIST_INGEST"
+#define ENV_DRMLIST_INGEST_BUFFERS "DRMLIST_INGEST_BUFFERS"
+#define ENV_DRMLIST_CAPTURE_DIR "DRMLIST_CAPTURE_DIR"
+#define ENV_DRMLIST_CAPTURE_BUFFERS "DRMLIST_CAPTURE_BUFFERS"
+#define ENV_DRMLIST_RECORD_FORMAT "DRMLIST_RECORD_FORMAT"
+#define ENV_DRMLIST_LOOP "DRMLIST_LOOP"
+#define ENV_DRMLIST_FB_BUDGET "DRMLIST_FB_BUDGET_MB"
+#define ENV_DRMLIST_TRACE "DRMLIST_TRACE"
+#define ENV_DRMLIST_STATS "DRMLIST_STATS"
+#define ENV_DRMLIST_HUD "DRMLIST_HUD"
+#define ENV_DRMLIST_BACKGROUND "DRMLIST_BACKGROUND"
+#define ENV_DRMLIST_SPLASH "DRMLIST_SPLASH"
+#define ENV_DRMLIST_SPLASH_MS "DRMLIST_SPLASH_MS"
+#define ENV_DRMLIST_IMAGE_SCALE "DRMLIST_IMAGE_SCALE"
+#define ENV_DRMLIST_SCALE_THREADS "DRMLIST_SCALE_THREADS"
+#define ENV_DRMLIST_DIRTYFB "DRMLIST_DIRTYFB"
+#define ENV_DRMLIST_FB_MAP "DRMLIST_FB_MAP"
+#define ENV_DRMLIST_VRR "DRMLIST_VRR"
+#define ENV_DRMLIST_VRR_RANGE "DRMLIST_VRR_RANGE"
+#define ENV_DRMLIST_FRAME_COST "DRMLIST_FRAME_COST_US"
+#define ENV_DRMLIST_INPUT_RECORD "DRMLIST_INPUT_RECORD"
+#define ENV_DRMLIST_INPUT_REPLAY "DRMLIST_INPUT_REPLAY"
+#define ENV_DRMLIST_INPUT_REPLAY_MODE "DRMLIST_INPUT_REPLAY_MODE"
+#define ENV_DRMLIST_INPUT_REPLAY_EXIT "DRMLIST_INPUT_REPLAY_EXIT"
+#define ENV_DRMLIST_SPRITES "DRMLIST_SPRITES"
+#define ENV_DRMLIST_CPU "DRMLIST_CPU"
+#define ENV_DRMLIST_ON_DEMAND "DRMLIST_ON_DEMAND"
+#define ENV_DRMLIST_IOCTL_RECORD "DRMLIST_IOCTL_RECORD"    // drmlist_ioctl_trace
+#define ENV_DRMLIST_IOCTL_REPLAY "DRMLIST_IOCTL_REPLAY"
+#define ENV_DRMLIST_HASH "DRMLIST_HASH"
+#define ENV_DRMLIST_HASH_TILE "DRMLIST_HASH_TILE"
+#define ENV_DRMLIST_COLOR "DRMLIST_COLOR"              // brightness=..,temperature=.. on the CRTC
+#define ENV_DRMLIST_COLOR_FILE "DRMLIST_COLOR_FILE"    // calibration file, DRMLIST_COLOR keys go over it
 
 #define DRMLIST_DRM_DEFAULT "/dev/dri/card0"
 #define CURSOR_SIZE 32
 #define DRMLIST_BACKGROUND_COLOR 0xFF111111
+#define DRMLIST_SIM_HZ 240          // fixed simulation rate, independent of the refresh rate
+#define DRMLIST_BOX_WIDTH 32
+#define DRMLIST_BOX_SPEED 300.0f    // pixels per second
+#define DRMLIST_HUD_DEFAULT_SCALE 2
+#define DRMLIST_HUD_MARGIN 8
+#define DRMLIST_HUD_FG 0xFFFFFFFF
+#define DRMLIST_HUD_BG 0xFF000000
+#define DRMLIST_HUD_INTERVAL_NS 250000000ull
+#define DRMLIST_SPLASH_DEFAULT_MS 2000
+#define DRMLIST_FB_MAP_DEFAULT "populate,prefault"
+#define DRMLIST_STARTUP_FRAMES 60
 
 int drmlist_init(int argc, const char** argv);
 int drmlist_run(void);
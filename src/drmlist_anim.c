@@ -0,0 +1,147 @@
+#include "drmlist_anim.h"
+#include "drmlist_cpu.h"
+#include <immintrin.h>
+
+int drmlist_anim_init(drmlist_anim_t* anim, size_t capacity, float max_x, float max_y)
+{
+    float** arrays[] = { &anim->x, &anim->y, &anim->prev_x, &anim->prev_y, &anim->vx, &anim->vy, &anim->w, &anim->h };
+    size_t size = ((capacity + DRMLIST_ANIM_LANES - 1) & ~(size_t)(DRMLIST_ANIM_LANES - 1)) * sizeof(float);
+
+    memset(anim, 0, sizeof(drmlist_anim_t));
+    anim->capacity = capacity;
+    anim->max_x = max_x;
+    anim->max_y = max_y;
+
+    for (size_t i = 0; i < sizeof(arrays) / sizeof(arrays[0]); i++)
+    {
+        if ((*arrays[i] = aligned_alloc(32, size ? size : 32)) == NULL)
+        {
+            drmlist_anim_free(anim);
+            return -ENOMEM;
+        }
+        memset(*arrays[i], 0, size);
+    }
+
+    return 0;
+}
+
+int drmlist_anim_add(drmlist_anim_t* anim, float x, float y, float vx, float vy, float w, float h)
+{
+    size_t i = anim->count;
+
+    if (i == anim->capacity)
+        return -1;
+
+    anim->x[i] = anim->prev_x[i] = x;
+    anim->y[i] = anim->prev_y[i] = y;
+    anim->vx[i] = vx;
+    anim->vy[i] = vy;
+    anim->w[i] = w;
+    anim->h[i] = h;
+    anim->count++;
+
+    return i;
+}
+
+static inline void anim_bounce(float* pos, float* vel, float size, float max)
+{
+    if (*pos < 0.0f)
+    {
+        *pos = -*pos;
+        *vel = -*vel;
+    }
+    else if (*pos + size > max)
+    {
+        *pos = 2.0f * (max - size) - *pos;
+        *vel = -*vel;
+    }
+}
+
+/*
+ * Same operations as anim_bounce(), in the same order, so both steps agree to
+ * the bit: no FMA, the high side only bounces what the low side didn't
+ */
+DRMLIST_TARGET_AVX2 static inline void anim_bounce_avx2(__m256* pos, __m256* vel, __m256 size, __m256 max)
+{
+    const __m256 sign = _mm256_set1_ps(-0.0f);
+    __m256 lo = _mm256_cmp_ps(*pos, _mm256_setzero_ps(), _CMP_LT_OQ);
+    __m256 hi = _mm256_andnot_ps(lo, _mm256_cmp_ps(_mm256_add_ps(*pos, size), max, _CMP_GT_OQ));
+    __m256 limit = _mm256_sub_ps(max, size);
+    __m256 flip = _mm256_or_ps(lo, hi);
+
+    *pos = _mm256_blendv_ps(*pos, _mm256_xor_ps(*pos, sign), lo);
+    *pos = _mm256_blendv_ps(*pos, _mm256_sub_ps(_mm256_add_ps(limit, limit), *pos), hi);
+    *vel = _mm256_xor_ps(*vel, _mm256_and_ps(flip, sign));
+}
+
+DRMLIST_TARGET_AVX2 static void anim_step_avx2(drmlist_anim_t* anim, float dt)
+{
+    const __m256 vdt = _mm256_set1_ps(dt);
+    const __m256 max_x = _mm256_set1_ps(anim->max_x);
+    const __m256 max_y = _mm256_set1_ps(anim->max_y);
+
+    /* Padding lanes up to the next multiple of 8 are zero and stay zero */
+    for (size_t i = 0; i < anim->count; i += DRMLIST_ANIM_LANES)
+    {
+        __m256 x = _mm256_load_ps(&anim->x[i]);
+        __m256 y = _mm256_load_ps(&anim->y[i]);
+        __m256 vx = _mm256_load_ps(&anim->vx[i]);
+        __m256 vy = _mm256_load_ps(&anim->vy[i]);
+
+        _mm256_store_ps(&anim->prev_x[i], x);
+        _mm256_store_ps(&anim->prev_y[i], y);
+
+        x = _mm256_add_ps(x, _mm256_mul_ps(vx, vdt));
+        y = _mm256_add_ps(y, _mm256_mul_ps(vy, vdt));
+
+        anim_bounce_avx2(&x, &vx, _mm256_load_ps(&anim->w[i]), max_x);
+        anim_bounce_avx2(&y, &vy, _mm256_load_ps(&anim->h[i]), max_y);
+
+        _mm256_store_ps(&anim->x[i], x);
+        _mm256_store_ps(&anim->y[i], y);
+        _mm256_store_ps(&anim->vx[i], vx);
+        _mm256_store_ps(&anim->vy[i], vy);
+    }
+}
+
+void drmlist_anim_step(drmlist_anim_t* anim, float dt)
+{
+    if (drmlist_cpu_level >= DRMLIST_CPU_AVX2)
+        anim_step_avx2(anim, dt);
+    else
+        drmlist_anim_step_scalar(anim, dt);
+}
+
+void drmlist_anim_step_scalar(drmlist_anim_t* anim, float dt)
+{
+    for (size_t i = 0; i < anim->count; i++)
+    {
+        anim->prev_x[i] = anim->x[i];
+        anim->prev_y[i] = anim->y[i];
+
+        anim->x[i] += anim->vx[i] * dt;
+        anim->y[i] += anim->vy[i] * dt;
+
+        anim_bounce(&anim->x[i], &anim->vx[i], anim->w[i], anim->max_x);
+        anim_bounce(&anim->y[i], &anim->vy[i], anim->h[i], anim->max_y);
+    }
+}
+
+void drmlist_anim_lerp(drmlist_anim_t* anim, size_t i, float alpha, float* x, float* y)
+{
+    *x = anim->prev_x[i] + (anim->x[i] - anim->prev_x[i]) * alpha;
+    *y = anim->prev_y[i] + (anim->y[i] - anim->prev_y[i]) * alpha;
+}
+
+void drmlist_anim_free(drmlist_anim_t* anim)
+{
+    free(anim->x);
+    free(anim->y);
+    free(anim->prev_x);
+    free(anim->prev_y);
+    free(anim->vx);
+    free(anim->vy);
+    free(anim->w);
+    free(anim->h);
+    memset(anim, 0, sizeof(drmlist_anim_t));
+}
@@ -0,0 +1,41 @@
+#ifndef _DRMLIST_ANIM_H_
+#define _DRMLIST_ANIM_H_
+
+#include "mydrm/mydrm.h"
+
+/*
+ * Animated objects bouncing inside [0, max_x] x [0, max_y], structure of arrays.
+ * Stepped by drmlist_clock_t, drawn at the position interpolated between the
+ * previous and current step.
+ *
+ * Arrays are 32 byte aligned and padded to a multiple of DRMLIST_ANIM_LANES, a
+ * step updates 8 objects at a time with AVX2 (one at a time without). Padding
+ * objects are zero sized and don't move.
+ */
+#define DRMLIST_ANIM_LANES 8
+
+typedef struct
+{
+    size_t count;
+    size_t capacity;
+    float max_x;
+    float max_y;
+
+    float* x;
+    float* y;
+    float* prev_x;
+    float* prev_y;
+    float* vx;          // pixels per second
+    float* vy;
+    float* w;
+    float* h;
+} drmlist_anim_t;
+
+int drmlist_anim_init(drmlist_anim_t* anim, size_t capacity, float max_x, float max_y);
+int drmlist_anim_add(drmlist_anim_t* anim, float x, float y, float vx, float vy, float w, float h);
+void drmlist_anim_step(drmlist_anim_t* anim, float dt);
+void drmlist_anim_step_scalar(drmlist_anim_t* anim, float dt);     // reference, same results
+void drmlist_anim_lerp(drmlist_anim_t* anim, size_t i, float alpha, float* x, float* y);
+void drmlist_anim_free(drmlist_anim_t* anim);
+
+#endif // _DRMLIST_ANIM_H_
@@ -0,0 +1,434 @@
+#include "drmlist_capture.h"
+#include "drmlist_convert.h"
+#include "drmlist_trace.h"
+#include "drmlist_mem.h"
+#include "drmlist_kernels.h"
+#include <time.h>
+
+static bool capture_queue_push(drmlist_capture_queue_t* q, drmlist_capture_job_t* job)
+{
+    uint32_t head = atomic_load_explicit(&q->head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&q->tail, memory_order_acquire);
+
+    if (head - tail == DRMLIST_CAPTURE_QUEUE_SIZE)
+        return false;
+
+    q->jobs[head & (DRMLIST_CAPTURE_QUEUE_SIZE - 1)] = *job;
+    atomic_store_explicit(&q->head, head + 1, memory_order_release);
+    return true;
+}
+
+static bool capture_queue_pop(drmlist_capture_queue_t* q, drmlist_capture_job_t* job)
+{
+    uint32_t tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&q->head, memory_order_acquire);
+
+    if (head == tail)
+        return false;
+
+    *job = q->jobs[tail & (DRMLIST_CAPTURE_QUEUE_SIZE - 1)];
+    atomic_store_explicit(&q->tail, tail + 1, memory_order_release);
+    return true;
+}
+
+static bool capture_submit(drmlist_capture_t* cap, uint32_t type, int32_t staging, uint64_t seq)
+{
+    drmlist_capture_job_t job = { .type = type, .staging = staging, .seq = seq };
+
+    if (!capture_queue_push(&cap->queue, &job))
+        return false;
+
+    sem_post(&cap->queue_sem);
+    return true;
+}
+
+static int capture_write_all(drmlist_capture_t* cap, int fd, const void* buf, size_t size)
+{
+    const uint8_t* p = buf;
+
+    while (size)
+    {
+        ssize_t len = write(fd, p, size);
+
+        if (len == -1)
+        {
+            if (errno == EINTR)
+                continue;
+            perror("capture write");
+            return -1;
+        }
+
+        p += len;
+        size -= len;
+        atomic_fetch_add_explicit(&cap->bytes_written, len, memory_order_relaxed);
+    }
+
+    return 0;
+}
+
+static int capture_open(drmlist_capture_t* cap, uint64_t seq, const char* ext)
+{
+    char path[PATH_MAX];
+    int fd;
+
+    snprintf(path, PATH_MAX, "%s/drmlist-%06lu.%s", cap->dir, seq, ext);
+
+    if ((fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)) == -1)
+    {
+        char errmsg[PATH_MAX + 32];
+        snprintf(errmsg, sizeof(errmsg), "Failed to open %s", path);
+        perror(errmsg);
+    }
+    else
+        printf("Capture: writing %s\n", path);
+
+    return fd;
+}
+
+/*
+ * BT.601 limited range, planar 4:4:4
+ */
+static void capture_xrgb_to_yuv444(uint8_t* out, const uint8_t* pixels, drmlist_capture_t* cap)
+{
+    size_t plane = (size_t)cap->width * cap->height;
+    uint8_t* py = out;
+    uint8_t* pu = out + plane;
+    uint8_t* pv = out + plane * 2;
+
+    for (uint32_t y = 0; y < cap->height; y++)
+    {
+        const uint32_t* row = (const uint32_t*)(pixels + (size_t)y * cap->stride);
+
+        for (uint32_t x = 0; x < cap->width; x++)
+        {
+            int r = (row[x] >> 16) & 0xFF;
+            int g = (row[x] >> 8) & 0xFF;
+            int b = row[x] & 0xFF;
+
+            *py++ = ((66 * r + 129 * g + 25 * b + 128) >> 8) + 16;
+            *pu++ = ((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128;
+            *pv++ = ((112 * r - 94 * g - 18 * b + 128) >> 8) + 128;
+        }
+    }
+}
+
+static void capture_write_ppm(drmlist_capture_t* cap, uint8_t* out, const uint8_t* pixels, uint64_t seq)
+{
+    char header[64];
+    int len;
+    int fd;
+
+    if ((fd = capture_open(cap, seq, "ppm")) == -1)
+        return;
+
+    len = snprintf(header, sizeof(header), "P6\n%u %u\n255\n", cap->width, cap->height);
+    drmlist_convert(out, DRM_FORMAT_RGB888, cap->width * 3, pixels, DRM_FORMAT_XRGB8888, cap->stride,
+                    cap->width, cap->height, 0);
+
+    /* RGB888 is B, G, R in memory, P6 wants R, G, B */
+    for (size_t i = 0; i < (size_t)cap->width * cap->height * 3; i += 3)
+    {
+        uint8_t b = out[i];
+
+        out[i] = out[i + 2];
+        out[i + 2] = b;
+    }
+
+    if (capture_write_all(cap, fd, header, len) == 0)
+        capture_write_all(cap, fd, out, (size_t)cap->width * cap->height * 3);
+
+    close(fd);
+}
+
+static void capture_write_record_frame(drmlist_capture_t* cap, int fd, uint8_t* out, const uint8_t* pixels)
+{
+    size_t size;
+
+    if (cap->record_format == DRMLIST_CAPTURE_Y4M)
+    {
+        static const char frame_header[] = "FRAME\n";
+
+        capture_xrgb_to_yuv444(out, pixels, cap);
+        size = (size_t)cap->width * cap->height * 3;
+
+        if (capture_write_all(cap, fd, frame_header, sizeof(frame_header) - 1))
+            return;
+    }
+    else
+    {
+        drmlist_convert(out, DRM_FORMAT_XRGB8888, cap->width * 4, pixels, DRM_FORMAT_XRGB8888, cap->stride,
+                        cap->width, cap->height, 0);
+        size = (size_t)cap->width * cap->height * 4;
+    }
+
+    capture_write_all(cap, fd, out, size);
+}
+
+static void* drmlist_capture_writer(void* arg)
+{
+    drmlist_capture_t* cap = arg;
+    drmlist_capture_job_t job;
+    uint8_t* out = NULL;
+    int record_fd = -1;
+
+    drmlist_trace_thread_name("drmlist-capture");
+
+    for (;;)
+    {
+        while (sem_wait(&cap->queue_sem) == -1 && errno == EINTR)
+            ;
+
+        if (!capture_queue_pop(&cap->queue, &job))
+            continue;
+
+        if (job.type == CAPTURE_JOB_QUIT)
+            break;
+
+        struct timespec t0, t1;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        DRMLIST_TRACE_SCOPE("capture write");
+
+        /* Big enough for packed XRGB8888, RGB888 and YUV 4:4:4 */
+        if (!out && (out = malloc((size_t)cap->width * cap->height * 4)) == NULL)
+            perror("capture malloc");
+
+        switch (job.type)
+        {
+            case CAPTURE_JOB_SCREENSHOT:
+                if (out)
+                    capture_write_ppm(cap, out, cap->staging[job.staging], job.seq);
+                break;
+            case CAPTURE_JOB_RECORD_START:
+            {
+                if (record_fd != -1)
+                    close(record_fd);
+
+                record_fd = capture_open(cap, job.seq, cap->record_format == DRMLIST_CAPTURE_Y4M ? "y4m" : "raw");
+
+                if (record_fd != -1 && cap->record_format == DRMLIST_CAPTURE_Y4M)
+                {
+                    char header[128];
+                    int len = snprintf(header, sizeof(header), "YUV4MPEG2 W%u H%u F%u:1 Ip A1:1 C444\n",
+                                        cap->width, cap->height, cap->refresh ? cap->refresh : 60);
+                    capture_write_all(cap, record_fd, header, len);
+                }
+                break;
+            }
+            case CAPTURE_JOB_RECORD_FRAME:
+                if (out && record_fd != -1)
+                    capture_write_record_frame(cap, record_fd, out, cap->staging[job.staging]);
+                break;
+            case CAPTURE_JOB_RECORD_END:
+                if (record_fd != -1)
+                    close(record_fd);
+                record_fd = -1;
+                break;
+        }
+
+        if (job.staging != -1)
+        {
+            drmlist_capture_job_t ret = { .staging = job.staging };
+
+            atomic_fetch_add_explicit(&cap->written, 1, memory_order_relaxed);
+            capture_queue_push(&cap->free, &ret);
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        atomic_fetch_add_explicit(&cap->write_ns, (t1.tv_sec - t0.tv_sec) * 1000000000ull + t1.tv_nsec - t0.tv_nsec, memory_order_relaxed);
+    }
+
+    if (record_fd != -1)
+        close(record_fd);
+    free(out);
+
+    return NULL;
+}
+
+int drmlist_capture_init(drmlist_capture_t* cap, mydrm_fb_t* fb, uint32_t refresh, const char* dir, uint32_t record_format, int n_staging)
+{
+    int ret;
+
+    memset(cap, 0, sizeof(drmlist_capture_t));
+
+    if (n_staging < 1)
+        n_staging = 1;
+    else if (n_staging > DRMLIST_CAPTURE_MAX_BUFFERS)
+        n_staging = DRMLIST_CAPTURE_MAX_BUFFERS;
+
+    cap->n_staging = n_staging;
+    cap->width = fb->width;
+    cap->height = fb->height;
+    cap->stride = fb->stride;
+    cap->size = fb->size;
+    cap->refresh = refresh;
+    cap->dir = dir;
+    cap->record_format = record_format;
+
+    if (sem_init(&cap->queue_sem, 0, 0) == -1)
+    {
+        perror("sem_init");
+        return -1;
+    }
+
+    if ((ret = pthread_create(&cap->writer, NULL, drmlist_capture_writer, cap)))
+    {
+        errno = ret;
+        perror("pthread_create capture writer");
+        sem_destroy(&cap->queue_sem);
+        return -1;
+    }
+
+    cap->writer_running = true;
+
+    return 0;
+}
+
+static int drmlist_capture_alloc(drmlist_capture_t* cap)
+{
+    if (cap->staging[0])
+        return 0;
+
+    for (int i = 0; i < cap->n_staging; i++)
+    {
+        drmlist_capture_job_t job = { .staging = i };
+
+        if ((cap->staging[i] = drmlist_huge_alloc(cap->size)) == NULL)
+            return -ENOMEM;
+
+        capture_queue_push(&cap->free, &job);
+    }
+
+    printf("Capture: %d staging buffers of %u bytes\n", cap->n_staging, cap->size);
+
+    return 0;
+}
+
+int drmlist_capture_screenshot(drmlist_capture_t* cap)
+{
+    int ret;
+
+    /* Disabled, nothing would drain the queue */
+    if (!cap->writer_running)
+        return -ENODEV;
+
+    if ((ret = drmlist_capture_alloc(cap)))
+        return ret;
+
+    cap->screenshot_requested = true;
+    return 0;
+}
+
+int drmlist_capture_record_start(drmlist_capture_t* cap)
+{
+    int ret;
+
+    if (cap->recording)
+        return 0;
+
+    if (!cap->writer_running)
+        return -ENODEV;
+
+    if ((ret = drmlist_capture_alloc(cap)))
+        return ret;
+
+    cap->recording = true;
+    return 0;
+}
+
+void drmlist_capture_record_stop(drmlist_capture_t* cap)
+{
+    if (!cap->recording)
+        return;
+
+    cap->recording = false;
+    cap->record_started = false;
+    capture_submit(cap, CAPTURE_JOB_RECORD_END, -1, 0);
+    drmlist_capture_print_stats(cap);
+}
+
+/*
+ * Copies `fb` into a free staging buffer for a `type` job, false (and counted
+ * as dropped) when the writer fell behind
+ */
+static bool capture_stage(drmlist_capture_t* cap, mydrm_fb_t* fb, uint32_t type, uint64_t seq)
+{
+    drmlist_capture_job_t job;
+
+    if (fb->size != cap->size || !capture_queue_pop(&cap->free, &job))
+    {
+        /* Writer fell behind, don't wait for it */
+        cap->dropped++;
+        return false;
+    }
+
+    /*
+     * Non-temporal loads and stores: dumb buffers are often write-combined,
+     * where normal loads are uncached and painfully slow, and the staging
+     * copy is not read again on this core
+     */
+    drmlist_kernels.stream(cap->staging[job.staging], fb->pixels, fb->size);
+
+    if (!capture_submit(cap, type, job.staging, seq))
+    {
+        capture_queue_push(&cap->free, &job);
+        cap->dropped++;
+        return false;
+    }
+
+    cap->captured++;
+    return true;
+}
+
+/*
+ * Called by the render loop with the finished back buffer. A screenshot
+ * taken while recording gets its own staging buffer, the recording keeps
+ * the frame.
+ */
+void drmlist_capture_frame(drmlist_capture_t* cap, mydrm_fb_t* fb, uint64_t seq)
+{
+    if (!cap->writer_running || (!cap->screenshot_requested && !cap->recording))
+        return;
+
+    if (cap->screenshot_requested && capture_stage(cap, fb, CAPTURE_JOB_SCREENSHOT, seq))
+        cap->screenshot_requested = false;
+
+    if (!cap->recording)
+        return;
+
+    if (!cap->record_started && !(cap->record_started = capture_submit(cap, CAPTURE_JOB_RECORD_START, -1, seq)))
+        return;
+
+    capture_stage(cap, fb, CAPTURE_JOB_RECORD_FRAME, seq);
+}
+
+void drmlist_capture_print_stats(drmlist_capture_t* cap)
+{
+    uint64_t written = atomic_load(&cap->written);
+    uint64_t write_ns = atomic_load(&cap->write_ns);
+
+    printf("Capture: captured: %lu, written: %lu, dropped: %lu, %.1f MiB written, %.2f ms/frame in writer\n",
+                    cap->captured, written, cap->dropped, atomic_load(&cap->bytes_written) / (1024.0 * 1024.0),
+                    written ? write_ns / 1e6 / written : 0.0);
+}
+
+void drmlist_capture_cleanup(drmlist_capture_t* cap)
+{
+    if (cap->writer_running)
+    {
+        drmlist_capture_record_stop(cap);
+
+        /* The queue is drained in order, so everything captured is written before QUIT */
+        while (!capture_submit(cap, CAPTURE_JOB_QUIT, -1, 0))
+            usleep(1000);
+
+        pthread_join(cap->writer, NULL);
+        sem_destroy(&cap->queue_sem);
+        cap->writer_running = false;
+
+        if (cap->captured)
+            drmlist_capture_print_stats(cap);
+    }
+
+    for (int i = 0; i < cap->n_staging; i++)
+        drmlist_huge_free(cap->staging[i], cap->size);
+}
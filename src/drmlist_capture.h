@@ -0,0 +1,96 @@
+#ifndef _DRMLIST_CAPTURE_H_
+#define _DRMLIST_CAPTURE_H_
+
+#include "mydrm/mydrm.h"
+#include <stdatomic.h>
+#include <pthread.h>
+#include <semaphore.h>
+
+/*
+ * Non-blocking frame capture
+ *
+ * The render loop copies the finished back buffer into a pooled staging buffer
+ * and queues it, a writer thread does the encoding and the file I/O. When every
+ * staging buffer is busy the frame is dropped and counted, the render loop
+ * never waits for the writer.
+ */
+
+#define DRMLIST_CAPTURE_MAX_BUFFERS 8
+#define DRMLIST_CAPTURE_DEFAULT_BUFFERS 3
+#define DRMLIST_CAPTURE_QUEUE_SIZE 32   // power of two
+
+enum drmlist_capture_format
+{
+    DRMLIST_CAPTURE_PPM = 0,    // screenshots, one file per frame
+    DRMLIST_CAPTURE_Y4M = 1,    // recording, YUV 4:4:4
+    DRMLIST_CAPTURE_RAW = 2     // recording, packed XRGB8888 frames
+};
+
+enum drmlist_capture_job_type
+{
+    CAPTURE_JOB_SCREENSHOT = 0,
+    CAPTURE_JOB_RECORD_START = 1,
+    CAPTURE_JOB_RECORD_FRAME = 2,
+    CAPTURE_JOB_RECORD_END = 3,
+    CAPTURE_JOB_QUIT = 4
+};
+
+typedef struct
+{
+    uint32_t type;
+    int32_t staging;        // staging buffer index, -1 for control jobs
+    uint64_t seq;
+} drmlist_capture_job_t;
+
+typedef struct
+{
+    _Atomic uint32_t head;
+    uint8_t pad0[60];
+    _Atomic uint32_t tail;
+    uint8_t pad1[60];
+    drmlist_capture_job_t jobs[DRMLIST_CAPTURE_QUEUE_SIZE];
+} drmlist_capture_queue_t;
+
+typedef struct
+{
+    uint8_t* staging[DRMLIST_CAPTURE_MAX_BUFFERS];  // allocated on the first request
+    int n_staging;
+    uint32_t width;
+    uint32_t height;
+    uint32_t stride;
+    uint32_t size;
+    uint32_t refresh;
+
+    const char* dir;
+    uint32_t record_format;
+    bool screenshot_requested;
+    bool recording;
+    bool record_started;
+
+    /* render loop -> writer */
+    drmlist_capture_queue_t queue;
+    sem_t queue_sem;
+    /* writer -> render loop, staging indices stored in job.staging */
+    drmlist_capture_queue_t free;
+
+    pthread_t writer;
+    bool writer_running;
+
+    /* Written by the render loop */
+    uint64_t captured;
+    uint64_t dropped;
+    /* Written by the writer */
+    _Atomic uint64_t written;
+    _Atomic uint64_t bytes_written;
+    _Atomic uint64_t write_ns;
+} drmlist_capture_t;
+
+int drmlist_capture_init(drmlist_capture_t* cap, mydrm_fb_t* fb, uint32_t refresh, const char* dir, uint32_t record_format, int n_staging);
+int drmlist_capture_screenshot(drmlist_capture_t* cap);
+int drmlist_capture_record_start(drmlist_capture_t* cap);
+void drmlist_capture_record_stop(drmlist_capture_t* cap);
+void drmlist_capture_frame(drmlist_capture_t* cap, mydrm_fb_t* fb, uint64_t seq);
+void drmlist_capture_print_stats(drmlist_capture_t* cap);
+void drmlist_capture_cleanup(drmlist_capture_t* cap);
+
+#endif // _DRMLIST_CAPTURE_H_
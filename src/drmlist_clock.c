@@ -0,0 +1,124 @@
+#include "drmlist_clock.h"
+
+static uint64_t clock_monotonic_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+void drmlist_clock_init(drmlist_clock_t* clk, uint32_t sim_hz, uint64_t refresh_ns, bool virtual_time)
+{
+    memset(clk, 0, sizeof(drmlist_clock_t));
+    clk->virtual_time = virtual_time;
+
+    clk->step_ns = 1000000000ull / (sim_hz ? sim_hz : 240);
+    clk->refresh_ns = refresh_ns ? refresh_ns : 1000000000ull / 60;
+    clk->sim_time_ns = drmlist_clock_now(clk);
+}
+
+uint64_t drmlist_clock_now(drmlist_clock_t* clk)
+{
+    return clk->virtual_time ? clk->virtual_now_ns : clock_monotonic_ns();
+}
+
+void drmlist_clock_set_now(drmlist_clock_t* clk, uint64_t now_ns)
+{
+    clk->virtual_now_ns = now_ns;
+}
+
+/*
+ * Exact refresh interval from the mode timings, vrefresh is rounded
+ */
+uint64_t drmlist_clock_mode_refresh_ns(struct drm_mode_modeinfo* mode)
+{
+    if (!mode->clock || !mode->htotal || !mode->vtotal)
+        return mode->vrefresh ? 1000000000ull / mode->vrefresh : 0;
+
+    return (uint64_t)mode->htotal * mode->vtotal * 1000000ull / mode->clock;
+}
+
+/*
+ * Feed a page flip completion, keeps a running estimate of the refresh interval
+ */
+void drmlist_clock_flip(drmlist_clock_t* clk, uint32_t tv_sec, uint32_t tv_usec)
+{
+    uint64_t t = clk->flip_timestamps ? (uint64_t)tv_sec * 1000000000ull + (uint64_t)tv_usec * 1000ull : drmlist_clock_now(clk);
+
+    if (clk->last_flip_ns && t > clk->last_flip_ns)
+    {
+        uint64_t delta = t - clk->last_flip_ns;
+        uint64_t vblanks = (delta + clk->refresh_ns / 2) / clk->refresh_ns;
+
+        /* Missed vblanks show up as multiples of the interval */
+        if (vblanks >= 1 && vblanks <= 8)
+        {
+            int64_t error = (int64_t)(delta / vblanks) - (int64_t)clk->refresh_ns;
+            clk->refresh_ns += error / 16;
+        }
+    }
+
+    clk->last_flip_ns = t;
+}
+
+/*
+ * First vblank after now, that is when a frame rendered now can be on screen
+ */
+uint64_t drmlist_clock_predict_present(drmlist_clock_t* clk)
+{
+    uint64_t now = drmlist_clock_now(clk);
+    uint64_t t;
+
+    if (!clk->last_flip_ns || clk->last_flip_ns > now)
+        return now + clk->refresh_ns;
+
+    t = clk->last_flip_ns + clk->refresh_ns;
+    if (t <= now)
+        t += ((now - t) / clk->refresh_ns + 1) * clk->refresh_ns;
+
+    return t;
+}
+
+/*
+ * Number of fixed steps to run so the simulation reaches `target_ns`
+ */
+uint32_t drmlist_clock_advance(drmlist_clock_t* clk, uint64_t target_ns)
+{
+    uint32_t steps = 0;
+
+    if (target_ns > clk->sim_time_ns + DRMLIST_CLOCK_MAX_CATCHUP_NS)
+    {
+        uint64_t skip = target_ns - clk->sim_time_ns - DRMLIST_CLOCK_MAX_CATCHUP_NS;
+
+        skip -= skip % clk->step_ns;
+        clk->sim_time_ns += skip;
+        clk->skipped_ns += skip;
+    }
+
+    while (clk->sim_time_ns < target_ns)
+    {
+        clk->sim_time_ns += clk->step_ns;
+        steps++;
+    }
+
+    clk->steps += steps;
+
+    return steps;
+}
+
+/*
+ * Interpolation factor between the previous step (0.0) and the newest one (1.0)
+ */
+float drmlist_clock_alpha(drmlist_clock_t* clk, uint64_t target_ns)
+{
+    uint64_t behind;
+
+    if (target_ns >= clk->sim_time_ns)
+        return 1.0f;
+
+    behind = clk->sim_time_ns - target_ns;
+    if (behind >= clk->step_ns)
+        return 0.0f;
+
+    return 1.0f - (float)behind / clk->step_ns;
+}
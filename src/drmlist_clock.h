@@ -0,0 +1,47 @@
+#ifndef _DRMLIST_CLOCK_H_
+#define _DRMLIST_CLOCK_H_
+
+#include "mydrm/mydrm.h"
+#include <time.h>
+
+/*
+ * Fixed timestep clock
+ *
+ * The simulation advances in fixed `step_ns` steps on CLOCK_MONOTONIC, no matter
+ * how often frames are rendered. Each frame asks for the predicted presentation
+ * time (next vblank, from page flip timestamps), steps the simulation up to it
+ * and interpolates between the last two steps. A missed frame then only costs
+ * smoothness, positions stay correct.
+ *
+ * With `virtual_time` the clock never reads CLOCK_MONOTONIC, time only moves
+ * through drmlist_clock_set_now(), so simulations can run faster than real time.
+ */
+
+#define DRMLIST_CLOCK_MAX_CATCHUP_NS 1000000000ull   // stall longer than this and time is skipped
+
+typedef struct
+{
+    uint64_t step_ns;
+    uint64_t sim_time_ns;       // time of the newest simulation step
+    uint64_t refresh_ns;        // estimated vblank interval
+    uint64_t last_flip_ns;      // last page flip timestamp, 0 if unknown
+    uint64_t steps;
+    uint64_t skipped_ns;
+
+    bool flip_timestamps;       // DRM flip timestamps are CLOCK_MONOTONIC
+    bool virtual_time;
+    uint64_t virtual_now_ns;
+} drmlist_clock_t;
+
+void drmlist_clock_init(drmlist_clock_t* clk, uint32_t sim_hz, uint64_t refresh_ns, bool virtual_time);
+uint64_t drmlist_clock_now(drmlist_clock_t* clk);
+void drmlist_clock_set_now(drmlist_clock_t* clk, uint64_t now_ns);
+uint64_t drmlist_clock_mode_refresh_ns(struct drm_mode_modeinfo* mode);
+
+void drmlist_clock_flip(drmlist_clock_t* clk, uint32_t tv_sec, uint32_t tv_usec);
+uint64_t drmlist_clock_predict_present(drmlist_clock_t* clk);
+
+uint32_t drmlist_clock_advance(drmlist_clock_t* clk, uint64_t target_ns);
+float drmlist_clock_alpha(drmlist_clock_t* clk, uint64_t target_ns);
+
+#endif // _DRMLIST_CLOCK_H_
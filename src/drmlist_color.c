@@ -0,0 +1,658 @@
+#include "drmlist_color.h"
+#include <math.h>
+#include <time.h>
+
+static const char* color_prop_names[DRMLIST_COLOR_PROPS] = { "DEGAMMA_LUT", "CTM", "GAMMA_LUT" };
+static const char* color_size_names[DRMLIST_COLOR_PROPS] = { "DEGAMMA_LUT_SIZE", NULL, "GAMMA_LUT_SIZE" };
+
+/* Rec.709 luma, saturation keeps it */
+static const double color_luma[3] = { 0.2126, 0.7152, 0.0722 };
+
+static uint64_t color_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static inline double color_clamp(double v)
+{
+    return v < 0.0 ? 0.0 : v > 1.0 ? 1.0 : v;
+}
+
+static inline uint16_t color_u16(double v)
+{
+    return (uint16_t)(color_clamp(v) * 65535.0 + 0.5);
+}
+
+static inline double srgb_to_linear(double v)
+{
+    return v <= 0.04045 ? v / 12.92 : pow((v + 0.055) / 1.055, 2.4);
+}
+
+static inline double linear_to_srgb(double v)
+{
+    return v <= 0.0031308 ? v * 12.92 : 1.055 * pow(v, 1.0 / 2.4) - 0.055;
+}
+
+/*
+ * Blackbody colour at `k` on 0-255 (Tanner Helland's fit), good to about 1%
+ * over DRMLIST_COLOR_MIN_K - DRMLIST_COLOR_MAX_K
+ */
+static void color_blackbody(double k, double rgb[3])
+{
+    double t = k / 100.0;
+
+    rgb[0] = t <= 66.0 ? 255.0 : 329.698727446 * pow(t - 60.0, -0.1332047592);
+    rgb[1] = t <= 66.0 ? 99.4708025861 * log(t) - 161.1195681661 : 288.1221695283 * pow(t - 60.0, -0.0755148492);
+    rgb[2] = t >= 66.0 ? 255.0 : t <= 19.0 ? 0.0 : 138.5177312231 * log(t - 10.0) - 305.0447927307;
+}
+
+/* Linear light gains moving white to `k`, the largest 1 so nothing clips */
+static void color_temperature_gains(double k, double gains[3])
+{
+    double ref[3], rgb[3], max = 0.0;
+
+    color_blackbody(DRMLIST_COLOR_NEUTRAL_K, ref);
+    color_blackbody(k, rgb);
+
+    for (int i = 0; i < 3; i++)
+    {
+        gains[i] = srgb_to_linear(color_clamp(rgb[i] / 255.0)) / srgb_to_linear(color_clamp(ref[i] / 255.0));
+        if (gains[i] > max)
+            max = gains[i];
+    }
+
+    for (int i = 0; i < 3; i++)
+        gains[i] /= max;
+}
+
+static bool color_neutral_temperature(const drmlist_color_params_t* p)
+{
+    return fabsf(p->temperature - DRMLIST_COLOR_NEUTRAL_K) < 1.0f;
+}
+
+bool drmlist_color_neutral(const drmlist_color_params_t* p)
+{
+    return p->brightness == 1.0f && p->contrast == 1.0f && p->gamma == 1.0f && p->saturation == 1.0f &&
+                    color_neutral_temperature(p) && !p->curve_size;
+}
+
+/* Contrast around mid grey, gamma, brightness and the calibration curve on an encoded value */
+static double color_adjust(const drmlist_color_params_t* p, int channel, double v)
+{
+    v = color_clamp((v - 0.5) * p->contrast + 0.5);
+    if (p->gamma != 1.0f)
+        v = pow(v, 1.0 / p->gamma);
+    v = color_clamp(v * p->brightness);
+
+    if (p->curve_size)
+    {
+        double x = v * (p->curve_size - 1);
+        uint32_t i = (uint32_t)x;
+        double f;
+
+        if (i >= p->curve_size - 1)
+            return p->curve[(p->curve_size - 1) * 3 + channel];
+
+        f = x - i;
+        v = p->curve[i * 3 + channel] * (1.0 - f) + p->curve[(i + 1) * 3 + channel] * f;
+    }
+
+    return v;
+}
+
+/*
+ * Encoded input to output for one channel, with the temperature folded in
+ * (no CTM). Linear light only when there's a temperature to apply.
+ */
+static double color_channel(const drmlist_color_params_t* p, const double gains[3], int channel, double v)
+{
+    if (gains[channel] != 1.0)
+        v = linear_to_srgb(srgb_to_linear(v) * gains[channel]);
+
+    return color_adjust(p, channel, v);
+}
+
+uint64_t drmlist_color_ctm_fixed(double v)
+{
+    uint64_t m = (uint64_t)(fabs(v) * 4294967296.0 + 0.5);
+
+    return v < 0.0 ? m | (1ull << 63) : m;
+}
+
+void drmlist_color_degamma_lut(struct drm_color_lut* lut, uint32_t n)
+{
+    for (uint32_t i = 0; i < n; i++)
+    {
+        uint16_t v = color_u16(srgb_to_linear((double)i / (n - 1)));
+
+        lut[i] = (struct drm_color_lut){ v, v, v, 0 };
+    }
+}
+
+void drmlist_color_ctm(const drmlist_color_params_t* p, struct drm_color_ctm* m)
+{
+    double gains[3] = { 1.0, 1.0, 1.0 };
+
+    if (!color_neutral_temperature(p))
+        color_temperature_gains(p->temperature, gains);
+
+    /* Row-major, out = M * in: the white point gains after the saturation around luma */
+    for (int row = 0; row < 3; row++)
+        for (int col = 0; col < 3; col++)
+            m->matrix[row * 3 + col] = drmlist_color_ctm_fixed(gains[row] * ((1.0 - p->saturation) * color_luma[col] +
+                                                                             (row == col ? p->saturation : 0.0)));
+}
+
+void drmlist_color_gamma_lut(const drmlist_color_params_t* p, bool linear, struct drm_color_lut* lut, uint32_t n)
+{
+    double gains[3] = { 1.0, 1.0, 1.0 };
+
+    /* In the CTM when the values are linear */
+    if (!linear && !color_neutral_temperature(p))
+        color_temperature_gains(p->temperature, gains);
+
+    for (uint32_t i = 0; i < n; i++)
+    {
+        double v = (double)i / (n - 1);
+
+        if (linear)
+        {
+            v = linear_to_srgb(v);
+            lut[i] = (struct drm_color_lut){ color_u16(color_adjust(p, 0, v)), color_u16(color_adjust(p, 1, v)),
+                                             color_u16(color_adjust(p, 2, v)), 0 };
+        }
+        else
+            lut[i] = (struct drm_color_lut){ color_u16(color_channel(p, gains, 0, v)), color_u16(color_channel(p, gains, 1, v)),
+                                             color_u16(color_channel(p, gains, 2, v)), 0 };
+    }
+}
+
+void drmlist_color_params_init(drmlist_color_params_t* p)
+{
+    memset(p, 0, sizeof(drmlist_color_params_t));
+    p->brightness = 1.0f;
+    p->contrast = 1.0f;
+    p->gamma = 1.0f;
+    p->temperature = DRMLIST_COLOR_NEUTRAL_K;
+    p->saturation = 1.0f;
+}
+
+void drmlist_color_params_free(drmlist_color_params_t* p)
+{
+    free(p->curve);
+    p->curve = NULL;
+    p->curve_size = 0;
+}
+
+static int color_set(drmlist_color_params_t* p, const char* key, const char* value)
+{
+    char* end;
+    float v = strtof(value, &end);
+
+    if (end == value || *end)
+    {
+        fprintf(stderr, "color: %s: \"%s\" isn't a number\n", key, value);
+        return -EINVAL;
+    }
+
+    if (!strcmp(key, "brightness") && v >= 0.0f && v <= 1.0f)
+        p->brightness = v;
+    else if (!strcmp(key, "contrast") && v >= 0.0f && v <= 4.0f)
+        p->contrast = v;
+    else if (!strcmp(key, "gamma") && v >= 0.1f && v <= 10.0f)
+        p->gamma = v;
+    else if (!strcmp(key, "temperature") && v >= DRMLIST_COLOR_MIN_K && v <= DRMLIST_COLOR_MAX_K)
+        p->temperature = v;
+    else if (!strcmp(key, "saturation") && v >= 0.0f && v <= 4.0f)
+        p->saturation = v;
+    else
+    {
+        fprintf(stderr, "color: %s=%s, expected brightness=0-1, contrast=0-4, gamma=0.1-10, temperature=%u-%u, "
+                        "saturation=0-4\n", key, value, DRMLIST_COLOR_MIN_K, DRMLIST_COLOR_MAX_K);
+        return -EINVAL;
+    }
+
+    return 0;
+}
+
+int drmlist_color_parse(drmlist_color_params_t* p, const char* str)
+{
+    char* copy = strdup(str);
+    char* save = NULL;
+    int ret = 0;
+
+    if (!copy)
+        return -ENOMEM;
+
+    for (char* tok = strtok_r(copy, " ,\t\n", &save); tok && !ret; tok = strtok_r(NULL, " ,\t\n", &save))
+    {
+        char* eq = strchr(tok, '=');
+
+        if (!eq)
+        {
+            fprintf(stderr, "color: \"%s\", expected key=value\n", tok);
+            ret = -EINVAL;
+            break;
+        }
+
+        *eq = '\0';
+        ret = color_set(p, tok, eq + 1);
+    }
+
+    free(copy);
+    return ret;
+}
+
+int drmlist_color_load(drmlist_color_params_t* p, const char* path)
+{
+    FILE* f;
+    char* line = NULL;
+    size_t line_size = 0;
+    unsigned long lineno = 0;
+    float* curve = NULL;
+    uint32_t n = 0;
+    bool in_curve = false;
+    int ret = 0;
+
+    if ((f = fopen(path, "r")) == NULL)
+    {
+        perror(path);
+        return -errno;
+    }
+
+    while (!ret && getline(&line, &line_size, f) != -1)
+    {
+        char key[32], value[32];
+        float rgb[3];
+        char* s = line;
+
+        lineno++;
+        while (*s == ' ' || *s == '\t')
+            s++;
+        if (*s == '#' || *s == '\n' || *s == '\0')
+            continue;
+
+        if (in_curve && sscanf(s, "%f %f %f", &rgb[0], &rgb[1], &rgb[2]) == 3)
+        {
+            if (n == DRMLIST_COLOR_MAX_CURVE)
+            {
+                fprintf(stderr, "%s:%lu: More than %u curve points\n", path, lineno, DRMLIST_COLOR_MAX_CURVE);
+                ret = -EINVAL;
+                break;
+            }
+
+            if (!curve && (curve = malloc(DRMLIST_COLOR_MAX_CURVE * 3 * sizeof(float))) == NULL)
+            {
+                ret = -ENOMEM;
+                break;
+            }
+
+            for (int i = 0; i < 3; i++)
+                curve[n * 3 + i] = color_clamp(rgb[i]);
+            n++;
+        }
+        else if (!strncmp(s, "curve", 5) && (s[5] == '\n' || s[5] == '\0' || s[5] == ' '))
+            in_curve = true;
+        else if (sscanf(s, "%31[a-z] %31s", key, value) == 2)
+        {
+            in_curve = false;
+            if (color_set(p, key, value))
+            {
+                fprintf(stderr, "%s:%lu: Bad setting\n", path, lineno);
+                ret = -EINVAL;
+            }
+        }
+        else
+        {
+            fprintf(stderr, "%s:%lu: Expected \"<key> <value>\", \"curve\" or \"<r> <g> <b>\"\n", path, lineno);
+            ret = -EINVAL;
+        }
+    }
+
+    if (!ret && in_curve && n < 2)
+    {
+        fprintf(stderr, "%s: A curve needs 2 points or more\n", path);
+        ret = -EINVAL;
+    }
+
+    if (!ret && n)
+    {
+        free(p->curve);
+        p->curve = curve;
+        p->curve_size = n;
+        curve = NULL;
+    }
+
+    free(curve);
+    free(line);
+    fclose(f);
+    return ret;
+}
+
+/* Contents of the blob `prop` refers to, NULL for none */
+static int color_save_blob(drmlist_color_t* c, mydrm_props_t* props, int i)
+{
+    uint64_t blob_id = 0;
+    uint32_t len = 0;
+
+    if (!mydrm_props_value(props, MYDRM_PROP_TYPE_CRTC, c->crtc_id, color_prop_names[i], &blob_id) || !blob_id)
+        return 0;
+
+    if (mydrm_get_blob(c->fd, blob_id, NULL, &len) == -1 || !len)
+        return -errno;
+
+    if ((c->saved[i] = malloc(len)) == NULL)
+        return -ENOMEM;
+
+    c->saved_len[i] = len;
+    if (mydrm_get_blob(c->fd, blob_id, c->saved[i], &c->saved_len[i]) == -1 || c->saved_len[i] != len ||
+        (c->last[i] = malloc(len)) == NULL)
+    {
+        free(c->saved[i]);
+        c->saved[i] = NULL;
+        return -EIO;
+    }
+
+    /* What's on the CRTC, so setting it again is skipped */
+    memcpy(c->last[i], c->saved[i], len);
+    c->last_len[i] = len;
+
+    return 0;
+}
+
+int drmlist_color_init(drmlist_color_t* c, int fd, uint32_t crtc_id, mydrm_props_t* props, uint32_t legacy_size)
+{
+    uint64_t size;
+
+    memset(c, 0, sizeof(drmlist_color_t));
+    c->fd = fd;
+    c->crtc_id = crtc_id;
+    drmlist_color_params_init(&c->params);
+
+    for (int i = 0; i < DRMLIST_COLOR_PROPS; i++)
+    {
+        if (!(c->prop[i] = mydrm_props_id(props, MYDRM_PROP_TYPE_CRTC, crtc_id, color_prop_names[i])))
+            continue;
+
+        if (color_size_names[i] && (!mydrm_props_value(props, MYDRM_PROP_TYPE_CRTC, crtc_id, color_size_names[i], &size) ||
+                                    size < 2 || size > 65536))
+        {
+            c->prop[i] = 0;
+            continue;
+        }
+        c->lut_size[i] = color_size_names[i] ? size : 0;
+
+        /* Unreadable, left alone rather than not put back */
+        if (color_save_blob(c, props, i))
+        {
+            fprintf(stderr, "CRTC %u: can't read %s, leaving it alone\n", crtc_id, color_prop_names[i]);
+            c->prop[i] = 0;
+        }
+    }
+
+    if (c->prop[DRMLIST_COLOR_GAMMA])
+    {
+        c->path = DRMLIST_COLOR_LUT;
+        return 0;
+    }
+
+    if (!legacy_size)
+        return -ENOTSUP;
+
+    c->gamma_size = legacy_size;
+    if ((c->saved_ramp = malloc(legacy_size * 3 * sizeof(uint16_t))) == NULL ||
+        (c->ramp = malloc(legacy_size * 3 * sizeof(uint16_t))) == NULL)
+        return -ENOMEM;
+
+    if (mydrm_get_gamma(fd, crtc_id, legacy_size, c->saved_ramp, c->saved_ramp + legacy_size,
+                        c->saved_ramp + legacy_size * 2) == -1)
+        return -errno;
+
+    c->path = DRMLIST_COLOR_LEGACY;
+    return 0;
+}
+
+/*
+ * Sets `prop` to a blob of `data` (NULL for bypass) unless that's what it
+ * already holds. The blob is dropped right away, the property keeps it.
+ */
+static int color_set_blob(drmlist_color_t* c, int i, const void* data, uint32_t len)
+{
+    uint32_t blob_id = 0;
+    void* last = NULL;
+    int ret;
+
+    if (!c->prop[i])
+        return 0;
+
+    if (c->last_len[i] == len && (!len || !memcmp(c->last[i], data, len)))
+        return 0;
+
+    if (len)
+    {
+        if ((last = malloc(len)) == NULL)
+            return -ENOMEM;
+        memcpy(last, data, len);
+
+        c->ioctls++;
+        if (mydrm_create_blob(c->fd, data, len, &blob_id) == -1)
+        {
+            ret = -errno;
+            fprintf(stderr, "CRTC %u: creating the %s blob: %s\n", c->crtc_id, color_prop_names[i], strerror(errno));
+            free(last);
+            return ret;
+        }
+    }
+
+    c->ioctls++;
+    ret = mydrm_set_property(c->fd, c->crtc_id, DRM_MODE_OBJECT_CRTC, c->prop[i], blob_id) == -1 ? -errno : 0;
+    if (ret)
+        fprintf(stderr, "CRTC %u: setting %s: %s\n", c->crtc_id, color_prop_names[i], strerror(-ret));
+
+    if (blob_id)
+    {
+        c->ioctls++;
+        mydrm_destroy_blob(c->fd, blob_id);
+    }
+
+    if (ret)
+    {
+        free(last);
+        return ret;
+    }
+
+    free(c->last[i]);
+    c->last[i] = last;
+    c->last_len[i] = len;
+    c->changed = true;
+
+    return 0;
+}
+
+/* A CTM on encoded values would skew hues, it needs a DEGAMMA_LUT before it */
+static bool color_linear(drmlist_color_t* c)
+{
+    return c->prop[DRMLIST_COLOR_CTM] && c->prop[DRMLIST_COLOR_DEGAMMA];
+}
+
+static int color_apply_lut(drmlist_color_t* c)
+{
+    const drmlist_color_params_t* p = &c->params;
+    bool ctm = color_linear(c);
+    uint32_t n = c->lut_size[DRMLIST_COLOR_GAMMA];
+    struct drm_color_lut* lut;
+    int ret;
+
+    if (drmlist_color_neutral(p))
+    {
+        for (int i = 0; i < DRMLIST_COLOR_PROPS; i++)
+            if ((ret = color_set_blob(c, i, NULL, 0)))
+                return ret;
+        return 0;
+    }
+
+    if (ctm)
+    {
+        struct drm_color_lut* degamma;
+        struct drm_color_ctm matrix;
+        uint32_t nd = c->lut_size[DRMLIST_COLOR_DEGAMMA];
+
+        if ((degamma = malloc(nd * sizeof(struct drm_color_lut))) == NULL)
+            return -ENOMEM;
+
+        drmlist_color_degamma_lut(degamma, nd);
+        ret = color_set_blob(c, DRMLIST_COLOR_DEGAMMA, degamma, nd * sizeof(struct drm_color_lut));
+        free(degamma);
+        if (ret)
+            return ret;
+
+        /* An identity matrix is bypass */
+        if (p->saturation == 1.0f && color_neutral_temperature(p))
+            ret = color_set_blob(c, DRMLIST_COLOR_CTM, NULL, 0);
+        else
+        {
+            drmlist_color_ctm(p, &matrix);
+            ret = color_set_blob(c, DRMLIST_COLOR_CTM, &matrix, sizeof(matrix));
+        }
+        if (ret)
+            return ret;
+    }
+    else
+    {
+        if (p->saturation != 1.0f)
+            fprintf(stderr, "CRTC %u has no CTM after a DEGAMMA_LUT, saturation isn't applied\n", c->crtc_id);
+
+        /* The gamma LUT does it all on encoded values */
+        if ((ret = color_set_blob(c, DRMLIST_COLOR_DEGAMMA, NULL, 0)) || (ret = color_set_blob(c, DRMLIST_COLOR_CTM, NULL, 0)))
+            return ret;
+    }
+
+    if ((lut = malloc(n * sizeof(struct drm_color_lut))) == NULL)
+        return -ENOMEM;
+
+    /* After the CTM the values are linear */
+    drmlist_color_gamma_lut(p, ctm, lut, n);
+    ret = color_set_blob(c, DRMLIST_COLOR_GAMMA, lut, n * sizeof(struct drm_color_lut));
+    free(lut);
+
+    return ret;
+}
+
+static int color_apply_legacy(drmlist_color_t* c)
+{
+    const drmlist_color_params_t* p = &c->params;
+    double gains[3] = { 1.0, 1.0, 1.0 };
+    uint32_t n = c->gamma_size;
+
+    if (p->saturation != 1.0f)
+        fprintf(stderr, "CRTC %u has only a gamma ramp, saturation isn't applied\n", c->crtc_id);
+
+    if (!color_neutral_temperature(p))
+        color_temperature_gains(p->temperature, gains);
+
+    for (uint32_t i = 0; i < n; i++)
+        for (int ch = 0; ch < 3; ch++)
+            c->ramp[ch * n + i] = color_u16(color_channel(p, gains, ch, (double)i / (n - 1)));
+
+    c->ioctls++;
+    if (mydrm_set_gamma(c->fd, c->crtc_id, n, c->ramp, c->ramp + n, c->ramp + n * 2) == -1)
+    {
+        perror("ioctl DRM_IOCTL_MODE_SETGAMMA");
+        return -errno;
+    }
+
+    c->changed = true;
+    return 0;
+}
+
+int drmlist_color_apply(drmlist_color_t* c)
+{
+    uint64_t start = color_now_ns();
+    int ret;
+
+    switch (c->path)
+    {
+        case DRMLIST_COLOR_LUT:
+            ret = color_apply_lut(c);
+            break;
+        case DRMLIST_COLOR_LEGACY:
+            ret = color_apply_legacy(c);
+            break;
+        default:
+            return -ENOTSUP;
+    }
+
+    c->updates++;
+    c->update_ns += color_now_ns() - start;
+
+    return ret;
+}
+
+void drmlist_color_restore(drmlist_color_t* c)
+{
+    drmlist_color_params_free(&c->params);
+    drmlist_color_params_init(&c->params);
+
+    if (!c->changed)
+        return;
+
+    if (c->path == DRMLIST_COLOR_LEGACY)
+    {
+        c->ioctls++;
+        if (mydrm_set_gamma(c->fd, c->crtc_id, c->gamma_size, c->saved_ramp, c->saved_ramp + c->gamma_size,
+                            c->saved_ramp + c->gamma_size * 2) == -1)
+            perror("ioctl DRM_IOCTL_MODE_SETGAMMA");
+    }
+    else if (c->path == DRMLIST_COLOR_LUT)
+    {
+        /* The original blobs may be gone with their owner, the contents are set again */
+        for (int i = 0; i < DRMLIST_COLOR_PROPS; i++)
+            color_set_blob(c, i, c->saved[i], c->saved_len[i]);
+    }
+
+    c->changed = false;
+}
+
+void drmlist_color_print(drmlist_color_t* c)
+{
+    const drmlist_color_params_t* p = &c->params;
+
+    if (c->path == DRMLIST_COLOR_NONE)
+    {
+        printf("Colour: no GAMMA_LUT or gamma ramp on CRTC %u\n", c->crtc_id);
+        return;
+    }
+
+    if (c->path == DRMLIST_COLOR_LUT)
+        printf("Colour: GAMMA_LUT %u%s", c->lut_size[DRMLIST_COLOR_GAMMA], color_linear(c) ? ", DEGAMMA_LUT and CTM" : "");
+    else
+        printf("Colour: gamma ramp %u", c->gamma_size);
+
+    printf(", brightness %.2f contrast %.2f gamma %.2f temperature %.0fK saturation %.2f", p->brightness,
+                    p->contrast, p->gamma, p->temperature, p->saturation);
+    if (p->curve_size)
+        printf(" curve %u points", p->curve_size);
+    printf("\n");
+
+    if (c->updates)
+        printf("Colour: %lu updates (%.1f us avg), %lu ioctls\n", c->updates, c->update_ns / 1e3 / c->updates, c->ioctls);
+}
+
+void drmlist_color_cleanup(drmlist_color_t* c)
+{
+    drmlist_color_restore(c);
+
+    for (int i = 0; i < DRMLIST_COLOR_PROPS; i++)
+    {
+        free(c->saved[i]);
+        free(c->last[i]);
+        c->saved[i] = c->last[i] = NULL;
+    }
+
+    free(c->saved_ramp);
+    free(c->ramp);
+    c->saved_ramp = c->ramp = NULL;
+    c->path = DRMLIST_COLOR_NONE;
+}
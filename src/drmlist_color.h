@@ -0,0 +1,123 @@
+#ifndef _DRMLIST_COLOR_H_
+#define _DRMLIST_COLOR_H_
+
+#include "mydrm/mydrm.h"
+
+/*
+ * Colour management on the CRTC
+ *
+ * Brightness, contrast, gamma, colour temperature (night mode), saturation
+ * and calibration curves are applied by the display pipeline, not the CPU,
+ * so a change costs a property update instead of a pass over every pixel.
+ *
+ * With the CRTC colour properties DEGAMMA_LUT takes the pixels to linear
+ * light, CTM applies the temperature and saturation there and GAMMA_LUT
+ * encodes them again with the adjustments and the calibration curve. Only
+ * the properties whose contents changed are set (a temperature change is one
+ * CTM update). Without a CTM the temperature is folded into the per-channel
+ * gamma LUT and saturation isn't available, without GAMMA_LUT the same curves
+ * go out as the legacy SETGAMMA ramp.
+ *
+ * Parameters are "key=value" lists (brightness, contrast, gamma,
+ * temperature, saturation) or calibration files: the same keys one per line,
+ * then optionally "curve" and two or more "r g b" lines (0 to 1, evenly
+ * spaced inputs) mapping each channel last.
+ */
+
+#define DRMLIST_COLOR_NEUTRAL_K 6500
+#define DRMLIST_COLOR_MIN_K 1000
+#define DRMLIST_COLOR_MAX_K 12000
+#define DRMLIST_COLOR_MAX_CURVE 4096
+
+enum drmlist_color_path
+{
+    DRMLIST_COLOR_NONE = 0,
+    DRMLIST_COLOR_LEGACY,           // SETGAMMA
+    DRMLIST_COLOR_LUT,              // GAMMA_LUT, DEGAMMA_LUT and CTM where there
+};
+
+enum drmlist_color_prop
+{
+    DRMLIST_COLOR_DEGAMMA = 0,
+    DRMLIST_COLOR_CTM,
+    DRMLIST_COLOR_GAMMA,
+    DRMLIST_COLOR_PROPS
+};
+
+typedef struct
+{
+    float brightness;               // output scale, 1 is neutral
+    float contrast;                 // around mid grey, 1 is neutral
+    float gamma;                    // 1 is neutral, over 1 brightens mid tones
+    float temperature;              // white point in K
+    float saturation;               // 1 is neutral, 0 is grey
+
+    /* Calibration curve, curve_size "r g b" points, applied last */
+    float* curve;
+    uint32_t curve_size;
+} drmlist_color_params_t;
+
+typedef struct
+{
+    int fd;
+    uint32_t crtc_id;
+    int path;
+    bool changed;                   // from what was there before init
+
+    /* DRMLIST_COLOR_LUT, by drmlist_color_prop, prop 0 if the CRTC doesn't have it */
+    uint32_t prop[DRMLIST_COLOR_PROPS];
+    uint32_t lut_size[DRMLIST_COLOR_PROPS];     // entries of the LUTs
+    void* saved[DRMLIST_COLOR_PROPS];           // blob contents before init, NULL for none
+    uint32_t saved_len[DRMLIST_COLOR_PROPS];
+    void* last[DRMLIST_COLOR_PROPS];            // what we set, NULL for none
+    uint32_t last_len[DRMLIST_COLOR_PROPS];
+
+    /* DRMLIST_COLOR_LEGACY, 3 channels of gamma_size */
+    uint32_t gamma_size;
+    uint16_t* saved_ramp;
+    uint16_t* ramp;
+
+    drmlist_color_params_t params;
+
+    /* Stats */
+    uint64_t updates;
+    uint64_t update_ns;
+    uint64_t ioctls;
+} drmlist_color_t;
+
+void drmlist_color_params_init(drmlist_color_params_t* p);
+void drmlist_color_params_free(drmlist_color_params_t* p);
+
+/* "key=value" separated by spaces or commas into `p`, -EINVAL with a message */
+int drmlist_color_parse(drmlist_color_params_t* p, const char* str);
+
+/* Calibration file into `p`, keys it doesn't have are left as they are in `p` */
+int drmlist_color_load(drmlist_color_params_t* p, const char* path);
+
+/*
+ * Finds the colour properties of `crtc_id` in `props` and saves their
+ * contents, `legacy_size` (the CRTC's gamma_size) for the SETGAMMA fallback
+ */
+int drmlist_color_init(drmlist_color_t* c, int fd, uint32_t crtc_id, mydrm_props_t* props, uint32_t legacy_size);
+
+/* Puts `c->params` on the CRTC */
+int drmlist_color_apply(drmlist_color_t* c);
+
+/* Back to what was there before init, neutral parameters */
+void drmlist_color_restore(drmlist_color_t* c);
+
+void drmlist_color_print(drmlist_color_t* c);
+void drmlist_color_cleanup(drmlist_color_t* c);
+
+/*
+ * What apply puts on the CRTC, without a device (drmlist_bench). The gamma
+ * LUT takes linear values (after DEGAMMA_LUT and CTM) when `linear`, encoded
+ * ones with the temperature folded in otherwise.
+ */
+bool drmlist_color_neutral(const drmlist_color_params_t* p);   // identity, every property can be bypass
+uint64_t drmlist_color_ctm_fixed(double v);                    // S31.32 sign-magnitude
+void drmlist_color_degamma_lut(struct drm_color_lut* lut, uint32_t n);
+void drmlist_color_ctm(const drmlist_color_params_t* p, struct drm_color_ctm* m);
+void drmlist_color_gamma_lut(const drmlist_color_params_t* p, bool linear, struct drm_color_lut* lut, uint32_t n);
+
+#endif // _DRMLIST_COLOR_H_
@@ -0,0 +1,950 @@
+#include "drmlist_convert.h"
+#include "drmlist_cpu.h"
+#include <immintrin.h>
+
+/*
+ * Every conversion goes through ARGB8888: the source row is decoded into
+ * ARGB8888, optionally (un)premultiplied, then encoded into the target.
+ * Rows are processed in chunks small enough to stay in L1.
+ */
+#define CONVERT_CHUNK 256
+
+typedef void (*to_argb_fn)(uint32_t* dst, const void* src, size_t n);
+typedef void (*from_argb_fn)(void* dst, const uint32_t* src, size_t n, const uint32_t* dither);
+typedef void (*alpha_fn)(uint32_t* pixels, size_t n);
+
+typedef struct
+{
+    uint32_t format;
+    uint32_t cpp;
+    const char* name;
+    to_argb_fn to_argb;
+    from_argb_fn from_argb;
+} convert_ops_t;
+
+typedef struct
+{
+    const convert_ops_t* formats;
+    alpha_fn premultiply;
+    alpha_fn unpremultiply;
+} convert_kernels_t;
+
+/* 4x4 Bayer matrix, thresholds 0..15 */
+static const uint8_t bayer4[4][4] = {
+    {  0,  8,  2, 10 },
+    { 12,  4, 14,  6 },
+    {  3, 11,  1,  9 },
+    { 15,  7, 13,  5 },
+};
+
+static inline uint32_t adds_u8x4(uint32_t a, uint32_t b)
+{
+    uint32_t ret = 0;
+
+    for (int s = 0; s < 32; s += 8)
+    {
+        uint32_t c = ((a >> s) & 0xFF) + ((b >> s) & 0xFF);
+        ret |= (c > 0xFF ? 0xFF : c) << s;
+    }
+
+    return ret;
+}
+
+/*
+ * Scalar reference kernels
+ */
+static void argb8888_to_argb_scalar(uint32_t* dst, const void* src, size_t n)
+{
+    if (dst != src)
+        memcpy(dst, src, n * 4);
+}
+
+static void xrgb8888_to_argb_scalar(uint32_t* dst, const void* src, size_t n)
+{
+    const uint32_t* s = src;
+
+    for (size_t i = 0; i < n; i++)
+        dst[i] = s[i] | 0xFF000000;
+}
+
+static void argb8888_from_argb_scalar(void* dst, const uint32_t* src, size_t n, const uint32_t* dither)
+{
+    if (dst != src)
+        memcpy(dst, src, n * 4);
+}
+
+static void rgb565_to_argb_scalar(uint32_t* dst, const void* src, size_t n)
+{
+    const uint16_t* s = src;
+
+    for (size_t i = 0; i < n; i++)
+    {
+        uint32_t r = (s[i] >> 11) & 0x1F;
+        uint32_t g = (s[i] >> 5) & 0x3F;
+        uint32_t b = s[i] & 0x1F;
+
+        r = (r << 3) | (r >> 2);
+        g = (g << 2) | (g >> 4);
+        b = (b << 3) | (b >> 2);
+
+        dst[i] = 0xFF000000 | (r << 16) | (g << 8) | b;
+    }
+}
+
+static void rgb565_from_argb_scalar(void* dst, const uint32_t* src, size_t n, const uint32_t* dither)
+{
+    uint16_t* d = dst;
+
+    for (size_t i = 0; i < n; i++)
+    {
+        uint32_t p = src[i];
+
+        if (dither)
+            p = adds_u8x4(p, dither[i & 3]);
+
+        d[i] = ((p >> 8) & 0xF800) | ((p >> 5) & 0x07E0) | ((p >> 3) & 0x001F);
+    }
+}
+
+static void xrgb2101010_to_argb_scalar(uint32_t* dst, const void* src, size_t n)
+{
+    const uint32_t* s = src;
+
+    for (size_t i = 0; i < n; i++)
+    {
+        uint32_t p = s[i];
+
+        dst[i] = 0xFF000000 | (((p >> 22) & 0xFF) << 16) | (((p >> 12) & 0xFF) << 8) | ((p >> 2) & 0xFF);
+    }
+}
+
+static void xrgb2101010_from_argb_scalar(void* dst, const uint32_t* src, size_t n, const uint32_t* dither)
+{
+    uint32_t* d = dst;
+
+    for (size_t i = 0; i < n; i++)
+    {
+        uint32_t r = (src[i] >> 16) & 0xFF;
+        uint32_t g = (src[i] >> 8) & 0xFF;
+        uint32_t b = src[i] & 0xFF;
+
+        r = (r << 2) | (r >> 6);
+        g = (g << 2) | (g >> 6);
+        b = (b << 2) | (b >> 6);
+
+        d[i] = 0xC0000000 | (r << 20) | (g << 10) | b;
+    }
+}
+
+static void rgb888_to_argb_scalar(uint32_t* dst, const void* src, size_t n)
+{
+    const uint8_t* s = src;
+
+    for (size_t i = 0; i < n; i++, s += 3)
+        dst[i] = 0xFF000000 | (s[2] << 16) | (s[1] << 8) | s[0];
+}
+
+static void rgb888_from_argb_scalar(void* dst, const uint32_t* src, size_t n, const uint32_t* dither)
+{
+    uint8_t* d = dst;
+
+    for (size_t i = 0; i < n; i++, d += 3)
+    {
+        d[0] = src[i];
+        d[1] = src[i] >> 8;
+        d[2] = src[i] >> 16;
+    }
+}
+
+static void premultiply_scalar(uint32_t* pixels, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        uint32_t p = pixels[i];
+        uint32_t a = p >> 24;
+        uint32_t ret = p & 0xFF000000;
+
+        for (int s = 0; s < 24; s += 8)
+        {
+            uint32_t t = ((p >> s) & 0xFF) * a + 128;
+            ret |= ((t + (t >> 8)) >> 8) << s;
+        }
+
+        pixels[i] = ret;
+    }
+}
+
+static void unpremultiply_scalar(uint32_t* pixels, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        uint32_t p = pixels[i];
+        uint32_t a = p >> 24;
+        uint32_t ret = p & 0xFF000000;
+
+        if (a == 0)
+        {
+            pixels[i] = 0;
+            continue;
+        }
+
+        for (int s = 0; s < 24; s += 8)
+        {
+            uint32_t c = (((p >> s) & 0xFF) * 255 + a / 2) / a;
+            ret |= (c > 0xFF ? 0xFF : c) << s;
+        }
+
+        pixels[i] = ret;
+    }
+}
+
+/*
+ * SSE2 kernels, the x86-64 baseline, 8 pixels per iteration in two halves.
+ * RGB888 needs byte shuffles (SSSE3) and stays scalar.
+ */
+static void xrgb8888_to_argb_sse2(uint32_t* dst, const void* src, size_t n)
+{
+    const uint32_t* s = src;
+    const __m128i alpha = _mm_set1_epi32(0xFF000000);
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4)
+    {
+        __m128i p = _mm_loadu_si128((const __m128i*)&s[i]);
+        _mm_storeu_si128((__m128i*)&dst[i], _mm_or_si128(p, alpha));
+    }
+
+    xrgb8888_to_argb_scalar(dst + i, s + i, n - i);
+}
+
+static inline __m128i rgb565_expand_sse2(__m128i p)
+{
+    const __m128i alpha = _mm_set1_epi32(0xFF000000);
+    const __m128i mask5 = _mm_set1_epi32(0x1F);
+    const __m128i mask6 = _mm_set1_epi32(0x3F);
+    __m128i r = _mm_and_si128(_mm_srli_epi32(p, 11), mask5);
+    __m128i g = _mm_and_si128(_mm_srli_epi32(p, 5), mask6);
+    __m128i b = _mm_and_si128(p, mask5);
+
+    r = _mm_or_si128(_mm_slli_epi32(r, 3), _mm_srli_epi32(r, 2));
+    g = _mm_or_si128(_mm_slli_epi32(g, 2), _mm_srli_epi32(g, 4));
+    b = _mm_or_si128(_mm_slli_epi32(b, 3), _mm_srli_epi32(b, 2));
+
+    return _mm_or_si128(_mm_or_si128(alpha, _mm_slli_epi32(r, 16)), _mm_or_si128(_mm_slli_epi32(g, 8), b));
+}
+
+static void rgb565_to_argb_sse2(uint32_t* dst, const void* src, size_t n)
+{
+    const uint16_t* s = src;
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8)
+    {
+        __m128i p = _mm_loadu_si128((const __m128i*)&s[i]);
+
+        _mm_storeu_si128((__m128i*)&dst[i], rgb565_expand_sse2(_mm_unpacklo_epi16(p, zero)));
+        _mm_storeu_si128((__m128i*)&dst[i + 4], rgb565_expand_sse2(_mm_unpackhi_epi16(p, zero)));
+    }
+
+    rgb565_to_argb_scalar(dst + i, s + i, n - i);
+}
+
+static inline __m128i rgb565_reduce_sse2(__m128i p, __m128i dvec)
+{
+    p = _mm_adds_epu8(p, dvec);
+    p = _mm_or_si128(_mm_or_si128(_mm_and_si128(_mm_srli_epi32(p, 8), _mm_set1_epi32(0xF800)),
+                                  _mm_and_si128(_mm_srli_epi32(p, 5), _mm_set1_epi32(0x07E0))),
+                     _mm_and_si128(_mm_srli_epi32(p, 3), _mm_set1_epi32(0x001F)));
+
+    /* Sign extend the low half, the signed pack then keeps it as is */
+    return _mm_srai_epi32(_mm_slli_epi32(p, 16), 16);
+}
+
+static void rgb565_from_argb_sse2(void* dst, const uint32_t* src, size_t n, const uint32_t* dither)
+{
+    uint16_t* d = dst;
+    __m128i dvec = _mm_setzero_si128();
+    size_t i = 0;
+
+    if (dither)
+        dvec = _mm_setr_epi32(dither[0], dither[1], dither[2], dither[3]);
+
+    for (; i + 8 <= n; i += 8)
+    {
+        __m128i lo = rgb565_reduce_sse2(_mm_loadu_si128((const __m128i*)&src[i]), dvec);
+        __m128i hi = rgb565_reduce_sse2(_mm_loadu_si128((const __m128i*)&src[i + 4]), dvec);
+
+        _mm_storeu_si128((__m128i*)&d[i], _mm_packs_epi32(lo, hi));
+    }
+
+    rgb565_from_argb_scalar(d + i, src + i, n - i, dither);
+}
+
+static void xrgb2101010_to_argb_sse2(uint32_t* dst, const void* src, size_t n)
+{
+    const uint32_t* s = src;
+    const __m128i alpha = _mm_set1_epi32(0xFF000000);
+    const __m128i mask8 = _mm_set1_epi32(0xFF);
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4)
+    {
+        __m128i p = _mm_loadu_si128((const __m128i*)&s[i]);
+
+        __m128i r = _mm_and_si128(_mm_srli_epi32(p, 22), mask8);
+        __m128i g = _mm_and_si128(_mm_srli_epi32(p, 12), mask8);
+        __m128i b = _mm_and_si128(_mm_srli_epi32(p, 2), mask8);
+
+        p = _mm_or_si128(_mm_or_si128(alpha, _mm_slli_epi32(r, 16)), _mm_or_si128(_mm_slli_epi32(g, 8), b));
+
+        _mm_storeu_si128((__m128i*)&dst[i], p);
+    }
+
+    xrgb2101010_to_argb_scalar(dst + i, s + i, n - i);
+}
+
+static void xrgb2101010_from_argb_sse2(void* dst, const uint32_t* src, size_t n, const uint32_t* dither)
+{
+    uint32_t* d = dst;
+    const __m128i x = _mm_set1_epi32(0xC0000000);
+    const __m128i mask8 = _mm_set1_epi32(0xFF);
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4)
+    {
+        __m128i p = _mm_loadu_si128((const __m128i*)&src[i]);
+
+        __m128i r = _mm_and_si128(_mm_srli_epi32(p, 16), mask8);
+        __m128i g = _mm_and_si128(_mm_srli_epi32(p, 8), mask8);
+        __m128i b = _mm_and_si128(p, mask8);
+
+        r = _mm_or_si128(_mm_slli_epi32(r, 2), _mm_srli_epi32(r, 6));
+        g = _mm_or_si128(_mm_slli_epi32(g, 2), _mm_srli_epi32(g, 6));
+        b = _mm_or_si128(_mm_slli_epi32(b, 2), _mm_srli_epi32(b, 6));
+
+        p = _mm_or_si128(_mm_or_si128(x, _mm_slli_epi32(r, 20)), _mm_or_si128(_mm_slli_epi32(g, 10), b));
+
+        _mm_storeu_si128((__m128i*)&d[i], p);
+    }
+
+    xrgb2101010_from_argb_scalar(d + i, src + i, n - i, dither);
+}
+
+/* Channels of 2 pixels in 16-bit lanes times their alpha, divided by 255 */
+static inline __m128i premultiply_mul_sse2(__m128i c16)
+{
+    const __m128i round = _mm_set1_epi16(128);
+    __m128i a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(c16, 0xFF), 0xFF);
+    __m128i t = _mm_add_epi16(_mm_mullo_epi16(c16, a), round);
+
+    return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+static void premultiply_sse2(uint32_t* pixels, size_t n)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i alpha_mask = _mm_set1_epi32(0xFF000000);
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4)
+    {
+        __m128i p = _mm_loadu_si128((const __m128i*)&pixels[i]);
+        __m128i lo = premultiply_mul_sse2(_mm_unpacklo_epi8(p, zero));
+        __m128i hi = premultiply_mul_sse2(_mm_unpackhi_epi8(p, zero));
+
+        p = _mm_or_si128(_mm_andnot_si128(alpha_mask, _mm_packus_epi16(lo, hi)), _mm_and_si128(p, alpha_mask));
+        _mm_storeu_si128((__m128i*)&pixels[i], p);
+    }
+
+    premultiply_scalar(pixels + i, n - i);
+}
+
+static void unpremultiply_sse2(uint32_t* pixels, size_t n)
+{
+    const __m128i mask8 = _mm_set1_epi32(0xFF);
+    const __m128i c255 = _mm_set1_epi32(255);
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4)
+    {
+        __m128i p = _mm_loadu_si128((const __m128i*)&pixels[i]);
+        __m128i a = _mm_srli_epi32(p, 24);
+        __m128i half = _mm_srli_epi32(a, 1);
+        __m128 af = _mm_cvtepi32_ps(a);
+        __m128i ret = _mm_slli_epi32(a, 24);
+
+        /* c * 255 as (c << 8) - c, 32-bit multiplies and unsigned min are SSE4.1 */
+        for (int s = 0; s < 24; s += 8)
+        {
+            __m128i c = _mm_and_si128(_mm_srli_epi32(p, s), mask8);
+            __m128i num = _mm_add_epi32(_mm_sub_epi32(_mm_slli_epi32(c, 8), c), half);
+            __m128i q = _mm_cvttps_epi32(_mm_div_ps(_mm_cvtepi32_ps(num), af));
+            __m128i over = _mm_cmpgt_epi32(q, c255);
+
+            q = _mm_or_si128(_mm_andnot_si128(over, q), _mm_and_si128(over, c255));
+            ret = _mm_or_si128(ret, _mm_slli_epi32(q, s));
+        }
+
+        ret = _mm_andnot_si128(_mm_cmpeq_epi32(a, zero), ret);
+        _mm_storeu_si128((__m128i*)&pixels[i], ret);
+    }
+
+    unpremultiply_scalar(pixels + i, n - i);
+}
+
+/*
+ * AVX2 kernels, 8 pixels per iteration. Tails fall back to the scalar kernels.
+ */
+DRMLIST_TARGET_AVX2 static void xrgb8888_to_argb_avx2(uint32_t* dst, const void* src, size_t n)
+{
+    const uint32_t* s = src;
+    const __m256i alpha = _mm256_set1_epi32(0xFF000000);
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8)
+    {
+        __m256i p = _mm256_loadu_si256((const __m256i*)&s[i]);
+        _mm256_storeu_si256((__m256i*)&dst[i], _mm256_or_si256(p, alpha));
+    }
+
+    xrgb8888_to_argb_scalar(dst + i, s + i, n - i);
+}
+
+DRMLIST_TARGET_AVX2 static void rgb565_to_argb_avx2(uint32_t* dst, const void* src, size_t n)
+{
+    const uint16_t* s = src;
+    const __m256i alpha = _mm256_set1_epi32(0xFF000000);
+    const __m256i mask5 = _mm256_set1_epi32(0x1F);
+    const __m256i mask6 = _mm256_set1_epi32(0x3F);
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8)
+    {
+        __m256i p = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)&s[i]));
+
+        __m256i r = _mm256_and_si256(_mm256_srli_epi32(p, 11), mask5);
+        __m256i g = _mm256_and_si256(_mm256_srli_epi32(p, 5), mask6);
+        __m256i b = _mm256_and_si256(p, mask5);
+
+        r = _mm256_or_si256(_mm256_slli_epi32(r, 3), _mm256_srli_epi32(r, 2));
+        g = _mm256_or_si256(_mm256_slli_epi32(g, 2), _mm256_srli_epi32(g, 4));
+        b = _mm256_or_si256(_mm256_slli_epi32(b, 3), _mm256_srli_epi32(b, 2));
+
+        p = _mm256_or_si256(_mm256_or_si256(alpha, _mm256_slli_epi32(r, 16)),
+                            _mm256_or_si256(_mm256_slli_epi32(g, 8), b));
+
+        _mm256_storeu_si256((__m256i*)&dst[i], p);
+    }
+
+    rgb565_to_argb_scalar(dst + i, s + i, n - i);
+}
+
+DRMLIST_TARGET_AVX2 static void rgb565_from_argb_avx2(void* dst, const uint32_t* src, size_t n, const uint32_t* dither)
+{
+    uint16_t* d = dst;
+    const __m256i rmask = _mm256_set1_epi32(0xF800);
+    const __m256i gmask = _mm256_set1_epi32(0x07E0);
+    const __m256i bmask = _mm256_set1_epi32(0x001F);
+    __m256i dvec = _mm256_setzero_si256();
+    size_t i = 0;
+
+    if (dither)
+        dvec = _mm256_setr_epi32(dither[0], dither[1], dither[2], dither[3],
+                                 dither[0], dither[1], dither[2], dither[3]);
+
+    for (; i + 8 <= n; i += 8)
+    {
+        __m256i p = _mm256_loadu_si256((const __m256i*)&src[i]);
+
+        p = _mm256_adds_epu8(p, dvec);
+
+        p = _mm256_or_si256(_mm256_or_si256(_mm256_and_si256(_mm256_srli_epi32(p, 8), rmask),
+                                            _mm256_and_si256(_mm256_srli_epi32(p, 5), gmask)),
+                            _mm256_and_si256(_mm256_srli_epi32(p, 3), bmask));
+
+        /* Pack to 16 bit, packus works per 128-bit lane so fix the order up */
+        p = _mm256_permute4x64_epi64(_mm256_packus_epi32(p, p), 0xD8);
+        _mm_storeu_si128((__m128i*)&d[i], _mm256_castsi256_si128(p));
+    }
+
+    rgb565_from_argb_scalar(d + i, src + i, n - i, dither);
+}
+
+DRMLIST_TARGET_AVX2 static void xrgb2101010_to_argb_avx2(uint32_t* dst, const void* src, size_t n)
+{
+    const uint32_t* s = src;
+    const __m256i alpha = _mm256_set1_epi32(0xFF000000);
+    const __m256i mask8 = _mm256_set1_epi32(0xFF);
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8)
+    {
+        __m256i p = _mm256_loadu_si256((const __m256i*)&s[i]);
+
+        __m256i r = _mm256_and_si256(_mm256_srli_epi32(p, 22), mask8);
+        __m256i g = _mm256_and_si256(_mm256_srli_epi32(p, 12), mask8);
+        __m256i b = _mm256_and_si256(_mm256_srli_epi32(p, 2), mask8);
+
+        p = _mm256_or_si256(_mm256_or_si256(alpha, _mm256_slli_epi32(r, 16)),
+                            _mm256_or_si256(_mm256_slli_epi32(g, 8), b));
+
+        _mm256_storeu_si256((__m256i*)&dst[i], p);
+    }
+
+    xrgb2101010_to_argb_scalar(dst + i, s + i, n - i);
+}
+
+DRMLIST_TARGET_AVX2 static void xrgb2101010_from_argb_avx2(void* dst, const uint32_t* src, size_t n, const uint32_t* dither)
+{
+    uint32_t* d = dst;
+    const __m256i x = _mm256_set1_epi32(0xC0000000);
+    const __m256i mask8 = _mm256_set1_epi32(0xFF);
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8)
+    {
+        __m256i p = _mm256_loadu_si256((const __m256i*)&src[i]);
+
+        __m256i r = _mm256_and_si256(_mm256_srli_epi32(p, 16), mask8);
+        __m256i g = _mm256_and_si256(_mm256_srli_epi32(p, 8), mask8);
+        __m256i b = _mm256_and_si256(p, mask8);
+
+        r = _mm256_or_si256(_mm256_slli_epi32(r, 2), _mm256_srli_epi32(r, 6));
+        g = _mm256_or_si256(_mm256_slli_epi32(g, 2), _mm256_srli_epi32(g, 6));
+        b = _mm256_or_si256(_mm256_slli_epi32(b, 2), _mm256_srli_epi32(b, 6));
+
+        p = _mm256_or_si256(_mm256_or_si256(x, _mm256_slli_epi32(r, 20)),
+                            _mm256_or_si256(_mm256_slli_epi32(g, 10), b));
+
+        _mm256_storeu_si256((__m256i*)&d[i], p);
+    }
+
+    xrgb2101010_from_argb_scalar(d + i, src + i, n - i, dither);
+}
+
+DRMLIST_TARGET_AVX2 static void rgb888_to_argb_avx2(uint32_t* dst, const void* src, size_t n)
+{
+    const uint8_t* s = src;
+    const __m128i shuf = _mm_setr_epi8(0, 1, 2, -128, 3, 4, 5, -128, 6, 7, 8, -128, 9, 10, 11, -128);
+    const __m256i alpha = _mm256_set1_epi32(0xFF000000);
+    size_t i = 0;
+
+    /* Each 16 byte load only uses 12 bytes, keep the last load inside the row */
+    for (; i + 10 <= n; i += 8)
+    {
+        __m128i lo = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)&s[i * 3]), shuf);
+        __m128i hi = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)&s[i * 3 + 12]), shuf);
+        __m256i p = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+
+        _mm256_storeu_si256((__m256i*)&dst[i], _mm256_or_si256(p, alpha));
+    }
+
+    rgb888_to_argb_scalar(dst + i, s + i * 3, n - i);
+}
+
+DRMLIST_TARGET_AVX2 static void rgb888_from_argb_avx2(void* dst, const uint32_t* src, size_t n, const uint32_t* dither)
+{
+    uint8_t* d = dst;
+    const __m256i shuf = _mm256_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -128, -128, -128, -128,
+                                          0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -128, -128, -128, -128);
+    size_t i = 0;
+
+    /* Each 16 byte store only carries 12 bytes, the overhang is rewritten by the next one */
+    for (; i + 10 <= n; i += 8)
+    {
+        __m256i p = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i*)&src[i]), shuf);
+
+        _mm_storeu_si128((__m128i*)&d[i * 3], _mm256_castsi256_si128(p));
+        _mm_storeu_si128((__m128i*)&d[i * 3 + 12], _mm256_extracti128_si256(p, 1));
+    }
+
+    rgb888_from_argb_scalar(d + i * 3, src + i, n - i, dither);
+}
+
+DRMLIST_TARGET_AVX2 static void premultiply_avx2(uint32_t* pixels, size_t n)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i round = _mm256_set1_epi16(128);
+    const __m256i alpha_mask = _mm256_set1_epi32(0xFF000000);
+    const __m256i alpha_shuf = _mm256_setr_epi8(3, 3, 3, 3, 7, 7, 7, 7, 11, 11, 11, 11, 15, 15, 15, 15,
+                                                3, 3, 3, 3, 7, 7, 7, 7, 11, 11, 11, 11, 15, 15, 15, 15);
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8)
+    {
+        __m256i p = _mm256_loadu_si256((const __m256i*)&pixels[i]);
+        __m256i a = _mm256_shuffle_epi8(p, alpha_shuf);
+
+        __m256i lo = _mm256_mullo_epi16(_mm256_unpacklo_epi8(p, zero), _mm256_unpacklo_epi8(a, zero));
+        __m256i hi = _mm256_mullo_epi16(_mm256_unpackhi_epi8(p, zero), _mm256_unpackhi_epi8(a, zero));
+
+        /* (t + (t >> 8)) >> 8 with t = c * a + 128, exact division by 255 */
+        lo = _mm256_add_epi16(lo, round);
+        hi = _mm256_add_epi16(hi, round);
+        lo = _mm256_srli_epi16(_mm256_add_epi16(lo, _mm256_srli_epi16(lo, 8)), 8);
+        hi = _mm256_srli_epi16(_mm256_add_epi16(hi, _mm256_srli_epi16(hi, 8)), 8);
+
+        p = _mm256_blendv_epi8(_mm256_packus_epi16(lo, hi), p, alpha_mask);
+        _mm256_storeu_si256((__m256i*)&pixels[i], p);
+    }
+
+    premultiply_scalar(pixels + i, n - i);
+}
+
+DRMLIST_TARGET_AVX2 static void unpremultiply_avx2(uint32_t* pixels, size_t n)
+{
+    const __m256i mask8 = _mm256_set1_epi32(0xFF);
+    const __m256i c255 = _mm256_set1_epi32(255);
+    const __m256i zero = _mm256_setzero_si256();
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8)
+    {
+        __m256i p = _mm256_loadu_si256((const __m256i*)&pixels[i]);
+        __m256i a = _mm256_srli_epi32(p, 24);
+        __m256i half = _mm256_srli_epi32(a, 1);
+        __m256 af = _mm256_cvtepi32_ps(a);
+        __m256i ret = _mm256_slli_epi32(a, 24);
+
+        /* Numerators stay below 2^16, so the float quotient truncates exactly */
+        for (int s = 0; s < 24; s += 8)
+        {
+            __m256i c = _mm256_and_si256(_mm256_srli_epi32(p, s), mask8);
+            __m256i num = _mm256_add_epi32(_mm256_mullo_epi32(c, c255), half);
+            __m256i q = _mm256_cvttps_epi32(_mm256_div_ps(_mm256_cvtepi32_ps(num), af));
+
+            ret = _mm256_or_si256(ret, _mm256_slli_epi32(_mm256_min_epu32(q, c255), s));
+        }
+
+        ret = _mm256_andnot_si256(_mm256_cmpeq_epi32(a, zero), ret);
+        _mm256_storeu_si256((__m256i*)&pixels[i], ret);
+    }
+
+    unpremultiply_scalar(pixels + i, n - i);
+}
+
+/*
+ * AVX-512 kernels, 16 pixels per iteration. RGB888 has no cheap 3-byte
+ * shuffle without VBMI and keeps the AVX2 kernels.
+ */
+DRMLIST_TARGET_AVX512 static void xrgb8888_to_argb_avx512(uint32_t* dst, const void* src, size_t n)
+{
+    const uint32_t* s = src;
+    const __m512i alpha = _mm512_set1_epi32(0xFF000000);
+    size_t i = 0;
+
+    for (; i + 16 <= n; i += 16)
+        _mm512_storeu_si512(&dst[i], _mm512_or_si512(_mm512_loadu_si512(&s[i]), alpha));
+
+    xrgb8888_to_argb_scalar(dst + i, s + i, n - i);
+}
+
+DRMLIST_TARGET_AVX512 static void rgb565_to_argb_avx512(uint32_t* dst, const void* src, size_t n)
+{
+    const uint16_t* s = src;
+    const __m512i alpha = _mm512_set1_epi32(0xFF000000);
+    const __m512i mask5 = _mm512_set1_epi32(0x1F);
+    const __m512i mask6 = _mm512_set1_epi32(0x3F);
+    size_t i = 0;
+
+    for (; i + 16 <= n; i += 16)
+    {
+        __m512i p = _mm512_cvtepu16_epi32(_mm256_loadu_si256((const __m256i*)&s[i]));
+
+        __m512i r = _mm512_and_si512(_mm512_srli_epi32(p, 11), mask5);
+        __m512i g = _mm512_and_si512(_mm512_srli_epi32(p, 5), mask6);
+        __m512i b = _mm512_and_si512(p, mask5);
+
+        r = _mm512_or_si512(_mm512_slli_epi32(r, 3), _mm512_srli_epi32(r, 2));
+        g = _mm512_or_si512(_mm512_slli_epi32(g, 2), _mm512_srli_epi32(g, 4));
+        b = _mm512_or_si512(_mm512_slli_epi32(b, 3), _mm512_srli_epi32(b, 2));
+
+        p = _mm512_or_si512(_mm512_or_si512(alpha, _mm512_slli_epi32(r, 16)),
+                            _mm512_or_si512(_mm512_slli_epi32(g, 8), b));
+
+        _mm512_storeu_si512(&dst[i], p);
+    }
+
+    rgb565_to_argb_scalar(dst + i, s + i, n - i);
+}
+
+DRMLIST_TARGET_AVX512 static void rgb565_from_argb_avx512(void* dst, const uint32_t* src, size_t n, const uint32_t* dither)
+{
+    uint16_t* d = dst;
+    const __m512i rmask = _mm512_set1_epi32(0xF800);
+    const __m512i gmask = _mm512_set1_epi32(0x07E0);
+    const __m512i bmask = _mm512_set1_epi32(0x001F);
+    __m512i dvec = _mm512_setzero_si512();
+    size_t i = 0;
+
+    if (dither)
+        dvec = _mm512_broadcast_i32x4(_mm_setr_epi32(dither[0], dither[1], dither[2], dither[3]));
+
+    for (; i + 16 <= n; i += 16)
+    {
+        __m512i p = _mm512_adds_epu8(_mm512_loadu_si512(&src[i]), dvec);
+
+        p = _mm512_or_si512(_mm512_or_si512(_mm512_and_si512(_mm512_srli_epi32(p, 8), rmask),
+                                            _mm512_and_si512(_mm512_srli_epi32(p, 5), gmask)),
+                            _mm512_and_si512(_mm512_srli_epi32(p, 3), bmask));
+
+        /* Truncating narrow, in order, no lane fix up */
+        _mm256_storeu_si256((__m256i*)&d[i], _mm512_cvtepi32_epi16(p));
+    }
+
+    rgb565_from_argb_scalar(d + i, src + i, n - i, dither);
+}
+
+DRMLIST_TARGET_AVX512 static void xrgb2101010_to_argb_avx512(uint32_t* dst, const void* src, size_t n)
+{
+    const uint32_t* s = src;
+    const __m512i alpha = _mm512_set1_epi32(0xFF000000);
+    const __m512i mask8 = _mm512_set1_epi32(0xFF);
+    size_t i = 0;
+
+    for (; i + 16 <= n; i += 16)
+    {
+        __m512i p = _mm512_loadu_si512(&s[i]);
+
+        __m512i r = _mm512_and_si512(_mm512_srli_epi32(p, 22), mask8);
+        __m512i g = _mm512_and_si512(_mm512_srli_epi32(p, 12), mask8);
+        __m512i b = _mm512_and_si512(_mm512_srli_epi32(p, 2), mask8);
+
+        p = _mm512_or_si512(_mm512_or_si512(alpha, _mm512_slli_epi32(r, 16)),
+                            _mm512_or_si512(_mm512_slli_epi32(g, 8), b));
+
+        _mm512_storeu_si512(&dst[i], p);
+    }
+
+    xrgb2101010_to_argb_scalar(dst + i, s + i, n - i);
+}
+
+DRMLIST_TARGET_AVX512 static void xrgb2101010_from_argb_avx512(void* dst, const uint32_t* src, size_t n, const uint32_t* dither)
+{
+    uint32_t* d = dst;
+    const __m512i x = _mm512_set1_epi32(0xC0000000);
+    const __m512i mask8 = _mm512_set1_epi32(0xFF);
+    size_t i = 0;
+
+    for (; i + 16 <= n; i += 16)
+    {
+        __m512i p = _mm512_loadu_si512(&src[i]);
+
+        __m512i r = _mm512_and_si512(_mm512_srli_epi32(p, 16), mask8);
+        __m512i g = _mm512_and_si512(_mm512_srli_epi32(p, 8), mask8);
+        __m512i b = _mm512_and_si512(p, mask8);
+
+        r = _mm512_or_si512(_mm512_slli_epi32(r, 2), _mm512_srli_epi32(r, 6));
+        g = _mm512_or_si512(_mm512_slli_epi32(g, 2), _mm512_srli_epi32(g, 6));
+        b = _mm512_or_si512(_mm512_slli_epi32(b, 2), _mm512_srli_epi32(b, 6));
+
+        p = _mm512_or_si512(_mm512_or_si512(x, _mm512_slli_epi32(r, 20)),
+                            _mm512_or_si512(_mm512_slli_epi32(g, 10), b));
+
+        _mm512_storeu_si512(&d[i], p);
+    }
+
+    xrgb2101010_from_argb_scalar(d + i, src + i, n - i, dither);
+}
+
+DRMLIST_TARGET_AVX512 static void premultiply_avx512(uint32_t* pixels, size_t n)
+{
+    const __m512i zero = _mm512_setzero_si512();
+    const __m512i round = _mm512_set1_epi16(128);
+    size_t i = 0;
+
+    for (; i + 16 <= n; i += 16)
+    {
+        __m512i p = _mm512_loadu_si512(&pixels[i]);
+        __m512i lo = _mm512_unpacklo_epi8(p, zero);
+        __m512i hi = _mm512_unpackhi_epi8(p, zero);
+
+        lo = _mm512_add_epi16(_mm512_mullo_epi16(lo, _mm512_shufflehi_epi16(_mm512_shufflelo_epi16(lo, 0xFF), 0xFF)), round);
+        hi = _mm512_add_epi16(_mm512_mullo_epi16(hi, _mm512_shufflehi_epi16(_mm512_shufflelo_epi16(hi, 0xFF), 0xFF)), round);
+        lo = _mm512_srli_epi16(_mm512_add_epi16(lo, _mm512_srli_epi16(lo, 8)), 8);
+        hi = _mm512_srli_epi16(_mm512_add_epi16(hi, _mm512_srli_epi16(hi, 8)), 8);
+
+        /* Alpha bytes from the source */
+        p = _mm512_mask_blend_epi8(0x8888888888888888ull, _mm512_packus_epi16(lo, hi), p);
+        _mm512_storeu_si512(&pixels[i], p);
+    }
+
+    premultiply_scalar(pixels + i, n - i);
+}
+
+DRMLIST_TARGET_AVX512 static void unpremultiply_avx512(uint32_t* pixels, size_t n)
+{
+    const __m512i mask8 = _mm512_set1_epi32(0xFF);
+    const __m512i c255 = _mm512_set1_epi32(255);
+    size_t i = 0;
+
+    for (; i + 16 <= n; i += 16)
+    {
+        __m512i p = _mm512_loadu_si512(&pixels[i]);
+        __m512i a = _mm512_srli_epi32(p, 24);
+        __m512i half = _mm512_srli_epi32(a, 1);
+        __m512 af = _mm512_cvtepi32_ps(a);
+        __m512i ret = _mm512_slli_epi32(a, 24);
+
+        for (int s = 0; s < 24; s += 8)
+        {
+            __m512i c = _mm512_and_si512(_mm512_srli_epi32(p, s), mask8);
+            __m512i num = _mm512_add_epi32(_mm512_mullo_epi32(c, c255), half);
+            __m512i q = _mm512_cvttps_epi32(_mm512_div_ps(_mm512_cvtepi32_ps(num), af));
+
+            ret = _mm512_or_si512(ret, _mm512_slli_epi32(_mm512_min_epu32(q, c255), s));
+        }
+
+        _mm512_storeu_si512(&pixels[i], _mm512_maskz_mov_epi32(_mm512_test_epi32_mask(a, a), ret));
+    }
+
+    unpremultiply_scalar(pixels + i, n - i);
+}
+
+static const convert_ops_t formats_scalar[] = {
+    { DRM_FORMAT_ARGB8888,    4, "ARGB8888",    argb8888_to_argb_scalar,    argb8888_from_argb_scalar },
+    { DRM_FORMAT_XRGB8888,    4, "XRGB8888",    xrgb8888_to_argb_scalar,    argb8888_from_argb_scalar },
+    { DRM_FORMAT_RGB565,      2, "RGB565",      rgb565_to_argb_scalar,      rgb565_from_argb_scalar },
+    { DRM_FORMAT_XRGB2101010, 4, "XRGB2101010", xrgb2101010_to_argb_scalar, xrgb2101010_from_argb_scalar },
+    { DRM_FORMAT_RGB888,      3, "RGB888",      rgb888_to_argb_scalar,      rgb888_from_argb_scalar },
+    { 0 }
+};
+
+static const convert_ops_t formats_sse2[] = {
+    { DRM_FORMAT_ARGB8888,    4, "ARGB8888",    argb8888_to_argb_scalar,    argb8888_from_argb_scalar },
+    { DRM_FORMAT_XRGB8888,    4, "XRGB8888",    xrgb8888_to_argb_sse2,      argb8888_from_argb_scalar },
+    { DRM_FORMAT_RGB565,      2, "RGB565",      rgb565_to_argb_sse2,        rgb565_from_argb_sse2 },
+    { DRM_FORMAT_XRGB2101010, 4, "XRGB2101010", xrgb2101010_to_argb_sse2,   xrgb2101010_from_argb_sse2 },
+    { DRM_FORMAT_RGB888,      3, "RGB888",      rgb888_to_argb_scalar,      rgb888_from_argb_scalar },
+    { 0 }
+};
+
+static const convert_ops_t formats_avx2[] = {
+    { DRM_FORMAT_ARGB8888,    4, "ARGB8888",    argb8888_to_argb_scalar,    argb8888_from_argb_scalar },
+    { DRM_FORMAT_XRGB8888,    4, "XRGB8888",    xrgb8888_to_argb_avx2,      argb8888_from_argb_scalar },
+    { DRM_FORMAT_RGB565,      2, "RGB565",      rgb565_to_argb_avx2,        rgb565_from_argb_avx2 },
+    { DRM_FORMAT_XRGB2101010, 4, "XRGB2101010", xrgb2101010_to_argb_avx2,   xrgb2101010_from_argb_avx2 },
+    { DRM_FORMAT_RGB888,      3, "RGB888",      rgb888_to_argb_avx2,        rgb888_from_argb_avx2 },
+    { 0 }
+};
+
+static const convert_ops_t formats_avx512[] = {
+    { DRM_FORMAT_ARGB8888,    4, "ARGB8888",    argb8888_to_argb_scalar,    argb8888_from_argb_scalar },
+    { DRM_FORMAT_XRGB8888,    4, "XRGB8888",    xrgb8888_to_argb_avx512,    argb8888_from_argb_scalar },
+    { DRM_FORMAT_RGB565,      2, "RGB565",      rgb565_to_argb_avx512,      rgb565_from_argb_avx512 },
+    { DRM_FORMAT_XRGB2101010, 4, "XRGB2101010", xrgb2101010_to_argb_avx512, xrgb2101010_from_argb_avx512 },
+    { DRM_FORMAT_RGB888,      3, "RGB888",      rgb888_to_argb_avx2,        rgb888_from_argb_avx2 },
+    { 0 }
+};
+
+static const convert_kernels_t kernels_scalar = { formats_scalar, premultiply_scalar, unpremultiply_scalar };
+
+/* By drmlist_cpu_level */
+static const convert_kernels_t kernels_simd[DRMLIST_CPU_LEVELS] = {
+    { formats_sse2, premultiply_sse2, unpremultiply_sse2 },
+    { formats_avx2, premultiply_avx2, unpremultiply_avx2 },
+    { formats_avx512, premultiply_avx512, unpremultiply_avx512 },
+};
+
+static const convert_ops_t* drmlist_convert_find(const convert_ops_t* formats, uint32_t format)
+{
+    for (const convert_ops_t* ops = formats; ops->format; ops++)
+        if (ops->format == format)
+            return ops;
+    return NULL;
+}
+
+bool drmlist_convert_supported(uint32_t format)
+{
+    return drmlist_convert_find(formats_scalar, format) != NULL;
+}
+
+uint32_t drmlist_convert_cpp(uint32_t format)
+{
+    const convert_ops_t* ops = drmlist_convert_find(formats_scalar, format);
+    return ops ? ops->cpp : 0;
+}
+
+const char* drmlist_convert_format_name(uint32_t format)
+{
+    const convert_ops_t* ops = drmlist_convert_find(formats_scalar, format);
+    return ops ? ops->name : "Unknown";
+}
+
+static inline bool is_argb8888(uint32_t format)
+{
+    return format == DRM_FORMAT_ARGB8888 || format == DRM_FORMAT_XRGB8888;
+}
+
+int drmlist_convert(void* dst, uint32_t dst_format, uint32_t dst_stride,
+                    const void* src, uint32_t src_format, uint32_t src_stride,
+                    uint32_t width, uint32_t height, uint32_t flags)
+{
+    const convert_kernels_t* k = (flags & DRMLIST_CONVERT_SCALAR) ? &kernels_scalar : &kernels_simd[drmlist_cpu_level];
+    const convert_ops_t* dops = drmlist_convert_find(k->formats, dst_format);
+    const convert_ops_t* sops = drmlist_convert_find(k->formats, src_format);
+    const bool alpha_op = flags & (DRMLIST_CONVERT_PREMULTIPLY | DRMLIST_CONVERT_UNPREMULTIPLY);
+    const bool dst_direct = is_argb8888(dst_format);
+    uint32_t tmp[CONVERT_CHUNK] __attribute__((aligned(32)));
+    uint32_t dither[4];
+
+    if (!dops || !sops)
+        return -EINVAL;
+
+    if (src_format == dst_format && !alpha_op)
+    {
+        for (uint32_t y = 0; y < height; y++)
+            memcpy((uint8_t*)dst + (size_t)y * dst_stride, (const uint8_t*)src + (size_t)y * src_stride, (size_t)width * dops->cpp);
+        return 0;
+    }
+
+    for (uint32_t y = 0; y < height; y++)
+    {
+        const uint8_t* srow = (const uint8_t*)src + (size_t)y * src_stride;
+        uint8_t* drow = (uint8_t*)dst + (size_t)y * dst_stride;
+        const uint32_t* dither_row = NULL;
+
+        if ((flags & DRMLIST_CONVERT_DITHER) && dst_format == DRM_FORMAT_RGB565)
+        {
+            /* 5 bit channels lose 3 bits, the 6 bit green channel loses 2 */
+            for (int x = 0; x < 4; x++)
+            {
+                uint32_t t = bayer4[y & 3][x];
+                dither[x] = ((t >> 1) << 16) | ((t >> 2) << 8) | (t >> 1);
+            }
+            dither_row = dither;
+        }
+
+        for (uint32_t x = 0; x < width; x += CONVERT_CHUNK)
+        {
+            size_t n = (width - x < CONVERT_CHUNK) ? width - x : CONVERT_CHUNK;
+            const uint32_t* argb;
+
+            if (src_format == DRM_FORMAT_ARGB8888 && !alpha_op && !dst_direct)
+            {
+                argb = (const uint32_t*)srow + x;
+            }
+            else
+            {
+                /* Decode straight into the destination row when it is already ARGB8888 */
+                uint32_t* out = dst_direct ? (uint32_t*)drow + x : tmp;
+
+                sops->to_argb(out, srow + x * sops->cpp, n);
+
+                if (flags & DRMLIST_CONVERT_PREMULTIPLY)
+                    k->premultiply(out, n);
+                else if (flags & DRMLIST_CONVERT_UNPREMULTIPLY)
+                    k->unpremultiply(out, n);
+
+                argb = out;
+            }
+
+            if (!dst_direct)
+                dops->from_argb(drow + x * dops->cpp, argb, n, dither_row);
+        }
+    }
+
+    return 0;
+}
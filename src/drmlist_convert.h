@@ -0,0 +1,31 @@
+#ifndef _DRMLIST_CONVERT_H_
+#define _DRMLIST_CONVERT_H_
+
+#include "mydrm/mydrm.h"
+
+/*
+ * Pixel format conversion flags
+ */
+#define DRMLIST_CONVERT_PREMULTIPLY     (1 << 0)    // multiply RGB by alpha after decode
+#define DRMLIST_CONVERT_UNPREMULTIPLY   (1 << 1)    // divide RGB by alpha after decode
+#define DRMLIST_CONVERT_DITHER          (1 << 2)    // 4x4 ordered dither when reducing depth
+#define DRMLIST_CONVERT_SCALAR          (1 << 3)    // force the scalar reference kernels
+
+/*
+ * Supported formats:
+ *  DRM_FORMAT_ARGB8888, DRM_FORMAT_XRGB8888, DRM_FORMAT_RGB565,
+ *  DRM_FORMAT_XRGB2101010, DRM_FORMAT_RGB888
+ */
+bool drmlist_convert_supported(uint32_t format);
+uint32_t drmlist_convert_cpp(uint32_t format);
+const char* drmlist_convert_format_name(uint32_t format);
+
+/*
+ * Convert a width x height image from `src_format` to `dst_format`.
+ * Strides are in bytes. Returns 0 on success or -EINVAL for an unsupported format.
+ */
+int drmlist_convert(void* dst, uint32_t dst_format, uint32_t dst_stride,
+                    const void* src, uint32_t src_format, uint32_t src_stride,
+                    uint32_t width, uint32_t height, uint32_t flags);
+
+#endif // _DRMLIST_CONVERT_H_
@@ -0,0 +1,87 @@
+#include "drmlist_cpu.h"
+#include "drmlist_kernels.h"
+#include <cpuid.h>
+
+#define XCR0_SSE        (1 << 1)
+#define XCR0_AVX        (1 << 2)
+#define XCR0_OPMASK     (1 << 5)
+#define XCR0_ZMM_HI256  (1 << 6)
+#define XCR0_HI16_ZMM   (1 << 7)
+
+int drmlist_cpu_level = DRMLIST_CPU_SSE2;
+
+static const char* level_names[DRMLIST_CPU_LEVELS] = { "sse2", "avx2", "avx512" };
+
+/* Registers the OS saves on context switch, only valid with OSXSAVE */
+static uint64_t cpu_xgetbv(void)
+{
+    uint32_t lo, hi;
+
+    __asm__ volatile ("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+
+    return (uint64_t)hi << 32 | lo;
+}
+
+int drmlist_cpu_detect(void)
+{
+    uint32_t eax, ebx, ecx, edx;
+    uint64_t xcr0;
+
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx) || !(ecx & bit_OSXSAVE) || !(ecx & bit_AVX))
+        return DRMLIST_CPU_SSE2;
+
+    xcr0 = cpu_xgetbv();
+    if ((xcr0 & (XCR0_SSE | XCR0_AVX)) != (XCR0_SSE | XCR0_AVX))
+        return DRMLIST_CPU_SSE2;
+
+    if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) || !(ebx & bit_AVX2))
+        return DRMLIST_CPU_SSE2;
+
+    if ((ebx & bit_AVX512F) && (ebx & bit_AVX512BW) && (ebx & bit_AVX512VL) &&
+        (xcr0 & (XCR0_OPMASK | XCR0_ZMM_HI256 | XCR0_HI16_ZMM)) == (XCR0_OPMASK | XCR0_ZMM_HI256 | XCR0_HI16_ZMM))
+        return DRMLIST_CPU_AVX512;
+
+    return DRMLIST_CPU_AVX2;
+}
+
+int drmlist_cpu_parse(const char* name)
+{
+    for (int i = 0; i < DRMLIST_CPU_LEVELS; i++)
+        if (!strcmp(name, level_names[i]))
+            return i;
+
+    return -EINVAL;
+}
+
+const char* drmlist_cpu_level_name(int level)
+{
+    return level >= 0 && level < DRMLIST_CPU_LEVELS ? level_names[level] : "Unknown";
+}
+
+int drmlist_cpu_init(const char* force)
+{
+    int best = drmlist_cpu_detect();
+    int level = best;
+
+    if (force)
+    {
+        if ((level = drmlist_cpu_parse(force)) < 0)
+        {
+            fprintf(stderr, "CPU: unknown level '%s', expected sse2, avx2 or avx512\n", force);
+            return -EINVAL;
+        }
+
+        if (level > best)
+        {
+            fprintf(stderr, "CPU: %s not supported, using %s\n", level_names[level], level_names[best]);
+            level = best;
+        }
+    }
+
+    drmlist_cpu_level = level;
+    drmlist_kernels_bind(level);
+
+    printf("CPU: %s kernels (supports %s%s)\n", level_names[level], level_names[best], level != best ? ", forced" : "");
+
+    return level;
+}
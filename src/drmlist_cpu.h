@@ -0,0 +1,44 @@
+#ifndef _DRMLIST_CPU_H_
+#define _DRMLIST_CPU_H_
+
+#include "mydrm/mydrm.h"
+
+/*
+ * Runtime CPU dispatch
+ *
+ * Everything is built for the x86-64 baseline (SSE2). Only the kernels are
+ * built for more, each variant with a target attribute, and picked at run
+ * time: drmlist_cpu_init() reads cpuid once, checks the OS saves the wider
+ * registers (XGETBV) and binds drmlist_kernels to the best variant. Until
+ * then the SSE2 variants are bound, so nothing can hit an unsupported
+ * instruction. A forced level (DRMLIST_CPU=sse2|avx2|avx512) is for A/B
+ * runs, it can't go above what the CPU supports.
+ */
+
+enum drmlist_cpu_level
+{
+    DRMLIST_CPU_SSE2 = 0,
+    DRMLIST_CPU_AVX2 = 1,
+    DRMLIST_CPU_AVX512 = 2,         // F + BW + VL
+};
+
+#define DRMLIST_CPU_LEVELS 3
+
+#define DRMLIST_TARGET_AVX2 __attribute__((target("avx2")))
+#define DRMLIST_TARGET_AVX512 __attribute__((target("avx2,avx512f,avx512bw,avx512vl")))
+
+/* Bound level, DRMLIST_CPU_SSE2 until drmlist_cpu_init() */
+extern int drmlist_cpu_level;
+
+/* Best level the CPU and OS support */
+int drmlist_cpu_detect(void);
+int drmlist_cpu_parse(const char* name);
+const char* drmlist_cpu_level_name(int level);
+
+/*
+ * Detect and bind the kernels, `force` (NULL for none) picks a lower level.
+ * Returns the bound level or -EINVAL for an unknown name.
+ */
+int drmlist_cpu_init(const char* force);
+
+#endif // _DRMLIST_CPU_H_
@@ -0,0 +1,230 @@
+#include "drmlist_damage.h"
+
+static inline uint64_t rect_area(const struct drm_clip_rect* r)
+{
+    return (uint64_t)(r->x2 - r->x1) * (r->y2 - r->y1);
+}
+
+static inline struct drm_clip_rect rect_union(const struct drm_clip_rect* a, const struct drm_clip_rect* b)
+{
+    struct drm_clip_rect u;
+
+    u.x1 = a->x1 < b->x1 ? a->x1 : b->x1;
+    u.y1 = a->y1 < b->y1 ? a->y1 : b->y1;
+    u.x2 = a->x2 > b->x2 ? a->x2 : b->x2;
+    u.y2 = a->y2 > b->y2 ? a->y2 : b->y2;
+
+    return u;
+}
+
+/* Area of the intersection, 0 if they don't overlap */
+static inline uint64_t rect_overlap(const struct drm_clip_rect* a, const struct drm_clip_rect* b)
+{
+    int w = (a->x2 < b->x2 ? a->x2 : b->x2) - (a->x1 > b->x1 ? a->x1 : b->x1);
+    int h = (a->y2 < b->y2 ? a->y2 : b->y2) - (a->y1 > b->y1 ? a->y1 : b->y1);
+
+    return w > 0 && h > 0 ? (uint64_t)w * h : 0;
+}
+
+static inline void damage_remove(drmlist_damage_t* d, uint32_t i)
+{
+    d->rects[i] = d->rects[--d->n];
+}
+
+void drmlist_damage_reset(drmlist_damage_t* d, uint32_t width, uint32_t height)
+{
+    d->n = 0;
+    d->width = width;
+    d->height = height;
+    d->full = false;
+}
+
+void drmlist_damage_full(drmlist_damage_t* d)
+{
+    d->full = true;
+    d->n = 1;
+    d->rects[0].x1 = 0;
+    d->rects[0].y1 = 0;
+    d->rects[0].x2 = d->width;
+    d->rects[0].y2 = d->height;
+}
+
+static void sort_u16(uint16_t* v, uint32_t n)
+{
+    for (uint32_t i = 1; i < n; i++)
+    {
+        uint16_t x = v[i];
+        uint32_t j = i;
+
+        for (; j > 0 && v[j - 1] > x; j--)
+            v[j] = v[j - 1];
+        v[j] = x;
+    }
+}
+
+/*
+ * Pixels covered, crossing rects (a box through the HUD) overlap without
+ * being merged so their areas can't just be added: the columns between the
+ * rects' x edges, each the union of the y spans reaching over it
+ */
+uint64_t drmlist_damage_area(drmlist_damage_t* d)
+{
+    uint16_t xs[2 * (DRMLIST_DAMAGE_MAX_RECTS + 1)];
+    uint64_t area = 0;
+    bool overlap = false;
+
+    /* Usually nothing crosses */
+    for (uint32_t i = 0; i < d->n; i++)
+    {
+        area += rect_area(&d->rects[i]);
+        for (uint32_t j = i + 1; j < d->n && !overlap; j++)
+            overlap = rect_overlap(&d->rects[i], &d->rects[j]);
+    }
+
+    if (!overlap)
+        return area;
+
+    area = 0;
+    for (uint32_t i = 0; i < d->n; i++)
+    {
+        xs[2 * i] = d->rects[i].x1;
+        xs[2 * i + 1] = d->rects[i].x2;
+    }
+    sort_u16(xs, 2 * d->n);
+
+    for (uint32_t c = 0; c + 1 < 2 * d->n; c++)
+    {
+        uint16_t y1[DRMLIST_DAMAGE_MAX_RECTS + 1], y2[DRMLIST_DAMAGE_MAX_RECTS + 1];
+        uint32_t n = 0, height = 0, top = 0;
+
+        if (xs[c] == xs[c + 1])
+            continue;
+
+        /* Spans sorted by y1, then merged going down */
+        for (uint32_t i = 0; i < d->n; i++)
+        {
+            uint32_t j;
+
+            if (d->rects[i].x1 > xs[c] || d->rects[i].x2 < xs[c + 1])
+                continue;
+
+            for (j = n++; j > 0 && y1[j - 1] > d->rects[i].y1; j--)
+            {
+                y1[j] = y1[j - 1];
+                y2[j] = y2[j - 1];
+            }
+            y1[j] = d->rects[i].y1;
+            y2[j] = d->rects[i].y2;
+        }
+
+        for (uint32_t i = 0; i < n; i++)
+        {
+            if (y2[i] <= top)
+                continue;
+            height += y2[i] - (y1[i] > top ? y1[i] : top);
+            top = y2[i];
+        }
+
+        area += (uint64_t)height * (xs[c + 1] - xs[c]);
+    }
+
+    return area;
+}
+
+void drmlist_damage_add(drmlist_damage_t* d, int x1, int y1, int x2, int y2)
+{
+    struct drm_clip_rect r;
+    uint64_t best_cost = UINT64_MAX;
+    uint32_t best_i = 0, best_j = 0;
+    uint64_t limit = (uint64_t)d->width * d->height * DRMLIST_DAMAGE_FULL_PERCENT;
+    uint64_t sum = 0;
+
+    if (d->full)
+        return;
+
+    if (x1 < 0) x1 = 0;
+    if (y1 < 0) y1 = 0;
+    if (x2 > (int)d->width) x2 = d->width;
+    if (y2 > (int)d->height) y2 = d->height;
+
+    if (x2 <= x1 || y2 <= y1)
+        return;
+
+    r.x1 = x1;
+    r.y1 = y1;
+    r.x2 = x2;
+    r.y2 = y2;
+
+    /* Absorb rectangles that merging doesn't cost anything for, the union grows so look again */
+    for (uint32_t i = 0; i < d->n; i++)
+    {
+        struct drm_clip_rect u = rect_union(&r, &d->rects[i]);
+
+        if (rect_area(&u) <= rect_area(&r) + rect_area(&d->rects[i]))
+        {
+            r = u;
+            damage_remove(d, i);
+            i = -1;
+        }
+    }
+
+    d->rects[d->n++] = r;
+
+    /* Over the limit: merge the pair that adds the least area */
+    if (d->n > DRMLIST_DAMAGE_MAX_RECTS)
+    {
+        for (uint32_t i = 0; i < d->n; i++)
+        {
+            for (uint32_t j = i + 1; j < d->n; j++)
+            {
+                struct drm_clip_rect u = rect_union(&d->rects[i], &d->rects[j]);
+                uint64_t cost = rect_area(&u) + rect_overlap(&d->rects[i], &d->rects[j]) - rect_area(&d->rects[i]) -
+                                rect_area(&d->rects[j]);
+
+                /* What the bounding box adds over the pixels the two cover, crossing rects overlap */
+                if (cost < best_cost)
+                {
+                    best_cost = cost;
+                    best_i = i;
+                    best_j = j;
+                }
+            }
+        }
+
+        d->rects[best_i] = rect_union(&d->rects[best_i], &d->rects[best_j]);
+        damage_remove(d, best_j);
+    }
+
+    /* The areas added up are never less than what's covered, only near the limit is it counted */
+    for (uint32_t i = 0; i < d->n; i++)
+        sum += rect_area(&d->rects[i]);
+
+    if (sum * 100 >= limit && drmlist_damage_area(d) * 100 >= limit)
+        drmlist_damage_full(d);
+}
+
+void drmlist_damage_add_rect(drmlist_damage_t* d, const struct drm_clip_rect* r)
+{
+    drmlist_damage_add(d, r->x1, r->y1, r->x2, r->y2);
+}
+
+void drmlist_damage_account(drmlist_damage_t* d, uint32_t cpp)
+{
+    d->frames++;
+    d->full_frames += d->full;
+    d->rects_total += d->n;
+    d->bytes_last = drmlist_damage_area(d) * cpp;
+    d->bytes += d->bytes_last;
+}
+
+void drmlist_damage_print_stats(drmlist_damage_t* d, uint32_t cpp)
+{
+    uint64_t full_bytes = (uint64_t)d->width * d->height * cpp;
+
+    if (!d->frames)
+        return;
+
+    printf("Damage: %lu frames (%lu full), %.1f rects/frame, %.1f KiB/frame flushed, %.1f%% of full frames\n",
+                    d->frames, d->full_frames, (double)d->rects_total / d->frames, d->bytes / 1024.0 / d->frames,
+                    full_bytes ? 100.0 * d->bytes / (full_bytes * d->frames) : 0.0);
+}
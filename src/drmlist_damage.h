@@ -0,0 +1,46 @@
+#ifndef _DRMLIST_DAMAGE_H_
+#define _DRMLIST_DAMAGE_H_
+
+#include "mydrm/mydrm.h"
+
+/*
+ * Damage tracking for drivers that upload on DIRTYFB (virtio-gpu, udl, gud, ...)
+ *
+ * Rectangles are clamped to the framebuffer and merged as they're added: two
+ * rectangles whose bounding box isn't bigger than their areas together are
+ * always merged, and past DRMLIST_DAMAGE_MAX_RECTS the pair whose bounding
+ * box adds the least area is. Crossing rectangles (the box through the HUD)
+ * stay apart and overlap, the area counts their pixels once. A frame whose
+ * damage covers most of the screen is flushed whole.
+ */
+
+#define DRMLIST_DAMAGE_MAX_RECTS 8
+#define DRMLIST_DAMAGE_FULL_PERCENT 75
+
+typedef struct
+{
+    struct drm_clip_rect rects[DRMLIST_DAMAGE_MAX_RECTS + 1];
+    uint32_t n;
+    uint32_t width;
+    uint32_t height;
+    bool full;
+
+    /* Stats, from drmlist_damage_account() */
+    uint64_t frames;
+    uint64_t full_frames;
+    uint64_t rects_total;
+    uint64_t bytes;
+    uint64_t bytes_last;
+} drmlist_damage_t;
+
+void drmlist_damage_reset(drmlist_damage_t* d, uint32_t width, uint32_t height);
+void drmlist_damage_add(drmlist_damage_t* d, int x1, int y1, int x2, int y2);
+void drmlist_damage_add_rect(drmlist_damage_t* d, const struct drm_clip_rect* r);
+void drmlist_damage_full(drmlist_damage_t* d);
+uint64_t drmlist_damage_area(drmlist_damage_t* d);
+
+/* Count a flushed frame of `cpp` bytes per pixel */
+void drmlist_damage_account(drmlist_damage_t* d, uint32_t cpp);
+void drmlist_damage_print_stats(drmlist_damage_t* d, uint32_t cpp);
+
+#endif // _DRMLIST_DAMAGE_H_
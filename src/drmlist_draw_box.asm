@@ -5,16 +5,17 @@ start_x:    dq  0
 start_y:    dq  0
 box_width:  dq  32
 box_height: dq  32
-speed:      dq  0x05
-go_right:   db  0xFF
 
 
 section .text
-; void drmlist_draw_box_asm(uint32_t* pixels, mydrm_data_t* screen, uint32_t color);
+; void drmlist_draw_box_asm(uint32_t* pixels, mydrm_data_t* screen, uint32_t color, uint64_t x);
 drmlist_draw_box_asm:
     ; rdi = uint32_t* pixels  
     ; rsi = mydrm_data_t* screen
     ; rdx = color
+    ; rcx = x, position is animated by the caller (drmlist_clock/drmlist_anim)
+
+    mov QWORD [start_x], rcx    ; store x into [start_x], RCX gets reused below
 
     ; Here we move function parameters into registers 
     mov eax, DWORD [rsi + 92]   ; move screen->height into EAX
@@ -24,28 +25,6 @@ drmlist_draw_box_asm:
     mov r14, rdi                ; move RDI (pixels) into R14
     xor r11, r11                ; y = 0
 
-    ; Here we compare [go_right], and if true, plus start_x, else subtract start_x
-    mov rax, [start_x]          ; move [start_x] into RAX
-    cmp byte [go_right], 0x00      ; Compare [go_right] with 0
-    jz go_left                  ; Jump to go_left if [go_right] is 0
-    add rax, QWORD [speed]      ; else RAX += [speed]
-    jmp done_speed_adding       ; Jump done_speed_adding
-go_left: 
-    sub rax, QWORD [speed]      ; RAX -= [speed]
-
-done_speed_adding:
-    mov QWORD [start_x], rax    ; Store RAX back to [start_x]
-
-    ; Checking boundaries
-    add rax, QWORD [box_width]  ; RAX += [box_width]        (RAX is still [start_x])
-    cmp rax, r15                ; Compare RAX with R15 (screen->width)
-    jge switch_go_right         ; if greater than or equal to, jump to switch_go_right
-    cmp QWORD [start_x], 0      ; OR compare [start_x] with 0
-    jle switch_go_right         ; jump if less or equal to switch_go_right
-    jmp for_y_start             ; if false, do nothing
-switch_go_right:
-    not byte [go_right]         ; go_right = !go_right;
-
     ; Nested loop, y and x
 for_y_start:
     xor r10, r10                ; x = 0
@@ -4,6 +4,6 @@
 #include <mydrm/mydrm.h>
 
 /* drmlist_draw_box.asm */
-void drmlist_draw_box_asm(uint32_t* pixels, mydrm_data_t* data, uint32_t color);
+void drmlist_draw_box_asm(uint32_t* pixels, mydrm_data_t* data, uint32_t color, uint64_t x);
 
 #endif // _DRMLIST_DRAW_BOX_ASM_
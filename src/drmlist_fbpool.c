@@ -0,0 +1,168 @@
+#include "drmlist_fbpool.h"
+#include "drmlist_mem.h"
+#include <time.h>
+
+static uint64_t fbpool_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+void drmlist_fbpool_init(drmlist_fbpool_t* pool, int fd, uint64_t budget, uint32_t map_flags)
+{
+    memset(pool, 0, sizeof(drmlist_fbpool_t));
+    pool->fd = fd;
+    pool->budget = budget;
+    pool->map_flags = map_flags;
+}
+
+static void drmlist_fbpool_evict(drmlist_fbpool_t* pool, drmlist_fbpool_entry_t* e)
+{
+    pool->bytes -= e->fb.size;
+    pool->evictions++;
+    mydrm_destroy_framebuffer(pool->fd, &e->fb);
+    memset(e, 0, sizeof(drmlist_fbpool_entry_t));
+}
+
+static drmlist_fbpool_entry_t* drmlist_fbpool_lru_idle(drmlist_fbpool_t* pool)
+{
+    drmlist_fbpool_entry_t* lru = NULL;
+
+    for (int i = 0; i < DRMLIST_FBPOOL_MAX; i++)
+    {
+        drmlist_fbpool_entry_t* e = &pool->entries[i];
+
+        if (e->valid && !e->in_use && (!lru || e->last_used < lru->last_used))
+            lru = e;
+    }
+
+    return lru;
+}
+
+/*
+ * Idle buffer of this size/format, or a new one. Buffers in use are never
+ * evicted, so the budget can be exceeded while a switch holds both modes.
+ */
+mydrm_fb_t* drmlist_fbpool_acquire(drmlist_fbpool_t* pool, uint32_t width, uint32_t height, uint32_t format)
+{
+    drmlist_fbpool_entry_t* slot = NULL;
+    drmlist_fbpool_entry_t* lru;
+    uint64_t start, faults;
+    uint64_t size = (uint64_t)width * height * 4;
+
+    /* Dumb buffers are created with ADDFB depth 24/bpp 32 */
+    if (format != DRM_FORMAT_XRGB8888)
+        return NULL;
+
+    for (int i = 0; i < DRMLIST_FBPOOL_MAX; i++)
+    {
+        drmlist_fbpool_entry_t* e = &pool->entries[i];
+
+        if (e->valid && !e->in_use && e->fb.width == width && e->fb.height == height && e->format == format)
+        {
+            e->in_use = true;
+            e->last_used = ++pool->tick;
+            pool->hits++;
+            return &e->fb;
+        }
+
+        if (!e->valid && !slot)
+            slot = e;
+    }
+
+    /* Make room, pitch padding is ignored here */
+    while ((pool->bytes + size > pool->budget || !slot) && (lru = drmlist_fbpool_lru_idle(pool)))
+    {
+        drmlist_fbpool_evict(pool, lru);
+        if (!slot)
+            slot = lru;
+    }
+
+    if (!slot)
+    {
+        fprintf(stderr, "Framebuffer pool: all %d buffers in use\n", DRMLIST_FBPOOL_MAX);
+        return NULL;
+    }
+
+    memset(slot, 0, sizeof(drmlist_fbpool_entry_t));
+    slot->fb.width = width;
+    slot->fb.height = height;
+
+    start = fbpool_now_ns();
+    faults = drmlist_mem_faults();
+
+    if (!mydrm_create_framebuffer_flags(pool->fd, &slot->fb, pool->map_flags))
+    {
+        mydrm_destroy_framebuffer(pool->fd, &slot->fb);
+        memset(slot, 0, sizeof(drmlist_fbpool_entry_t));
+        return NULL;
+    }
+
+    slot->format = format;
+    slot->valid = true;
+    slot->in_use = true;
+    slot->last_used = ++pool->tick;
+    pool->bytes += slot->fb.size;
+    pool->misses++;
+    pool->create_ns += fbpool_now_ns() - start;
+    pool->create_faults += drmlist_mem_faults() - faults;
+
+    return &slot->fb;
+}
+
+void drmlist_fbpool_release(drmlist_fbpool_t* pool, uint32_t fb_id)
+{
+    for (int i = 0; i < DRMLIST_FBPOOL_MAX; i++)
+    {
+        drmlist_fbpool_entry_t* e = &pool->entries[i];
+
+        if (e->valid && e->fb.fb == fb_id)
+        {
+            e->in_use = false;
+            e->last_used = ++pool->tick;
+            break;
+        }
+    }
+
+    /* Back under budget once the old mode is released */
+    while (pool->bytes > pool->budget)
+    {
+        drmlist_fbpool_entry_t* lru = drmlist_fbpool_lru_idle(pool);
+
+        if (!lru)
+            break;
+        drmlist_fbpool_evict(pool, lru);
+    }
+}
+
+void drmlist_fbpool_print_stats(drmlist_fbpool_t* pool)
+{
+    int n = 0, n_idle = 0;
+
+    for (int i = 0; i < DRMLIST_FBPOOL_MAX; i++)
+    {
+        if (!pool->entries[i].valid)
+            continue;
+        n++;
+        if (!pool->entries[i].in_use)
+            n_idle++;
+    }
+
+    printf("Framebuffer pool: %d buffers (%d idle), %.1f/%.1f MiB, %lu hits, %lu misses, %lu evictions\n",
+                    n, n_idle, pool->bytes / 1048576.0, pool->budget / 1048576.0,
+                    pool->hits, pool->misses, pool->evictions);
+    if (pool->misses)
+        printf("Framebuffer pool: creating took %.2f ms, %lu page faults per buffer\n",
+                        pool->create_ns / 1e6 / pool->misses, pool->create_faults / pool->misses);
+}
+
+void drmlist_fbpool_cleanup(drmlist_fbpool_t* pool)
+{
+    for (int i = 0; i < DRMLIST_FBPOOL_MAX; i++)
+        if (pool->entries[i].valid)
+            mydrm_destroy_framebuffer(pool->fd, &pool->entries[i].fb);
+
+    memset(pool->entries, 0, sizeof(pool->entries));
+    pool->bytes = 0;
+}
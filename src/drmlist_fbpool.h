@@ -0,0 +1,50 @@
+#ifndef _DRMLIST_FBPOOL_H_
+#define _DRMLIST_FBPOOL_H_
+
+#include "mydrm/mydrm.h"
+
+/*
+ * Framebuffer pool
+ *
+ * Dumb buffers keyed by width/height/format. Released buffers stay mapped so
+ * switching back to a mode skips CREATE_DUMB/ADDFB/MAP_DUMB and the page faults
+ * of a fresh mapping. Idle buffers are evicted (RMFB + DESTROY_DUMB), least
+ * recently used first, when a new buffer would go over the memory budget.
+ */
+
+#define DRMLIST_FBPOOL_MAX 16
+#define DRMLIST_FBPOOL_DEFAULT_BUDGET_MB 256
+
+typedef struct
+{
+    mydrm_fb_t fb;
+    uint32_t format;
+    uint64_t last_used;
+    bool valid;
+    bool in_use;
+} drmlist_fbpool_entry_t;
+
+typedef struct
+{
+    drmlist_fbpool_entry_t entries[DRMLIST_FBPOOL_MAX];
+    int fd;
+    uint64_t budget;
+    uint64_t bytes;             // every pooled buffer, in use or idle
+    uint64_t tick;
+    uint32_t map_flags;         // MYDRM_MAP_* for new buffers
+
+    /* Stats */
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    uint64_t create_ns;         // misses only
+    uint64_t create_faults;
+} drmlist_fbpool_t;
+
+void drmlist_fbpool_init(drmlist_fbpool_t* pool, int fd, uint64_t budget, uint32_t map_flags);
+mydrm_fb_t* drmlist_fbpool_acquire(drmlist_fbpool_t* pool, uint32_t width, uint32_t height, uint32_t format);
+void drmlist_fbpool_release(drmlist_fbpool_t* pool, uint32_t fb_id);
+void drmlist_fbpool_print_stats(drmlist_fbpool_t* pool);
+void drmlist_fbpool_cleanup(drmlist_fbpool_t* pool);
+
+#endif // _DRMLIST_FBPOOL_H_
@@ -0,0 +1,439 @@
+#include "drmlist_hash.h"
+#include "drmlist_cpu.h"
+#include "drmlist_trace.h"
+#include <immintrin.h>
+#include <time.h>
+
+#define CRC32C_POLY 0x82F63B78u     // reflected
+
+static uint32_t crc32c_table[8][256];
+static pthread_once_t crc32c_table_once = PTHREAD_ONCE_INIT;
+
+static void crc32c_table_init(void)
+{
+    for (uint32_t i = 0; i < 256; i++)
+    {
+        uint32_t c = i;
+
+        for (int k = 0; k < 8; k++)
+            c = c & 1 ? (c >> 1) ^ CRC32C_POLY : c >> 1;
+        crc32c_table[0][i] = c;
+    }
+
+    for (uint32_t i = 0; i < 256; i++)
+        for (int k = 1; k < 8; k++)
+            crc32c_table[k][i] = (crc32c_table[k - 1][i] >> 8) ^ crc32c_table[0][crc32c_table[k - 1][i] & 0xFF];
+}
+
+/* Slice-by-8, on the inverted state */
+static uint32_t crc32c_update_scalar(uint32_t c, const uint8_t* p, size_t len)
+{
+    for (; len >= 8; len -= 8, p += 8)
+    {
+        uint32_t lo, hi;
+
+        memcpy(&lo, p, 4);
+        memcpy(&hi, p + 4, 4);
+        lo ^= c;
+        c = crc32c_table[7][lo & 0xFF] ^ crc32c_table[6][(lo >> 8) & 0xFF] ^
+            crc32c_table[5][(lo >> 16) & 0xFF] ^ crc32c_table[4][lo >> 24] ^
+            crc32c_table[3][hi & 0xFF] ^ crc32c_table[2][(hi >> 8) & 0xFF] ^
+            crc32c_table[1][(hi >> 16) & 0xFF] ^ crc32c_table[0][hi >> 24];
+    }
+
+    while (len--)
+        c = crc32c_table[0][(c ^ *p++) & 0xFF] ^ (c >> 8);
+
+    return c;
+}
+
+/* SSE4.2, every CPU with AVX2 has it */
+DRMLIST_TARGET_AVX2 static uint32_t crc32c_update_hw(uint32_t crc, const uint8_t* p, size_t len)
+{
+    uint64_t c = crc;
+
+    for (; len >= 8; len -= 8, p += 8)
+    {
+        uint64_t v;
+
+        memcpy(&v, p, 8);
+        c = _mm_crc32_u64(c, v);
+    }
+
+    while (len--)
+        c = _mm_crc32_u8((uint32_t)c, *p++);
+
+    return (uint32_t)c;
+}
+
+/* Non-temporal loads where `p` is 16-byte aligned, the rest like crc32c_update_hw() */
+DRMLIST_TARGET_AVX2 static uint32_t crc32c_update_stream(uint32_t crc, const uint8_t* p, size_t len)
+{
+    uint64_t c = crc;
+    size_t i = 0;
+
+    if ((uintptr_t)p & 15)
+        return crc32c_update_hw(crc, p, len);
+
+    for (; i + 16 <= len; i += 16)
+    {
+        __m128i v = _mm_stream_load_si128((__m128i*)(p + i));
+
+        c = _mm_crc32_u64(c, _mm_cvtsi128_si64(v));
+        c = _mm_crc32_u64(c, _mm_extract_epi64(v, 1));
+    }
+
+    return crc32c_update_hw((uint32_t)c, p + i, len - i);
+}
+
+uint32_t drmlist_crc32c_scalar(uint32_t crc, const void* data, size_t len)
+{
+    pthread_once(&crc32c_table_once, crc32c_table_init);
+    return ~crc32c_update_scalar(~crc, data, len);
+}
+
+uint32_t drmlist_crc32c(uint32_t crc, const void* data, size_t len)
+{
+    if (drmlist_cpu_level >= DRMLIST_CPU_AVX2)
+        return ~crc32c_update_hw(~crc, data, len);
+
+    return drmlist_crc32c_scalar(crc, data, len);
+}
+
+static void hash_row_scalar(uint32_t* crc, const uint8_t* row, uint32_t width, uint32_t tile_w)
+{
+    size_t seg = (size_t)tile_w * 4;
+    uint32_t t = 0;
+
+    for (uint32_t x = 0; x < width; x += tile_w, t++)
+        crc[t] = crc32c_update_scalar(crc[t], row + t * seg, (size_t)(width - x < tile_w ? width - x : tile_w) * 4);
+}
+
+/*
+ * One CRC32 instruction has 3 cycles of latency and a throughput of one, so
+ * four tiles go side by side
+ */
+DRMLIST_TARGET_AVX2 static void hash_row_hw(uint32_t* crc, const uint8_t* row, uint32_t width, uint32_t tile_w)
+{
+    size_t seg = (size_t)tile_w * 4;
+    uint32_t full = width / tile_w;
+    uint32_t t = 0;
+
+    if (!((uintptr_t)row & 15) && !(seg & 15))
+    {
+        for (; t + 4 <= full; t += 4)
+        {
+            const uint8_t* p = row + t * seg;
+            uint64_t c0 = crc[t], c1 = crc[t + 1], c2 = crc[t + 2], c3 = crc[t + 3];
+
+            for (size_t i = 0; i < seg; i += 16)
+            {
+                __m128i a = _mm_stream_load_si128((__m128i*)(p + i));
+                __m128i b = _mm_stream_load_si128((__m128i*)(p + seg + i));
+                __m128i c = _mm_stream_load_si128((__m128i*)(p + seg * 2 + i));
+                __m128i d = _mm_stream_load_si128((__m128i*)(p + seg * 3 + i));
+
+                c0 = _mm_crc32_u64(c0, _mm_cvtsi128_si64(a));
+                c1 = _mm_crc32_u64(c1, _mm_cvtsi128_si64(b));
+                c2 = _mm_crc32_u64(c2, _mm_cvtsi128_si64(c));
+                c3 = _mm_crc32_u64(c3, _mm_cvtsi128_si64(d));
+                c0 = _mm_crc32_u64(c0, _mm_extract_epi64(a, 1));
+                c1 = _mm_crc32_u64(c1, _mm_extract_epi64(b, 1));
+                c2 = _mm_crc32_u64(c2, _mm_extract_epi64(c, 1));
+                c3 = _mm_crc32_u64(c3, _mm_extract_epi64(d, 1));
+            }
+
+            crc[t] = c0;
+            crc[t + 1] = c1;
+            crc[t + 2] = c2;
+            crc[t + 3] = c3;
+        }
+    }
+
+    for (; t < full; t++)
+        crc[t] = crc32c_update_stream(crc[t], row + t * seg, seg);
+
+    if (width % tile_w)
+        crc[t] = crc32c_update_stream(crc[t], row + t * seg, (size_t)(width % tile_w) * 4);
+}
+
+void drmlist_hash_grid(uint32_t width, uint32_t height, uint32_t tile, uint32_t* tiles_x, uint32_t* tiles_y)
+{
+    *tiles_x = tile ? (width + tile - 1) / tile : 1;
+    *tiles_y = tile ? (height + tile - 1) / tile : 1;
+}
+
+uint32_t drmlist_hash_tiles(const uint8_t* pixels, uint32_t width, uint32_t height, uint32_t stride, uint32_t tile,
+                            uint32_t* tiles)
+{
+    uint32_t tile_w = tile ? tile : width;
+    uint32_t tile_h = tile ? tile : height;
+    bool hw = drmlist_cpu_level >= DRMLIST_CPU_AVX2;
+    uint32_t tiles_x, tiles_y;
+
+    pthread_once(&crc32c_table_once, crc32c_table_init);
+    drmlist_hash_grid(width, height, tile, &tiles_x, &tiles_y);
+
+    for (uint32_t ty = 0; ty < tiles_y; ty++)
+    {
+        uint32_t* crc = tiles + (size_t)ty * tiles_x;
+        uint32_t y1 = (ty + 1) * tile_h < height ? (ty + 1) * tile_h : height;
+
+        for (uint32_t tx = 0; tx < tiles_x; tx++)
+            crc[tx] = ~0u;
+
+        for (uint32_t y = ty * tile_h; y < y1; y++)
+        {
+            if (hw)
+                hash_row_hw(crc, pixels + (size_t)y * stride, width, tile_w);
+            else
+                hash_row_scalar(crc, pixels + (size_t)y * stride, width, tile_w);
+        }
+
+        for (uint32_t tx = 0; tx < tiles_x; tx++)
+            crc[tx] = ~crc[tx];
+    }
+
+    return drmlist_crc32c(0, tiles, (size_t)tiles_x * tiles_y * sizeof(uint32_t));
+}
+
+static bool hash_queue_push(drmlist_hash_t* h, drmlist_hash_job_t* job)
+{
+    uint32_t head = atomic_load_explicit(&h->head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&h->tail, memory_order_acquire);
+
+    if (head - tail == DRMLIST_HASH_QUEUE_SIZE)
+        return false;
+
+    h->jobs[head & (DRMLIST_HASH_QUEUE_SIZE - 1)] = *job;
+    atomic_store_explicit(&h->head, head + 1, memory_order_release);
+    sem_post(&h->queue_sem);
+    return true;
+}
+
+static bool hash_queue_pop(drmlist_hash_t* h, drmlist_hash_job_t* job)
+{
+    uint32_t tail = atomic_load_explicit(&h->tail, memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&h->head, memory_order_acquire);
+
+    if (head == tail)
+        return false;
+
+    *job = h->jobs[tail & (DRMLIST_HASH_QUEUE_SIZE - 1)];
+    atomic_store_explicit(&h->tail, tail + 1, memory_order_release);
+    return true;
+}
+
+static void hash_write(drmlist_hash_t* h, drmlist_hash_job_t* job, uint32_t frame, uint32_t n_tiles)
+{
+    if (job->width != h->log_width || job->height != h->log_height)
+    {
+        uint32_t tiles_x, tiles_y;
+
+        drmlist_hash_grid(job->width, job->height, h->tile, &tiles_x, &tiles_y);
+        fprintf(h->log, "# crc32c %ux%u tile %u %ux%u\n", job->width, job->height, h->tile, tiles_x, tiles_y);
+        h->log_width = job->width;
+        h->log_height = job->height;
+    }
+
+    fprintf(h->log, "%lu %08x", job->seq, frame);
+    if (h->tile)
+        for (uint32_t i = 0; i < n_tiles; i++)
+            fprintf(h->log, " %08x", h->tiles[i]);
+    fputc('\n', h->log);
+}
+
+static void* drmlist_hash_worker(void* arg)
+{
+    drmlist_hash_t* h = arg;
+    drmlist_hash_job_t job;
+
+    drmlist_trace_thread_name("drmlist-hash");
+
+    for (;;)
+    {
+        uint32_t tiles_x, tiles_y;
+        uint32_t frame;
+
+        while (sem_wait(&h->queue_sem) == -1 && errno == EINTR)
+            ;
+
+        if (!hash_queue_pop(h, &job))
+            continue;
+
+        if (!job.pixels)
+            break;
+
+        struct timespec t0, t1;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        DRMLIST_TRACE_SCOPE("frame hash");
+
+        drmlist_hash_grid(job.width, job.height, h->tile, &tiles_x, &tiles_y);
+
+        if ((size_t)tiles_x * tiles_y > h->n_tiles)
+        {
+            uint32_t* tiles = realloc(h->tiles, (size_t)tiles_x * tiles_y * sizeof(uint32_t));
+
+            if (tiles)
+            {
+                h->tiles = tiles;
+                h->n_tiles = (size_t)tiles_x * tiles_y;
+            }
+            else
+                perror("hash realloc");
+        }
+
+        if ((size_t)tiles_x * tiles_y <= h->n_tiles)
+        {
+            frame = drmlist_hash_tiles(job.pixels, job.width, job.height, job.stride, h->tile, h->tiles);
+            hash_write(h, &job, frame, tiles_x * tiles_y);
+
+            atomic_fetch_add_explicit(&h->frames, 1, memory_order_relaxed);
+            atomic_fetch_add_explicit(&h->bytes, (uint64_t)job.width * job.height * 4, memory_order_relaxed);
+        }
+
+        /* The render loop may draw into the pixels from here */
+        atomic_store_explicit(&h->done, job.id, memory_order_release);
+        sem_post(&h->done_sem);
+
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        atomic_fetch_add_explicit(&h->hash_ns, (t1.tv_sec - t0.tv_sec) * 1000000000ull + t1.tv_nsec - t0.tv_nsec, memory_order_relaxed);
+    }
+
+    fflush(h->log);
+
+    return NULL;
+}
+
+int drmlist_hash_init(drmlist_hash_t* h, const char* path, uint32_t tile)
+{
+    int ret;
+
+    memset(h, 0, sizeof(drmlist_hash_t));
+
+    /* Tile rows in whole 32 bytes for the non-temporal loads */
+    h->tile = (tile + 7) & ~7u;
+
+    if ((h->log = fopen(path, "w")) == NULL)
+    {
+        char errmsg[PATH_MAX + 32];
+        snprintf(errmsg, sizeof(errmsg), "Failed to open %s", path);
+        perror(errmsg);
+        return -1;
+    }
+
+    if (sem_init(&h->queue_sem, 0, 0) == -1 || sem_init(&h->done_sem, 0, 0) == -1)
+    {
+        perror("sem_init");
+        fclose(h->log);
+        return -1;
+    }
+
+    if ((ret = pthread_create(&h->worker, NULL, drmlist_hash_worker, h)))
+    {
+        errno = ret;
+        perror("pthread_create hash worker");
+        sem_destroy(&h->queue_sem);
+        sem_destroy(&h->done_sem);
+        fclose(h->log);
+        return -1;
+    }
+
+    h->worker_running = true;
+    if (h->tile)
+        printf("Hash: CRC32C (%s) of every frame in %u px tiles to %s\n",
+                        drmlist_cpu_level >= DRMLIST_CPU_AVX2 ? "sse4.2" : "table", h->tile, path);
+    else
+        printf("Hash: CRC32C (%s) of every frame to %s\n",
+                        drmlist_cpu_level >= DRMLIST_CPU_AVX2 ? "sse4.2" : "table", path);
+
+    return 0;
+}
+
+static void hash_wait_id(drmlist_hash_t* h, uint64_t id)
+{
+    struct timespec t0, t1;
+
+    if (atomic_load_explicit(&h->done, memory_order_acquire) >= id)
+        return;
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    h->waits++;
+
+    /* Posts of the jobs nobody waited for */
+    while (sem_trywait(&h->done_sem) == 0)
+        ;
+
+    while (atomic_load_explicit(&h->done, memory_order_acquire) < id)
+        while (sem_wait(&h->done_sem) == -1 && errno == EINTR)
+            ;
+
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    h->wait_ns += (t1.tv_sec - t0.tv_sec) * 1000000000ull + t1.tv_nsec - t0.tv_nsec;
+}
+
+/*
+ * Called by the render loop once `fb` is presented. At most a queue of jobs is
+ * outstanding, so the job of every id past `done` is still in its slot.
+ */
+void drmlist_hash_frame(drmlist_hash_t* h, mydrm_fb_t* fb, uint64_t seq)
+{
+    drmlist_hash_job_t job = {
+        .pixels = fb->pixels, .width = fb->width, .height = fb->height, .stride = fb->stride,
+        .seq = seq, .id = h->submitted + 1
+    };
+
+    if (!h->worker_running)
+        return;
+
+    if (h->submitted - atomic_load_explicit(&h->done, memory_order_acquire) == DRMLIST_HASH_QUEUE_SIZE)
+        hash_wait_id(h, h->submitted - DRMLIST_HASH_QUEUE_SIZE + 1);
+
+    hash_queue_push(h, &job);
+    h->submitted++;
+}
+
+void drmlist_hash_wait(drmlist_hash_t* h, const uint8_t* pixels)
+{
+    uint64_t done = atomic_load_explicit(&h->done, memory_order_acquire);
+
+    for (uint64_t id = h->submitted; id > done; id--)
+    {
+        if (!pixels || h->jobs[(id - 1) & (DRMLIST_HASH_QUEUE_SIZE - 1)].pixels == pixels)
+        {
+            hash_wait_id(h, id);
+            return;
+        }
+    }
+}
+
+void drmlist_hash_print_stats(drmlist_hash_t* h)
+{
+    uint64_t frames = atomic_load(&h->frames);
+    uint64_t hash_ns = atomic_load(&h->hash_ns);
+
+    printf("Hash: %lu frames, %.2f ms/frame in worker (%.2f GB/s), render loop waited %lu times for %.2f ms\n",
+                    frames, frames ? hash_ns / 1e6 / frames : 0.0,
+                    hash_ns ? (double)atomic_load(&h->bytes) / hash_ns : 0.0, h->waits, h->wait_ns / 1e6);
+}
+
+void drmlist_hash_cleanup(drmlist_hash_t* h)
+{
+    if (!h->worker_running)
+        return;
+
+    /* The queue is drained in order, so every frame is logged before QUIT */
+    drmlist_hash_job_t quit = { .pixels = NULL };
+
+    while (!hash_queue_push(h, &quit))
+        usleep(1000);
+
+    pthread_join(h->worker, NULL);
+    sem_destroy(&h->queue_sem);
+    sem_destroy(&h->done_sem);
+    h->worker_running = false;
+
+    drmlist_hash_print_stats(h);
+    fclose(h->log);
+    free(h->tiles);
+}
@@ -0,0 +1,98 @@
+#ifndef _DRMLIST_HASH_H_
+#define _DRMLIST_HASH_H_
+
+#include "mydrm/mydrm.h"
+#include <stdatomic.h>
+#include <pthread.h>
+#include <semaphore.h>
+
+/*
+ * Per-frame checksums for golden image checks
+ *
+ * Every presented frame is queued for a worker thread, which hashes it in
+ * place: CRC32C of each tile (rows of the tile, left to right, top to
+ * bottom), the frame hash is the CRC32C of its tile hashes. One line per
+ * frame goes to the log, the frame sequence number, the frame hash and the
+ * tile hashes, so two runs diff with drmlist_hashdiff and the differing
+ * tiles point at the changed region. Tile 0 hashes the frame as one tile.
+ *
+ * CRC32C uses the SSE4.2 instruction from DRMLIST_CPU_AVX2 up, four tiles
+ * interleaved and non-temporal loads (dumb buffers are often write-combined),
+ * a slice-by-8 table below. Both give the same hashes.
+ *
+ * The render loop doesn't wait for the worker unless it's about to draw into
+ * a buffer still being hashed (drmlist_hash_wait()), which takes a worker
+ * more than a frame behind.
+ */
+
+#define DRMLIST_HASH_DEFAULT_TILE 64
+#define DRMLIST_HASH_QUEUE_SIZE 8       // power of two
+
+typedef struct
+{
+    const uint8_t* pixels;
+    uint32_t width;
+    uint32_t height;
+    uint32_t stride;
+    uint64_t seq;
+    uint64_t id;
+} drmlist_hash_job_t;
+
+typedef struct
+{
+    FILE* log;
+    uint32_t tile;                  // pixels, multiple of 8, 0 for the whole frame
+
+    /* render loop -> worker */
+    _Atomic uint32_t head;
+    uint8_t pad0[60];
+    _Atomic uint32_t tail;
+    uint8_t pad1[60];
+    drmlist_hash_job_t jobs[DRMLIST_HASH_QUEUE_SIZE];
+    sem_t queue_sem;
+
+    /* worker -> render loop, jobs finish in order */
+    _Atomic uint64_t done;          // id of the last hashed job
+    sem_t done_sem;
+
+    pthread_t worker;
+    bool worker_running;
+
+    /* Render loop */
+    uint64_t submitted;             // id of the last queued job
+    uint64_t waits;
+    uint64_t wait_ns;
+
+    /* Worker */
+    uint32_t* tiles;
+    size_t n_tiles;
+    uint32_t log_width;             // of the last header line
+    uint32_t log_height;
+    _Atomic uint64_t frames;
+    _Atomic uint64_t bytes;
+    _Atomic uint64_t hash_ns;
+} drmlist_hash_t;
+
+/* CRC32C (Castagnoli), `crc` 0 to start, chains like zlib's crc32() */
+uint32_t drmlist_crc32c(uint32_t crc, const void* data, size_t len);
+uint32_t drmlist_crc32c_scalar(uint32_t crc, const void* data, size_t len);
+
+/* Tiles across and down for `tile` (0 for one tile) */
+void drmlist_hash_grid(uint32_t width, uint32_t height, uint32_t tile, uint32_t* tiles_x, uint32_t* tiles_y);
+
+/* Hashes of every tile into `tiles` (tiles_x * tiles_y, row major), returns the frame hash */
+uint32_t drmlist_hash_tiles(const uint8_t* pixels, uint32_t width, uint32_t height, uint32_t stride, uint32_t tile,
+                            uint32_t* tiles);
+
+int drmlist_hash_init(drmlist_hash_t* h, const char* path, uint32_t tile);
+
+/* Queue the presented `fb`, waits only if the queue is full */
+void drmlist_hash_frame(drmlist_hash_t* h, mydrm_fb_t* fb, uint64_t seq);
+
+/* Until no job reads `pixels` (NULL for any), before drawing into them */
+void drmlist_hash_wait(drmlist_hash_t* h, const uint8_t* pixels);
+
+void drmlist_hash_print_stats(drmlist_hash_t* h);
+void drmlist_hash_cleanup(drmlist_hash_t* h);
+
+#endif // _DRMLIST_HASH_H_
@@ -0,0 +1,83 @@
+#include "drmlist_idle.h"
+#include <time.h>
+
+/* Every thread of the process, the capture and scaler threads sleep along */
+static uint64_t idle_cpu_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+void drmlist_idle_init(drmlist_idle_t* idle, bool enabled)
+{
+    memset(idle, 0, sizeof(drmlist_idle_t));
+    idle->enabled = enabled;
+}
+
+void drmlist_idle_enter(drmlist_idle_t* idle, uint64_t now_ns, uint64_t wakeups)
+{
+    if (idle->idle)
+        return;
+
+    idle->idle = true;
+    idle->start_ns = now_ns;
+    idle->start_cpu_ns = idle_cpu_ns();
+    idle->start_wakeups = wakeups;
+    idle->periods++;
+}
+
+void drmlist_idle_leave(drmlist_idle_t* idle, uint64_t now_ns, uint64_t wakeups)
+{
+    if (!idle->idle)
+        return;
+
+    idle->idle = false;
+    idle->idle_ns += now_ns - idle->start_ns;
+    idle->cpu_ns += idle_cpu_ns() - idle->start_cpu_ns;
+    idle->wakeups += wakeups - idle->start_wakeups;
+    idle->resume_ns = now_ns;
+}
+
+void drmlist_idle_presented(drmlist_idle_t* idle, uint64_t now_ns, uint64_t refresh_ns)
+{
+    uint64_t ns;
+
+    if (!idle->resume_ns)
+        return;
+
+    ns = now_ns > idle->resume_ns ? now_ns - idle->resume_ns : 0;
+    idle->resume_ns = 0;
+    idle->resumes++;
+    idle->resume_sum_ns += ns;
+    if (ns > idle->resume_max_ns)
+        idle->resume_max_ns = ns;
+    if (refresh_ns && ns > refresh_ns)
+        idle->resumes_late++;
+}
+
+void drmlist_idle_print_stats(drmlist_idle_t* idle, uint64_t now_ns, uint64_t run_ns, uint64_t wakeups)
+{
+    uint64_t idle_ns = idle->idle_ns;
+    uint64_t cpu_ns = idle->cpu_ns;
+    uint64_t idle_wakeups = idle->wakeups;
+
+    if (!idle->enabled)
+        return;
+
+    if (idle->idle)
+    {
+        idle_ns += now_ns - idle->start_ns;
+        cpu_ns += idle_cpu_ns() - idle->start_cpu_ns;
+        idle_wakeups += wakeups - idle->start_wakeups;
+    }
+
+    printf("On demand: idle %.1f s of %.1f s (%lu periods), %.3f%% CPU and %.2f wakeups/s while idle\n",
+                    idle_ns / 1e9, run_ns / 1e9, idle->periods, idle_ns ? 100.0 * cpu_ns / idle_ns : 0.0,
+                    idle_ns ? idle_wakeups * 1e9 / idle_ns : 0.0);
+
+    if (idle->resumes)
+        printf("    change to on screen after idle: %.2f ms avg, %.2f ms max, %lu of %lu over one refresh\n",
+                        idle->resume_sum_ns / 1e6 / idle->resumes, idle->resume_max_ns / 1e6,
+                        idle->resumes_late, idle->resumes);
+}
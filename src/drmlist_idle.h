@@ -0,0 +1,54 @@
+#ifndef _DRMLIST_IDLE_H_
+#define _DRMLIST_IDLE_H_
+
+#include "mydrm/mydrm.h"
+
+/*
+ * On-demand rendering accounting
+ *
+ * With on-demand rendering a frame is only rendered when something changed
+ * (input, animation, a command), otherwise no flip is queued and the event
+ * loop sleeps. This keeps track of the idle periods, the process CPU time
+ * and event loop wakeups spent in them, and how long the first frame after
+ * each took to reach the screen from the change that ended it.
+ */
+
+typedef struct
+{
+    bool enabled;
+    bool idle;
+
+    /* Current idle period */
+    uint64_t start_ns;
+    uint64_t start_cpu_ns;
+    uint64_t start_wakeups;
+
+    /* All idle periods */
+    uint64_t periods;
+    uint64_t idle_ns;
+    uint64_t cpu_ns;
+    uint64_t wakeups;
+
+    /* Change to on screen, for the frames ending an idle period */
+    uint64_t resume_ns;         // change that ended the last period, 0 once on screen
+    uint64_t resumes;
+    uint64_t resume_sum_ns;
+    uint64_t resume_max_ns;
+    uint64_t resumes_late;      // slower than one refresh interval
+} drmlist_idle_t;
+
+void drmlist_idle_init(drmlist_idle_t* idle, bool enabled);
+
+/* Nothing left to render at `now_ns`, `wakeups` so far (drmlist_loop_t) */
+void drmlist_idle_enter(drmlist_idle_t* idle, uint64_t now_ns, uint64_t wakeups);
+
+/* A change at `now_ns` ends the idle period */
+void drmlist_idle_leave(drmlist_idle_t* idle, uint64_t now_ns, uint64_t wakeups);
+
+/* A frame reached the screen at `now_ns`, `refresh_ns` apart from the previous vblank */
+void drmlist_idle_presented(drmlist_idle_t* idle, uint64_t now_ns, uint64_t refresh_ns);
+
+/* Run time `run_ns` so far, an ongoing idle period counts up to `now_ns` */
+void drmlist_idle_print_stats(drmlist_idle_t* idle, uint64_t now_ns, uint64_t run_ns, uint64_t wakeups);
+
+#endif // _DRMLIST_IDLE_H_
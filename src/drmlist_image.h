@@ -0,0 +1,88 @@
+#ifndef _DRMLIST_IMAGE_H_
+#define _DRMLIST_IMAGE_H_
+
+#include "mydrm/mydrm.h"
+
+/*
+ * Images for backgrounds and splash screens
+ *
+ * Binary PPM (P6, 8-bit) and QOI files are mmapped and decoded row by row
+ * straight into the destination format; only one source row is ever staged.
+ * The image is centered on the destination, cropped if it's larger, and the
+ * uncovered area is filled with a background color.
+ *
+ * drmlist_image_cache_t keeps the decoded result per mode (width, height,
+ * format) so later frames are a streaming copy into the framebuffer. With a
+ * scale filter set, the image is instead fitted to the mode keeping its aspect
+ * ratio: it's decoded once at its own size and each mode gets one rescale.
+ */
+
+#define DRMLIST_IMAGE_CACHE 4
+#define DRMLIST_IMAGE_MAX_DIM 16384
+
+enum drmlist_image_type
+{
+    DRMLIST_IMAGE_PPM = 1,
+    DRMLIST_IMAGE_QOI = 2,
+};
+
+typedef struct
+{
+    uint8_t* map;               // NULL for images opened from a buffer
+    size_t map_size;
+    uint32_t type;              // DRMLIST_IMAGE_*
+    uint32_t width;
+    uint32_t height;
+    uint32_t maxval;            // PPM
+    uint32_t channels;          // QOI, 3 or 4
+    const uint8_t* data;        // pixel data, after the header
+    size_t data_size;
+} drmlist_image_t;
+
+typedef struct
+{
+    uint8_t* pixels;
+    uint32_t width;
+    uint32_t height;
+    uint32_t stride;
+    uint32_t format;
+    uint64_t last_used;
+} drmlist_image_entry_t;
+
+typedef struct
+{
+    drmlist_image_t image;
+    const char* path;
+    uint32_t bg;
+    uint32_t filter;            // DRMLIST_SCALE_*, NONE centers the image unscaled
+    uint32_t threads;
+    uint32_t* native;           // ARGB8888 at the image size, when scaling
+    drmlist_image_entry_t entries[DRMLIST_IMAGE_CACHE];
+    uint64_t tick;
+
+    /* Stats */
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t decode_ns;         // last decode, including scaling
+} drmlist_image_cache_t;
+
+int drmlist_image_open(drmlist_image_t* img, const char* path);
+int drmlist_image_open_buffer(drmlist_image_t* img, const void* buf, size_t size);
+const char* drmlist_image_type_name(uint32_t type);
+
+/*
+ * Decode into a width x height image of `format`, stride in bytes.
+ * Returns 0, -EINVAL for corrupt data or an unsupported format.
+ */
+int drmlist_image_decode(drmlist_image_t* img, void* dst, uint32_t format, uint32_t stride,
+                         uint32_t width, uint32_t height, uint32_t bg);
+void drmlist_image_close(drmlist_image_t* img);
+
+int drmlist_image_cache_init(drmlist_image_cache_t* cache, const char* path, uint32_t bg);
+void drmlist_image_cache_set_scale(drmlist_image_cache_t* cache, uint32_t filter, uint32_t threads);
+drmlist_image_entry_t* drmlist_image_cache_get(drmlist_image_cache_t* cache, uint32_t width, uint32_t height, uint32_t format);
+int drmlist_image_cache_blit(drmlist_image_cache_t* cache, mydrm_fb_t* fb);
+void drmlist_image_cache_print_stats(drmlist_image_cache_t* cache);
+void drmlist_image_cache_cleanup(drmlist_image_cache_t* cache);
+
+#endif // _DRMLIST_IMAGE_H_
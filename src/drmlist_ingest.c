@@ -0,0 +1,329 @@
+#define _GNU_SOURCE
+#include "drmlist_ingest.h"
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/eventfd.h>
+
+static void drmlist_ingest_reset_rings(drmlist_ingest_t* ingest)
+{
+    drmlist_ingest_ctl_t* ctl = ingest->ctl;
+
+    atomic_store(&ctl->ready.head, 0);
+    atomic_store(&ctl->ready.tail, 0);
+    atomic_store(&ctl->free.head, 0);
+    atomic_store(&ctl->free.tail, 0);
+    atomic_store(&ctl->consumer_waiting, 0);
+    atomic_store(&ctl->presented, 0);
+    atomic_store(&ctl->dropped, 0);
+
+    /* Buffers still on screen or waiting for a flip come back through flip_done */
+    for (int i = 0; i < ingest->n_buffers; i++)
+        if (i != ingest->shown && i != ingest->pending)
+            drmlist_ingest_ring_push(&ctl->free, i);
+}
+
+int drmlist_ingest_init(drmlist_ingest_t* ingest, mydrm_data_t* data, const char* path, int n_buffers)
+{
+    struct sockaddr_un addr;
+    uint64_t cap = 0;
+
+    memset(ingest, 0, sizeof(drmlist_ingest_t));
+    ingest->ctl_fd = -1;
+    ingest->event_fd = -1;
+    ingest->listen_fd = -1;
+    ingest->client_fd = -1;
+    ingest->pending = -1;
+    ingest->shown = -1;
+    ingest->path = path;
+
+    for (int i = 0; i < DRMLIST_INGEST_MAX_BUFFERS; i++)
+        ingest->prime_fds[i] = -1;
+
+    if (n_buffers < 2)
+        n_buffers = 2;
+    else if (n_buffers > DRMLIST_INGEST_MAX_BUFFERS)
+        n_buffers = DRMLIST_INGEST_MAX_BUFFERS;
+
+    if (mydrm_get_cap(data->fd, DRM_CAP_PRIME, &cap) == -1 || !(cap & DRM_PRIME_CAP_EXPORT))
+    {
+        fprintf(stderr, "Ingest: DRM device can't export PRIME buffers\n");
+        return -EOPNOTSUPP;
+    }
+
+    for (int i = 0; i < n_buffers; i++)
+    {
+        ingest->fbs[i].width = data->framebuffer[0].width;
+        ingest->fbs[i].height = data->framebuffer[0].height;
+
+        if (!mydrm_create_framebuffer(data->fd, &ingest->fbs[i]))
+        {
+            fprintf(stderr, "Ingest: Failed to create framebuffer[%d]\n", i);
+            return -1;
+        }
+        ingest->n_buffers++;
+
+        if (mydrm_prime_export(data->fd, &ingest->fbs[i], &ingest->prime_fds[i]) == -1)
+        {
+            perror("ioctl DRM_IOCTL_PRIME_HANDLE_TO_FD");
+            return -1;
+        }
+    }
+
+    if ((ingest->ctl_fd = memfd_create("drmlist-ingest", MFD_CLOEXEC)) == -1)
+    {
+        perror("memfd_create");
+        return -1;
+    }
+
+    if (ftruncate(ingest->ctl_fd, sizeof(drmlist_ingest_ctl_t)) == -1)
+    {
+        perror("ftruncate ingest ctl");
+        return -1;
+    }
+
+    ingest->ctl = mmap(NULL, sizeof(drmlist_ingest_ctl_t), PROT_READ | PROT_WRITE, MAP_SHARED, ingest->ctl_fd, 0);
+    if (ingest->ctl == MAP_FAILED)
+    {
+        ingest->ctl = NULL;
+        perror("mmap ingest ctl");
+        return -1;
+    }
+
+    ingest->ctl->magic = DRMLIST_INGEST_MAGIC;
+    ingest->ctl->version = DRMLIST_INGEST_VERSION;
+    ingest->ctl->n_buffers = ingest->n_buffers;
+    ingest->ctl->width = ingest->fbs[0].width;
+    ingest->ctl->height = ingest->fbs[0].height;
+    ingest->ctl->stride = ingest->fbs[0].stride;
+    ingest->ctl->format = DRM_FORMAT_XRGB8888;
+    ingest->ctl->size = ingest->fbs[0].size;
+    drmlist_ingest_reset_rings(ingest);
+
+    if ((ingest->event_fd = eventfd(0, EFD_CLOEXEC)) == -1)
+    {
+        perror("eventfd");
+        return -1;
+    }
+
+    if ((ingest->listen_fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC | SOCK_NONBLOCK, 0)) == -1)
+    {
+        perror("socket");
+        return -1;
+    }
+
+    memset(&addr, 0, sizeof(struct sockaddr_un));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+    unlink(path);
+
+    if (bind(ingest->listen_fd, (struct sockaddr*)&addr, sizeof(struct sockaddr_un)) == -1 || listen(ingest->listen_fd, 1) == -1)
+    {
+        char errmsg[PATH_MAX];
+        snprintf(errmsg, PATH_MAX, "Failed to listen on %s", path);
+        perror(errmsg);
+        return -1;
+    }
+
+    printf("Ingest: %d buffers (%dx%d, stride: %d), waiting for producer on %s\n", ingest->n_buffers,
+                    ingest->ctl->width, ingest->ctl->height, ingest->ctl->stride, path);
+
+    return 0;
+}
+
+static int drmlist_ingest_send_hello(drmlist_ingest_t* ingest, int fd)
+{
+    int fds[2 + DRMLIST_INGEST_MAX_BUFFERS];
+    char cmsg_buf[CMSG_SPACE(sizeof(fds))];
+    drmlist_ingest_hello_t hello;
+    struct msghdr msg;
+    struct cmsghdr* cmsg;
+    struct iovec iov;
+    int n_fds = 0;
+
+    fds[n_fds++] = ingest->ctl_fd;
+    fds[n_fds++] = ingest->event_fd;
+    for (int i = 0; i < ingest->n_buffers; i++)
+        fds[n_fds++] = ingest->prime_fds[i];
+
+    hello.magic = DRMLIST_INGEST_MAGIC;
+    hello.version = DRMLIST_INGEST_VERSION;
+    hello.n_fds = n_fds;
+
+    iov.iov_base = &hello;
+    iov.iov_len = sizeof(drmlist_ingest_hello_t);
+
+    memset(&msg, 0, sizeof(struct msghdr));
+    memset(cmsg_buf, 0, sizeof(cmsg_buf));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = cmsg_buf;
+    msg.msg_controllen = CMSG_SPACE(n_fds * sizeof(int));
+
+    cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(n_fds * sizeof(int));
+    memcpy(CMSG_DATA(cmsg), fds, n_fds * sizeof(int));
+
+    return sendmsg(fd, &msg, MSG_NOSIGNAL);
+}
+
+/*
+ * Accept a producer, returns its fd (to be watched for hangup) or -1
+ */
+int drmlist_ingest_accept(drmlist_ingest_t* ingest)
+{
+    int fd;
+
+    if ((fd = accept4(ingest->listen_fd, NULL, NULL, SOCK_CLOEXEC | SOCK_NONBLOCK)) == -1)
+    {
+        perror("accept4");
+        return -1;
+    }
+
+    if (ingest->client_fd != -1)
+    {
+        fprintf(stderr, "Ingest: Producer already connected, rejecting new one\n");
+        close(fd);
+        return -1;
+    }
+
+    drmlist_ingest_reset_rings(ingest);
+
+    /* Idle until the first frame, it has to ring (a flip still pending looks again when it's done) */
+    atomic_store(&ingest->ctl->consumer_waiting, 1);
+
+    if (drmlist_ingest_send_hello(ingest, fd) == -1)
+    {
+        perror("Ingest: sendmsg");
+        close(fd);
+        return -1;
+    }
+
+    printf("Ingest: Producer connected\n");
+    ingest->client_fd = fd;
+
+    return fd;
+}
+
+void drmlist_ingest_client_event(drmlist_ingest_t* ingest)
+{
+    char buf[64];
+    ssize_t len = recv(ingest->client_fd, buf, sizeof(buf), 0);
+
+    if (len > 0 || (len == -1 && errno == EAGAIN))
+        return;
+
+    printf("Ingest: Producer disconnected (presented: %lu, dropped: %lu)\n",
+                    atomic_load(&ingest->ctl->presented), atomic_load(&ingest->ctl->dropped));
+
+    atomic_store(&ingest->ctl->consumer_waiting, 0);
+    close(ingest->client_fd);
+    ingest->client_fd = -1;
+}
+
+/*
+ * Flip to the newest ready buffer, older ready buffers go straight back to the producer
+ */
+static bool drmlist_ingest_present(drmlist_ingest_t* ingest, mydrm_data_t* data)
+{
+    drmlist_ingest_ctl_t* ctl = ingest->ctl;
+    uint32_t idx;
+    int newest = -1;
+
+    while (drmlist_ingest_ring_pop(&ctl->ready, &idx))
+    {
+        if (idx >= (uint32_t)ingest->n_buffers)
+            continue;
+
+        if (newest != -1)
+        {
+            drmlist_ingest_ring_push(&ctl->free, newest);
+            atomic_fetch_add_explicit(&ctl->dropped, 1, memory_order_relaxed);
+        }
+        newest = idx;
+    }
+
+    if (newest == -1)
+        return false;
+
+    if (mydrm_page_flip(data->fd, data->crt_id, ingest->fbs[newest].fb, DRM_MODE_PAGE_FLIP_EVENT, data) == -1)
+    {
+        perror("FAILED ioctl DRM_IOCTL_MODE_PAGE_FLIP");
+        drmlist_ingest_ring_push(&ctl->free, newest);
+        return false;
+    }
+
+    data->pflip_pending = true;
+    ingest->pending = newest;
+
+    return true;
+}
+
+static void drmlist_ingest_try_present(drmlist_ingest_t* ingest, mydrm_data_t* data)
+{
+    if (data->pflip_pending || ingest->client_fd == -1)
+        return;
+
+    if (drmlist_ingest_present(ingest, data))
+        return;
+
+    /* Going idle: ask for the doorbell, then look again so a push in between isn't lost */
+    atomic_store(&ingest->ctl->consumer_waiting, 1);
+    atomic_thread_fence(memory_order_seq_cst);
+
+    if (drmlist_ingest_present(ingest, data))
+        atomic_store(&ingest->ctl->consumer_waiting, 0);
+}
+
+/*
+ * Producer rang the doorbell, the event loop already consumed the eventfd count
+ */
+void drmlist_ingest_doorbell(drmlist_ingest_t* ingest, mydrm_data_t* data)
+{
+    drmlist_ingest_try_present(ingest, data);
+}
+
+void drmlist_ingest_flip_done(drmlist_ingest_t* ingest, mydrm_data_t* data)
+{
+    if (ingest->pending == -1)
+        return;
+
+    if (ingest->shown != -1)
+        drmlist_ingest_ring_push(&ingest->ctl->free, ingest->shown);
+
+    ingest->shown = ingest->pending;
+    ingest->pending = -1;
+    atomic_fetch_add_explicit(&ingest->ctl->presented, 1, memory_order_relaxed);
+
+    drmlist_ingest_try_present(ingest, data);
+}
+
+void drmlist_ingest_cleanup(drmlist_ingest_t* ingest, mydrm_data_t* data)
+{
+    if (ingest->client_fd != -1)
+        close(ingest->client_fd);
+
+    if (ingest->listen_fd != -1)
+    {
+        close(ingest->listen_fd);
+        unlink(ingest->path);
+    }
+
+    if (ingest->event_fd != -1)
+        close(ingest->event_fd);
+
+    if (ingest->ctl)
+        munmap(ingest->ctl, sizeof(drmlist_ingest_ctl_t));
+
+    if (ingest->ctl_fd != -1)
+        close(ingest->ctl_fd);
+
+    for (int i = 0; i < ingest->n_buffers; i++)
+    {
+        if (ingest->prime_fds[i] != -1)
+            close(ingest->prime_fds[i]);
+        mydrm_destroy_framebuffer(data->fd, &ingest->fbs[i]);
+    }
+}
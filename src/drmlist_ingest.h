@@ -0,0 +1,117 @@
+#ifndef _DRMLIST_INGEST_H_
+#define _DRMLIST_INGEST_H_
+
+#include "mydrm/mydrm.h"
+#include <stdatomic.h>
+
+/*
+ * Shared-memory frame ingestion
+ *
+ * drmlist listens on a Unix socket. When a producer connects it receives, via
+ * SCM_RIGHTS, in this order:
+ *  - a memfd holding drmlist_ingest_ctl_t
+ *  - an eventfd doorbell
+ *  - one DMA-BUF fd per scanout buffer (exported dumb buffers)
+ *
+ * The producer pops a buffer index from `free`, renders into the mapped buffer,
+ * then pushes the index to `ready`. drmlist flips to the newest ready buffer and
+ * hands buffers back through `free` once they left the screen. Pixels are never
+ * copied by drmlist.
+ *
+ * The doorbell is only written when `consumer_waiting` is set, i.e. when drmlist
+ * is idle in epoll with no page flip pending.
+ */
+
+#define DRMLIST_INGEST_MAGIC        0x474E4944  // "DING"
+#define DRMLIST_INGEST_VERSION      1
+#define DRMLIST_INGEST_MAX_BUFFERS  4
+#define DRMLIST_INGEST_RING_SIZE    8           // power of two, > DRMLIST_INGEST_MAX_BUFFERS
+#define DRMLIST_INGEST_DEFAULT_BUFFERS 3
+
+/* Single producer, single consumer ring of buffer indices */
+typedef struct
+{
+    _Atomic uint32_t head;                      // written by the pushing side
+    uint8_t pad0[60];
+    _Atomic uint32_t tail;                      // written by the popping side
+    uint8_t pad1[60];
+    uint32_t slots[DRMLIST_INGEST_RING_SIZE];
+} drmlist_ingest_ring_t;
+
+typedef struct
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t n_buffers;
+    uint32_t width;
+    uint32_t height;
+    uint32_t stride;
+    uint32_t format;
+    uint32_t size;
+
+    _Atomic uint32_t consumer_waiting;
+    _Atomic uint64_t presented;                 // frames that made it to the screen
+    _Atomic uint64_t dropped;                   // ready frames replaced by a newer one
+
+    drmlist_ingest_ring_t ready;                // producer -> drmlist
+    drmlist_ingest_ring_t free;                 // drmlist -> producer
+} drmlist_ingest_ctl_t;
+
+typedef struct
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t n_fds;
+} drmlist_ingest_hello_t;
+
+static inline bool drmlist_ingest_ring_push(drmlist_ingest_ring_t* ring, uint32_t idx)
+{
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+
+    if (head - tail == DRMLIST_INGEST_RING_SIZE)
+        return false;
+
+    ring->slots[head & (DRMLIST_INGEST_RING_SIZE - 1)] = idx;
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+    return true;
+}
+
+static inline bool drmlist_ingest_ring_pop(drmlist_ingest_ring_t* ring, uint32_t* idx)
+{
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+
+    if (head == tail)
+        return false;
+
+    *idx = ring->slots[tail & (DRMLIST_INGEST_RING_SIZE - 1)];
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+    return true;
+}
+
+typedef struct
+{
+    mydrm_fb_t fbs[DRMLIST_INGEST_MAX_BUFFERS];
+    int prime_fds[DRMLIST_INGEST_MAX_BUFFERS];
+    int n_buffers;
+
+    drmlist_ingest_ctl_t* ctl;
+    int ctl_fd;
+    int event_fd;
+    int listen_fd;
+    int client_fd;
+
+    int pending;        // buffer index waiting for its flip, -1 if none
+    int shown;          // buffer index on screen, -1 if none
+    const char* path;
+} drmlist_ingest_t;
+
+int drmlist_ingest_init(drmlist_ingest_t* ingest, mydrm_data_t* data, const char* path, int n_buffers);
+int drmlist_ingest_accept(drmlist_ingest_t* ingest);
+void drmlist_ingest_client_event(drmlist_ingest_t* ingest);
+void drmlist_ingest_doorbell(drmlist_ingest_t* ingest, mydrm_data_t* data);
+void drmlist_ingest_flip_done(drmlist_ingest_t* ingest, mydrm_data_t* data);
+void drmlist_ingest_cleanup(drmlist_ingest_t* ingest, mydrm_data_t* data);
+
+#endif // _DRMLIST_INGEST_H_
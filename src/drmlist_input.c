@@ -0,0 +1,302 @@
+#define _GNU_SOURCE
+#include "drmlist_input.h"
+#include <poll.h>
+#include <time.h>
+#include <sys/eventfd.h>
+
+static uint64_t input_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/*
+ * Recorder
+ */
+
+int drmlist_input_record_open(drmlist_input_recorder_t* rec, const char* path, uint64_t start_ns)
+{
+    drmlist_input_header_t header = {
+        .magic = DRMLIST_INPUT_MAGIC,
+        .version = DRMLIST_INPUT_VERSION,
+        .packet_size = sizeof(drmlist_input_packet_t),
+        .reserved = 0
+    };
+
+    memset(rec, 0, sizeof(drmlist_input_recorder_t));
+
+    if ((rec->file = fopen(path, "wb")) == NULL)
+        return -1;
+
+    if (fwrite(&header, sizeof(header), 1, rec->file) != 1)
+    {
+        fclose(rec->file);
+        rec->file = NULL;
+        return -1;
+    }
+
+    rec->start_ns = start_ns;
+
+    return 0;
+}
+
+/*
+ * Buffered, a packet costs a memcpy until stdio flushes
+ */
+void drmlist_input_record(drmlist_input_recorder_t* rec, uint64_t now_ns, uint32_t frame, const uint8_t* buf, size_t len)
+{
+    drmlist_input_packet_t p;
+
+    if (!rec->file)
+        return;
+
+    memset(&p, 0, sizeof(drmlist_input_packet_t));
+    p.t_ns = now_ns - rec->start_ns;
+    p.frame = frame;
+    p.len = len > DRMLIST_INPUT_PACKET_MAX ? DRMLIST_INPUT_PACKET_MAX : len;
+    memcpy(p.data, buf, p.len);
+
+    if (fwrite(&p, sizeof(p), 1, rec->file) == 1)
+        rec->packets++;
+}
+
+void drmlist_input_record_close(drmlist_input_recorder_t* rec)
+{
+    if (!rec->file)
+        return;
+
+    fclose(rec->file);
+    rec->file = NULL;
+    printf("Input recording: %lu packets\n", rec->packets);
+}
+
+/*
+ * Replayer
+ */
+
+/* Waits for `fd` to be ready for `events` or until `deadline_ns` (0: no timeout), false once told to quit */
+static bool replay_wait(drmlist_input_replay_t* r, int fd, short events, uint64_t deadline_ns)
+{
+    struct pollfd fds[2] = {
+        { .fd = r->quit_fd, .events = POLLIN },
+        { .fd = fd, .events = events }
+    };
+
+    for (;;)
+    {
+        struct timespec ts, *timeout = NULL;
+        uint64_t now;
+
+        if (deadline_ns)
+        {
+            if ((now = input_now_ns()) >= deadline_ns)
+                return true;
+            ts.tv_sec = (deadline_ns - now) / 1000000000ull;
+            ts.tv_nsec = (deadline_ns - now) % 1000000000ull;
+            timeout = &ts;
+        }
+
+        if (ppoll(fds, fd == -1 ? 1 : 2, timeout, NULL) == -1 && errno != EINTR)
+            return false;
+
+        if (fds[0].revents)
+            return false;
+        if (fd != -1 && fds[1].revents)
+            return true;
+    }
+}
+
+static void* drmlist_input_replay_thread(void* arg)
+{
+    drmlist_input_replay_t* r = arg;
+    uint64_t one = 1;
+
+    r->start_ns = input_now_ns();
+
+    for (size_t i = 0; i < r->n_packets; i++)
+    {
+        const drmlist_input_packet_t* p = &r->packets[i];
+
+        if (!r->fast)
+        {
+            uint64_t due = r->start_ns + p->t_ns;
+            uint64_t now;
+
+            if (!replay_wait(r, -1, 0, due))
+                return NULL;
+
+            if ((now = input_now_ns()) - due > r->late_ns_max)
+                r->late_ns_max = now - due;
+        }
+
+        /* The write end is non-blocking, a full pipe waits for the reader */
+        while (write(r->write_fd, p->data, p->len) == -1)
+        {
+            if (errno != EAGAIN || !replay_wait(r, r->write_fd, POLLOUT, 0))
+                return NULL;
+        }
+
+        atomic_fetch_add_explicit(&r->sent, 1, memory_order_relaxed);
+    }
+
+    r->end_ns = input_now_ns();
+    if (write(r->done_fd, &one, sizeof(one)) == -1)
+        perror("write input replay done_fd");
+
+    return NULL;
+}
+
+int drmlist_input_replay_open(drmlist_input_replay_t* r, const char* path, bool fast)
+{
+    const drmlist_input_header_t* header;
+    struct stat st;
+    int fds[2];
+    int fd;
+
+    memset(r, 0, sizeof(drmlist_input_replay_t));
+    r->read_fd = r->write_fd = r->done_fd = r->quit_fd = -1;
+    r->fast = fast;
+
+    if ((fd = open(path, O_RDONLY | O_CLOEXEC)) == -1)
+        return -1;
+
+    if (fstat(fd, &st) == -1 || (size_t)st.st_size < sizeof(drmlist_input_header_t))
+    {
+        close(fd);
+        errno = EINVAL;
+        return -1;
+    }
+
+    r->map_size = st.st_size;
+    r->map = mmap(NULL, r->map_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+    close(fd);
+
+    if (r->map == MAP_FAILED)
+    {
+        r->map = NULL;
+        return -1;
+    }
+
+    header = r->map;
+    if (header->magic != DRMLIST_INPUT_MAGIC || header->version != DRMLIST_INPUT_VERSION ||
+        header->packet_size != sizeof(drmlist_input_packet_t))
+    {
+        fprintf(stderr, "%s: not a drmlist input log (version %u)\n", path, DRMLIST_INPUT_VERSION);
+        drmlist_input_replay_close(r);
+        errno = EINVAL;
+        return -1;
+    }
+
+    /* A truncated log or a packet longer than its data would be read past */
+    if ((r->map_size - sizeof(drmlist_input_header_t)) % sizeof(drmlist_input_packet_t))
+    {
+        fprintf(stderr, "%s: truncated, not a whole number of packets\n", path);
+        drmlist_input_replay_close(r);
+        errno = EINVAL;
+        return -1;
+    }
+
+    r->packets = (const drmlist_input_packet_t*)(header + 1);
+    r->n_packets = (r->map_size - sizeof(drmlist_input_header_t)) / sizeof(drmlist_input_packet_t);
+
+    for (size_t i = 0; i < r->n_packets; i++)
+    {
+        if (r->packets[i].len > DRMLIST_INPUT_PACKET_MAX)
+        {
+            fprintf(stderr, "%s: packet %zu is %u bytes, at most %u\n", path, i, r->packets[i].len, DRMLIST_INPUT_PACKET_MAX);
+            drmlist_input_replay_close(r);
+            errno = EINVAL;
+            return -1;
+        }
+    }
+
+    /* O_DIRECT: packet mode, every read returns exactly one write */
+    if (pipe2(fds, O_CLOEXEC | O_DIRECT) == -1)
+    {
+        drmlist_input_replay_close(r);
+        return -1;
+    }
+    r->read_fd = fds[0];
+    r->write_fd = fds[1];
+
+    if (fcntl(r->write_fd, F_SETFL, O_NONBLOCK | O_DIRECT) == -1 ||
+        (r->done_fd = eventfd(0, EFD_CLOEXEC)) == -1 || (r->quit_fd = eventfd(0, EFD_CLOEXEC)) == -1)
+    {
+        drmlist_input_replay_close(r);
+        return -1;
+    }
+
+    return 0;
+}
+
+int drmlist_input_replay_start(drmlist_input_replay_t* r)
+{
+    int ret;
+
+    if ((ret = pthread_create(&r->thread, NULL, drmlist_input_replay_thread, r)))
+    {
+        errno = ret;
+        perror("pthread_create input replay");
+        return -1;
+    }
+    r->running = true;
+
+    return 0;
+}
+
+size_t drmlist_input_replay_pending(drmlist_input_replay_t* r)
+{
+    int bytes = 0;
+
+    if (r->read_fd == -1 || ioctl(r->read_fd, FIONREAD, &bytes) == -1)
+        return 0;
+
+    return bytes;
+}
+
+void drmlist_input_replay_print_stats(drmlist_input_replay_t* r)
+{
+    uint64_t sent = atomic_load_explicit(&r->sent, memory_order_relaxed);
+
+    if (!r->map)
+        return;
+
+    printf("Input replay (%s): %lu/%zu packets", r->fast ? "fast" : "realtime", sent, r->n_packets);
+    if (r->end_ns)
+        printf(" in %.2f ms (recorded %.2f ms)", (r->end_ns - r->start_ns) / 1e6,
+                        r->n_packets ? r->packets[r->n_packets - 1].t_ns / 1e6 : 0.0);
+    if (!r->fast)
+        printf(", up to %.3f ms late", r->late_ns_max / 1e6);
+    printf("\n");
+}
+
+void drmlist_input_replay_close(drmlist_input_replay_t* r)
+{
+    uint64_t one = 1;
+
+    /* Never opened, or already closed */
+    if (!r->map)
+        return;
+
+    if (r->running)
+    {
+        if (write(r->quit_fd, &one, sizeof(one)) == -1)
+            perror("write input replay quit_fd");
+        pthread_join(r->thread, NULL);
+        r->running = false;
+    }
+
+    if (r->read_fd != -1)
+        close(r->read_fd);
+    if (r->write_fd != -1)
+        close(r->write_fd);
+    if (r->done_fd != -1)
+        close(r->done_fd);
+    if (r->quit_fd != -1)
+        close(r->quit_fd);
+    r->read_fd = r->write_fd = r->done_fd = r->quit_fd = -1;
+
+    munmap(r->map, r->map_size);
+    r->map = NULL;
+}
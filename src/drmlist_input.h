@@ -0,0 +1,85 @@
+#ifndef _DRMLIST_INPUT_H_
+#define _DRMLIST_INPUT_H_
+
+#include "mydrm/mydrm.h"
+#include <stdatomic.h>
+#include <pthread.h>
+
+/*
+ * Input recording and replay
+ *
+ * The recorder appends every raw mouse packet, as read from /dev/input/mice,
+ * to a binary log with its time since the start of the recording and the
+ * frame it arrived in. The log is a drmlist_input_header_t followed by
+ * fixed size drmlist_input_packet_t records.
+ *
+ * The replayer maps a log and, once started, a thread writes the packets into a packet mode
+ * pipe (one read, one packet, like the mice device), either at their recorded
+ * times or as fast as the reader takes them. drmlist reads the pipe in place
+ * of /dev/input/mice, so packets go through the same handler. `done_fd`, an
+ * eventfd, is signalled once the last packet is in the pipe.
+ */
+
+#define DRMLIST_INPUT_MAGIC     0x4E494C44  // "DLIN"
+#define DRMLIST_INPUT_VERSION   1
+#define DRMLIST_INPUT_PACKET_MAX 3          // PS/2 packets, as drmlist reads /dev/input/mice
+
+typedef struct
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t packet_size;                   // sizeof(drmlist_input_packet_t)
+    uint32_t reserved;
+} drmlist_input_header_t;
+
+typedef struct
+{
+    uint64_t t_ns;                          // since the start of the recording
+    uint32_t frame;
+    uint8_t len;
+    uint8_t data[DRMLIST_INPUT_PACKET_MAX];
+} drmlist_input_packet_t;
+
+_Static_assert(sizeof(drmlist_input_packet_t) == 16, "drmlist_input_packet_t is part of the log format");
+
+typedef struct
+{
+    FILE* file;
+    uint64_t start_ns;
+    uint64_t packets;
+} drmlist_input_recorder_t;
+
+typedef struct
+{
+    const drmlist_input_packet_t* packets;  // in the mapped log
+    size_t n_packets;
+    void* map;
+    size_t map_size;
+
+    int read_fd;                            // the mouse fd while replaying
+    int write_fd;
+    int done_fd;
+    int quit_fd;
+    bool fast;
+
+    pthread_t thread;
+    bool running;
+
+    /* Written by the replay thread, read once done_fd fired */
+    uint64_t start_ns;
+    uint64_t end_ns;
+    uint64_t late_ns_max;                   // behind the recorded time, realtime replay only
+    _Atomic uint64_t sent;
+} drmlist_input_replay_t;
+
+int drmlist_input_record_open(drmlist_input_recorder_t* rec, const char* path, uint64_t start_ns);
+void drmlist_input_record(drmlist_input_recorder_t* rec, uint64_t now_ns, uint32_t frame, const uint8_t* buf, size_t len);
+void drmlist_input_record_close(drmlist_input_recorder_t* rec);
+
+int drmlist_input_replay_open(drmlist_input_replay_t* r, const char* path, bool fast);
+int drmlist_input_replay_start(drmlist_input_replay_t* r);         // packet times count from here
+size_t drmlist_input_replay_pending(drmlist_input_replay_t* r);     // bytes still in the pipe
+void drmlist_input_replay_print_stats(drmlist_input_replay_t* r);
+void drmlist_input_replay_close(drmlist_input_replay_t* r);
+
+#endif // _DRMLIST_INPUT_H_
@@ -0,0 +1,540 @@
+#include "drmlist_kernels.h"
+#include <immintrin.h>
+
+/*
+ * Scalar helpers, the tails of every variant
+ */
+static inline uint32_t over_u8x4(uint32_t s, uint32_t d)
+{
+    uint32_t ia = 255 - (s >> 24);
+    uint32_t ret = 0;
+
+    /* (t + (t >> 8)) >> 8 with t = c * ia + 128, exact division by 255 */
+    for (int sh = 0; sh < 32; sh += 8)
+    {
+        uint32_t t = ((d >> sh) & 0xFF) * ia + 128;
+        uint32_t c = ((s >> sh) & 0xFF) + ((t + (t >> 8)) >> 8);
+        ret |= (c > 0xFF ? 0xFF : c) << sh;
+    }
+
+    return ret;
+}
+
+static inline void over_span_scalar(uint32_t* dst, const uint32_t* src, uint32_t n)
+{
+    for (uint32_t i = 0; i < n; i++)
+    {
+        if (src[i] >> 24 == 0xFF)
+            dst[i] = src[i];
+        else if (src[i])
+            dst[i] = over_u8x4(src[i], dst[i]);
+    }
+}
+
+static inline void keyed_span_scalar(uint32_t* dst, const uint32_t* src, uint32_t n)
+{
+    for (uint32_t i = 0; i < n; i++)
+        if (src[i])
+            dst[i] = src[i];
+}
+
+/*
+ * SSE2, the x86-64 baseline, 4 pixels per iteration
+ */
+static void clear_sse2(uint32_t* dst, uint32_t color, size_t n)
+{
+    const __m128i c = _mm_set1_epi32(color);
+    size_t i = 0;
+
+    for (; i < n && ((uintptr_t)(dst + i) & 15); i++)
+        dst[i] = color;
+
+    for (; i + 16 <= n; i += 16)
+    {
+        _mm_store_si128((__m128i*)(dst + i), c);
+        _mm_store_si128((__m128i*)(dst + i + 4), c);
+        _mm_store_si128((__m128i*)(dst + i + 8), c);
+        _mm_store_si128((__m128i*)(dst + i + 12), c);
+    }
+
+    for (; i < n; i++)
+        dst[i] = color;
+}
+
+static void fill_sse2(uint8_t* dst, uint32_t stride, uint32_t width, uint32_t height, uint32_t color)
+{
+    const __m128i c = _mm_set1_epi32(color);
+
+    for (uint32_t y = 0; y < height; y++)
+    {
+        uint32_t* row = (uint32_t*)(dst + (size_t)y * stride);
+        uint32_t x = 0;
+
+        for (; x + 4 <= width; x += 4)
+            _mm_storeu_si128((__m128i*)(row + x), c);
+
+        for (; x < width; x++)
+            row[x] = color;
+    }
+}
+
+static void blit_sse2(uint8_t* dst, uint32_t dst_stride, const uint8_t* src, uint32_t src_stride, uint32_t width, uint32_t height)
+{
+    size_t n = (size_t)width * 4;
+
+    for (uint32_t y = 0; y < height; y++)
+    {
+        uint8_t* d = dst + (size_t)y * dst_stride;
+        const uint8_t* s = src + (size_t)y * src_stride;
+        size_t i = 0;
+
+        if (((uintptr_t)d & 15) == 0)
+            for (; i + 16 <= n; i += 16)
+                _mm_stream_si128((__m128i*)(d + i), _mm_loadu_si128((const __m128i*)(s + i)));
+
+        memcpy(d + i, s + i, n - i);
+    }
+
+    _mm_sfence();
+}
+
+/* Non-temporal loads are SSE4.1, plain loads here */
+static void stream_sse2(uint8_t* dst, const uint8_t* src, size_t size)
+{
+    size_t i = 0;
+
+    if (((uintptr_t)dst | (uintptr_t)src) & 15)
+    {
+        memcpy(dst, src, size);
+        return;
+    }
+
+    for (; i + 64 <= size; i += 64)
+    {
+        __m128i a = _mm_load_si128((const __m128i*)(src + i));
+        __m128i b = _mm_load_si128((const __m128i*)(src + i + 16));
+        __m128i c = _mm_load_si128((const __m128i*)(src + i + 32));
+        __m128i d = _mm_load_si128((const __m128i*)(src + i + 48));
+
+        _mm_stream_si128((__m128i*)(dst + i), a);
+        _mm_stream_si128((__m128i*)(dst + i + 16), b);
+        _mm_stream_si128((__m128i*)(dst + i + 32), c);
+        _mm_stream_si128((__m128i*)(dst + i + 48), d);
+    }
+    _mm_sfence();
+
+    memcpy(dst + i, src + i, size - i);
+}
+
+/* Channels of 2 pixels in 16-bit lanes times 255 - alpha, divided by 255 */
+static inline __m128i over_mul_sse2(__m128i d16, __m128i s16)
+{
+    const __m128i c255 = _mm_set1_epi16(255);
+    const __m128i round = _mm_set1_epi16(128);
+    __m128i ia = _mm_sub_epi16(c255, _mm_shufflehi_epi16(_mm_shufflelo_epi16(s16, 0xFF), 0xFF));
+    __m128i t = _mm_add_epi16(_mm_mullo_epi16(d16, ia), round);
+
+    return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+static void over_sse2(uint8_t* dst, uint32_t dst_stride, const uint32_t* src, uint32_t src_stride, uint32_t width, uint32_t height)
+{
+    const __m128i zero = _mm_setzero_si128();
+
+    for (uint32_t y = 0; y < height; y++)
+    {
+        uint32_t* d = (uint32_t*)(dst + (size_t)y * dst_stride);
+        const uint32_t* s = (const uint32_t*)((const uint8_t*)src + (size_t)y * src_stride);
+        uint32_t x = 0;
+
+        for (; x + 4 <= width; x += 4)
+        {
+            __m128i sp = _mm_loadu_si128((const __m128i*)(s + x));
+            __m128i dp = _mm_loadu_si128((const __m128i*)(d + x));
+            __m128i lo = over_mul_sse2(_mm_unpacklo_epi8(dp, zero), _mm_unpacklo_epi8(sp, zero));
+            __m128i hi = over_mul_sse2(_mm_unpackhi_epi8(dp, zero), _mm_unpackhi_epi8(sp, zero));
+
+            _mm_storeu_si128((__m128i*)(d + x), _mm_adds_epu8(sp, _mm_packus_epi16(lo, hi)));
+        }
+
+        over_span_scalar(d + x, s + x, width - x);
+    }
+}
+
+static void keyed_sse2(uint8_t* dst, uint32_t dst_stride, const uint32_t* src, uint32_t src_stride, uint32_t width, uint32_t height)
+{
+    const __m128i zero = _mm_setzero_si128();
+
+    for (uint32_t y = 0; y < height; y++)
+    {
+        uint32_t* d = (uint32_t*)(dst + (size_t)y * dst_stride);
+        const uint32_t* s = (const uint32_t*)((const uint8_t*)src + (size_t)y * src_stride);
+        uint32_t x = 0;
+
+        /* No masked stores before AVX, blend with what's there */
+        for (; x + 4 <= width; x += 4)
+        {
+            __m128i sp = _mm_loadu_si128((const __m128i*)(s + x));
+            __m128i dp = _mm_loadu_si128((const __m128i*)(d + x));
+            __m128i unset = _mm_cmpeq_epi32(sp, zero);
+
+            _mm_storeu_si128((__m128i*)(d + x), _mm_or_si128(sp, _mm_and_si128(unset, dp)));
+        }
+
+        keyed_span_scalar(d + x, s + x, width - x);
+    }
+}
+
+/*
+ * AVX2, 8 pixels per iteration, masked stores for the row tails
+ */
+DRMLIST_TARGET_AVX2 static inline __m256i tail_mask_avx2(uint32_t n)
+{
+    static const int32_t lanes[16] = { -1, -1, -1, -1, -1, -1, -1, -1, 0, 0, 0, 0, 0, 0, 0, 0 };
+
+    return _mm256_loadu_si256((const __m256i*)&lanes[8 - n]);
+}
+
+DRMLIST_TARGET_AVX2 static void clear_avx2(uint32_t* dst, uint32_t color, size_t n)
+{
+    const __m256i c = _mm256_set1_epi32(color);
+    size_t i = 0;
+
+    for (; i < n && ((uintptr_t)(dst + i) & 31); i++)
+        dst[i] = color;
+
+    for (; i + 32 <= n; i += 32)
+    {
+        _mm256_store_si256((__m256i*)(dst + i), c);
+        _mm256_store_si256((__m256i*)(dst + i + 8), c);
+        _mm256_store_si256((__m256i*)(dst + i + 16), c);
+        _mm256_store_si256((__m256i*)(dst + i + 24), c);
+    }
+
+    for (; i + 8 <= n; i += 8)
+        _mm256_store_si256((__m256i*)(dst + i), c);
+
+    if (i < n)
+        _mm256_maskstore_epi32((int*)(dst + i), tail_mask_avx2(n - i), c);
+}
+
+/*
+ * Rows of 8 and more end with a store overlapping the previous one, masked
+ * stores are slow and only left for narrower rows
+ */
+DRMLIST_TARGET_AVX2 static void fill_avx2(uint8_t* dst, uint32_t stride, uint32_t width, uint32_t height, uint32_t color)
+{
+    const __m256i c = _mm256_set1_epi32(color);
+    const __m256i tail = tail_mask_avx2(width & 7);
+
+    for (uint32_t y = 0; y < height; y++)
+    {
+        uint32_t* row = (uint32_t*)(dst + (size_t)y * stride);
+        uint32_t x = 0;
+
+        if (width < 8)
+        {
+            _mm256_maskstore_epi32((int*)row, tail, c);
+            continue;
+        }
+
+        for (; x + 8 <= width; x += 8)
+            _mm256_storeu_si256((__m256i*)(row + x), c);
+
+        if (x < width)
+            _mm256_storeu_si256((__m256i*)(row + width - 8), c);
+    }
+}
+
+DRMLIST_TARGET_AVX2 static void blit_avx2(uint8_t* dst, uint32_t dst_stride, const uint8_t* src, uint32_t src_stride, uint32_t width, uint32_t height)
+{
+    size_t n = (size_t)width * 4;
+
+    for (uint32_t y = 0; y < height; y++)
+    {
+        uint8_t* d = dst + (size_t)y * dst_stride;
+        const uint8_t* s = src + (size_t)y * src_stride;
+        size_t i = 0;
+
+        if (((uintptr_t)d & 31) == 0)
+            for (; i + 32 <= n; i += 32)
+                _mm256_stream_si256((__m256i*)(d + i), _mm256_loadu_si256((const __m256i*)(s + i)));
+
+        memcpy(d + i, s + i, n - i);
+    }
+
+    _mm_sfence();
+}
+
+DRMLIST_TARGET_AVX2 static void stream_avx2(uint8_t* dst, const uint8_t* src, size_t size)
+{
+    size_t i = 0;
+
+    if (((uintptr_t)dst | (uintptr_t)src) & 31)
+    {
+        memcpy(dst, src, size);
+        return;
+    }
+
+    for (; i + 128 <= size; i += 128)
+    {
+        __m256i a = _mm256_stream_load_si256((__m256i*)(src + i));
+        __m256i b = _mm256_stream_load_si256((__m256i*)(src + i + 32));
+        __m256i c = _mm256_stream_load_si256((__m256i*)(src + i + 64));
+        __m256i d = _mm256_stream_load_si256((__m256i*)(src + i + 96));
+
+        _mm256_stream_si256((__m256i*)(dst + i), a);
+        _mm256_stream_si256((__m256i*)(dst + i + 32), b);
+        _mm256_stream_si256((__m256i*)(dst + i + 64), c);
+        _mm256_stream_si256((__m256i*)(dst + i + 96), d);
+    }
+    _mm_sfence();
+
+    memcpy(dst + i, src + i, size - i);
+}
+
+DRMLIST_TARGET_AVX2 static inline __m256i over_mul_avx2(__m256i d16, __m256i s16)
+{
+    const __m256i c255 = _mm256_set1_epi16(255);
+    const __m256i round = _mm256_set1_epi16(128);
+    __m256i ia = _mm256_sub_epi16(c255, _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(s16, 0xFF), 0xFF));
+    __m256i t = _mm256_add_epi16(_mm256_mullo_epi16(d16, ia), round);
+
+    return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+}
+
+DRMLIST_TARGET_AVX2 static void over_avx2(uint8_t* dst, uint32_t dst_stride, const uint32_t* src, uint32_t src_stride, uint32_t width, uint32_t height)
+{
+    const __m256i zero = _mm256_setzero_si256();
+
+    for (uint32_t y = 0; y < height; y++)
+    {
+        uint32_t* d = (uint32_t*)(dst + (size_t)y * dst_stride);
+        const uint32_t* s = (const uint32_t*)((const uint8_t*)src + (size_t)y * src_stride);
+        uint32_t x = 0;
+
+        for (; x + 8 <= width; x += 8)
+        {
+            __m256i sp = _mm256_loadu_si256((const __m256i*)(s + x));
+            __m256i dp = _mm256_loadu_si256((const __m256i*)(d + x));
+            __m256i lo = over_mul_avx2(_mm256_unpacklo_epi8(dp, zero), _mm256_unpacklo_epi8(sp, zero));
+            __m256i hi = over_mul_avx2(_mm256_unpackhi_epi8(dp, zero), _mm256_unpackhi_epi8(sp, zero));
+
+            _mm256_storeu_si256((__m256i*)(d + x), _mm256_adds_epu8(sp, _mm256_packus_epi16(lo, hi)));
+        }
+
+        over_span_scalar(d + x, s + x, width - x);
+    }
+}
+
+DRMLIST_TARGET_AVX2 static void keyed_avx2(uint8_t* dst, uint32_t dst_stride, const uint32_t* src, uint32_t src_stride, uint32_t width, uint32_t height)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i tail = tail_mask_avx2(width & 7);
+
+    for (uint32_t y = 0; y < height; y++)
+    {
+        uint32_t* d = (uint32_t*)(dst + (size_t)y * dst_stride);
+        const uint32_t* s = (const uint32_t*)((const uint8_t*)src + (size_t)y * src_stride);
+        uint32_t x = 0;
+
+        for (; x + 8 <= width; x += 8)
+        {
+            __m256i sp = _mm256_loadu_si256((const __m256i*)(s + x));
+            __m256i set = _mm256_xor_si256(_mm256_cmpeq_epi32(sp, zero), _mm256_set1_epi32(-1));
+
+            _mm256_maskstore_epi32((int*)(d + x), set, sp);
+        }
+
+        if (x < width)
+        {
+            __m256i sp = _mm256_maskload_epi32((const int*)(s + x), tail);
+            __m256i set = _mm256_andnot_si256(_mm256_cmpeq_epi32(sp, zero), tail);
+
+            _mm256_maskstore_epi32((int*)(d + x), set, sp);
+        }
+    }
+}
+
+/*
+ * AVX-512, 16 pixels per iteration, mask registers for tails and keys
+ */
+DRMLIST_TARGET_AVX512 static void clear_avx512(uint32_t* dst, uint32_t color, size_t n)
+{
+    const __m512i c = _mm512_set1_epi32(color);
+    size_t i = 0;
+
+    for (; i < n && ((uintptr_t)(dst + i) & 63); i++)
+        dst[i] = color;
+
+    for (; i + 64 <= n; i += 64)
+    {
+        _mm512_store_si512(dst + i, c);
+        _mm512_store_si512(dst + i + 16, c);
+        _mm512_store_si512(dst + i + 32, c);
+        _mm512_store_si512(dst + i + 48, c);
+    }
+
+    for (; i + 16 <= n; i += 16)
+        _mm512_store_si512(dst + i, c);
+
+    if (i < n)
+        _mm512_mask_storeu_epi32(dst + i, (__mmask16)((1u << (n - i)) - 1), c);
+}
+
+/* Same overlapping tail as fill_avx2(), narrow rows take one 256-bit masked store */
+DRMLIST_TARGET_AVX512 static void fill_avx512(uint8_t* dst, uint32_t stride, uint32_t width, uint32_t height, uint32_t color)
+{
+    const __m512i c = _mm512_set1_epi32(color);
+    const __m256i c8 = _mm512_castsi512_si256(c);
+
+    for (uint32_t y = 0; y < height; y++)
+    {
+        uint32_t* row = (uint32_t*)(dst + (size_t)y * stride);
+        uint32_t x = 0;
+
+        if (width < 8)
+        {
+            _mm256_mask_storeu_epi32(row, (__mmask8)((1u << width) - 1), c8);
+            continue;
+        }
+
+        if (width < 16)
+        {
+            _mm256_storeu_si256((__m256i*)row, c8);
+            _mm256_storeu_si256((__m256i*)(row + width - 8), c8);
+            continue;
+        }
+
+        for (; x + 16 <= width; x += 16)
+            _mm512_storeu_si512(row + x, c);
+
+        if (x < width)
+            _mm512_storeu_si512(row + width - 16, c);
+    }
+}
+
+DRMLIST_TARGET_AVX512 static void blit_avx512(uint8_t* dst, uint32_t dst_stride, const uint8_t* src, uint32_t src_stride, uint32_t width, uint32_t height)
+{
+    size_t n = (size_t)width * 4;
+
+    for (uint32_t y = 0; y < height; y++)
+    {
+        uint8_t* d = dst + (size_t)y * dst_stride;
+        const uint8_t* s = src + (size_t)y * src_stride;
+        size_t i = 0;
+
+        if (((uintptr_t)d & 63) == 0)
+            for (; i + 64 <= n; i += 64)
+                _mm512_stream_si512((void*)(d + i), _mm512_loadu_si512(s + i));
+
+        memcpy(d + i, s + i, n - i);
+    }
+
+    _mm_sfence();
+}
+
+DRMLIST_TARGET_AVX512 static void stream_avx512(uint8_t* dst, const uint8_t* src, size_t size)
+{
+    size_t i = 0;
+
+    if (((uintptr_t)dst | (uintptr_t)src) & 63)
+    {
+        stream_avx2(dst, src, size);
+        return;
+    }
+
+    for (; i + 256 <= size; i += 256)
+    {
+        __m512i a = _mm512_stream_load_si512((void*)(src + i));
+        __m512i b = _mm512_stream_load_si512((void*)(src + i + 64));
+        __m512i c = _mm512_stream_load_si512((void*)(src + i + 128));
+        __m512i d = _mm512_stream_load_si512((void*)(src + i + 192));
+
+        _mm512_stream_si512((void*)(dst + i), a);
+        _mm512_stream_si512((void*)(dst + i + 64), b);
+        _mm512_stream_si512((void*)(dst + i + 128), c);
+        _mm512_stream_si512((void*)(dst + i + 192), d);
+    }
+    _mm_sfence();
+
+    memcpy(dst + i, src + i, size - i);
+}
+
+DRMLIST_TARGET_AVX512 static inline __m512i over_mul_avx512(__m512i d16, __m512i s16)
+{
+    const __m512i c255 = _mm512_set1_epi16(255);
+    const __m512i round = _mm512_set1_epi16(128);
+    __m512i ia = _mm512_sub_epi16(c255, _mm512_shufflehi_epi16(_mm512_shufflelo_epi16(s16, 0xFF), 0xFF));
+    __m512i t = _mm512_add_epi16(_mm512_mullo_epi16(d16, ia), round);
+
+    return _mm512_srli_epi16(_mm512_add_epi16(t, _mm512_srli_epi16(t, 8)), 8);
+}
+
+DRMLIST_TARGET_AVX512 static void over_avx512(uint8_t* dst, uint32_t dst_stride, const uint32_t* src, uint32_t src_stride, uint32_t width, uint32_t height)
+{
+    const __m512i zero = _mm512_setzero_si512();
+    const __mmask16 tail = (__mmask16)((1u << (width & 15)) - 1);
+
+    for (uint32_t y = 0; y < height; y++)
+    {
+        uint32_t* d = (uint32_t*)(dst + (size_t)y * dst_stride);
+        const uint32_t* s = (const uint32_t*)((const uint8_t*)src + (size_t)y * src_stride);
+
+        /* The tail goes through the vector path too, masked loads don't fault past the row */
+        for (uint32_t x = 0; x < width; x += 16)
+        {
+            __mmask16 m = x + 16 <= width ? 0xFFFF : tail;
+            __m512i sp = _mm512_maskz_loadu_epi32(m, s + x);
+            __m512i dp = _mm512_maskz_loadu_epi32(m, d + x);
+            __m512i lo = over_mul_avx512(_mm512_unpacklo_epi8(dp, zero), _mm512_unpacklo_epi8(sp, zero));
+            __m512i hi = over_mul_avx512(_mm512_unpackhi_epi8(dp, zero), _mm512_unpackhi_epi8(sp, zero));
+
+            _mm512_mask_storeu_epi32(d + x, m, _mm512_adds_epu8(sp, _mm512_packus_epi16(lo, hi)));
+        }
+    }
+}
+
+DRMLIST_TARGET_AVX512 static void keyed_avx512(uint8_t* dst, uint32_t dst_stride, const uint32_t* src, uint32_t src_stride, uint32_t width, uint32_t height)
+{
+    const __mmask16 tail = (__mmask16)((1u << (width & 15)) - 1);
+
+    for (uint32_t y = 0; y < height; y++)
+    {
+        uint32_t* d = (uint32_t*)(dst + (size_t)y * dst_stride);
+        const uint32_t* s = (const uint32_t*)((const uint8_t*)src + (size_t)y * src_stride);
+
+        for (uint32_t x = 0; x < width; x += 16)
+        {
+            __mmask16 m = x + 16 <= width ? 0xFFFF : tail;
+            __m512i sp = _mm512_maskz_loadu_epi32(m, s + x);
+
+            _mm512_mask_storeu_epi32(d + x, _mm512_test_epi32_mask(sp, sp), sp);
+        }
+    }
+}
+
+static const drmlist_kernels_t kernels[DRMLIST_CPU_LEVELS] = {
+    { "sse2",   clear_sse2,   fill_sse2,   blit_sse2,   stream_sse2,   over_sse2,   keyed_sse2 },
+    { "avx2",   clear_avx2,   fill_avx2,   blit_avx2,   stream_avx2,   over_avx2,   keyed_avx2 },
+    { "avx512", clear_avx512, fill_avx512, blit_avx512, stream_avx512, over_avx512, keyed_avx512 },
+};
+
+drmlist_kernels_t drmlist_kernels = {
+    "sse2", clear_sse2, fill_sse2, blit_sse2, stream_sse2, over_sse2, keyed_sse2
+};
+
+void drmlist_kernels_bind(int level)
+{
+    drmlist_kernels = *drmlist_kernels_get(level);
+}
+
+const drmlist_kernels_t* drmlist_kernels_get(int level)
+{
+    if (level < 0)
+        level = 0;
+    if (level >= DRMLIST_CPU_LEVELS)
+        level = DRMLIST_CPU_LEVELS - 1;
+
+    return &kernels[level];
+}
@@ -0,0 +1,44 @@
+#ifndef _DRMLIST_KERNELS_H_
+#define _DRMLIST_KERNELS_H_
+
+#include "mydrm/mydrm.h"
+#include "drmlist_cpu.h"
+
+/*
+ * Pixel kernels, one variant per drmlist_cpu_level, bound by drmlist_cpu_init()
+ *
+ * Pixels are 32-bit, strides in bytes. Every variant produces the same
+ * pixels as the SSE2 one.
+ */
+
+typedef struct
+{
+    const char* name;
+
+    /* `n` pixels of `color` */
+    void (*clear)(uint32_t* dst, uint32_t color, size_t n);
+
+    /* width x height rectangle of `color` */
+    void (*fill)(uint8_t* dst, uint32_t stride, uint32_t width, uint32_t height, uint32_t color);
+
+    /* width x height copy, non-temporal stores where aligned, for write-combined framebuffers */
+    void (*blit)(uint8_t* dst, uint32_t dst_stride, const uint8_t* src, uint32_t src_stride, uint32_t width, uint32_t height);
+
+    /* `size` bytes with non-temporal loads and stores, for reading back write-combined memory */
+    void (*stream)(uint8_t* dst, const uint8_t* src, size_t size);
+
+    /* Premultiplied ARGB `src` over `dst` (the software cursor) */
+    void (*over)(uint8_t* dst, uint32_t dst_stride, const uint32_t* src, uint32_t src_stride, uint32_t width, uint32_t height);
+
+    /* Copies the pixels of `src` that aren't 0, the others are transparent (cached text) */
+    void (*keyed)(uint8_t* dst, uint32_t dst_stride, const uint32_t* src, uint32_t src_stride, uint32_t width, uint32_t height);
+} drmlist_kernels_t;
+
+extern drmlist_kernels_t drmlist_kernels;
+
+void drmlist_kernels_bind(int level);
+
+/* The variants of `level`, for comparing them */
+const drmlist_kernels_t* drmlist_kernels_get(int level);
+
+#endif // _DRMLIST_KERNELS_H_
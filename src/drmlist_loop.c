@@ -0,0 +1,412 @@
+#include "drmlist_loop.h"
+#include <sys/syscall.h>
+#include <poll.h>
+
+#define URING_CANCEL_USER_DATA UINT64_MAX
+
+static inline uint64_t loop_user_data(drmlist_loop_t* loop, drmlist_loop_source_t* src)
+{
+    return ((uint64_t)src->gen << 8) | (uint64_t)(src - loop->sources);
+}
+
+/*
+ * io_uring, straight syscalls, no liburing
+ */
+static int uring_setup(drmlist_uring_t* ring, uint32_t entries)
+{
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(struct io_uring_params));
+    memset(ring, 0, sizeof(drmlist_uring_t));
+
+    if ((ring->fd = syscall(__NR_io_uring_setup, entries, &p)) == -1)
+        return -1;
+
+    ring->sq_size = p.sq_off.array + p.sq_entries * sizeof(uint32_t);
+    ring->cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+
+    if (p.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        if (ring->cq_size > ring->sq_size)
+            ring->sq_size = ring->cq_size;
+        ring->cq_size = ring->sq_size;
+    }
+
+    ring->sq_ptr = mmap(NULL, ring->sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+    if (ring->sq_ptr == MAP_FAILED)
+        return -1;
+
+    if (p.features & IORING_FEAT_SINGLE_MMAP)
+        ring->cq_ptr = ring->sq_ptr;
+    else if ((ring->cq_ptr = mmap(NULL, ring->cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING)) == MAP_FAILED)
+        return -1;
+
+    ring->sqes = mmap(NULL, p.sq_entries * sizeof(struct io_uring_sqe), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED)
+        return -1;
+
+    ring->sq_head = (uint32_t*)((uint8_t*)ring->sq_ptr + p.sq_off.head);
+    ring->sq_tail = (uint32_t*)((uint8_t*)ring->sq_ptr + p.sq_off.tail);
+    ring->sq_mask = (uint32_t*)((uint8_t*)ring->sq_ptr + p.sq_off.ring_mask);
+    ring->sq_array = (uint32_t*)((uint8_t*)ring->sq_ptr + p.sq_off.array);
+    ring->cq_head = (uint32_t*)((uint8_t*)ring->cq_ptr + p.cq_off.head);
+    ring->cq_tail = (uint32_t*)((uint8_t*)ring->cq_ptr + p.cq_off.tail);
+    ring->cq_mask = (uint32_t*)((uint8_t*)ring->cq_ptr + p.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe*)((uint8_t*)ring->cq_ptr + p.cq_off.cqes);
+
+    return 0;
+}
+
+static int uring_enter(drmlist_loop_t* loop, uint32_t min_complete, uint32_t flags)
+{
+    drmlist_uring_t* ring = &loop->ring;
+    int ret;
+
+    loop->syscalls++;
+    ret = syscall(__NR_io_uring_enter, ring->fd, ring->to_submit, min_complete, flags, NULL, 0);
+
+    if (ret > 0)
+        ring->to_submit -= ret;
+
+    return ret;
+}
+
+static struct io_uring_sqe* uring_get_sqe(drmlist_loop_t* loop)
+{
+    drmlist_uring_t* ring = &loop->ring;
+    uint32_t tail = *ring->sq_tail;
+    uint32_t mask = *ring->sq_mask;
+    struct io_uring_sqe* sqe;
+
+    /* SQ full, push what we have */
+    if (tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE) > mask)
+        if (uring_enter(loop, 0, 0) == -1)
+            return NULL;
+
+    sqe = &ring->sqes[tail & mask];
+    memset(sqe, 0, sizeof(struct io_uring_sqe));
+    ring->sq_array[tail & mask] = tail & mask;
+
+    return sqe;
+}
+
+static void uring_commit_sqe(drmlist_uring_t* ring)
+{
+    __atomic_store_n(ring->sq_tail, *ring->sq_tail + 1, __ATOMIC_RELEASE);
+    ring->to_submit++;
+}
+
+static void uring_arm(drmlist_loop_t* loop, drmlist_loop_source_t* src)
+{
+    struct io_uring_sqe* sqe;
+
+    if ((sqe = uring_get_sqe(loop)) == NULL)
+    {
+        perror("io_uring_enter");
+        return;
+    }
+
+    sqe->fd = src->fd;
+    sqe->user_data = loop_user_data(loop, src);
+
+    if (src->on_read)
+    {
+        sqe->opcode = IORING_OP_READ;
+        sqe->addr = (uint64_t)src->buf;
+        sqe->len = src->read_size;
+        sqe->off = (uint64_t)-1;    // current file position
+    }
+    else
+    {
+        sqe->opcode = IORING_OP_POLL_ADD;
+        sqe->poll32_events = POLLIN;
+        sqe->len = IORING_POLL_ADD_MULTI;
+    }
+
+    uring_commit_sqe(&loop->ring);
+    src->armed = true;
+}
+
+static void uring_cancel(drmlist_loop_t* loop, drmlist_loop_source_t* src)
+{
+    struct io_uring_sqe* sqe;
+
+    if ((sqe = uring_get_sqe(loop)) == NULL)
+        return;
+
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->addr = loop_user_data(loop, src);
+    sqe->user_data = URING_CANCEL_USER_DATA;
+    uring_commit_sqe(&loop->ring);
+}
+
+static void uring_cleanup(drmlist_uring_t* ring)
+{
+    if (ring->sqes && ring->sqes != MAP_FAILED)
+        munmap(ring->sqes, DRMLIST_LOOP_URING_ENTRIES * sizeof(struct io_uring_sqe));
+    if (ring->cq_ptr && ring->cq_ptr != MAP_FAILED && ring->cq_ptr != ring->sq_ptr)
+        munmap(ring->cq_ptr, ring->cq_size);
+    if (ring->sq_ptr && ring->sq_ptr != MAP_FAILED)
+        munmap(ring->sq_ptr, ring->sq_size);
+    if (ring->fd > 0)
+        close(ring->fd);
+}
+
+/*
+ * Generic part
+ */
+const char* drmlist_loop_backend_name(int backend)
+{
+    return backend == DRMLIST_LOOP_IO_URING ? "io_uring" : "epoll";
+}
+
+int drmlist_loop_init(drmlist_loop_t* loop, int backend)
+{
+    memset(loop, 0, sizeof(drmlist_loop_t));
+    loop->backend = backend;
+    loop->epfd = -1;
+    loop->ring.fd = -1;
+
+    if (backend == DRMLIST_LOOP_IO_URING)
+    {
+        if (uring_setup(&loop->ring, DRMLIST_LOOP_URING_ENTRIES) == 0)
+            return 0;
+
+        perror("io_uring_setup, falling back to epoll");
+        uring_cleanup(&loop->ring);
+        memset(&loop->ring, 0, sizeof(drmlist_uring_t));
+        loop->ring.fd = -1;
+        loop->backend = DRMLIST_LOOP_EPOLL;
+    }
+
+    if ((loop->epfd = epoll_create1(EPOLL_CLOEXEC)) == -1)
+    {
+        perror("FAILED epoll_create1");
+        return -1;
+    }
+
+    return 0;
+}
+
+static drmlist_loop_source_t* drmlist_loop_add(drmlist_loop_t* loop, int fd)
+{
+    drmlist_loop_source_t* src = NULL;
+
+    /* A slot can only be reused once its last request completed */
+    for (int i = 0; i < DRMLIST_LOOP_MAX_SOURCES; i++)
+    {
+        if (!loop->sources[i].active && !loop->sources[i].armed)
+        {
+            src = &loop->sources[i];
+            break;
+        }
+    }
+
+    if (!src)
+    {
+        fprintf(stderr, "Event loop: too many sources\n");
+        return NULL;
+    }
+
+    src->gen++;
+    src->fd = fd;
+    src->on_read = NULL;
+    src->on_ready = NULL;
+    src->active = true;
+
+    if (loop->backend == DRMLIST_LOOP_EPOLL)
+    {
+        struct epoll_event event;
+
+        event.events = EPOLLIN;
+        event.data.u64 = src - loop->sources;
+
+        if (epoll_ctl(loop->epfd, EPOLL_CTL_ADD, fd, &event) == -1)
+        {
+            perror("FAILED EPOLL_CTL_ADD");
+            src->active = false;
+            return NULL;
+        }
+    }
+
+    return src;
+}
+
+int drmlist_loop_add_read(drmlist_loop_t* loop, int fd, size_t read_size, drmlist_loop_read_cb cb, void* user)
+{
+    drmlist_loop_source_t* src;
+
+    if ((src = drmlist_loop_add(loop, fd)) == NULL)
+        return -1;
+
+    src->on_read = cb;
+    src->user = user;
+    src->read_size = read_size < DRMLIST_LOOP_READ_MAX ? read_size : DRMLIST_LOOP_READ_MAX;
+
+    return 0;
+}
+
+int drmlist_loop_add_ready(drmlist_loop_t* loop, int fd, drmlist_loop_ready_cb cb, void* user)
+{
+    drmlist_loop_source_t* src;
+
+    if ((src = drmlist_loop_add(loop, fd)) == NULL)
+        return -1;
+
+    src->on_ready = cb;
+    src->user = user;
+
+    return 0;
+}
+
+static void drmlist_loop_deactivate(drmlist_loop_t* loop, drmlist_loop_source_t* src)
+{
+    src->active = false;
+
+    if (loop->backend == DRMLIST_LOOP_EPOLL)
+        epoll_ctl(loop->epfd, EPOLL_CTL_DEL, src->fd, NULL);     // EBADF if the fd is already closed, fine
+    else if (src->armed)
+        uring_cancel(loop, src);
+}
+
+void drmlist_loop_remove(drmlist_loop_t* loop, int fd)
+{
+    for (int i = 0; i < DRMLIST_LOOP_MAX_SOURCES; i++)
+        if (loop->sources[i].active && loop->sources[i].fd == fd)
+            drmlist_loop_deactivate(loop, &loop->sources[i]);
+}
+
+static void drmlist_loop_dispatch_read(drmlist_loop_t* loop, drmlist_loop_source_t* src, ssize_t len)
+{
+    loop->events++;
+
+    /* Nothing more will come, don't spin on it */
+    if (len == 0)
+        drmlist_loop_deactivate(loop, src);
+
+    src->on_read(src->user, src->buf, len);
+}
+
+static int drmlist_loop_run_epoll(drmlist_loop_t* loop)
+{
+    struct epoll_event events[DRMLIST_LOOP_MAX_SOURCES];
+    int nfds;
+
+    loop->syscalls++;
+    if ((nfds = epoll_wait(loop->epfd, events, DRMLIST_LOOP_MAX_SOURCES, -1)) == -1)
+    {
+        if (errno == EINTR)
+            return 0;
+        perror("epoll_wait");
+        return -1;
+    }
+
+    for (int i = 0; i < nfds; i++)
+    {
+        drmlist_loop_source_t* src = &loop->sources[events[i].data.u64];
+
+        if (!src->active)
+            continue;
+
+        if (src->on_read)
+        {
+            ssize_t len;
+
+            loop->syscalls++;
+            if ((len = read(src->fd, src->buf, src->read_size)) == -1)
+            {
+                if (errno == EAGAIN || errno == EINTR)
+                    continue;
+                len = -errno;
+            }
+
+            drmlist_loop_dispatch_read(loop, src, len);
+        }
+        else
+        {
+            loop->events++;
+            src->on_ready(src->user);
+        }
+    }
+
+    return nfds;
+}
+
+static int drmlist_loop_run_uring(drmlist_loop_t* loop)
+{
+    drmlist_uring_t* ring = &loop->ring;
+    uint32_t head, tail;
+    int n = 0;
+
+    /* (Re-)arm everything that completed last time, submitted together with the wait */
+    for (int i = 0; i < DRMLIST_LOOP_MAX_SOURCES; i++)
+        if (loop->sources[i].active && !loop->sources[i].armed)
+            uring_arm(loop, &loop->sources[i]);
+
+    if (uring_enter(loop, 1, IORING_ENTER_GETEVENTS) == -1 && errno != EINTR)
+    {
+        perror("io_uring_enter");
+        return -1;
+    }
+
+    head = *ring->cq_head;
+    tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+
+    for (; head != tail; head++, n++)
+    {
+        struct io_uring_cqe* cqe = &ring->cqes[head & *ring->cq_mask];
+        drmlist_loop_source_t* src;
+        uint64_t user_data = cqe->user_data;
+        int32_t res = cqe->res;
+        uint32_t flags = cqe->flags;
+
+        if (user_data == URING_CANCEL_USER_DATA)
+            continue;
+
+        src = &loop->sources[user_data & 0xFF];
+
+        if (!(flags & IORING_CQE_F_MORE))
+            src->armed = false;
+
+        /* Completion of an old, removed source */
+        if (!src->active || src->gen != (user_data >> 8))
+            continue;
+
+        if (src->on_read)
+        {
+            if (res == -EAGAIN || res == -EINTR)
+                continue;
+            drmlist_loop_dispatch_read(loop, src, res);
+        }
+        else if (res > 0)
+        {
+            loop->events++;
+            src->on_ready(src->user);
+        }
+    }
+
+    __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+
+    return n;
+}
+
+/*
+ * Wait for at least one event and handle everything that is ready
+ */
+int drmlist_loop_run_once(drmlist_loop_t* loop)
+{
+    loop->wakeups++;
+
+    if (loop->backend == DRMLIST_LOOP_IO_URING)
+        return drmlist_loop_run_uring(loop);
+
+    return drmlist_loop_run_epoll(loop);
+}
+
+void drmlist_loop_cleanup(drmlist_loop_t* loop)
+{
+    if (loop->epfd != -1)
+        close(loop->epfd);
+
+    if (loop->ring.fd != -1)
+        uring_cleanup(&loop->ring);
+}
@@ -0,0 +1,86 @@
+#ifndef _DRMLIST_LOOP_H_
+#define _DRMLIST_LOOP_H_
+
+#include "mydrm/mydrm.h"
+#include <linux/io_uring.h>
+
+/*
+ * Event loop with two backends
+ *
+ *  epoll:    epoll_wait, then one read() per ready source
+ *  io_uring: a read stays posted on every read source, completions are
+ *            handled in batches and the reads are re-armed with the next
+ *            io_uring_enter, so one syscall covers a whole wakeup
+ *
+ * Read sources get the data handed to their callback (len <= 0 on EOF/error,
+ * -errno for io_uring). Ready sources only get told that the fd is readable and
+ * do their own syscalls (e.g. accept()).
+ */
+
+#define DRMLIST_LOOP_MAX_SOURCES 16
+#define DRMLIST_LOOP_READ_MAX 1024
+#define DRMLIST_LOOP_URING_ENTRIES 32
+
+enum drmlist_loop_backend
+{
+    DRMLIST_LOOP_EPOLL = 0,
+    DRMLIST_LOOP_IO_URING = 1
+};
+
+typedef void (*drmlist_loop_read_cb)(void* user, const uint8_t* buf, ssize_t len);
+typedef void (*drmlist_loop_ready_cb)(void* user);
+
+typedef struct
+{
+    drmlist_loop_read_cb on_read;
+    drmlist_loop_ready_cb on_ready;
+    void* user;
+    size_t read_size;
+    uint32_t gen;
+    int fd;
+    bool active;
+    bool armed;             // io_uring: request in flight
+    uint8_t buf[DRMLIST_LOOP_READ_MAX];
+} drmlist_loop_source_t;
+
+typedef struct
+{
+    int fd;
+    uint32_t* sq_head;
+    uint32_t* sq_tail;
+    uint32_t* sq_mask;
+    uint32_t* sq_array;
+    uint32_t* cq_head;
+    uint32_t* cq_tail;
+    uint32_t* cq_mask;
+    struct io_uring_sqe* sqes;
+    struct io_uring_cqe* cqes;
+    void* sq_ptr;
+    void* cq_ptr;
+    size_t sq_size;
+    size_t cq_size;
+    uint32_t to_submit;
+} drmlist_uring_t;
+
+typedef struct
+{
+    drmlist_loop_source_t sources[DRMLIST_LOOP_MAX_SOURCES];
+    int backend;
+    int epfd;
+    drmlist_uring_t ring;
+
+    /* Stats */
+    uint64_t wakeups;
+    uint64_t syscalls;
+    uint64_t events;
+} drmlist_loop_t;
+
+int drmlist_loop_init(drmlist_loop_t* loop, int backend);
+int drmlist_loop_add_read(drmlist_loop_t* loop, int fd, size_t read_size, drmlist_loop_read_cb cb, void* user);
+int drmlist_loop_add_ready(drmlist_loop_t* loop, int fd, drmlist_loop_ready_cb cb, void* user);
+void drmlist_loop_remove(drmlist_loop_t* loop, int fd);
+int drmlist_loop_run_once(drmlist_loop_t* loop);
+const char* drmlist_loop_backend_name(int backend);
+void drmlist_loop_cleanup(drmlist_loop_t* loop);
+
+#endif // _DRMLIST_LOOP_H_
@@ -0,0 +1,84 @@
+#include "drmlist_mem.h"
+#include <stdatomic.h>
+#include <sys/resource.h>
+
+/* Capture staging buffers are allocated and freed from the render thread, read by the writer */
+static _Atomic uint64_t stats_hugetlb = 0;
+static _Atomic uint64_t stats_thp = 0;
+static _Atomic uint64_t stats_bytes = 0;
+
+static inline size_t huge_round(size_t size)
+{
+    return (size + DRMLIST_HUGE_PAGE - 1) & ~(size_t)(DRMLIST_HUGE_PAGE - 1);
+}
+
+static void huge_populate(uint8_t* p, size_t len)
+{
+#ifdef MADV_POPULATE_WRITE
+    if (madvise(p, len, MADV_POPULATE_WRITE) == 0)
+        return;
+#endif
+    /* Older kernels: write fault every page, huge or not */
+    for (size_t i = 0; i < len; i += 4096)
+        ((volatile uint8_t*)p)[i] = 0;
+}
+
+void* drmlist_huge_alloc(size_t size)
+{
+    size_t len = huge_round(size);
+    uint8_t* p;
+    uint8_t* aligned;
+
+    if (!size)
+        return NULL;
+
+    p = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE, -1, 0);
+    if (p != MAP_FAILED)
+    {
+        atomic_fetch_add(&stats_hugetlb, 1);
+        atomic_fetch_add(&stats_bytes, len);
+        return p;
+    }
+
+    /* No reserved huge pages: over-map and trim to a 2 MiB boundary so THP can back it */
+    if ((p = mmap(NULL, len + DRMLIST_HUGE_PAGE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0)) == MAP_FAILED)
+        return NULL;
+
+    aligned = (uint8_t*)(((uintptr_t)p + DRMLIST_HUGE_PAGE - 1) & ~(uintptr_t)(DRMLIST_HUGE_PAGE - 1));
+    if (aligned != p)
+        munmap(p, aligned - p);
+    munmap(aligned + len, (p + len + DRMLIST_HUGE_PAGE) - (aligned + len));
+
+    madvise(aligned, len, MADV_HUGEPAGE);
+    huge_populate(aligned, len);
+
+    atomic_fetch_add(&stats_thp, 1);
+    atomic_fetch_add(&stats_bytes, len);
+
+    return aligned;
+}
+
+void drmlist_huge_free(void* ptr, size_t size)
+{
+    if (!ptr)
+        return;
+
+    munmap(ptr, huge_round(size));
+    atomic_fetch_sub(&stats_bytes, huge_round(size));
+}
+
+void drmlist_mem_print_stats(void)
+{
+    printf("Huge page buffers: %lu hugetlb, %lu THP, %.1f MiB mapped\n", atomic_load(&stats_hugetlb),
+                    atomic_load(&stats_thp), atomic_load(&stats_bytes) / 1048576.0);
+}
+
+uint64_t drmlist_mem_faults(void)
+{
+    struct rusage ru;
+
+    if (getrusage(RUSAGE_SELF, &ru) == -1)
+        return 0;
+
+    return ru.ru_minflt + ru.ru_majflt;
+}
@@ -0,0 +1,24 @@
+#ifndef _DRMLIST_MEM_H_
+#define _DRMLIST_MEM_H_
+
+#include "mydrm/mydrm.h"
+
+/*
+ * Frame-sized CPU buffers (capture staging, decoded image shadows)
+ *
+ * Backed by huge pages so a 4K frame is a handful of TLB entries and faults:
+ * explicit hugetlb pages when the system has some reserved, otherwise a 2 MiB
+ * aligned anonymous mapping with MADV_HUGEPAGE. Either way the memory is
+ * populated up front and comes zeroed from the kernel, callers don't clear it.
+ */
+
+#define DRMLIST_HUGE_PAGE (2u << 20)
+
+void* drmlist_huge_alloc(size_t size);
+void drmlist_huge_free(void* ptr, size_t size);
+void drmlist_mem_print_stats(void);
+
+/* Minor + major page faults of the process so far */
+uint64_t drmlist_mem_faults(void);
+
+#endif // _DRMLIST_MEM_H_
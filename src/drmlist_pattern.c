@@ -0,0 +1,312 @@
+#include "drmlist_pattern.h"
+#include "drmlist_kernels.h"
+#include <immintrin.h>
+#include <time.h>
+
+static const char* pattern_names[DRMLIST_PATTERNS] = { "off", "bars", "gradient", "checker", "grid", "moving" };
+
+/* 75% white, yellow, cyan, green, magenta, red, blue, black */
+static const uint32_t pattern_bars[8] = {
+    0xFFBFBFBF, 0xFFBFBF00, 0xFF00BFBF, 0xFF00BF00, 0xFFBF00BF, 0xFFBF0000, 0xFF0000BF, 0xFF000000
+};
+
+#define PATTERN_WHITE 0xFFFFFFFF
+#define PATTERN_BLACK 0xFF000000
+
+static uint64_t pattern_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+int drmlist_pattern_find(const char* name)
+{
+    for (int i = 0; i < DRMLIST_PATTERNS; i++)
+        if (!strcmp(name, pattern_names[i]))
+            return i;
+
+    return -1;
+}
+
+const char* drmlist_pattern_name(int kind)
+{
+    return kind >= 0 && kind < DRMLIST_PATTERNS ? pattern_names[kind] : "?";
+}
+
+const char* drmlist_pattern_names(void)
+{
+    return "bars gradient checker grid moving off";
+}
+
+/*
+ * 0 to 255 across the row, 16.16 fixed point, 4 pixels at a time. `mask`
+ * picks the channels.
+ */
+static void pattern_ramp(uint32_t* row, uint32_t width, uint32_t mask)
+{
+    uint32_t step = width > 1 ? (255u << 16) / (width - 1) : 0;
+    __m128i acc = _mm_setr_epi32(0, step, step * 2, step * 3);
+    const __m128i inc = _mm_set1_epi32(step * 4);
+    const __m128i m = _mm_set1_epi32(mask);
+    const __m128i alpha = _mm_set1_epi32(0xFF000000);
+    uint32_t x = 0;
+
+    for (; x + 4 <= width; x += 4)
+    {
+        __m128i v = _mm_srli_epi32(acc, 16);
+
+        v = _mm_or_si128(v, _mm_or_si128(_mm_slli_epi32(v, 8), _mm_slli_epi32(v, 16)));
+        _mm_storeu_si128((__m128i*)(row + x), _mm_or_si128(alpha, _mm_and_si128(v, m)));
+        acc = _mm_add_epi32(acc, inc);
+    }
+
+    for (; x < width; x++)
+        row[x] = 0xFF000000 | (((x * step) >> 16) * 0x010101 & mask);
+}
+
+static void pattern_build_rows(drmlist_pattern_t* p)
+{
+    uint32_t w = p->width;
+    uint32_t* r0 = p->rows;
+    uint32_t* r1 = p->rows + w;
+
+    switch (p->kind)
+    {
+        case DRMLIST_PATTERN_BARS:
+            for (uint32_t i = 0; i < 8; i++)
+                drmlist_kernels.clear(r0 + w * i / 8, pattern_bars[i], w * (i + 1) / 8 - w * i / 8);
+            break;
+
+        case DRMLIST_PATTERN_GRADIENT:
+            pattern_ramp(r0, w, 0xFF0000);
+            pattern_ramp(r1, w, 0x00FF00);
+            pattern_ramp(p->rows + w * 2, w, 0x0000FF);
+            pattern_ramp(p->rows + w * 3, w, 0xFFFFFF);
+            break;
+
+        case DRMLIST_PATTERN_CHECKER:
+            for (uint32_t x = 0; x < w; x += DRMLIST_PATTERN_CHECKER_CELL)
+            {
+                uint32_t n = w - x < DRMLIST_PATTERN_CHECKER_CELL ? w - x : DRMLIST_PATTERN_CHECKER_CELL;
+                bool white = (x / DRMLIST_PATTERN_CHECKER_CELL) & 1;
+
+                drmlist_kernels.clear(r0 + x, white ? PATTERN_WHITE : PATTERN_BLACK, n);
+                drmlist_kernels.clear(r1 + x, white ? PATTERN_BLACK : PATTERN_WHITE, n);
+            }
+            break;
+
+        case DRMLIST_PATTERN_GRID:
+            drmlist_kernels.clear(r0, PATTERN_WHITE, w);
+            drmlist_kernels.clear(r1, PATTERN_BLACK, w);
+            for (uint32_t x = 0; x < w; x += DRMLIST_PATTERN_GRID_SPACING)
+                r1[x] = PATTERN_WHITE;
+            r1[w - 1] = PATTERN_WHITE;
+            break;
+
+        default:
+            drmlist_kernels.clear(r0, PATTERN_BLACK, w);
+            break;
+    }
+}
+
+/* Template of row `y` */
+static uint32_t pattern_row(drmlist_pattern_t* p, uint32_t y)
+{
+    switch (p->kind)
+    {
+        case DRMLIST_PATTERN_GRADIENT:
+            return y * 4 / p->height;
+        case DRMLIST_PATTERN_CHECKER:
+            return (y / DRMLIST_PATTERN_CHECKER_CELL) & 1;
+        case DRMLIST_PATTERN_GRID:
+            return !(y % DRMLIST_PATTERN_GRID_SPACING == 0 || y == p->height - 1);
+        default:
+            return 0;
+    }
+}
+
+/* One blit per run of rows with the same template */
+static void pattern_fill_rect(drmlist_pattern_t* p, mydrm_fb_t* fb, const struct drm_clip_rect* r)
+{
+    uint32_t x1 = r->x1;
+    uint32_t x2 = r->x2 < p->width ? r->x2 : p->width;
+    uint32_t y2 = r->y2 < p->height ? r->y2 : p->height;
+
+    if (x1 >= x2)
+        return;
+
+    for (uint32_t y = r->y1; y < y2;)
+    {
+        uint32_t row = pattern_row(p, y);
+        uint32_t end = y + 1;
+
+        while (end < y2 && pattern_row(p, end) == row)
+            end++;
+
+        drmlist_kernels.blit(fb->pixels + (size_t)y * fb->stride + x1 * 4, fb->stride,
+                             (const uint8_t*)(p->rows + (size_t)row * p->width + x1), 0, x2 - x1, end - y);
+        p->bytes += (size_t)(x2 - x1) * 4 * (end - y);
+        y = end;
+    }
+}
+
+static drmlist_pattern_buffer_t* pattern_buffer(drmlist_pattern_t* p, mydrm_fb_t* fb)
+{
+    drmlist_pattern_buffer_t* b;
+
+    for (int i = 0; i < DRMLIST_PATTERN_BUFFERS; i++)
+        if (p->buffers[i].pixels == fb->pixels)
+            return &p->buffers[i];
+
+    /* Oldest first */
+    b = &p->buffers[p->next_buffer];
+    p->next_buffer = (p->next_buffer + 1) % DRMLIST_PATTERN_BUFFERS;
+
+    memset(b, 0, sizeof(drmlist_pattern_buffer_t));
+    b->pixels = fb->pixels;
+
+    return b;
+}
+
+int drmlist_pattern_init(drmlist_pattern_t* p, int kind, uint32_t width, uint32_t height)
+{
+    memset(p, 0, sizeof(drmlist_pattern_t));
+    p->kind = kind;
+
+    return drmlist_pattern_resize(p, width, height);
+}
+
+int drmlist_pattern_set(drmlist_pattern_t* p, int kind)
+{
+    p->kind = kind;
+    p->frame = 0;
+
+    return drmlist_pattern_resize(p, p->width, p->height);
+}
+
+int drmlist_pattern_resize(drmlist_pattern_t* p, uint32_t width, uint32_t height)
+{
+    uint32_t* rows;
+
+    drmlist_pattern_invalidate(p, NULL);
+
+    /* The size is kept for a pattern set later */
+    if (p->kind == DRMLIST_PATTERN_NONE)
+    {
+        free(p->rows);
+        p->rows = NULL;
+        p->width = width;
+        p->height = height;
+        return 0;
+    }
+
+    if (!p->rows || width != p->width)
+    {
+        if ((rows = aligned_alloc(64, ((size_t)width * 4 * DRMLIST_PATTERN_MAX_ROWS + 63) & ~(size_t)63)) == NULL)
+            return -ENOMEM;
+
+        free(p->rows);
+        p->rows = rows;
+    }
+
+    p->width = width;
+    p->height = height;
+    pattern_build_rows(p);
+
+    return 0;
+}
+
+bool drmlist_pattern_animated(drmlist_pattern_t* p)
+{
+    return p->kind == DRMLIST_PATTERN_MOVING;
+}
+
+bool drmlist_pattern_draw(drmlist_pattern_t* p, mydrm_fb_t* fb, bool advance, struct drm_clip_rect* bar)
+{
+    drmlist_pattern_buffer_t* b = pattern_buffer(p, fb);
+    uint64_t start = pattern_now_ns();
+    bool full = !b->valid;
+
+    memset(bar, 0, sizeof(struct drm_clip_rect));
+
+    if (full)
+    {
+        struct drm_clip_rect all = { 0, 0, p->width, p->height };
+
+        pattern_fill_rect(p, fb, &all);
+        b->valid = true;
+    }
+    else
+    {
+        for (uint32_t i = 0; i < b->n_rects; i++)
+            pattern_fill_rect(p, fb, &b->rects[i]);
+    }
+    b->n_rects = 0;
+
+    if (p->kind == DRMLIST_PATTERN_MOVING)
+    {
+        uint32_t bar_w = p->width / DRMLIST_PATTERN_BAR_WIDTH_DIV ? p->width / DRMLIST_PATTERN_BAR_WIDTH_DIV : 1;
+
+        bar->x1 = (p->frame % DRMLIST_PATTERN_BAR_FRAMES) * p->width / DRMLIST_PATTERN_BAR_FRAMES;
+        bar->x2 = bar->x1 + bar_w < p->width ? bar->x1 + bar_w : p->width;
+        bar->y2 = p->height;
+
+        drmlist_kernels.fill(fb->pixels + bar->x1 * 4, fb->stride, bar->x2 - bar->x1, p->height, PATTERN_WHITE);
+        b->rects[b->n_rects++] = *bar;
+        p->bytes += (size_t)(bar->x2 - bar->x1) * 4 * p->height;
+
+        if (advance)
+            p->frame++;
+    }
+
+    if (full)
+    {
+        p->full++;
+        p->full_ns += pattern_now_ns() - start;
+    }
+    else
+    {
+        p->incremental++;
+        p->incremental_ns += pattern_now_ns() - start;
+    }
+
+    return full;
+}
+
+void drmlist_pattern_drawn_over(drmlist_pattern_t* p, mydrm_fb_t* fb, const struct drm_clip_rect* r)
+{
+    drmlist_pattern_buffer_t* b = pattern_buffer(p, fb);
+
+    if (r->x1 >= r->x2 || r->y1 >= r->y2)
+        return;
+
+    /* Out of rects, all of it next time */
+    if (b->n_rects == DRMLIST_PATTERN_MAX_RECTS)
+        b->valid = false;
+    else
+        b->rects[b->n_rects++] = *r;
+}
+
+void drmlist_pattern_invalidate(drmlist_pattern_t* p, mydrm_fb_t* fb)
+{
+    for (int i = 0; i < DRMLIST_PATTERN_BUFFERS; i++)
+        if (!fb || p->buffers[i].pixels == fb->pixels)
+            p->buffers[i].valid = false;
+}
+
+void drmlist_pattern_print_stats(drmlist_pattern_t* p)
+{
+    if (!p->full)
+        return;
+
+    printf("Test patterns: %lu full frames (%.2f ms avg), %lu incremental (%.1f us avg), %.1f MiB written\n",
+                    p->full, p->full_ns / 1e6 / p->full, p->incremental,
+                    p->incremental ? p->incremental_ns / 1e3 / p->incremental : 0.0, p->bytes / (1024.0 * 1024.0));
+}
+
+void drmlist_pattern_cleanup(drmlist_pattern_t* p)
+{
+    free(p->rows);
+    p->rows = NULL;
+}
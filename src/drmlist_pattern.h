@@ -0,0 +1,102 @@
+#ifndef _DRMLIST_PATTERN_H_
+#define _DRMLIST_PATTERN_H_
+
+#include "mydrm/mydrm.h"
+
+/*
+ * Display validation test patterns
+ *
+ * Every pattern is a few full-width XRGB8888 row templates, built once per
+ * pattern and mode (SSE2 ramps, drmlist_kernels.clear spans), and every
+ * framebuffer row is a copy of one of them: runs of equal rows go out with
+ * one drmlist_kernels.blit (source stride 0, non-temporal stores).
+ *
+ * A buffer is only generated in full the first time it's drawn with the
+ * pattern. After that, what was drawn over it (the moving bar, HUD, software
+ * cursor) is restored from the templates, so a static pattern costs the
+ * overlays and the moving bar two bar-sized rects per frame.
+ *
+ * The moving bar steps once per rendered frame, not with time, so a dropped
+ * or repeated frame shows as a jump or a stall and a torn flip as a break in
+ * the bar.
+ */
+
+enum drmlist_pattern_kind
+{
+    DRMLIST_PATTERN_NONE = 0,
+    DRMLIST_PATTERN_BARS,           // 75% colour bars
+    DRMLIST_PATTERN_GRADIENT,       // red, green, blue and grey ramps
+    DRMLIST_PATTERN_CHECKER,
+    DRMLIST_PATTERN_GRID,           // 1px lines and border
+    DRMLIST_PATTERN_MOVING,         // vertical bar sweeping across black
+    DRMLIST_PATTERNS
+};
+
+#define DRMLIST_PATTERN_CHECKER_CELL 64
+#define DRMLIST_PATTERN_GRID_SPACING 16
+#define DRMLIST_PATTERN_BAR_FRAMES 120      // frames for the moving bar to cross the screen
+#define DRMLIST_PATTERN_BAR_WIDTH_DIV 48    // bar width as a fraction of the screen
+#define DRMLIST_PATTERN_MAX_ROWS 4          // templates per pattern
+#define DRMLIST_PATTERN_BUFFERS 4
+#define DRMLIST_PATTERN_MAX_RECTS 4         // drawn over a buffer per frame
+
+typedef struct
+{
+    const uint8_t* pixels;          // NULL for a free slot
+    bool valid;                     // holds the pattern, apart from `rects`
+    struct drm_clip_rect rects[DRMLIST_PATTERN_MAX_RECTS];
+    uint32_t n_rects;
+} drmlist_pattern_buffer_t;
+
+typedef struct
+{
+    int kind;
+    uint32_t width;
+    uint32_t height;
+    uint32_t* rows;                 // DRMLIST_PATTERN_MAX_ROWS templates of `width`
+    uint64_t frame;                 // moving bar position
+
+    drmlist_pattern_buffer_t buffers[DRMLIST_PATTERN_BUFFERS];
+    uint32_t next_buffer;
+
+    /* Stats */
+    uint64_t full;
+    uint64_t full_ns;
+    uint64_t incremental;
+    uint64_t incremental_ns;
+    uint64_t bytes;
+} drmlist_pattern_t;
+
+/* DRMLIST_PATTERN_* of `name`, -1 for none */
+int drmlist_pattern_find(const char* name);
+const char* drmlist_pattern_name(int kind);
+
+/* Space separated names, for usage messages */
+const char* drmlist_pattern_names(void);
+
+int drmlist_pattern_init(drmlist_pattern_t* p, int kind, uint32_t width, uint32_t height);
+
+/* Another pattern or mode, every buffer is generated again */
+int drmlist_pattern_set(drmlist_pattern_t* p, int kind);
+int drmlist_pattern_resize(drmlist_pattern_t* p, uint32_t width, uint32_t height);
+
+/* Needs a frame every refresh */
+bool drmlist_pattern_animated(drmlist_pattern_t* p);
+
+/*
+ * Brings `fb` to this frame's pattern, stepping the moving bar with `advance`.
+ * Returns true if the whole buffer was written, the bar's rect goes to `bar`
+ * (empty without one).
+ */
+bool drmlist_pattern_draw(drmlist_pattern_t* p, mydrm_fb_t* fb, bool advance, struct drm_clip_rect* bar);
+
+/* `r` was drawn over the pattern in `fb`, restored with the next draw */
+void drmlist_pattern_drawn_over(drmlist_pattern_t* p, mydrm_fb_t* fb, const struct drm_clip_rect* r);
+
+/* `fb` (NULL for all) no longer holds the pattern */
+void drmlist_pattern_invalidate(drmlist_pattern_t* p, mydrm_fb_t* fb);
+
+void drmlist_pattern_print_stats(drmlist_pattern_t* p);
+void drmlist_pattern_cleanup(drmlist_pattern_t* p);
+
+#endif // _DRMLIST_PATTERN_H_
@@ -0,0 +1,465 @@
+#include "drmlist_scale.h"
+#include "drmlist_cpu.h"
+#include <immintrin.h>
+#include <pthread.h>
+
+typedef struct
+{
+    uint8_t* dst;               // first visible pixel of the scaled rectangle
+    uint32_t dst_stride;
+    const uint8_t* src;
+    uint32_t src_stride;
+    uint32_t src_w;
+    uint32_t src_h;
+    uint32_t w;                 // scaled size
+    uint32_t h;
+    uint32_t cx0;               // first visible column/row, in the scaled rectangle
+    uint32_t cy0;
+    uint32_t n;                 // visible columns
+    uint32_t filter;
+
+    /* By visible column */
+    int32_t* x0;                // nearest/bilinear: left tap, box: first pixel
+    int32_t* x1;                // bilinear: right tap, box: end (exclusive)
+    uint32_t* xw;               // bilinear: 7-bit weight of x1 in both 16-bit halves
+} scale_job_t;
+
+typedef struct
+{
+    scale_job_t* job;
+    uint32_t y_begin;           // visible rows
+    uint32_t y_end;
+    pthread_t thread;
+    bool threaded;
+    int ret;
+} scale_band_t;
+
+static const char* filter_names[] = { "none", "nearest", "bilinear", "box" };
+
+int drmlist_scale_filter_parse(const char* name)
+{
+    for (int i = 0; i < (int)(sizeof(filter_names) / sizeof(filter_names[0])); i++)
+        if (!strcmp(name, filter_names[i]))
+            return i;
+
+    return -EINVAL;
+}
+
+const char* drmlist_scale_filter_name(uint32_t filter)
+{
+    return filter <= DRMLIST_SCALE_BOX ? filter_names[filter] : "Unknown";
+}
+
+/*
+ * Coordinate mapping, output pixel centers onto the source
+ */
+static inline int64_t scale_pos(uint32_t x, uint32_t s, uint32_t d)
+{
+    int64_t pos = (((int64_t)(2 * x + 1) * s) << 16) / (2 * (int64_t)d) - 0x8000;
+    int64_t max = (int64_t)(s - 1) << 16;
+
+    return pos < 0 ? 0 : pos > max ? max : pos;
+}
+
+static inline uint32_t scale_nearest(uint32_t x, uint32_t s, uint32_t d)
+{
+    uint32_t i = (uint64_t)(2 * x + 1) * s / (2 * (uint64_t)d);
+    return i < s ? i : s - 1;
+}
+
+static inline void scale_box_span(uint32_t x, uint32_t s, uint32_t d, uint32_t* b0, uint32_t* b1)
+{
+    *b0 = (uint64_t)x * s / d;
+    *b1 = (uint64_t)(x + 1) * s / d;
+    if (*b1 <= *b0)
+        *b1 = *b0 + 1;
+}
+
+/*
+ * a + (b - a) * w / 128 per channel, w per pixel in both 16-bit halves
+ */
+DRMLIST_TARGET_AVX2 static inline __m256i lerp_epu8(__m256i a, __m256i b, __m256i w)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i round = _mm256_set1_epi16(64);
+    __m256i wlo = _mm256_unpacklo_epi32(w, w);
+    __m256i whi = _mm256_unpackhi_epi32(w, w);
+    __m256i alo = _mm256_unpacklo_epi8(a, zero);
+    __m256i ahi = _mm256_unpackhi_epi8(a, zero);
+    __m256i dlo = _mm256_sub_epi16(_mm256_unpacklo_epi8(b, zero), alo);
+    __m256i dhi = _mm256_sub_epi16(_mm256_unpackhi_epi8(b, zero), ahi);
+
+    alo = _mm256_add_epi16(alo, _mm256_srai_epi16(_mm256_add_epi16(_mm256_mullo_epi16(dlo, wlo), round), 7));
+    ahi = _mm256_add_epi16(ahi, _mm256_srai_epi16(_mm256_add_epi16(_mm256_mullo_epi16(dhi, whi), round), 7));
+
+    return _mm256_packus_epi16(alo, ahi);
+}
+
+static inline uint32_t lerp_u8x4(uint32_t a, uint32_t b, int w)
+{
+    uint32_t ret = 0;
+
+    for (int s = 0; s < 32; s += 8)
+    {
+        int ca = (a >> s) & 0xFF;
+        int cb = (b >> s) & 0xFF;
+        ret |= (uint32_t)(ca + (((cb - ca) * w + 64) >> 7)) << s;
+    }
+
+    return ret;
+}
+
+/*
+ * AVX2 row kernels, 8 pixels at a time, return how many pixels they did and
+ * leave the rest to the scalar loops
+ */
+DRMLIST_TARGET_AVX2 static uint32_t scale_row_nearest_avx2(scale_job_t* j, uint32_t* drow, const int* srow)
+{
+    uint32_t i = 0;
+
+    for (; i + 8 <= j->n; i += 8)
+    {
+        __m256i idx = _mm256_loadu_si256((const __m256i*)(j->x0 + i));
+        _mm256_storeu_si256((__m256i*)(drow + i), _mm256_i32gather_epi32(srow, idx, 4));
+    }
+
+    return i;
+}
+
+DRMLIST_TARGET_AVX2 static uint32_t scale_hrow_bilinear_avx2(scale_job_t* j, uint32_t* out, const int* srow)
+{
+    uint32_t i = 0;
+
+    for (; i + 8 <= j->n; i += 8)
+    {
+        __m256i a = _mm256_i32gather_epi32(srow, _mm256_loadu_si256((const __m256i*)(j->x0 + i)), 4);
+        __m256i b = _mm256_i32gather_epi32(srow, _mm256_loadu_si256((const __m256i*)(j->x1 + i)), 4);
+        __m256i w = _mm256_loadu_si256((const __m256i*)(j->xw + i));
+
+        _mm256_store_si256((__m256i*)(out + i), lerp_epu8(a, b, w));
+    }
+
+    return i;
+}
+
+DRMLIST_TARGET_AVX2 static uint32_t scale_vrow_bilinear_avx2(uint32_t* drow, const uint32_t* h0, const uint32_t* h1,
+                                                             uint32_t n, int wy)
+{
+    __m256i w = _mm256_set1_epi32(wy | wy << 16);
+    uint32_t i = 0;
+
+    for (; i + 8 <= n; i += 8)
+    {
+        __m256i a = _mm256_load_si256((const __m256i*)(h0 + i));
+        __m256i b = _mm256_load_si256((const __m256i*)(h1 + i));
+        _mm256_storeu_si256((__m256i*)(drow + i), lerp_epu8(a, b, w));
+    }
+
+    return i;
+}
+
+/* Two pixels per add into the box accumulators */
+DRMLIST_TARGET_AVX2 static uint32_t scale_box_acc_avx2(__m128i* acc, const uint8_t* srow, uint32_t span)
+{
+    uint32_t p = 0;
+
+    for (; p + 2 <= span; p += 2)
+    {
+        __m256i v = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(srow + p * 4)));
+        __m256i* a = (__m256i*)(acc + p);
+        _mm256_store_si256(a, _mm256_add_epi32(_mm256_load_si256(a), v));
+    }
+
+    return p;
+}
+
+/*
+ * Nearest
+ */
+static int scale_band_nearest(scale_job_t* j, uint32_t y_begin, uint32_t y_end)
+{
+    for (uint32_t y = y_begin; y < y_end; y++)
+    {
+        const int* srow = (const int*)(j->src + (size_t)scale_nearest(j->cy0 + y, j->src_h, j->h) * j->src_stride);
+        uint32_t* drow = (uint32_t*)(j->dst + (size_t)y * j->dst_stride);
+        uint32_t i = drmlist_cpu_level >= DRMLIST_CPU_AVX2 ? scale_row_nearest_avx2(j, drow, srow) : 0;
+
+        for (; i < j->n; i++)
+            drow[i] = srow[j->x0[i]];
+    }
+
+    return 0;
+}
+
+/*
+ * Bilinear: horizontal pass into two scratch rows, reused while the source
+ * rows don't change, then a vertical lerp into the output
+ */
+static void scale_hrow_bilinear(scale_job_t* j, uint32_t* out, uint32_t sy)
+{
+    const int* srow = (const int*)(j->src + (size_t)sy * j->src_stride);
+    uint32_t i = drmlist_cpu_level >= DRMLIST_CPU_AVX2 ? scale_hrow_bilinear_avx2(j, out, srow) : 0;
+
+    for (; i < j->n; i++)
+        out[i] = lerp_u8x4(srow[j->x0[i]], srow[j->x1[i]], j->xw[i] & 0xFFFF);
+}
+
+static int scale_band_bilinear(scale_job_t* j, uint32_t y_begin, uint32_t y_end)
+{
+    size_t row_size = ((size_t)j->n * 4 + 31) & ~(size_t)31;
+    uint32_t* h0 = aligned_alloc(32, row_size);
+    uint32_t* h1 = aligned_alloc(32, row_size);
+    int64_t r0 = -1, r1 = -1;
+
+    if (!h0 || !h1)
+    {
+        free(h0);
+        free(h1);
+        return -ENOMEM;
+    }
+
+    for (uint32_t y = y_begin; y < y_end; y++)
+    {
+        uint32_t* drow = (uint32_t*)(j->dst + (size_t)y * j->dst_stride);
+        int64_t pos = scale_pos(j->cy0 + y, j->src_h, j->h);
+        uint32_t sy0 = pos >> 16;
+        uint32_t sy1 = sy0 + 1 < j->src_h ? sy0 + 1 : sy0;
+        int wy = (pos & 0xFFFF) >> 9;
+        uint32_t i;
+
+        if (sy0 == r1)
+        {
+            uint32_t* t = h0;
+            h0 = h1;
+            h1 = t;
+            r0 = r1;
+            r1 = -1;
+        }
+
+        if (r0 != sy0)
+        {
+            scale_hrow_bilinear(j, h0, sy0);
+            r0 = sy0;
+        }
+
+        if (wy == 0)
+        {
+            memcpy(drow, h0, (size_t)j->n * 4);
+            continue;
+        }
+
+        if (r1 != sy1)
+        {
+            scale_hrow_bilinear(j, h1, sy1);
+            r1 = sy1;
+        }
+
+        i = drmlist_cpu_level >= DRMLIST_CPU_AVX2 ? scale_vrow_bilinear_avx2(drow, h0, h1, j->n, wy) : 0;
+
+        for (; i < j->n; i++)
+            drow[i] = lerp_u8x4(h0[i], h1[i], wy);
+    }
+
+    free(h0);
+    free(h1);
+
+    return 0;
+}
+
+/*
+ * Box: vertical pass sums the covered source rows into 32-bit channels, the
+ * horizontal pass sums the covered columns and divides by the area
+ */
+static int scale_band_box(scale_job_t* j, uint32_t y_begin, uint32_t y_end)
+{
+    uint32_t sx_begin = j->x0[0];
+    uint32_t sx_end = j->x1[j->n - 1];
+    uint32_t span = sx_end - sx_begin;
+    __m128i* acc = aligned_alloc(32, ((size_t)span * 16 + 31) & ~(size_t)31);
+    const __m128i zero = _mm_setzero_si128();
+
+    if (!acc)
+        return -ENOMEM;
+
+    for (uint32_t y = y_begin; y < y_end; y++)
+    {
+        uint32_t* drow = (uint32_t*)(j->dst + (size_t)y * j->dst_stride);
+        uint32_t by0, by1;
+
+        scale_box_span(j->cy0 + y, j->src_h, j->h, &by0, &by1);
+        memset(acc, 0, (size_t)span * 16);
+
+        for (uint32_t sy = by0; sy < by1; sy++)
+        {
+            const uint8_t* srow = j->src + (size_t)sy * j->src_stride + (size_t)sx_begin * 4;
+            uint32_t p = drmlist_cpu_level >= DRMLIST_CPU_AVX2 ? scale_box_acc_avx2(acc, srow, span) : 0;
+
+            for (; p < span; p++)
+            {
+                int32_t px;
+                memcpy(&px, srow + p * 4, 4);
+                acc[p] = _mm_add_epi32(acc[p], _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(px), zero), zero));
+            }
+        }
+
+        for (uint32_t i = 0; i < j->n; i++)
+        {
+            __m128i sum = _mm_setzero_si128();
+            __m128 inv = _mm_set1_ps(1.0f / ((j->x1[i] - j->x0[i]) * (by1 - by0)));
+
+            for (int32_t p = j->x0[i]; p < j->x1[i]; p++)
+                sum = _mm_add_epi32(sum, acc[p - sx_begin]);
+
+            /* Averages are 0..255, the signed pack keeps them */
+            sum = _mm_cvtps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(sum), inv));
+            sum = _mm_packs_epi32(sum, sum);
+            drow[i] = _mm_cvtsi128_si32(_mm_packus_epi16(sum, sum));
+        }
+    }
+
+    free(acc);
+
+    return 0;
+}
+
+static int scale_band(scale_job_t* j, uint32_t y_begin, uint32_t y_end)
+{
+    switch (j->filter)
+    {
+        case DRMLIST_SCALE_NEAREST: return scale_band_nearest(j, y_begin, y_end);
+        case DRMLIST_SCALE_BILINEAR: return scale_band_bilinear(j, y_begin, y_end);
+        default: return scale_band_box(j, y_begin, y_end);
+    }
+}
+
+static void* scale_band_thread(void* arg)
+{
+    scale_band_t* band = arg;
+
+    band->ret = scale_band(band->job, band->y_begin, band->y_end);
+    return NULL;
+}
+
+static int scale_tables(scale_job_t* j)
+{
+    size_t size = ((size_t)j->n * 4 + 31) & ~(size_t)31;
+
+    j->x0 = aligned_alloc(32, size);
+    j->x1 = aligned_alloc(32, size);
+    j->xw = aligned_alloc(32, size);
+
+    if (!j->x0 || !j->x1 || !j->xw)
+        return -ENOMEM;
+
+    for (uint32_t i = 0; i < j->n; i++)
+    {
+        uint32_t x = j->cx0 + i;
+
+        if (j->filter == DRMLIST_SCALE_NEAREST)
+        {
+            j->x0[i] = scale_nearest(x, j->src_w, j->w);
+        }
+        else if (j->filter == DRMLIST_SCALE_BILINEAR)
+        {
+            int64_t pos = scale_pos(x, j->src_w, j->w);
+            uint32_t w = (pos & 0xFFFF) >> 9;
+
+            j->x0[i] = pos >> 16;
+            j->x1[i] = j->x0[i] + 1 < (int32_t)j->src_w ? j->x0[i] + 1 : j->x0[i];
+            j->xw[i] = w | w << 16;
+        }
+        else
+        {
+            scale_box_span(x, j->src_w, j->w, (uint32_t*)&j->x0[i], (uint32_t*)&j->x1[i]);
+        }
+    }
+
+    return 0;
+}
+
+int drmlist_scale_to_fb(mydrm_fb_t* fb, const struct drm_clip_rect* clip, int x, int y, uint32_t width, uint32_t height,
+                        const uint32_t* src, uint32_t src_stride, uint32_t src_width, uint32_t src_height,
+                        uint32_t filter, uint32_t threads)
+{
+    scale_band_t bands[DRMLIST_SCALE_MAX_THREADS];
+    scale_job_t job;
+    int64_t x1 = 0, y1 = 0, x2 = fb->width, y2 = fb->height;
+    uint32_t rows, n_bands;
+    int ret = 0;
+
+    if (!src || !src_width || !src_height || !width || !height || filter < DRMLIST_SCALE_NEAREST || filter > DRMLIST_SCALE_BOX)
+        return -EINVAL;
+
+    if (filter == DRMLIST_SCALE_BOX && (width > src_width || height > src_height))
+        filter = DRMLIST_SCALE_BILINEAR;
+
+    /* Visible part of the target rectangle */
+    if (clip)
+    {
+        if (clip->x1 > x1) x1 = clip->x1;
+        if (clip->y1 > y1) y1 = clip->y1;
+        if (clip->x2 < x2) x2 = clip->x2;
+        if (clip->y2 < y2) y2 = clip->y2;
+    }
+    if (x > x1) x1 = x;
+    if (y > y1) y1 = y;
+    if ((int64_t)x + width < x2) x2 = (int64_t)x + width;
+    if ((int64_t)y + height < y2) y2 = (int64_t)y + height;
+
+    if (x2 <= x1 || y2 <= y1)
+        return 0;
+
+    memset(&job, 0, sizeof(scale_job_t));
+    job.dst = fb->pixels + (size_t)y1 * fb->stride + (size_t)x1 * 4;
+    job.dst_stride = fb->stride;
+    job.src = (const uint8_t*)src;
+    job.src_stride = src_stride;
+    job.src_w = src_width;
+    job.src_h = src_height;
+    job.w = width;
+    job.h = height;
+    job.cx0 = x1 - x;
+    job.cy0 = y1 - y;
+    job.n = x2 - x1;
+    job.filter = filter;
+
+    if ((ret = scale_tables(&job)))
+        goto out;
+
+    rows = y2 - y1;
+    n_bands = threads < 1 ? 1 : threads > DRMLIST_SCALE_MAX_THREADS ? DRMLIST_SCALE_MAX_THREADS : threads;
+    if (n_bands > rows / DRMLIST_SCALE_MIN_BAND)
+        n_bands = rows / DRMLIST_SCALE_MIN_BAND ? rows / DRMLIST_SCALE_MIN_BAND : 1;
+
+    for (uint32_t b = 0; b < n_bands; b++)
+    {
+        bands[b].job = &job;
+        bands[b].y_begin = (uint64_t)rows * b / n_bands;
+        bands[b].y_end = (uint64_t)rows * (b + 1) / n_bands;
+        bands[b].threaded = false;
+        bands[b].ret = 0;
+    }
+
+    /* Band 0 runs on the caller, a band whose thread can't start runs there too */
+    for (uint32_t b = 1; b < n_bands; b++)
+        bands[b].threaded = pthread_create(&bands[b].thread, NULL, scale_band_thread, &bands[b]) == 0;
+
+    for (uint32_t b = 0; b < n_bands; b++)
+        if (!bands[b].threaded)
+            scale_band_thread(&bands[b]);
+
+    for (uint32_t b = 0; b < n_bands; b++)
+    {
+        if (bands[b].threaded)
+            pthread_join(bands[b].thread, NULL);
+        if (bands[b].ret && !ret)
+            ret = bands[b].ret;
+    }
+
+out:
+    free(job.x0);
+    free(job.x1);
+    free(job.xw);
+
+    return ret;
+}
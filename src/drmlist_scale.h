@@ -0,0 +1,45 @@
+#ifndef _DRMLIST_SCALE_H_
+#define _DRMLIST_SCALE_H_
+
+#include "mydrm/mydrm.h"
+
+/*
+ * Image scaling, ARGB8888 source into a 32-bit framebuffer
+ *
+ * All filters are separable: source rows are first scaled horizontally into
+ * scratch rows (or, for the box filter, summed vertically), then combined
+ * into the output row, 8 pixels at a time with AVX2 when the CPU has it.
+ * Only the part of the target rectangle inside the framebuffer and clip
+ * rectangle is computed.
+ *
+ *  nearest     one source pixel per output pixel
+ *  bilinear    2x2 taps, 7-bit weights
+ *  box         average of every source pixel an output pixel covers, for
+ *              downscaling; falls back to bilinear if either axis is upscaled
+ *
+ * With threads > 1 the output rows are split into bands scaled in parallel.
+ */
+
+#define DRMLIST_SCALE_MAX_THREADS 16
+#define DRMLIST_SCALE_MIN_BAND 16       // rows, smaller bands aren't worth a thread
+
+enum drmlist_scale_filter
+{
+    DRMLIST_SCALE_NONE = 0,
+    DRMLIST_SCALE_NEAREST = 1,
+    DRMLIST_SCALE_BILINEAR = 2,
+    DRMLIST_SCALE_BOX = 3,
+};
+
+int drmlist_scale_filter_parse(const char* name);
+const char* drmlist_scale_filter_name(uint32_t filter);
+
+/*
+ * Scale `src` (stride in bytes) to width x height at (x, y) in `fb`, clipped
+ * to the framebuffer and `clip` (NULL for none). Returns 0, -EINVAL or -ENOMEM.
+ */
+int drmlist_scale_to_fb(mydrm_fb_t* fb, const struct drm_clip_rect* clip, int x, int y, uint32_t width, uint32_t height,
+                        const uint32_t* src, uint32_t src_stride, uint32_t src_width, uint32_t src_height,
+                        uint32_t filter, uint32_t threads);
+
+#endif // _DRMLIST_SCALE_H_
@@ -0,0 +1,304 @@
+#include "drmlist_sprites.h"
+#include "drmlist_kernels.h"
+#include <immintrin.h>
+#include <time.h>
+
+static uint64_t sprites_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static inline uint32_t sprites_rand(uint32_t* state)
+{
+    uint32_t x = *state;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+
+    return *state = x;
+}
+
+static inline void sprites_fill(mydrm_fb_t* fb, int x1, int y1, int x2, int y2, uint32_t color)
+{
+    drmlist_kernels.fill(fb->pixels + (size_t)y1 * fb->stride + (size_t)x1 * 4, fb->stride, x2 - x1, y2 - y1, color);
+}
+
+int drmlist_sprites_init(drmlist_sprites_t* s, size_t count, uint32_t width, uint32_t height, uint32_t seed)
+{
+    size_t size = ((count + DRMLIST_ANIM_LANES - 1) & ~(size_t)(DRMLIST_ANIM_LANES - 1)) * sizeof(int32_t);
+    uint32_t state = seed ? seed : 1;
+    int ret;
+
+    memset(s, 0, sizeof(drmlist_sprites_t));
+
+    if ((ret = drmlist_anim_init(&s->anim, count, width, height)))
+        return ret;
+
+    if ((s->color = aligned_alloc(32, size ? size : 32)) == NULL || (s->ix = aligned_alloc(32, size ? size : 32)) == NULL ||
+        (s->iy = aligned_alloc(32, size ? size : 32)) == NULL || (s->bins = malloc(4 * count * sizeof(drmlist_sprites_bin_t) + 1)) == NULL)
+    {
+        drmlist_sprites_cleanup(s);
+        return -ENOMEM;
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        float w = DRMLIST_SPRITES_MIN_SIZE + sprites_rand(&state) % (DRMLIST_SPRITES_MAX_SIZE - DRMLIST_SPRITES_MIN_SIZE + 1);
+        float h = DRMLIST_SPRITES_MIN_SIZE + sprites_rand(&state) % (DRMLIST_SPRITES_MAX_SIZE - DRMLIST_SPRITES_MIN_SIZE + 1);
+        float x = sprites_rand(&state) % (width > w ? width - (uint32_t)w : 1);
+        float y = sprites_rand(&state) % (height > h ? height - (uint32_t)h : 1);
+        float vx = DRMLIST_SPRITES_MIN_SPEED + sprites_rand(&state) % (DRMLIST_SPRITES_MAX_SPEED - DRMLIST_SPRITES_MIN_SPEED);
+        float vy = DRMLIST_SPRITES_MIN_SPEED + sprites_rand(&state) % (DRMLIST_SPRITES_MAX_SPEED - DRMLIST_SPRITES_MIN_SPEED);
+        uint32_t r = sprites_rand(&state);
+
+        drmlist_anim_add(&s->anim, x, y, (r & 1) ? vx : -vx, (r & 2) ? vy : -vy, w, h);
+        s->color[i] = 0xFF000000 | (sprites_rand(&state) & 0x00FFFFFF);
+    }
+
+    if ((ret = drmlist_sprites_resize(s, width, height)))
+    {
+        drmlist_sprites_cleanup(s);
+        return ret;
+    }
+
+    return 0;
+}
+
+/*
+ * New frame size (mode switch), sprites now past the edge are moved back in
+ */
+int drmlist_sprites_resize(drmlist_sprites_t* s, uint32_t width, uint32_t height)
+{
+    uint32_t* bin_start;
+    drmlist_anim_t* a = &s->anim;
+
+    s->tiles_x = (width + DRMLIST_SPRITES_TILE - 1) / DRMLIST_SPRITES_TILE;
+    s->tiles_y = (height + DRMLIST_SPRITES_TILE - 1) / DRMLIST_SPRITES_TILE;
+
+    if ((bin_start = realloc(s->bin_start, (s->tiles_x * s->tiles_y + 1) * sizeof(uint32_t))) == NULL)
+        return -ENOMEM;
+
+    s->bin_start = bin_start;
+    s->width = width;
+    s->height = height;
+
+    a->max_x = width;
+    a->max_y = height;
+    for (size_t i = 0; i < a->count; i++)
+    {
+        if (a->x[i] + a->w[i] > a->max_x)
+            a->x[i] = a->prev_x[i] = a->max_x > a->w[i] ? a->max_x - a->w[i] : 0.0f;
+        if (a->y[i] + a->h[i] > a->max_y)
+            a->y[i] = a->prev_y[i] = a->max_y > a->h[i] ? a->max_y - a->h[i] : 0.0f;
+    }
+
+    return 0;
+}
+
+void drmlist_sprites_step(drmlist_sprites_t* s, float dt)
+{
+    uint64_t start = sprites_now_ns();
+
+    drmlist_anim_step(&s->anim, dt);
+
+    s->steps++;
+    s->step_ns += sprites_now_ns() - start;
+}
+
+/*
+ * Same arithmetic as drmlist_anim_lerp(), truncated to pixels
+ */
+DRMLIST_TARGET_AVX2 static void sprites_lerp_avx2(drmlist_sprites_t* s, float alpha)
+{
+    drmlist_anim_t* a = &s->anim;
+    const __m256 va = _mm256_set1_ps(alpha);
+
+    for (size_t i = 0; i < a->count; i += DRMLIST_ANIM_LANES)
+    {
+        __m256 px = _mm256_load_ps(&a->prev_x[i]);
+        __m256 py = _mm256_load_ps(&a->prev_y[i]);
+        __m256 x = _mm256_add_ps(px, _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(&a->x[i]), px), va));
+        __m256 y = _mm256_add_ps(py, _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(&a->y[i]), py), va));
+
+        _mm256_store_si256((__m256i*)&s->ix[i], _mm256_cvttps_epi32(x));
+        _mm256_store_si256((__m256i*)&s->iy[i], _mm256_cvttps_epi32(y));
+    }
+}
+
+static void sprites_lerp(drmlist_sprites_t* s, float alpha)
+{
+    drmlist_anim_t* a = &s->anim;
+
+    if (drmlist_cpu_level >= DRMLIST_CPU_AVX2)
+    {
+        sprites_lerp_avx2(s, alpha);
+        return;
+    }
+
+    for (size_t i = 0; i < a->count; i++)
+    {
+        s->ix[i] = (int32_t)(a->prev_x[i] + (a->x[i] - a->prev_x[i]) * alpha);
+        s->iy[i] = (int32_t)(a->prev_y[i] + (a->y[i] - a->prev_y[i]) * alpha);
+    }
+}
+
+/* Sprite `i` clipped to the frame, false if nothing is left */
+static inline bool sprites_clip(drmlist_sprites_t* s, size_t i, uint32_t width, uint32_t height,
+                                int* x1, int* y1, int* x2, int* y2)
+{
+    *x1 = s->ix[i];
+    *y1 = s->iy[i];
+    *x2 = *x1 + (int)s->anim.w[i];
+    *y2 = *y1 + (int)s->anim.h[i];
+
+    if (*x1 < 0) *x1 = 0;
+    if (*y1 < 0) *y1 = 0;
+    if (*x2 > (int)width) *x2 = width;
+    if (*y2 > (int)height) *y2 = height;
+
+    return *x2 > *x1 && *y2 > *y1;
+}
+
+/*
+ * Counting sort by tile: counts land one slot up, the prefix sum turns them
+ * into starts, the scatter advances every start to its tile's end, and the
+ * shift back makes them starts again
+ */
+static void sprites_bin(drmlist_sprites_t* s, uint32_t width, uint32_t height)
+{
+    uint32_t n_tiles = s->tiles_x * s->tiles_y;
+    uint32_t* start = s->bin_start;
+    int x1, y1, x2, y2;
+
+    memset(start, 0, (n_tiles + 1) * sizeof(uint32_t));
+
+    for (size_t i = 0; i < s->anim.count; i++)
+    {
+        if (!sprites_clip(s, i, width, height, &x1, &y1, &x2, &y2))
+            continue;
+
+        for (int ty = y1 / DRMLIST_SPRITES_TILE; ty <= (y2 - 1) / DRMLIST_SPRITES_TILE; ty++)
+            for (int tx = x1 / DRMLIST_SPRITES_TILE; tx <= (x2 - 1) / DRMLIST_SPRITES_TILE; tx++)
+                start[ty * s->tiles_x + tx + 1]++;
+    }
+
+    for (uint32_t t = 0; t < n_tiles; t++)
+        start[t + 1] += start[t];
+
+    for (size_t i = 0; i < s->anim.count; i++)
+    {
+        if (!sprites_clip(s, i, width, height, &x1, &y1, &x2, &y2))
+            continue;
+
+        for (int ty = y1 / DRMLIST_SPRITES_TILE; ty <= (y2 - 1) / DRMLIST_SPRITES_TILE; ty++)
+        {
+            int tile_y = ty * DRMLIST_SPRITES_TILE;
+
+            for (int tx = x1 / DRMLIST_SPRITES_TILE; tx <= (x2 - 1) / DRMLIST_SPRITES_TILE; tx++)
+            {
+                drmlist_sprites_bin_t* b = &s->bins[start[ty * s->tiles_x + tx]++];
+                int tile_x = tx * DRMLIST_SPRITES_TILE;
+
+                b->x1 = x1 > tile_x ? x1 : tile_x;
+                b->y1 = y1 > tile_y ? y1 : tile_y;
+                b->x2 = x2 < tile_x + DRMLIST_SPRITES_TILE ? x2 : tile_x + DRMLIST_SPRITES_TILE;
+                b->y2 = y2 < tile_y + DRMLIST_SPRITES_TILE ? y2 : tile_y + DRMLIST_SPRITES_TILE;
+                b->color = s->color[i];
+            }
+        }
+    }
+
+    s->bin_entries += start[n_tiles - 1];
+    memmove(start + 1, start, n_tiles * sizeof(uint32_t));
+    start[0] = 0;
+}
+
+void drmlist_sprites_draw(drmlist_sprites_t* s, mydrm_fb_t* fb, float alpha, bool clear, uint32_t bg)
+{
+    uint32_t width = fb->width < s->width ? fb->width : s->width;
+    uint32_t height = fb->height < s->height ? fb->height : s->height;
+    uint64_t t0, t1, t2;
+
+    t0 = sprites_now_ns();
+    sprites_lerp(s, alpha);
+    t1 = sprites_now_ns();
+    sprites_bin(s, width, height);
+    t2 = sprites_now_ns();
+
+    for (uint32_t ty = 0; ty < s->tiles_y; ty++)
+    {
+        int tile_y1 = ty * DRMLIST_SPRITES_TILE;
+        int tile_y2 = tile_y1 + DRMLIST_SPRITES_TILE < (int)height ? tile_y1 + DRMLIST_SPRITES_TILE : (int)height;
+
+        for (uint32_t tx = 0; tx < s->tiles_x; tx++)
+        {
+            uint32_t t = ty * s->tiles_x + tx;
+            int tile_x1 = tx * DRMLIST_SPRITES_TILE;
+            int tile_x2 = tile_x1 + DRMLIST_SPRITES_TILE < (int)width ? tile_x1 + DRMLIST_SPRITES_TILE : (int)width;
+
+            if (tile_x1 >= tile_x2 || tile_y1 >= tile_y2)
+                continue;
+
+            if (clear)
+                sprites_fill(fb, tile_x1, tile_y1, tile_x2, tile_y2, bg);
+
+            for (uint32_t k = s->bin_start[t]; k < s->bin_start[t + 1]; k++)
+            {
+                drmlist_sprites_bin_t* b = &s->bins[k];
+
+                sprites_fill(fb, b->x1, b->y1, b->x2, b->y2, b->color);
+            }
+        }
+    }
+
+    s->frames++;
+    s->lerp_ns += t1 - t0;
+    s->bin_ns += t2 - t1;
+    s->draw_ns += sprites_now_ns() - t2;
+}
+
+void drmlist_sprites_draw_naive(drmlist_sprites_t* s, mydrm_fb_t* fb, float alpha, bool clear, uint32_t bg)
+{
+    uint32_t width = fb->width < s->width ? fb->width : s->width;
+    uint32_t height = fb->height < s->height ? fb->height : s->height;
+    int x1, y1, x2, y2;
+
+    sprites_lerp(s, alpha);
+
+    if (clear)
+        sprites_fill(fb, 0, 0, width, height, bg);
+
+    for (size_t i = 0; i < s->anim.count; i++)
+        if (sprites_clip(s, i, width, height, &x1, &y1, &x2, &y2))
+            sprites_fill(fb, x1, y1, x2, y2, s->color[i]);
+}
+
+void drmlist_sprites_print_stats(drmlist_sprites_t* s)
+{
+    double total;
+
+    if (!s->frames)
+        return;
+
+    total = (double)(s->lerp_ns + s->bin_ns + s->draw_ns) / s->frames + (s->steps ? (double)s->step_ns / s->frames : 0.0);
+
+    printf("Sprites: %zu, %.2f tiles each; per frame: step %.3f ms (%.2f steps), lerp %.3f ms, bin %.3f ms, "
+           "draw %.3f ms; %.1f M sprites/s\n",
+                    s->anim.count, (double)s->bin_entries / s->frames / (s->anim.count ? s->anim.count : 1),
+                    s->step_ns / 1e6 / s->frames, (double)s->steps / s->frames, s->lerp_ns / 1e6 / s->frames,
+                    s->bin_ns / 1e6 / s->frames, s->draw_ns / 1e6 / s->frames, s->anim.count / total * 1e3);
+}
+
+void drmlist_sprites_cleanup(drmlist_sprites_t* s)
+{
+    drmlist_anim_free(&s->anim);
+    free(s->color);
+    free(s->ix);
+    free(s->iy);
+    free(s->bin_start);
+    free(s->bins);
+    memset(s, 0, sizeof(drmlist_sprites_t));
+}
@@ -0,0 +1,77 @@
+#ifndef _DRMLIST_SPRITES_H_
+#define _DRMLIST_SPRITES_H_
+
+#include "mydrm/mydrm.h"
+#include "drmlist_anim.h"
+
+/*
+ * Sprite stress renderer
+ *
+ * Sprites are a drmlist_anim_t (structure of arrays, stepped 8 at a time with
+ * AVX2) plus a colour each. A frame interpolates every sprite to an integer
+ * position, 8 at a time, then bins the sprites by DRMLIST_SPRITES_TILE square
+ * tiles with a counting sort, each entry already clipped to its tile and
+ * carrying the colour, and fills tile by tile (drmlist_kernels.fill): the
+ * background, then the tile's entries. A tile stays in L1 while all of its sprites are drawn and
+ * its entries are read sequentially. The sort is stable, overlapping sprites
+ * come out in the same order as drawing them one after the other would.
+ */
+
+#define DRMLIST_SPRITES_TILE 64
+#define DRMLIST_SPRITES_MIN_SIZE 4
+#define DRMLIST_SPRITES_MAX_SIZE 24         // under a tile, a sprite is in at most 4 tiles
+#define DRMLIST_SPRITES_MIN_SPEED 40        // pixels per second, per axis
+#define DRMLIST_SPRITES_MAX_SPEED 400
+
+/* A sprite clipped to one tile, what drawing the tile reads, in order */
+typedef struct
+{
+    uint16_t x1;
+    uint16_t y1;
+    uint16_t x2;
+    uint16_t y2;
+    uint32_t color;
+} drmlist_sprites_bin_t;
+
+typedef struct
+{
+    drmlist_anim_t anim;
+    uint32_t* color;
+    int32_t* ix;                // interpolated position of this frame
+    int32_t* iy;
+
+    /* Bins, rebuilt every frame */
+    uint32_t width;
+    uint32_t height;
+    uint32_t tiles_x;
+    uint32_t tiles_y;
+    uint32_t* bin_start;        // tiles_x * tiles_y + 1 offsets into bins
+    drmlist_sprites_bin_t* bins;    // 4 per sprite at most
+
+    /* Stats */
+    uint64_t frames;
+    uint64_t steps;
+    uint64_t step_ns;
+    uint64_t lerp_ns;
+    uint64_t bin_ns;
+    uint64_t draw_ns;
+    uint64_t bin_entries;
+} drmlist_sprites_t;
+
+int drmlist_sprites_init(drmlist_sprites_t* s, size_t count, uint32_t width, uint32_t height, uint32_t seed);
+int drmlist_sprites_resize(drmlist_sprites_t* s, uint32_t width, uint32_t height);
+void drmlist_sprites_step(drmlist_sprites_t* s, float dt);
+
+/*
+ * Draw at `alpha` between the last two steps. `clear` fills every tile with
+ * `bg` first, otherwise sprites go over what's in `fb`.
+ */
+void drmlist_sprites_draw(drmlist_sprites_t* s, mydrm_fb_t* fb, float alpha, bool clear, uint32_t bg);
+
+/* One sprite after the other over the whole frame, the reference for drmlist_sprites_draw() */
+void drmlist_sprites_draw_naive(drmlist_sprites_t* s, mydrm_fb_t* fb, float alpha, bool clear, uint32_t bg);
+
+void drmlist_sprites_print_stats(drmlist_sprites_t* s);
+void drmlist_sprites_cleanup(drmlist_sprites_t* s);
+
+#endif // _DRMLIST_SPRITES_H_
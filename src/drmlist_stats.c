@@ -0,0 +1,196 @@
+#include "drmlist_stats.h"
+#include <time.h>
+
+static uint64_t stats_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static inline void stats_write_begin(drmlist_stats_page_t* page)
+{
+    atomic_store_explicit(&page->seq, atomic_load_explicit(&page->seq, memory_order_relaxed) + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+}
+
+static inline void stats_write_end(drmlist_stats_page_t* page)
+{
+    atomic_store_explicit(&page->seq, atomic_load_explicit(&page->seq, memory_order_relaxed) + 1, memory_order_release);
+}
+
+static void stats_page_init(drmlist_stats_t* st, struct drm_mode_modeinfo* mode)
+{
+    st->page->version = DRMLIST_STATS_VERSION;
+    st->page->size = sizeof(drmlist_stats_page_t);
+    st->page->pid = getpid();
+    st->page->start_ns = st->page->update_ns = st->window_start_ns = stats_now_ns();
+    drmlist_stats_mode(st, mode);
+
+    /* Readers check the magic last */
+    atomic_thread_fence(memory_order_release);
+    st->page->magic = DRMLIST_STATS_MAGIC;
+}
+
+int drmlist_stats_init(drmlist_stats_t* st, const char* path, struct drm_mode_modeinfo* mode)
+{
+    int fd;
+
+    memset(st, 0, sizeof(drmlist_stats_t));
+
+    if (path)
+        snprintf(st->path, sizeof(st->path), "%s", path);
+    else
+        snprintf(st->path, sizeof(st->path), DRMLIST_STATS_DIR "/drmlist-%d.stats", getpid());
+
+    if ((fd = open(st->path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)) == -1)
+    {
+        char errmsg[PATH_MAX + 32];
+        snprintf(errmsg, sizeof(errmsg), "Failed to open %s", st->path);
+        perror(errmsg);
+        return -1;
+    }
+
+    if (ftruncate(fd, sizeof(drmlist_stats_page_t)) == -1)
+    {
+        perror("ftruncate stats");
+        close(fd);
+        unlink(st->path);
+        return -1;
+    }
+
+    st->page = mmap(NULL, sizeof(drmlist_stats_page_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (st->page == MAP_FAILED)
+    {
+        st->page = NULL;
+        perror("mmap stats");
+        unlink(st->path);
+        return -1;
+    }
+
+    st->shared = true;
+    stats_page_init(st, mode);
+    printf("Stats: %s\n", st->path);
+
+    return 0;
+}
+
+/*
+ * Same counters for drmlist itself (e.g. the HUD), without the shared file
+ */
+int drmlist_stats_init_private(drmlist_stats_t* st, struct drm_mode_modeinfo* mode)
+{
+    memset(st, 0, sizeof(drmlist_stats_t));
+
+    if ((st->page = calloc(1, sizeof(drmlist_stats_page_t))) == NULL)
+        return -ENOMEM;
+
+    stats_page_init(st, mode);
+
+    return 0;
+}
+
+void drmlist_stats_mode(drmlist_stats_t* st, struct drm_mode_modeinfo* mode)
+{
+    drmlist_stats_page_t* page = st->page;
+
+    if (!page)
+        return;
+
+    stats_write_begin(page);
+    page->width = mode->hdisplay;
+    page->height = mode->vdisplay;
+    page->refresh_mhz = (mode->clock && mode->htotal && mode->vtotal) ?
+                        (uint64_t)mode->clock * 1000000ull / ((uint64_t)mode->htotal * mode->vtotal) : mode->vrefresh * 1000;
+    stats_write_end(page);
+
+    /* The vblank counter keeps running, but don't count the modeset as missed */
+    st->last_sequence = 0;
+}
+
+void drmlist_stats_render(drmlist_stats_t* st, uint64_t ns)
+{
+    st->render_ns_last = ns;
+}
+
+void drmlist_stats_input(drmlist_stats_t* st)
+{
+    st->pending_inputs++;
+}
+
+/*
+ * On-demand rendering went idle, the next flip starts counting again
+ */
+void drmlist_stats_idle(drmlist_stats_t* st)
+{
+    st->last_sequence = 0;
+}
+
+/*
+ * Page flip completed, `sequence` is the vblank counter it completed on
+ */
+void drmlist_stats_flip(drmlist_stats_t* st, uint32_t sequence)
+{
+    drmlist_stats_page_t* page = st->page;
+    uint64_t now, elapsed;
+
+    if (!page)
+        return;
+
+    now = stats_now_ns();
+    elapsed = now - st->window_start_ns;
+    st->window_frames++;
+    st->window_inputs += st->pending_inputs;
+
+    stats_write_begin(page);
+
+    page->update_ns = now;
+    page->frames++;
+    if (st->last_sequence && sequence - st->last_sequence > 1)
+        page->missed_vblanks += sequence - st->last_sequence - 1;
+
+    if (st->render_ns_last)
+    {
+        page->render_ns_last = st->render_ns_last;
+        page->render_ns_avg = page->render_ns_avg ?
+                              page->render_ns_avg - page->render_ns_avg / 16 + st->render_ns_last / 16 : st->render_ns_last;
+        if (st->render_ns_last > page->render_ns_max)
+            page->render_ns_max = st->render_ns_last;
+    }
+
+    page->input_events += st->pending_inputs;
+
+    if (elapsed >= 1000000000ull)
+    {
+        page->fps_milli = st->window_frames * 1000000000000ull / elapsed;
+        page->input_rate_milli = st->window_inputs * 1000000000000ull / elapsed;
+        st->window_start_ns = now;
+        st->window_frames = 0;
+        st->window_inputs = 0;
+    }
+
+    stats_write_end(page);
+
+    st->last_sequence = sequence;
+    st->pending_inputs = 0;
+    st->render_ns_last = 0;
+}
+
+void drmlist_stats_cleanup(drmlist_stats_t* st)
+{
+    if (!st->page)
+        return;
+
+    if (!st->shared)
+    {
+        free(st->page);
+        st->page = NULL;
+        return;
+    }
+
+    munmap(st->page, sizeof(drmlist_stats_page_t));
+    st->page = NULL;
+    unlink(st->path);
+}
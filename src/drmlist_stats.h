@@ -0,0 +1,91 @@
+#ifndef _DRMLIST_STATS_H_
+#define _DRMLIST_STATS_H_
+
+#include "mydrm/mydrm.h"
+#include <stdatomic.h>
+
+/*
+ * Live stats page
+ *
+ * drmlist publishes its counters in a shared-memory file (by default
+ * /dev/shm/drmlist-<pid>.stats), rewritten once per frame from the page flip
+ * handler. Readers map it read-only and poll, no IPC with drmlist.
+ *
+ * The payload is protected by a seqlock: `seq` is odd while drmlist writes.
+ * Readers copy the page and retry if `seq` was odd or changed meanwhile:
+ *
+ *   do {
+ *       s1 = atomic_load_explicit(&page->seq, memory_order_acquire);
+ *       memcpy(&copy, page, sizeof(copy));
+ *       atomic_thread_fence(memory_order_acquire);
+ *       s2 = atomic_load_explicit(&page->seq, memory_order_relaxed);
+ *   } while ((s1 & 1) || s1 != s2);
+ *
+ * New fields go at the end with a version bump, `size` tells readers how much
+ * of the page the writer knows about.
+ */
+
+#define DRMLIST_STATS_MAGIC     0x54534C44  // "DLST"
+#define DRMLIST_STATS_VERSION   1
+#define DRMLIST_STATS_DIR       "/dev/shm"
+
+typedef struct
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t size;                  // sizeof(drmlist_stats_page_t) of the writer
+    int32_t pid;
+    _Atomic uint32_t seq;
+    uint32_t pad;
+
+    uint64_t start_ns;              // CLOCK_MONOTONIC
+    uint64_t update_ns;
+
+    /* Mode */
+    uint32_t width;
+    uint32_t height;
+    uint32_t refresh_mhz;
+    uint32_t pad1;
+
+    /* Frames */
+    uint64_t frames;                // completed page flips
+    uint64_t missed_vblanks;        // vblanks between two flips beyond the first
+    uint32_t fps_milli;             // over the last second
+    uint32_t pad2;
+
+    /* Render time, from the start of drawing to the flip ioctl returning */
+    uint64_t render_ns_last;
+    uint64_t render_ns_avg;         // exponential moving average, 1/16
+    uint64_t render_ns_max;
+
+    /* Input */
+    uint64_t input_events;          // mouse packets
+    uint32_t input_rate_milli;      // events per second over the last second
+    uint32_t pad3;
+} drmlist_stats_page_t;
+
+typedef struct
+{
+    drmlist_stats_page_t* page;
+    char path[PATH_MAX];
+    bool shared;                // false: private page, nothing published
+
+    /* Writer side only */
+    uint32_t last_sequence;
+    uint64_t window_start_ns;
+    uint64_t window_frames;
+    uint64_t window_inputs;
+    uint64_t pending_inputs;
+    uint64_t render_ns_last;
+} drmlist_stats_t;
+
+int drmlist_stats_init(drmlist_stats_t* st, const char* path, struct drm_mode_modeinfo* mode);
+int drmlist_stats_init_private(drmlist_stats_t* st, struct drm_mode_modeinfo* mode);
+void drmlist_stats_mode(drmlist_stats_t* st, struct drm_mode_modeinfo* mode);
+void drmlist_stats_render(drmlist_stats_t* st, uint64_t ns);
+void drmlist_stats_input(drmlist_stats_t* st);
+void drmlist_stats_flip(drmlist_stats_t* st, uint32_t sequence);
+void drmlist_stats_idle(drmlist_stats_t* st);      // no flips on purpose, the gap isn't missed vblanks
+void drmlist_stats_cleanup(drmlist_stats_t* st);
+
+#endif // _DRMLIST_STATS_H_
@@ -0,0 +1,342 @@
+#include "drmlist_text.h"
+#include "drmlist_kernels.h"
+#include <immintrin.h>
+
+/* 5x7, bit 4 is the leftmost pixel */
+static const uint8_t drmlist_font[DRMLIST_TEXT_GLYPHS][DRMLIST_TEXT_FONT_H] = {
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },  // space
+    { 0x04, 0x04, 0x04, 0x04, 0x04, 0x00, 0x04 },  // !
+    { 0x0a, 0x0a, 0x0a, 0x00, 0x00, 0x00, 0x00 },  // "
+    { 0x0a, 0x0a, 0x1f, 0x0a, 0x1f, 0x0a, 0x0a },  // #
+    { 0x04, 0x0f, 0x14, 0x0e, 0x05, 0x1e, 0x04 },  // $
+    { 0x18, 0x19, 0x02, 0x04, 0x08, 0x13, 0x03 },  // %
+    { 0x0c, 0x12, 0x14, 0x08, 0x15, 0x12, 0x0d },  // &
+    { 0x04, 0x04, 0x08, 0x00, 0x00, 0x00, 0x00 },  // '
+    { 0x02, 0x04, 0x08, 0x08, 0x08, 0x04, 0x02 },  // (
+    { 0x08, 0x04, 0x02, 0x02, 0x02, 0x04, 0x08 },  // )
+    { 0x00, 0x04, 0x15, 0x0e, 0x15, 0x04, 0x00 },  // *
+    { 0x00, 0x04, 0x04, 0x1f, 0x04, 0x04, 0x00 },  // +
+    { 0x00, 0x00, 0x00, 0x00, 0x0c, 0x04, 0x08 },  // ,
+    { 0x00, 0x00, 0x00, 0x1f, 0x00, 0x00, 0x00 },  // -
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x0c, 0x0c },  // .
+    { 0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x00 },  // /
+    { 0x0e, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0e },  // 0
+    { 0x04, 0x0c, 0x04, 0x04, 0x04, 0x04, 0x0e },  // 1
+    { 0x0e, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1f },  // 2
+    { 0x1f, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0e },  // 3
+    { 0x02, 0x06, 0x0a, 0x12, 0x1f, 0x02, 0x02 },  // 4
+    { 0x1f, 0x10, 0x1e, 0x01, 0x01, 0x11, 0x0e },  // 5
+    { 0x06, 0x08, 0x10, 0x1e, 0x11, 0x11, 0x0e },  // 6
+    { 0x1f, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08 },  // 7
+    { 0x0e, 0x11, 0x11, 0x0e, 0x11, 0x11, 0x0e },  // 8
+    { 0x0e, 0x11, 0x11, 0x0f, 0x01, 0x02, 0x0c },  // 9
+    { 0x00, 0x0c, 0x0c, 0x00, 0x0c, 0x0c, 0x00 },  // :
+    { 0x00, 0x0c, 0x0c, 0x00, 0x0c, 0x04, 0x08 },  // ;
+    { 0x02, 0x04, 0x08, 0x10, 0x08, 0x04, 0x02 },  // <
+    { 0x00, 0x00, 0x1f, 0x00, 0x1f, 0x00, 0x00 },  // =
+    { 0x08, 0x04, 0x02, 0x01, 0x02, 0x04, 0x08 },  // >
+    { 0x0e, 0x11, 0x01, 0x02, 0x04, 0x00, 0x04 },  // ?
+    { 0x0e, 0x11, 0x01, 0x0d, 0x15, 0x15, 0x0e },  // @
+    { 0x0e, 0x11, 0x11, 0x1f, 0x11, 0x11, 0x11 },  // A
+    { 0x1e, 0x11, 0x11, 0x1e, 0x11, 0x11, 0x1e },  // B
+    { 0x0e, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0e },  // C
+    { 0x1c, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1c },  // D
+    { 0x1f, 0x10, 0x10, 0x1e, 0x10, 0x10, 0x1f },  // E
+    { 0x1f, 0x10, 0x10, 0x1e, 0x10, 0x10, 0x10 },  // F
+    { 0x0e, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0f },  // G
+    { 0x11, 0x11, 0x11, 0x1f, 0x11, 0x11, 0x11 },  // H
+    { 0x0e, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0e },  // I
+    { 0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0c },  // J
+    { 0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11 },  // K
+    { 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1f },  // L
+    { 0x11, 0x1b, 0x15, 0x15, 0x11, 0x11, 0x11 },  // M
+    { 0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11 },  // N
+    { 0x0e, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0e },  // O
+    { 0x1e, 0x11, 0x11, 0x1e, 0x10, 0x10, 0x10 },  // P
+    { 0x0e, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0d },  // Q
+    { 0x1e, 0x11, 0x11, 0x1e, 0x14, 0x12, 0x11 },  // R
+    { 0x0f, 0x10, 0x10, 0x0e, 0x01, 0x01, 0x1e },  // S
+    { 0x1f, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04 },  // T
+    { 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0e },  // U
+    { 0x11, 0x11, 0x11, 0x11, 0x11, 0x0a, 0x04 },  // V
+    { 0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0a },  // W
+    { 0x11, 0x11, 0x0a, 0x04, 0x0a, 0x11, 0x11 },  // X
+    { 0x11, 0x11, 0x11, 0x0a, 0x04, 0x04, 0x04 },  // Y
+    { 0x1f, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1f },  // Z
+    { 0x0e, 0x08, 0x08, 0x08, 0x08, 0x08, 0x0e },  // [
+    { 0x00, 0x10, 0x08, 0x04, 0x02, 0x01, 0x00 },  // backslash
+    { 0x0e, 0x02, 0x02, 0x02, 0x02, 0x02, 0x0e },  // ]
+    { 0x04, 0x0a, 0x11, 0x00, 0x00, 0x00, 0x00 },  // ^
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1f },  // _
+};
+
+int drmlist_text_init(drmlist_text_t* text, uint32_t scale)
+{
+    memset(text, 0, sizeof(drmlist_text_t));
+
+    if (scale < 1)
+        scale = 1;
+    else if (scale > DRMLIST_TEXT_MAX_SCALE)
+        scale = DRMLIST_TEXT_MAX_SCALE;
+
+    text->scale = scale;
+    text->cell_w = DRMLIST_TEXT_CELL_W * scale;
+    text->cell_h = DRMLIST_TEXT_CELL_H * scale;
+
+    /* Bake: scale every font bit to a scale x scale block */
+    for (int g = 0; g < DRMLIST_TEXT_GLYPHS; g++)
+    {
+        for (int row = 0; row < DRMLIST_TEXT_FONT_H; row++)
+        {
+            uint32_t bits = 0;
+
+            for (int col = 0; col < DRMLIST_TEXT_FONT_W; col++)
+                if (drmlist_font[g][row] & (0x10 >> col))
+                    bits |= (0xFFFFFFFFu << (32 - scale)) >> (col * scale);
+
+            for (uint32_t s = 0; s < scale; s++)
+                text->atlas[g][row * scale + s] = bits;
+        }
+    }
+
+    return 0;
+}
+
+static inline int drmlist_text_glyph(char c)
+{
+    if (c >= 'a' && c <= 'z')
+        c -= 'a' - 'A';
+
+    if (c < DRMLIST_TEXT_FIRST || c >= DRMLIST_TEXT_FIRST + DRMLIST_TEXT_GLYPHS)
+        c = '?';
+
+    return c - DRMLIST_TEXT_FIRST;
+}
+
+void drmlist_text_measure(drmlist_text_t* text, const char* str, uint32_t* width, uint32_t* height)
+{
+    uint32_t cols = 0, max_cols = 0, lines = 1;
+
+    for (; *str; str++)
+    {
+        if (*str == '\n')
+        {
+            lines++;
+            cols = 0;
+            continue;
+        }
+        if (++cols > max_cols)
+            max_cols = cols;
+    }
+
+    *width = max_cols * text->cell_w;
+    *height = lines * text->cell_h;
+}
+
+/*
+ * Expand one 32-pixel mask row into dst[0..n), bit 31 first. Pixels of bg are
+ * skipped when `opaque` is false. n <= 32.
+ */
+DRMLIST_TARGET_AVX2 static void drmlist_text_expand_avx2(uint32_t* dst, uint32_t mask, int n, uint32_t fg_color,
+                                                         uint32_t bg_color, bool opaque)
+{
+    const __m256i fg = _mm256_set1_epi32(fg_color);
+    const __m256i bg = _mm256_set1_epi32(bg_color);
+    const __m256i bits = _mm256_setr_epi32(0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01);
+    const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+
+    for (int i = 0; i < n; i += 8)
+    {
+        __m256i byte = _mm256_set1_epi32((mask >> (24 - i)) & 0xFF);
+        __m256i set = _mm256_cmpeq_epi32(_mm256_and_si256(byte, bits), bits);
+        __m256i in = _mm256_cmpgt_epi32(_mm256_set1_epi32(n - i), lanes);
+
+        if (opaque)
+            _mm256_maskstore_epi32((int*)&dst[i], in, _mm256_blendv_epi8(bg, fg, set));
+        else
+            _mm256_maskstore_epi32((int*)&dst[i], _mm256_and_si256(in, set), fg);
+    }
+}
+
+static void drmlist_text_expand(uint32_t* dst, uint32_t mask, int n, uint32_t fg, uint32_t bg, bool opaque)
+{
+    if (drmlist_cpu_level >= DRMLIST_CPU_AVX2)
+    {
+        drmlist_text_expand_avx2(dst, mask, n, fg, bg, opaque);
+        return;
+    }
+
+    for (int i = 0; i < n; i++, mask <<= 1)
+    {
+        if (mask & 0x80000000)
+            dst[i] = fg;
+        else if (opaque)
+            dst[i] = bg;
+    }
+}
+
+/*
+ * Draw into any 32-bit surface, `stride` in bytes, clipped to [x1,x2) x [y1,y2)
+ */
+static void drmlist_text_render(drmlist_text_t* text, uint8_t* pixels, uint32_t stride, int x1, int y1, int x2, int y2,
+                                int x, int y, const char* str, uint32_t fg, uint32_t bg)
+{
+    bool opaque = (bg >> 24) != 0;
+    int pen_x = x;
+
+    for (; *str; str++)
+    {
+        const uint32_t* glyph;
+        int skip, n, row0, row1;
+
+        if (*str == '\n')
+        {
+            pen_x = x;
+            y += text->cell_h;
+            continue;
+        }
+
+        glyph = text->atlas[drmlist_text_glyph(*str)];
+
+        /* Horizontal clip: shift the mask instead of branching per pixel */
+        skip = pen_x < x1 ? x1 - pen_x : 0;
+        n = (int)text->cell_w - skip;
+        if (pen_x + skip + n > x2)
+            n = x2 - pen_x - skip;
+
+        row0 = y < y1 ? y1 - y : 0;
+        row1 = y + (int)text->cell_h > y2 ? y2 - y : (int)text->cell_h;
+
+        for (int row = row0; n > 0 && row < row1; row++)
+        {
+            uint32_t* dst = (uint32_t*)(pixels + (size_t)(y + row) * stride) + pen_x + skip;
+            drmlist_text_expand(dst, glyph[row] << skip, n, fg, bg, opaque);
+        }
+
+        pen_x += text->cell_w;
+    }
+}
+
+static void drmlist_text_clip(mydrm_fb_t* fb, const struct drm_clip_rect* clip, int* x1, int* y1, int* x2, int* y2)
+{
+    *x1 = 0;
+    *y1 = 0;
+    *x2 = fb->width;
+    *y2 = fb->height;
+
+    if (clip)
+    {
+        if (clip->x1 > *x1) *x1 = clip->x1;
+        if (clip->y1 > *y1) *y1 = clip->y1;
+        if (clip->x2 < *x2) *x2 = clip->x2;
+        if (clip->y2 < *y2) *y2 = clip->y2;
+    }
+}
+
+void drmlist_text_draw(drmlist_text_t* text, mydrm_fb_t* fb, const struct drm_clip_rect* clip, int x, int y,
+                       const char* str, uint32_t fg, uint32_t bg)
+{
+    int x1, y1, x2, y2;
+
+    drmlist_text_clip(fb, clip, &x1, &y1, &x2, &y2);
+    drmlist_text_render(text, fb->pixels, fb->stride, x1, y1, x2, y2, x, y, str, fg, bg);
+}
+
+static drmlist_text_entry_t* drmlist_text_lookup(drmlist_text_t* text, const char* str, uint32_t fg, uint32_t bg)
+{
+    drmlist_text_entry_t* lru = &text->cache[0];
+    drmlist_text_entry_t* e;
+    uint32_t width, height;
+
+    for (int i = 0; i < DRMLIST_TEXT_CACHE; i++)
+    {
+        e = &text->cache[i];
+
+        if (e->pixels && e->fg == fg && e->bg == bg && !strcmp(e->text, str))
+        {
+            e->last_used = ++text->tick;
+            text->hits++;
+            return e;
+        }
+
+        if (!e->pixels || (lru->pixels && e->last_used < lru->last_used))
+            lru = e;
+    }
+
+    /* Miss: render into the least recently used entry */
+    e = lru;
+    drmlist_text_measure(text, str, &width, &height);
+
+    if (!e->pixels || e->width * e->height < width * height)
+    {
+        free(e->pixels);
+        if ((e->pixels = malloc((size_t)width * height * 4)) == NULL)
+        {
+            memset(e, 0, sizeof(drmlist_text_entry_t));
+            return NULL;
+        }
+    }
+
+    e->width = width;
+    e->height = height;
+    e->fg = fg;
+    e->bg = bg;
+    e->last_used = ++text->tick;
+    snprintf(e->text, sizeof(e->text), "%s", str);
+    text->misses++;
+
+    /* Transparent parts stay 0 and are skipped when copying */
+    memset(e->pixels, 0, (size_t)width * height * 4);
+    drmlist_text_render(text, (uint8_t*)e->pixels, width * 4, 0, 0, width, height, 0, 0, str, fg, bg);
+
+    return e;
+}
+
+void drmlist_text_draw_cached(drmlist_text_t* text, mydrm_fb_t* fb, const struct drm_clip_rect* clip, int x, int y,
+                              const char* str, uint32_t fg, uint32_t bg)
+{
+    drmlist_text_entry_t* e;
+    int x1, y1, x2, y2;
+    int sx, sy, w, h;
+
+    /* Too long to key the cache on */
+    if (strlen(str) >= DRMLIST_TEXT_MAX_LEN || (e = drmlist_text_lookup(text, str, fg, bg)) == NULL)
+    {
+        drmlist_text_draw(text, fb, clip, x, y, str, fg, bg);
+        return;
+    }
+
+    drmlist_text_clip(fb, clip, &x1, &y1, &x2, &y2);
+
+    sx = x < x1 ? x1 - x : 0;
+    sy = y < y1 ? y1 - y : 0;
+    w = (x + (int)e->width > x2 ? x2 - x : (int)e->width) - sx;
+    h = (y + (int)e->height > y2 ? y2 - y : (int)e->height) - sy;
+
+    if (w <= 0 || h <= 0)
+        return;
+
+    /* Transparent background: copy the set pixels only */
+    if ((bg >> 24) == 0)
+    {
+        drmlist_kernels.keyed(fb->pixels + (size_t)(y + sy) * fb->stride + (size_t)(x + sx) * 4, fb->stride,
+                              e->pixels + (size_t)sy * e->width + sx, e->width * 4, w, h);
+        return;
+    }
+
+    for (int row = 0; row < h; row++)
+    {
+        uint32_t* src = e->pixels + (size_t)(sy + row) * e->width + sx;
+        uint32_t* dst = (uint32_t*)(fb->pixels + (size_t)(y + sy + row) * fb->stride) + x + sx;
+
+        memcpy(dst, src, w * 4);
+    }
+}
+
+void drmlist_text_cleanup(drmlist_text_t* text)
+{
+    for (int i = 0; i < DRMLIST_TEXT_CACHE; i++)
+        free(text->cache[i].pixels);
+
+    memset(text->cache, 0, sizeof(text->cache));
+}
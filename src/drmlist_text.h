@@ -0,0 +1,63 @@
+#ifndef _DRMLIST_TEXT_H_
+#define _DRMLIST_TEXT_H_
+
+#include "mydrm/mydrm.h"
+
+/*
+ * Bitmap text
+ *
+ * The built-in 5x7 font (ASCII 32-95, lowercase is drawn as uppercase) is baked
+ * into a 1-bpp glyph atlas at the chosen scale on init. Drawing expands the
+ * glyph rows to 32-bit pixels with AVX2, eight pixels per step, and writes
+ * them into the framebuffer respecting its stride and a clip rectangle. A
+ * background with alpha 0 leaves the pixels under it untouched.
+ *
+ * drmlist_text_draw_cached() renders a string once into a small cache and
+ * only copies rows on later frames while the string and colors stay the same.
+ */
+
+#define DRMLIST_TEXT_FIRST 32
+#define DRMLIST_TEXT_GLYPHS 64
+#define DRMLIST_TEXT_FONT_W 5
+#define DRMLIST_TEXT_FONT_H 7
+#define DRMLIST_TEXT_CELL_W 6           // one column of spacing
+#define DRMLIST_TEXT_CELL_H 9           // two rows of line spacing
+#define DRMLIST_TEXT_MAX_SCALE 5        // a scaled cell row must fit 32 bits
+#define DRMLIST_TEXT_CACHE 8
+#define DRMLIST_TEXT_MAX_LEN 128
+
+typedef struct
+{
+    uint32_t* pixels;
+    uint32_t width;
+    uint32_t height;
+    uint32_t fg;
+    uint32_t bg;
+    uint64_t last_used;
+    char text[DRMLIST_TEXT_MAX_LEN];
+} drmlist_text_entry_t;
+
+typedef struct
+{
+    uint32_t scale;
+    uint32_t cell_w;
+    uint32_t cell_h;
+
+    /* Glyph rows at `scale`, bit 31 is the leftmost pixel */
+    uint32_t atlas[DRMLIST_TEXT_GLYPHS][DRMLIST_TEXT_CELL_H * DRMLIST_TEXT_MAX_SCALE];
+
+    drmlist_text_entry_t cache[DRMLIST_TEXT_CACHE];
+    uint64_t tick;
+    uint64_t hits;
+    uint64_t misses;
+} drmlist_text_t;
+
+int drmlist_text_init(drmlist_text_t* text, uint32_t scale);
+void drmlist_text_measure(drmlist_text_t* text, const char* str, uint32_t* width, uint32_t* height);
+void drmlist_text_draw(drmlist_text_t* text, mydrm_fb_t* fb, const struct drm_clip_rect* clip, int x, int y,
+                       const char* str, uint32_t fg, uint32_t bg);
+void drmlist_text_draw_cached(drmlist_text_t* text, mydrm_fb_t* fb, const struct drm_clip_rect* clip, int x, int y,
+                              const char* str, uint32_t fg, uint32_t bg);
+void drmlist_text_cleanup(drmlist_text_t* text);
+
+#endif // _DRMLIST_TEXT_H_
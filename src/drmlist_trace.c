@@ -0,0 +1,223 @@
+#define _GNU_SOURCE
+#include "drmlist_trace.h"
+#include <pthread.h>
+
+bool drmlist_trace_enabled = false;
+
+static _Atomic(drmlist_trace_ring_t*) rings[DRMLIST_TRACE_MAX_THREADS];
+static _Atomic uint32_t n_rings = 0;
+static _Thread_local drmlist_trace_ring_t* thread_ring = NULL;
+static _Thread_local bool thread_no_ring = false;
+
+static FILE* trace_file = NULL;
+static pthread_t flusher;
+static _Atomic bool flusher_running = false;
+static bool first_event = true;
+static uint64_t written = 0;
+static int pid = 0;
+
+/*
+ * First event of a thread, the only allocation on the recording side
+ */
+static drmlist_trace_ring_t* drmlist_trace_register(void)
+{
+    uint32_t idx;
+    drmlist_trace_ring_t* ring;
+
+    if (thread_no_ring)
+        return NULL;
+
+    if ((idx = atomic_fetch_add(&n_rings, 1)) >= DRMLIST_TRACE_MAX_THREADS ||
+        (ring = calloc(1, sizeof(drmlist_trace_ring_t))) == NULL)
+    {
+        thread_no_ring = true;
+        return NULL;
+    }
+
+    ring->tid = gettid();
+    pthread_getname_np(pthread_self(), ring->name, sizeof(ring->name));
+    atomic_store_explicit(&rings[idx], ring, memory_order_release);
+
+    return thread_ring = ring;
+}
+
+void drmlist_trace_record(const char* name, uint64_t start_ns, uint64_t end_ns)
+{
+    drmlist_trace_ring_t* ring = thread_ring;
+    uint32_t tail;
+
+    if (!ring && (ring = drmlist_trace_register()) == NULL)
+        return;
+
+    tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    if (tail - atomic_load_explicit(&ring->head, memory_order_acquire) == DRMLIST_TRACE_RING_SIZE)
+    {
+        atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+        return;
+    }
+
+    ring->events[tail & (DRMLIST_TRACE_RING_SIZE - 1)] = (drmlist_trace_event_t){ name, start_ns, end_ns };
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+}
+
+void drmlist_trace_thread_name(const char* name)
+{
+    pthread_setname_np(pthread_self(), name);
+
+    if (thread_ring)
+        snprintf(thread_ring->name, sizeof(thread_ring->name), "%s", name);
+}
+
+static void drmlist_trace_write(const char* event)
+{
+    fputs(first_event ? "\n" : ",\n", trace_file);
+    fputs(event, trace_file);
+    first_event = false;
+}
+
+static void drmlist_trace_drain(void)
+{
+    uint32_t n = atomic_load(&n_rings);
+    char buf[256];
+
+    if (n > DRMLIST_TRACE_MAX_THREADS)
+        n = DRMLIST_TRACE_MAX_THREADS;
+
+    for (uint32_t i = 0; i < n; i++)
+    {
+        drmlist_trace_ring_t* ring = atomic_load_explicit(&rings[i], memory_order_acquire);
+        uint32_t head, tail;
+
+        /* Slot taken, ring not published yet */
+        if (!ring)
+            continue;
+
+        head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+        tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+
+        for (; head != tail; head++)
+        {
+            drmlist_trace_event_t* e = &ring->events[head & (DRMLIST_TRACE_RING_SIZE - 1)];
+
+            if (e->end_ns == e->start_ns)
+                snprintf(buf, sizeof(buf), "{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,\"pid\":%d,\"tid\":%d}",
+                                e->name, e->start_ns / 1e3, pid, ring->tid);
+            else
+                snprintf(buf, sizeof(buf), "{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%d}",
+                                e->name, e->start_ns / 1e3, (e->end_ns - e->start_ns) / 1e3, pid, ring->tid);
+
+            drmlist_trace_write(buf);
+            written++;
+        }
+
+        atomic_store_explicit(&ring->head, head, memory_order_release);
+    }
+}
+
+static void* drmlist_trace_flusher(void* arg)
+{
+    struct timespec delay = { 0, DRMLIST_TRACE_FLUSH_MS * 1000000l };
+
+    /* Tracing the flusher would feed itself */
+    thread_no_ring = true;
+
+    while (atomic_load(&flusher_running))
+    {
+        drmlist_trace_drain();
+        nanosleep(&delay, NULL);
+    }
+
+    drmlist_trace_drain();
+
+    return NULL;
+}
+
+int drmlist_trace_init(const char* path)
+{
+    int ret;
+
+    if ((trace_file = fopen(path, "w")) == NULL)
+    {
+        char errmsg[PATH_MAX];
+        snprintf(errmsg, PATH_MAX, "Failed to open %s", path);
+        perror(errmsg);
+        return -1;
+    }
+
+    pid = getpid();
+    fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", trace_file);
+
+    atomic_store(&flusher_running, true);
+    if ((ret = pthread_create(&flusher, NULL, drmlist_trace_flusher, NULL)))
+    {
+        errno = ret;
+        perror("pthread_create trace flusher");
+        atomic_store(&flusher_running, false);
+        fclose(trace_file);
+        trace_file = NULL;
+        return -1;
+    }
+    pthread_setname_np(flusher, "drmlist-trace");
+
+    drmlist_trace_enabled = true;
+    printf("Tracing to %s\n", path);
+
+    return 0;
+}
+
+static uint64_t drmlist_trace_dropped(void)
+{
+    uint64_t dropped = 0;
+    uint32_t n = atomic_load(&n_rings);
+
+    for (uint32_t i = 0; i < n && i < DRMLIST_TRACE_MAX_THREADS; i++)
+    {
+        drmlist_trace_ring_t* ring = atomic_load(&rings[i]);
+
+        if (ring)
+            dropped += atomic_load(&ring->dropped);
+    }
+
+    return dropped;
+}
+
+void drmlist_trace_print_stats(void)
+{
+    if (trace_file)
+        printf("Trace: %lu events written, %lu dropped, %u threads\n", written, drmlist_trace_dropped(), atomic_load(&n_rings));
+}
+
+void drmlist_trace_cleanup(void)
+{
+    char buf[128];
+
+    if (!trace_file)
+        return;
+
+    drmlist_trace_enabled = false;
+    atomic_store(&flusher_running, false);
+    pthread_join(flusher, NULL);
+
+    /* Thread names as metadata events */
+    for (uint32_t i = 0; i < atomic_load(&n_rings) && i < DRMLIST_TRACE_MAX_THREADS; i++)
+    {
+        drmlist_trace_ring_t* ring = atomic_load(&rings[i]);
+
+        if (!ring)
+            continue;
+
+        snprintf(buf, sizeof(buf), "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                        pid, ring->tid, ring->name);
+        drmlist_trace_write(buf);
+    }
+
+    fputs("\n]}\n", trace_file);
+    drmlist_trace_print_stats();
+    fclose(trace_file);
+    trace_file = NULL;
+
+    thread_ring = NULL;
+    for (uint32_t i = 0; i < DRMLIST_TRACE_MAX_THREADS; i++)
+        free(atomic_exchange(&rings[i], NULL));
+    atomic_store(&n_rings, 0);
+}
@@ -0,0 +1,101 @@
+#ifndef _DRMLIST_TRACE_H_
+#define _DRMLIST_TRACE_H_
+
+#include "mydrm/mydrm.h"
+#include <stdatomic.h>
+#include <time.h>
+
+/*
+ * Frame phase tracing, Chrome trace-event JSON (opens in chrome://tracing and
+ * ui.perfetto.dev)
+ *
+ * Every thread records into its own single-producer ring, a background thread
+ * drains the rings and writes the file. Full rings drop events (counted), the
+ * recording thread never blocks. Names must be string literals, only the
+ * pointer is stored.
+ *
+ *   {
+ *       DRMLIST_TRACE_SCOPE("clear");
+ *       memset(...);
+ *   }   // event ends here
+ */
+
+#define DRMLIST_TRACE_MAX_THREADS 8
+#define DRMLIST_TRACE_RING_SIZE 8192        // events per thread, power of two
+#define DRMLIST_TRACE_FLUSH_MS 20
+
+typedef struct
+{
+    const char* name;
+    uint64_t start_ns;
+    uint64_t end_ns;        // == start_ns for instant events
+} drmlist_trace_event_t;
+
+typedef struct
+{
+    _Atomic uint32_t head;  // written by the flusher
+    uint8_t pad0[60];
+    _Atomic uint32_t tail;  // written by the owning thread
+    uint8_t pad1[60];
+    _Atomic uint64_t dropped;
+    int tid;
+    char name[16];
+    drmlist_trace_event_t events[DRMLIST_TRACE_RING_SIZE];
+} drmlist_trace_ring_t;
+
+typedef struct
+{
+    const char* name;
+    uint64_t start_ns;      // 0 when tracing is off
+} drmlist_trace_scope_t;
+
+extern bool drmlist_trace_enabled;
+
+static inline uint64_t drmlist_trace_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+void drmlist_trace_record(const char* name, uint64_t start_ns, uint64_t end_ns);
+
+static inline drmlist_trace_scope_t drmlist_trace_begin(const char* name)
+{
+    drmlist_trace_scope_t scope = { name, 0 };
+
+    if (drmlist_trace_enabled)
+        scope.start_ns = drmlist_trace_now();
+
+    return scope;
+}
+
+static inline void drmlist_trace_end(drmlist_trace_scope_t* scope)
+{
+    if (scope->start_ns)
+        drmlist_trace_record(scope->name, scope->start_ns, drmlist_trace_now());
+}
+
+static inline void drmlist_trace_instant(const char* name)
+{
+    if (drmlist_trace_enabled)
+    {
+        uint64_t now = drmlist_trace_now();
+        drmlist_trace_record(name, now, now);
+    }
+}
+
+#define DRMLIST_TRACE_CONCAT_(a, b) a##b
+#define DRMLIST_TRACE_CONCAT(a, b) DRMLIST_TRACE_CONCAT_(a, b)
+
+/* Ends when the enclosing block is left */
+#define DRMLIST_TRACE_SCOPE(name) \
+    drmlist_trace_scope_t DRMLIST_TRACE_CONCAT(trace_scope_, __LINE__) \
+        __attribute__((cleanup(drmlist_trace_end))) = drmlist_trace_begin(name)
+
+int drmlist_trace_init(const char* path);
+void drmlist_trace_thread_name(const char* name);
+void drmlist_trace_print_stats(void);
+void drmlist_trace_cleanup(void);
+
+#endif // _DRMLIST_TRACE_H_
@@ -0,0 +1,181 @@
+#include "drmlist_vrr.h"
+#include <immintrin.h>
+
+static inline double vrr_stddev(double sum, double sum_sq, uint64_t n)
+{
+    double mean = sum / n;
+    double var = sum_sq / n - mean * mean;
+
+    return var > 0.0 ? _mm_cvtsd_f64(_mm_sqrt_sd(_mm_setzero_pd(), _mm_set_sd(var))) : 0.0;
+}
+
+/*
+ * Presents per frame so the repeats stay under the panel's slowest refresh
+ * without going over its fastest. Ranges narrower than 2:1 can't fit repeats.
+ */
+static uint32_t vrr_lfc_mult(drmlist_vrr_t* v)
+{
+    uint64_t limit = v->max_ns * DRMLIST_VRR_LFC_MARGIN_PERCENT / 100;
+    uint32_t m;
+
+    if (!v->enabled || v->frame_ns_avg <= limit)
+        return 1;
+
+    m = (v->frame_ns_avg + limit - 1) / limit;
+    if (m > DRMLIST_VRR_MAX_LFC || v->frame_ns_avg / m < v->min_ns)
+        return 1;
+
+    return m;
+}
+
+void drmlist_vrr_init(drmlist_vrr_t* v, uint32_t min_hz, uint32_t max_hz, uint64_t refresh_ns)
+{
+    memset(v, 0, sizeof(drmlist_vrr_t));
+    v->min_hz = min_hz ? min_hz : DRMLIST_VRR_DEFAULT_MIN_HZ;
+    v->max_hz = max_hz;
+
+    drmlist_vrr_set_mode(v, refresh_ns);
+}
+
+/*
+ * The mode's refresh is the fastest the panel can go, whatever its range says
+ */
+void drmlist_vrr_set_mode(drmlist_vrr_t* v, uint64_t refresh_ns)
+{
+    v->refresh_ns = refresh_ns;
+    v->min_ns = v->max_hz ? 1000000000ull / v->max_hz : refresh_ns;
+    if (v->min_ns < refresh_ns)
+        v->min_ns = refresh_ns;
+    v->max_ns = 1000000000ull / v->min_hz;
+    if (v->max_ns < v->min_ns)
+        v->max_ns = v->min_ns;
+
+    v->frame_ns_avg = 0;
+    v->lfc_mult = 1;
+    v->frame_start_ns = 0;
+    v->last_present_ns = 0;
+    v->ready_ns = 0;
+    v->fixed_ns = 0;
+}
+
+/*
+ * Display range limits descriptor (tag 0xFD) in one of the four 18 byte
+ * descriptors of the base block. EDID 1.4 flags rates over 255 Hz in byte 4.
+ */
+bool drmlist_vrr_parse_edid(const uint8_t* edid, uint32_t len, uint32_t* min_hz, uint32_t* max_hz)
+{
+    static const uint8_t header[8] = { 0x00, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x00 };
+
+    if (len < 128 || memcmp(edid, header, sizeof(header)))
+        return false;
+
+    for (uint32_t off = 54; off <= 108; off += 18)
+    {
+        const uint8_t* d = edid + off;
+
+        if (d[0] || d[1] || d[2] || d[3] != 0xfd)
+            continue;
+
+        *min_hz = d[5] + ((d[4] & 0x01) ? 255 : 0);
+        *max_hz = d[6] + ((d[4] & 0x02) ? 255 : 0);
+
+        return *min_hz && *max_hz > *min_hz;
+    }
+
+    return false;
+}
+
+void drmlist_vrr_frame_ready(drmlist_vrr_t* v, uint64_t now_ns)
+{
+    uint64_t r, vblanks;
+
+    if (!v->frame_start_ns || now_ns < v->frame_start_ns)
+        return;
+
+    r = now_ns - v->frame_start_ns;
+    v->frame_ns_avg = v->frame_ns_avg ? (uint64_t)((int64_t)v->frame_ns_avg + ((int64_t)r - (int64_t)v->frame_ns_avg) / 8) : r;
+
+    /* On fixed-rate vsync the frame would have waited for the first vblank after it was ready */
+    vblanks = (r + v->refresh_ns - 1) / v->refresh_ns;
+    v->fixed_ns = (vblanks ? vblanks : 1) * v->refresh_ns;
+    v->ready_ns = now_ns;
+}
+
+void drmlist_vrr_present(drmlist_vrr_t* v, uint64_t flip_ns, bool repeat)
+{
+    v->last_present_ns = flip_ns;
+
+    if (repeat)
+    {
+        v->repeats++;
+        return;
+    }
+
+    if (v->frame_start_ns && flip_ns > v->frame_start_ns && v->fixed_ns)
+    {
+        double d = flip_ns - v->frame_start_ns;
+        double f = v->fixed_ns;
+
+        v->frames++;
+        v->sum += d;
+        v->sum_sq += d * d;
+        v->wait_sum += flip_ns > v->ready_ns ? flip_ns - v->ready_ns : 0;
+        v->fixed_sum += f;
+        v->fixed_sum_sq += f * f;
+        v->fixed_wait_sum += f - (v->ready_ns - v->frame_start_ns);
+        v->fixed_late += v->fixed_ns > v->refresh_ns;
+        v->lfc_frames += v->lfc_mult > 1;
+    }
+
+    v->fixed_ns = 0;
+    v->frame_start_ns = flip_ns;
+    v->lfc_mult = vrr_lfc_mult(v);
+}
+
+/*
+ * Evenly spaced repeats of the front buffer, except for the one that would
+ * land close to the new frame: that one could hold the new frame back by a
+ * whole repeat
+ */
+uint64_t drmlist_vrr_repeat_at(drmlist_vrr_t* v)
+{
+    uint64_t step, next, expected;
+
+    if (v->lfc_mult <= 1 || !v->last_present_ns)
+        return 0;
+
+    step = v->frame_ns_avg / v->lfc_mult;
+    next = v->last_present_ns + step;
+    expected = v->frame_start_ns + v->frame_ns_avg;
+
+    if (next + step / 2 > expected && v->last_present_ns < expected)
+        return 0;
+
+    return next;
+}
+
+uint64_t drmlist_vrr_predict_ns(drmlist_vrr_t* v)
+{
+    if (!v->enabled)
+        return v->refresh_ns;
+
+    return v->frame_ns_avg > v->min_ns ? v->frame_ns_avg : v->min_ns;
+}
+
+void drmlist_vrr_print_stats(drmlist_vrr_t* v)
+{
+    double fixed_hz = 1e9 / v->refresh_ns;
+
+    if (!v->frames)
+        return;
+
+    printf("Pacing (%s %u-%u Hz): %lu frames, %.2f ms avg (%.1f fps), jitter %.2f ms, %.2f ms ready to on screen, "
+                    "LFC on %lu frames (%lu repeats)\n",
+                    v->enabled ? "VRR" : "VRR off, range", v->min_hz, v->max_hz ? v->max_hz : (uint32_t)(fixed_hz + 0.5),
+                    v->frames, v->sum / v->frames / 1e6, 1e9 * v->frames / v->sum,
+                    vrr_stddev(v->sum, v->sum_sq, v->frames) / 1e6, v->wait_sum / v->frames / 1e6, v->lfc_frames, v->repeats);
+    printf("    on fixed %.2f Hz vsync: %.2f ms avg (%.1f fps), jitter %.2f ms, %.2f ms ready to on screen, "
+                    "%lu frames past their vblank\n",
+                    fixed_hz, v->fixed_sum / v->frames / 1e6, 1e9 * v->frames / v->fixed_sum,
+                    vrr_stddev(v->fixed_sum, v->fixed_sum_sq, v->frames) / 1e6, v->fixed_wait_sum / v->frames / 1e6, v->fixed_late);
+}
@@ -0,0 +1,74 @@
+#ifndef _DRMLIST_VRR_H_
+#define _DRMLIST_VRR_H_
+
+#include "mydrm/mydrm.h"
+
+/*
+ * Variable refresh rate present policy
+ *
+ * With VRR_ENABLED on the CRTC the panel starts scanning out as soon as a
+ * flip lands, anywhere between its fastest (the mode, or the panel's maximum)
+ * and slowest refresh. Frames are flipped as soon as they're ready. A frame
+ * slower than the panel's slowest refresh would make the panel repeat the old
+ * one on its own and the new frame wait out that repeat, so below the range
+ * the front buffer is re-presented `lfc_mult` times per frame at even
+ * intervals instead (low framerate compensation).
+ *
+ * The same frames are also accounted as they would have been shown on a
+ * fixed-rate vsync, for the pacing report.
+ */
+
+#define DRMLIST_VRR_DEFAULT_MIN_HZ 48        // without an EDID range descriptor
+#define DRMLIST_VRR_LFC_MARGIN_PERCENT 90    // repeats stay this far under the panel's slowest refresh
+#define DRMLIST_VRR_MAX_LFC 8
+
+typedef struct
+{
+    bool enabled;               // VRR_ENABLED is set, fixed-rate pacing is still accounted otherwise
+    uint32_t min_hz;
+    uint32_t max_hz;
+    uint64_t min_ns;            // shortest frame, the mode's refresh interval or the panel's maximum
+    uint64_t max_ns;            // longest the panel holds a frame
+    uint64_t refresh_ns;        // the mode's fixed refresh interval
+
+    uint64_t frame_ns_avg;      // frame start to ready, exponential moving average, 1/8
+    uint32_t lfc_mult;          // presents per frame, 1 without LFC
+    uint64_t frame_start_ns;    // last new frame on screen, the next one starts rendering then
+    uint64_t last_present_ns;   // last flip completion, new frame or repeat
+    uint64_t ready_ns;          // the frame in flight finished rendering
+    uint64_t fixed_ns;          // the frame in flight on fixed-rate vsync
+
+    /* Pacing, per new frame */
+    uint64_t frames;
+    uint64_t repeats;
+    uint64_t lfc_frames;
+    double sum;                 // present to present, ns
+    double sum_sq;
+    double wait_sum;            // ready to on screen
+    double fixed_sum;           // the same frames on fixed-rate vsync
+    double fixed_sum_sq;
+    double fixed_wait_sum;
+    uint64_t fixed_late;        // frames that would have missed their vblank
+} drmlist_vrr_t;
+
+void drmlist_vrr_init(drmlist_vrr_t* v, uint32_t min_hz, uint32_t max_hz, uint64_t refresh_ns);
+void drmlist_vrr_set_mode(drmlist_vrr_t* v, uint64_t refresh_ns);
+
+/* Monitor range limits descriptor of the base EDID block */
+bool drmlist_vrr_parse_edid(const uint8_t* edid, uint32_t len, uint32_t* min_hz, uint32_t* max_hz);
+
+/* A new frame finished rendering at `now_ns` and is flipped */
+void drmlist_vrr_frame_ready(drmlist_vrr_t* v, uint64_t now_ns);
+
+/* A flip completed, `repeat` if it re-presented the front buffer */
+void drmlist_vrr_present(drmlist_vrr_t* v, uint64_t flip_ns, bool repeat);
+
+/* When the front buffer should be re-presented, 0 if it shouldn't */
+uint64_t drmlist_vrr_repeat_at(drmlist_vrr_t* v);
+
+/* Expected frame to frame interval, what the animation clock should predict with */
+uint64_t drmlist_vrr_predict_ns(drmlist_vrr_t* v);
+
+void drmlist_vrr_print_stats(drmlist_vrr_t* v);
+
+#endif // _DRMLIST_VRR_H_
@@ -5,6 +5,161 @@ int mydrm_open(const char* dev_path)
     return open(dev_path, O_RDWR | O_CLOEXEC);
 }
 
+#ifdef MYDRM_IOCTL_STATS
+#include <time.h>
+
+/*
+ * Per-ioctl instrumentation, keyed by the ioctl number (_IOC_NR). Bucket b of
+ * the histogram counts calls that took [2^b, 2^(b+1)) ns, retries included.
+ * Only touched from the thread that drives the DRM device.
+ */
+#define MYDRM_IOCTL_STATS_BUCKETS 32
+
+typedef struct
+{
+    unsigned long request;
+    uint64_t count;
+    uint64_t retries;
+    uint64_t errors;
+    uint64_t total_ns;
+    uint64_t max_ns;
+    uint64_t hist[MYDRM_IOCTL_STATS_BUCKETS];
+} mydrm_ioctl_stats_t;
+
+static mydrm_ioctl_stats_t ioctl_stats[256];
+
+static inline uint64_t mydrm_stats_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+int mydrm_ioctl(int fd, unsigned long request, void* arg)
+{
+    mydrm_ioctl_stats_t* st = &ioctl_stats[_IOC_NR(request)];
+    uint64_t start = mydrm_stats_now_ns();
+    uint64_t ns;
+    int bucket;
+    int ret;
+
+    while ((ret = ioctl(fd, request, arg)) == -1 && (errno == EINTR || errno == EAGAIN))
+        st->retries++;
+
+    ns = mydrm_stats_now_ns() - start;
+    bucket = ns ? 63 - __builtin_clzll(ns) : 0;
+    if (bucket >= MYDRM_IOCTL_STATS_BUCKETS)
+        bucket = MYDRM_IOCTL_STATS_BUCKETS - 1;
+
+    st->request = request;
+    st->count++;
+    st->errors += (ret == -1);
+    st->total_ns += ns;
+    st->hist[bucket]++;
+    if (ns > st->max_ns)
+        st->max_ns = ns;
+
+    return ret;
+}
+
+static const char* mydrm_ioctl_name(unsigned long request)
+{
+    switch (request)
+    {
+        case DRM_IOCTL_VERSION:                 return "VERSION";
+        case DRM_IOCTL_GET_CAP:                 return "GET_CAP";
+        case DRM_IOCTL_SET_CLIENT_CAP:          return "SET_CLIENT_CAP";
+        case DRM_IOCTL_SET_MASTER:              return "SET_MASTER";
+        case DRM_IOCTL_DROP_MASTER:             return "DROP_MASTER";
+        case DRM_IOCTL_PRIME_HANDLE_TO_FD:      return "PRIME_HANDLE_TO_FD";
+        case DRM_IOCTL_MODE_GETRESOURCES:       return "MODE_GETRESOURCES";
+        case DRM_IOCTL_MODE_GETCRTC:            return "MODE_GETCRTC";
+        case DRM_IOCTL_MODE_SETCRTC:            return "MODE_SETCRTC";
+        case DRM_IOCTL_MODE_CURSOR:             return "MODE_CURSOR";
+        case DRM_IOCTL_MODE_GETENCODER:         return "MODE_GETENCODER";
+        case DRM_IOCTL_MODE_GETCONNECTOR:       return "MODE_GETCONNECTOR";
+        case DRM_IOCTL_MODE_GETPROPERTY:        return "MODE_GETPROPERTY";
+        case DRM_IOCTL_MODE_ADDFB:              return "MODE_ADDFB";
+        case DRM_IOCTL_MODE_RMFB:               return "MODE_RMFB";
+        case DRM_IOCTL_MODE_PAGE_FLIP:          return "MODE_PAGE_FLIP";
+        case DRM_IOCTL_MODE_CREATE_DUMB:        return "MODE_CREATE_DUMB";
+        case DRM_IOCTL_MODE_MAP_DUMB:           return "MODE_MAP_DUMB";
+        case DRM_IOCTL_MODE_DESTROY_DUMB:       return "MODE_DESTROY_DUMB";
+        case DRM_IOCTL_MODE_GETPLANERESOURCES:  return "MODE_GETPLANERESOURCES";
+        case DRM_IOCTL_MODE_OBJ_GETPROPERTIES:  return "MODE_OBJ_GETPROPERTIES";
+        case DRM_IOCTL_MODE_OBJ_SETPROPERTY:    return "MODE_OBJ_SETPROPERTY";
+        case DRM_IOCTL_MODE_CREATEPROPBLOB:     return "MODE_CREATEPROPBLOB";
+        case DRM_IOCTL_MODE_DESTROYPROPBLOB:    return "MODE_DESTROYPROPBLOB";
+        case DRM_IOCTL_MODE_GETGAMMA:           return "MODE_GETGAMMA";
+        case DRM_IOCTL_MODE_SETGAMMA:           return "MODE_SETGAMMA";
+        default:                                return NULL;
+    }
+}
+
+/*
+ * Upper bound of the bucket holding the `pct` percentile, capped at the max
+ */
+static uint64_t mydrm_ioctl_percentile(mydrm_ioctl_stats_t* st, double pct)
+{
+    uint64_t want = (uint64_t)(st->count * pct + 0.5);
+    uint64_t seen = 0;
+
+    if (want == 0)
+        want = 1;
+
+    for (int b = 0; b < MYDRM_IOCTL_STATS_BUCKETS; b++)
+        if ((seen += st->hist[b]) >= want)
+            return (2ull << b) < st->max_ns ? (2ull << b) : st->max_ns;
+
+    return st->max_ns;
+}
+
+int mydrm_ioctl_stats_dump(FILE* out)
+{
+    fprintf(out, "%-24s %9s %7s %6s %10s %10s %10s %10s\n",
+                    "ioctl", "count", "retries", "errors", "avg us", "p50 us", "p99 us", "max us");
+
+    for (int i = 0; i < 256; i++)
+    {
+        mydrm_ioctl_stats_t* st = &ioctl_stats[i];
+        const char* name;
+        char unknown[32];
+
+        if (!st->count)
+            continue;
+
+        if ((name = mydrm_ioctl_name(st->request)) == NULL)
+        {
+            snprintf(unknown, sizeof(unknown), "0x%02x", i);
+            name = unknown;
+        }
+
+        fprintf(out, "%-24s %9lu %7lu %6lu %10.2f %10.2f %10.2f %10.2f\n", name, st->count, st->retries, st->errors,
+                        st->total_ns / 1e3 / st->count, mydrm_ioctl_percentile(st, 0.50) / 1e3,
+                        mydrm_ioctl_percentile(st, 0.99) / 1e3, st->max_ns / 1e3);
+
+        /* Histogram, non-empty buckets only */
+        fprintf(out, "%24s", "");
+        for (int b = 0; b < MYDRM_IOCTL_STATS_BUCKETS; b++)
+        {
+            uint64_t limit = 2ull << b;
+
+            if (!st->hist[b])
+                continue;
+
+            if (limit < 1000)
+                fprintf(out, " <%luns:%lu", limit, st->hist[b]);
+            else if (limit < 1000000)
+                fprintf(out, " <%luus:%lu", limit / 1000, st->hist[b]);
+            else
+                fprintf(out, " <%lums:%lu", limit / 1000000, st->hist[b]);
+        }
+        fprintf(out, "\n");
+    }
+
+    return 0;
+}
+#else
 int mydrm_ioctl(int fd, unsigned long request, void* arg)
 {
     int ret;
@@ -16,6 +171,12 @@ int mydrm_ioctl(int fd, unsigned long request, void* arg)
     return ret;
 }
 
+int mydrm_ioctl_stats_dump(FILE* out)
+{
+    return -1;
+}
+#endif // MYDRM_IOCTL_STATS
+
 const char* mydrm_connector_typename(uint32_t connector_type)
 {
 	/* Keep the strings in sync with the kernel's drm_connector_enum_list in
@@ -90,7 +251,6 @@ int mydrm_check_cap(int fd)
 int mydrm_handle_event(int fd, mydrm_event_context_t* ctx)
 {
     uint8_t buffer[1024];
-    struct drm_event* e;
 
     int len = read(fd, buffer, sizeof(buffer));
 
@@ -100,20 +260,32 @@ int mydrm_handle_event(int fd, mydrm_event_context_t* ctx)
         return -1;
     }
 
-    if (len < sizeof(struct drm_event))
+    return mydrm_dispatch_events(fd, ctx, buffer, len);
+}
+
+/*
+ * Dispatch DRM events already read from the DRM device
+ */
+int mydrm_dispatch_events(int fd, mydrm_event_context_t* ctx, const uint8_t* buffer, int len)
+{
+    const struct drm_event* e;
+
+    if (len < (int)sizeof(struct drm_event))
         return -1;
     
     int i = 0;
-    while (i < len)
+    while (i + (int)sizeof(struct drm_event) <= len)
     {
-        e = (struct drm_event*)&buffer[i];
+        e = (const struct drm_event*)&buffer[i];
+        if (e->length < sizeof(struct drm_event))
+            break;
         i += e->length;
 
         switch (e->type)
         {
             case DRM_EVENT_FLIP_COMPLETE:
             {
-                struct drm_event_vblank* vb = (struct drm_event_vblank*)e;
+                const struct drm_event_vblank* vb = (const struct drm_event_vblank*)e;
                 ctx->page_flip_handler(fd, vb->sequence, vb->tv_sec, vb->tv_usec, (void*)vb->user_data);
                 break;
             }
@@ -175,7 +347,7 @@ static int mydrm_add_fb(int fd, mydrm_fb_t* fb)
 /*
  * Map dumb buffer into process's address space
  */
-static int mydrm_map_buffer(int fd, mydrm_fb_t* fb)
+static int mydrm_map_buffer(int fd, mydrm_fb_t* fb, uint32_t map_flags)
 {
     int ret;
     struct drm_mode_map_dumb mreq;
@@ -186,10 +358,20 @@ static int mydrm_map_buffer(int fd, mydrm_fb_t* fb)
     if ((ret = mydrm_ioctl(fd, DRM_IOCTL_MODE_MAP_DUMB, &mreq)) < 0)
         return ret;
 
-    if ((fb->pixels= mmap(NULL, fb->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, mreq.offset)) == MAP_FAILED)
+    if ((fb->pixels= mmap(NULL, fb->size, PROT_READ | PROT_WRITE,
+                          MAP_SHARED | ((map_flags & MYDRM_MAP_POPULATE) ? MAP_POPULATE : 0), fd, mreq.offset)) == MAP_FAILED)
         return -1;
-    
-    memset(fb->pixels, 0, fb->size);
+
+    if (map_flags & MYDRM_MAP_WILLNEED)
+        madvise(fb->pixels, fb->size, MADV_WILLNEED);
+
+    /* MAP_POPULATE skips VM_PFNMAP/VM_IO mappings, which many drivers use, one write per page maps them */
+    if (map_flags & MYDRM_MAP_PREFAULT)
+        for (uint32_t off = 0; off < fb->size; off += 4096)
+            ((volatile uint32_t*)(fb->pixels + off))[0] = 0;
+
+    if (map_flags & MYDRM_MAP_CLEAR)
+        memset(fb->pixels, 0, fb->size);
 
     return 0;
 }
@@ -202,6 +384,11 @@ static int mydrm_map_buffer(int fd, mydrm_fb_t* fb)
  * `fb` - FrameBuffer
  */
 bool mydrm_create_framebuffer(int fd, mydrm_fb_t* fb)
+{
+    return mydrm_create_framebuffer_flags(fd, fb, MYDRM_MAP_CLEAR);
+}
+
+bool mydrm_create_framebuffer_flags(int fd, mydrm_fb_t* fb, uint32_t map_flags)
 {
     int ret;
     struct drm_mode_create_dumb creq;
@@ -228,7 +415,7 @@ bool mydrm_create_framebuffer(int fd, mydrm_fb_t* fb)
     }
 
 
-    if ((ret = mydrm_map_buffer(fd, fb)) < 0)
+    if ((ret = mydrm_map_buffer(fd, fb, map_flags)) < 0)
     {
         perror("FAILED to map fb buffer");
         return false;
@@ -237,6 +424,53 @@ bool mydrm_create_framebuffer(int fd, mydrm_fb_t* fb)
     return true;
 }
 
+/*
+ * Unmap, remove FBO and destroy dumb buffer
+ */
+void mydrm_destroy_framebuffer(int fd, mydrm_fb_t* fb)
+{
+    struct drm_mode_destroy_dumb dreq;
+
+    if (fb->pixels)
+        munmap(fb->pixels, fb->size);
+
+    if (fb->fb && mydrm_ioctl(fd, DRM_IOCTL_MODE_RMFB, &fb->fb) == -1)
+        perror("ioctl DRM_IOCTL_MODE_RMFB");
+
+    if (fb->handle)
+    {
+        memset(&dreq, 0, sizeof(struct drm_mode_destroy_dumb));
+        dreq.handle = fb->handle;
+
+        if (mydrm_ioctl(fd, DRM_IOCTL_MODE_DESTROY_DUMB, &dreq) == -1)
+            perror("ioctl DRM_IOCTL_MODE_DESTROY_DUMB");
+    }
+
+    fb->pixels = NULL;
+    fb->fb = 0;
+    fb->handle = 0;
+}
+
+/*
+ * Export dumb buffer as a DMA-BUF fd, so another process can map it
+ */
+int mydrm_prime_export(int fd, mydrm_fb_t* fb, int* prime_fd)
+{
+    int ret;
+    struct drm_prime_handle prime;
+    memset(&prime, 0, sizeof(struct drm_prime_handle));
+
+    prime.handle = fb->handle;
+    prime.flags = DRM_CLOEXEC | DRM_RDWR;
+    prime.fd = -1;
+
+    if ((ret = mydrm_ioctl(fd, DRM_IOCTL_PRIME_HANDLE_TO_FD, &prime)) == -1)
+        return ret;
+
+    *prime_fd = prime.fd;
+    return 0;
+}
+
 /*
  * Set/Drop master
  */
@@ -250,58 +484,169 @@ int mydrm_drop_master(int fd)
     return mydrm_ioctl(fd, DRM_IOCTL_DROP_MASTER, 0);
 }
 
-int mydrm_get_res(int fd, struct drm_mode_card_res* res)
+/*
+ * Query arena
+ */
+struct mydrm_arena_chunk
 {
-    int ret;
-    memset(res, 0, sizeof(struct drm_mode_card_res));
+    mydrm_arena_chunk_t* next;
+    uint8_t data[] __attribute__((aligned(16)));
+};
 
-    if ((ret = mydrm_ioctl(fd, DRM_IOCTL_MODE_GETRESOURCES, res)))
+int mydrm_arena_init(mydrm_arena_t* arena, size_t size)
+{
+    memset(arena, 0, sizeof(mydrm_arena_t));
+
+    if (size && (arena->base = malloc(size)) == NULL)
+        return -ENOMEM;
+
+    arena->size = size;
+    arena->heap_allocs = size ? 1 : 0;
+
+    return 0;
+}
+
+void* mydrm_arena_alloc(mydrm_arena_t* arena, size_t size)
+{
+    void* ptr;
+
+    size = (size + 15) & ~(size_t)15;
+
+    if (arena->used + size <= arena->size)
     {
-        perror("ioctl DRM_IOCTL_MODE_GETRESOURCES (1)");
-        return ret;
+        ptr = arena->base + arena->used;
+        arena->used += size;
+    }
+    else
+    {
+        /* Doesn't fit, spill until the next reset grows the block */
+        mydrm_arena_chunk_t* chunk = malloc(sizeof(mydrm_arena_chunk_t) + size);
+
+        if (!chunk)
+            return NULL;
+
+        arena->heap_allocs++;
+        chunk->next = arena->spill;
+        arena->spill = chunk;
+        ptr = chunk->data;
     }
 
-    if (res->count_fbs)
+    arena->pass_used += size;
+    if (arena->pass_used > arena->high_water)
+        arena->high_water = arena->pass_used;
+
+    memset(ptr, 0, size);
+
+    return ptr;
+}
+
+/*
+ * Release everything allocated since the last reset
+ */
+void mydrm_arena_reset(mydrm_arena_t* arena)
+{
+    while (arena->spill)
     {
-        res->fb_id_ptr = (uint64_t)malloc(res->count_fbs * sizeof(uint32_t));
-        if (res->fb_id_ptr == 0)
-            return -ENOMEM;
-        memset((void*)res->fb_id_ptr, 0, res->count_fbs * sizeof(uint32_t));
+        mydrm_arena_chunk_t* next = arena->spill->next;
+        free(arena->spill);
+        arena->spill = next;
     }
 
-    if (res->count_crtcs)
+    if (arena->high_water > arena->size)
     {
-        res->crtc_id_ptr = (uint64_t)malloc(res->count_crtcs * sizeof(uint32_t));
-        if (res->crtc_id_ptr == 0)
-            return -ENOMEM;
-        memset((void*)res->crtc_id_ptr, 0, res->count_crtcs * sizeof(uint32_t));
+        size_t size = (arena->high_water + 4095) & ~(size_t)4095;
+        uint8_t* base = malloc(size);
+
+        /* Keep the old block if growing fails, we'll spill again */
+        if (base)
+        {
+            free(arena->base);
+            arena->base = base;
+            arena->size = size;
+            arena->heap_allocs++;
+        }
     }
 
-    if (res->count_connectors)
+    arena->used = 0;
+    arena->pass_used = 0;
+    arena->passes++;
+}
+
+void mydrm_arena_free(mydrm_arena_t* arena)
+{
+    mydrm_arena_reset(arena);
+    free(arena->base);
+    memset(arena, 0, sizeof(mydrm_arena_t));
+}
+
+/*
+ * Zeroed query array, from the arena or the heap
+ */
+static uint64_t mydrm_query_alloc(mydrm_arena_t* arena, size_t count, size_t size)
+{
+    if (!count)
+        return 0;
+
+    if (arena)
+        return (uint64_t)mydrm_arena_alloc(arena, count * size);
+
+    return (uint64_t)calloc(count, size);
+}
+
+int mydrm_get_res(int fd, struct drm_mode_card_res* res, mydrm_arena_t* arena)
+{
+    struct drm_mode_card_res counts;
+    int ret;
+
+retry:
+    memset(res, 0, sizeof(struct drm_mode_card_res));
+
+    if ((ret = mydrm_ioctl(fd, DRM_IOCTL_MODE_GETRESOURCES, res)))
     {
-        res->connector_id_ptr = (uint64_t)malloc(res->count_connectors * sizeof(uint32_t));
-        if (res->connector_id_ptr == 0)
-            return -ENOMEM;
-        memset((void*)res->connector_id_ptr, 0, res->count_connectors * sizeof(uint32_t));
+        perror("ioctl DRM_IOCTL_MODE_GETRESOURCES (1)");
+        return ret;
     }
 
-    if (res->count_encoders)
+    res->fb_id_ptr = mydrm_query_alloc(arena, res->count_fbs, sizeof(uint32_t));
+    res->crtc_id_ptr = mydrm_query_alloc(arena, res->count_crtcs, sizeof(uint32_t));
+    res->connector_id_ptr = mydrm_query_alloc(arena, res->count_connectors, sizeof(uint32_t));
+    res->encoder_id_ptr = mydrm_query_alloc(arena, res->count_encoders, sizeof(uint32_t));
+
+    if ((res->count_fbs && !res->fb_id_ptr) || (res->count_crtcs && !res->crtc_id_ptr) ||
+        (res->count_connectors && !res->connector_id_ptr) || (res->count_encoders && !res->encoder_id_ptr))
     {
-        res->encoder_id_ptr = (uint64_t)malloc(res->count_encoders * sizeof(uint32_t));
-        if (res->encoder_id_ptr == 0)
-            return -ENOMEM;
-        memset((void*)res->encoder_id_ptr, 0, res->count_encoders * sizeof(uint32_t));
+        if (!arena)
+            mydrm_free_res(res);
+        memset(res, 0, sizeof(struct drm_mode_card_res));
+        return -ENOMEM;
     }
 
+    counts = *res;
+
     if ((ret = mydrm_ioctl(fd, DRM_IOCTL_MODE_GETRESOURCES, res)))
+    {
         perror("ioctl DRM_IOCTL_MODE_GETRESOURCES (2)");
+        return ret;
+    }
+
+    /* Something got hotplugged between the two calls, the arrays weren't filled */
+    if (res->count_fbs > counts.count_fbs || res->count_crtcs > counts.count_crtcs ||
+        res->count_connectors > counts.count_connectors || res->count_encoders > counts.count_encoders)
+    {
+        if (!arena)
+            mydrm_free_res(res);
+        goto retry;
+    }
 
     return ret;
 }
 
-int mydrm_get_connector(int fd, int id, struct drm_mode_get_connector* conn)
+int mydrm_get_connector(int fd, int id, struct drm_mode_get_connector* conn, mydrm_arena_t* arena)
 {
+    struct drm_mode_get_connector counts;
     int ret;
+
+retry:
     memset(conn, 0, sizeof(struct drm_mode_get_connector));
     conn->connector_id = id;
     conn->count_modes = 0;
@@ -312,37 +657,37 @@ int mydrm_get_connector(int fd, int id, struct drm_mode_get_connector* conn)
         return ret;
     }
 
-    if (conn->count_props)
+    conn->props_ptr = mydrm_query_alloc(arena, conn->count_props, sizeof(uint32_t));
+    conn->prop_values_ptr = mydrm_query_alloc(arena, conn->count_props, sizeof(uint64_t));
+    conn->modes_ptr = mydrm_query_alloc(arena, conn->count_modes, sizeof(struct drm_mode_modeinfo));
+    conn->encoders_ptr = mydrm_query_alloc(arena, conn->count_encoders, sizeof(uint32_t));
+
+    if ((conn->count_props && (!conn->props_ptr || !conn->prop_values_ptr)) ||
+        (conn->count_modes && !conn->modes_ptr) || (conn->count_encoders && !conn->encoders_ptr))
     {
-        conn->props_ptr = (uint64_t)malloc(conn->count_props * sizeof(uint32_t));
-        if (conn->props_ptr == 0)
-            return -ENOMEM;
-        memset((void*)conn->props_ptr, 0, conn->count_props * sizeof(uint32_t));
-        conn->prop_values_ptr = (uint64_t)malloc(conn->count_props * sizeof(uint64_t));
-        if (conn->prop_values_ptr == 0)
-            return -ENOMEM;
-        memset((void*)conn->prop_values_ptr, 0, conn->count_props * sizeof(uint64_t));
+        if (!arena)
+            mydrm_free_connector(conn);
+        memset(conn, 0, sizeof(struct drm_mode_get_connector));
+        return -ENOMEM;
     }
 
-    if (conn->count_modes)
+    counts = *conn;
+
+    if ((ret = mydrm_ioctl(fd, DRM_IOCTL_MODE_GETCONNECTOR, conn)))
     {
-        conn->modes_ptr = (uint64_t)malloc(conn->count_modes * sizeof(struct drm_mode_modeinfo));
-        if (conn->modes_ptr == 0)
-            return -ENOMEM;
-        memset((void*)conn->modes_ptr, 0, conn->count_modes * sizeof(struct drm_mode_modeinfo));
+        perror("ioctl DRM_IOCTL_MODE_GETCONNECTOR (2)");
+        return ret;
     }
 
-    if (conn->count_encoders)
+    /* Modes changed between the two calls (monitor swapped), the arrays weren't filled */
+    if (conn->count_props > counts.count_props || conn->count_modes > counts.count_modes ||
+        conn->count_encoders > counts.count_encoders)
     {
-        conn->encoders_ptr = (uint64_t)malloc(conn->count_encoders * sizeof(uint32_t));
-        if (conn->encoders_ptr == 0)
-            return -ENOMEM;
-        memset((void*)conn->encoders_ptr, 0, conn->count_encoders * sizeof(uint32_t));
+        if (!arena)
+            mydrm_free_connector(conn);
+        goto retry;
     }
 
-    if ((ret = mydrm_ioctl(fd, DRM_IOCTL_MODE_GETCONNECTOR, conn)))
-        perror("ioctl DRM_IOCTL_MODE_GETCONNECTOR (2)");
-
     return ret;
 }
 
@@ -359,6 +704,39 @@ int mydrm_get_encorder(int fd, int id, struct drm_mode_get_encoder* enc)
     return ret;
 }
 
+int mydrm_get_cap(int fd, uint64_t capability, uint64_t* value)
+{
+    int ret;
+    struct drm_get_cap get_cap = {
+        .capability = capability,
+        .value = 0
+    };
+
+    if ((ret = mydrm_ioctl(fd, DRM_IOCTL_GET_CAP, &get_cap)) == 0)
+        *value = get_cap.value;
+
+    return ret;
+}
+
+/*
+ * Property blob (EDID, modes, ...). The kernel only copies when `*length` is
+ * the blob's exact size and always sets it, ask with 0 first.
+ */
+int mydrm_get_blob(int fd, uint32_t blob_id, void* data, uint32_t* length)
+{
+    int ret;
+    struct drm_mode_get_blob blob = {
+        .blob_id = blob_id,
+        .length = *length,
+        .data = (uint64_t)data
+    };
+
+    if ((ret = mydrm_ioctl(fd, DRM_IOCTL_MODE_GETPROPBLOB, &blob)) == 0)
+        *length = blob.length;
+
+    return ret;
+}
+
 /*
  * Sets
  */
@@ -368,6 +746,104 @@ int mydrm_set_crtc(int fd, struct drm_mode_crtc* crtc)
     return mydrm_ioctl(fd, DRM_IOCTL_MODE_SETCRTC, crtc);
 }
 
+int mydrm_page_flip(int fd, uint32_t crtc_id, uint32_t fb_id, uint32_t flags, void* user_data)
+{
+    struct drm_mode_crtc_page_flip flip;
+
+    flip.fb_id = fb_id;
+    flip.crtc_id = crtc_id;
+    flip.user_data = (uint64_t)user_data;
+    flip.flags = flags;
+    flip.reserved = 0;
+
+    return mydrm_ioctl(fd, DRM_IOCTL_MODE_PAGE_FLIP, &flip);
+}
+
+/*
+ * Flush `clips` of a framebuffer to the display, no clips flushes all of it
+ */
+int mydrm_dirty_fb(int fd, uint32_t fb_id, struct drm_clip_rect* clips, uint32_t num_clips)
+{
+    struct drm_mode_fb_dirty_cmd dirty;
+
+    memset(&dirty, 0, sizeof(struct drm_mode_fb_dirty_cmd));
+    dirty.fb_id = fb_id;
+    dirty.num_clips = num_clips;
+    dirty.clips_ptr = (uint64_t)clips;
+
+    return mydrm_ioctl(fd, DRM_IOCTL_MODE_DIRTYFB, &dirty);
+}
+
+/*
+ * Legacy property set, on atomic drivers the kernel wraps it in a commit
+ */
+int mydrm_set_property(int fd, uint32_t obj_id, uint32_t obj_type, uint32_t prop_id, uint64_t value)
+{
+    struct drm_mode_obj_set_property prop;
+
+    prop.value = value;
+    prop.prop_id = prop_id;
+    prop.obj_id = obj_id;
+    prop.obj_type = obj_type;
+
+    return mydrm_ioctl(fd, DRM_IOCTL_MODE_OBJ_SETPROPERTY, &prop);
+}
+
+/*
+ * Property blobs (GAMMA_LUT, CTM, ...), the kernel keeps a blob alive while a
+ * property refers to it, so it can be destroyed right after setting it
+ */
+int mydrm_create_blob(int fd, const void* data, uint32_t length, uint32_t* blob_id)
+{
+    struct drm_mode_create_blob blob;
+    int ret;
+
+    memset(&blob, 0, sizeof(struct drm_mode_create_blob));
+    blob.data = (uint64_t)data;
+    blob.length = length;
+
+    if ((ret = mydrm_ioctl(fd, DRM_IOCTL_MODE_CREATEPROPBLOB, &blob)) == 0)
+        *blob_id = blob.blob_id;
+
+    return ret;
+}
+
+int mydrm_destroy_blob(int fd, uint32_t blob_id)
+{
+    struct drm_mode_destroy_blob blob = { .blob_id = blob_id };
+
+    return mydrm_ioctl(fd, DRM_IOCTL_MODE_DESTROYPROPBLOB, &blob);
+}
+
+/*
+ * Legacy gamma ramp, `size` 16-bit entries per channel (the CRTC's gamma_size)
+ */
+int mydrm_get_gamma(int fd, uint32_t crtc_id, uint32_t size, uint16_t* red, uint16_t* green, uint16_t* blue)
+{
+    struct drm_mode_crtc_lut lut = {
+        .crtc_id = crtc_id,
+        .gamma_size = size,
+        .red = (uint64_t)red,
+        .green = (uint64_t)green,
+        .blue = (uint64_t)blue
+    };
+
+    return mydrm_ioctl(fd, DRM_IOCTL_MODE_GETGAMMA, &lut);
+}
+
+int mydrm_set_gamma(int fd, uint32_t crtc_id, uint32_t size, const uint16_t* red, const uint16_t* green, const uint16_t* blue)
+{
+    struct drm_mode_crtc_lut lut = {
+        .crtc_id = crtc_id,
+        .gamma_size = size,
+        .red = (uint64_t)red,
+        .green = (uint64_t)green,
+        .blue = (uint64_t)blue
+    };
+
+    return mydrm_ioctl(fd, DRM_IOCTL_MODE_SETGAMMA, &lut);
+}
+
 /*
  * Free functions
  */
@@ -377,6 +853,7 @@ void mydrm_free_res(struct drm_mode_card_res* res)
     free((void*)res->crtc_id_ptr);
     free((void*)res->connector_id_ptr);
     free((void*)res->encoder_id_ptr);
+    res->fb_id_ptr = res->crtc_id_ptr = res->connector_id_ptr = res->encoder_id_ptr = 0;
 }
 
 void mydrm_free_connector(struct drm_mode_get_connector* conn)
@@ -385,6 +862,7 @@ void mydrm_free_connector(struct drm_mode_get_connector* conn)
     free((void*)conn->prop_values_ptr);
     free((void*)conn->modes_ptr);
     free((void*)conn->encoders_ptr);
+    conn->props_ptr = conn->prop_values_ptr = conn->modes_ptr = conn->encoders_ptr = 0;
 }
 
 /*
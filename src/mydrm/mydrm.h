@@ -51,6 +51,85 @@ typedef struct
     uint32_t fb;
 } mydrm_fb_t; 
 
+/*
+ * Dumb buffer mapping options
+ *
+ * CREATE_DUMB hands out zeroed memory, MYDRM_MAP_CLEAR is only needed to get
+ * the old behavior of touching every byte once. The others move the page
+ * faults of the mapping from the first frames to creation time.
+ */
+#define MYDRM_MAP_POPULATE  (1 << 0)    // mmap with MAP_POPULATE
+#define MYDRM_MAP_WILLNEED  (1 << 1)    // madvise(MADV_WILLNEED)
+#define MYDRM_MAP_PREFAULT  (1 << 2)    // write one word per page
+#define MYDRM_MAP_CLEAR     (1 << 3)    // memset the whole buffer
+
+/*
+ * mydrm_arena_t - Bump allocator for query results (resources, connectors)
+ *
+ * A whole enumeration pass allocates from one block and is released at once with
+ * mydrm_arena_reset(). A pass that doesn't fit spills into heap chunks, the next
+ * reset grows the block to the high-water mark, so re-enumerating the same
+ * hardware does no heap allocations.
+ */
+#define MYDRM_ARENA_DEFAULT_SIZE (16 * 1024)
+
+typedef struct mydrm_arena_chunk mydrm_arena_chunk_t;
+
+typedef struct
+{
+    uint8_t* base;
+    size_t size;
+    size_t used;
+    size_t pass_used;           // this pass, including spilled chunks
+    size_t high_water;
+    mydrm_arena_chunk_t* spill;
+    uint64_t heap_allocs;       // total malloc calls, block and chunks
+    uint64_t passes;
+} mydrm_arena_t;
+
+/*
+ * mydrm_props_t - Property cache
+ *
+ * Every connector, CRTC and plane's properties are enumerated once per
+ * hotplug. Property names of each object type get a perfect hash (seeded
+ * FNV-1a over a power of two table, seed searched at build time), so a name
+ * resolves to a slot with one hash and one strcmp, and each object keeps its
+ * property IDs and values by slot. No ioctls after mydrm_props_build().
+ */
+#define MYDRM_PROP_TYPE_CONNECTOR 0
+#define MYDRM_PROP_TYPE_CRTC 1
+#define MYDRM_PROP_TYPE_PLANE 2
+#define MYDRM_PROP_TYPES 3
+#define MYDRM_PROP_MAX_NAMES 255        // per object type
+#define MYDRM_PROP_MAX_TABLE 4096
+
+typedef struct
+{
+    uint32_t n_names;
+    uint32_t max_names;
+    uint32_t seed;
+    uint32_t mask;
+    char (*names)[DRM_PROP_NAME_LEN];   // by slot
+    uint8_t* table;                     // hash -> slot + 1, 0 is empty
+} mydrm_prop_type_t;
+
+typedef struct
+{
+    uint32_t id;
+    uint32_t type;          // MYDRM_PROP_TYPE_*
+    uint32_t* prop_ids;     // by slot, 0 if the object doesn't have it
+    uint64_t* values;       // by slot, as of the last build
+} mydrm_prop_obj_t;
+
+typedef struct
+{
+    mydrm_prop_type_t types[MYDRM_PROP_TYPES];
+    mydrm_prop_obj_t* objs;
+    uint32_t n_objs;
+    uint64_t generation;    // bumped by every build
+    uint64_t ioctls;        // spent by the last build
+} mydrm_props_t;
+
 typedef struct mouse mouse_t;
 
 typedef struct 
@@ -90,25 +169,53 @@ typedef struct mouse
 
 int mydrm_open(const char* dev_path);
 int mydrm_ioctl(int fd, uint64_t request, void* arg);
+int mydrm_ioctl_stats_dump(FILE* out);   // -1 unless built with MYDRM_IOCTL_STATS
 const char* mydrm_connector_typename (uint32_t connector_type);
 int mydrm_check_cap(int fd);
 int mydrm_handle_event(int fd, mydrm_event_context_t* ctx);
+int mydrm_dispatch_events(int fd, mydrm_event_context_t* ctx, const uint8_t* buffer, int len);
 
-bool mydrm_create_framebuffer(int fd, mydrm_fb_t* fb);
+bool mydrm_create_framebuffer(int fd, mydrm_fb_t* fb);     // MYDRM_MAP_CLEAR
+bool mydrm_create_framebuffer_flags(int fd, mydrm_fb_t* fb, uint32_t map_flags);
+void mydrm_destroy_framebuffer(int fd, mydrm_fb_t* fb);
+int mydrm_prime_export(int fd, mydrm_fb_t* fb, int* prime_fd);
 
 // Set/Drop master
 int mydrm_set_master(int fd);
 int mydrm_drop_master(int fd);
 
-// Gets
-int mydrm_get_res(int fd, struct drm_mode_card_res* res);
+// Query arena
+int mydrm_arena_init(mydrm_arena_t* arena, size_t size);
+void* mydrm_arena_alloc(mydrm_arena_t* arena, size_t size);
+void mydrm_arena_reset(mydrm_arena_t* arena);
+void mydrm_arena_free(mydrm_arena_t* arena);
+
+// Gets, `arena` may be NULL to use the heap (release with the free functions)
+int mydrm_get_res(int fd, struct drm_mode_card_res* res, mydrm_arena_t* arena);
 int mydrm_get_encorder(int fd, int id, struct drm_mode_get_encoder* enc);
-int mydrm_get_connector(int fd, int id, struct drm_mode_get_connector* conn);
+int mydrm_get_connector(int fd, int id, struct drm_mode_get_connector* conn, mydrm_arena_t* arena);
+
+int mydrm_get_cap(int fd, uint64_t capability, uint64_t* value);
+int mydrm_get_blob(int fd, uint32_t blob_id, void* data, uint32_t* length);    // copies if `*length` is the blob's size, sets it either way
+
+// Property cache, `conns` (res->count_connectors, may be NULL) saves refetching connector props
+int mydrm_props_build(int fd, mydrm_props_t* props, struct drm_mode_card_res* res, struct drm_mode_get_connector* conns, mydrm_arena_t* arena);
+int mydrm_props_slot(mydrm_props_t* props, uint32_t type, const char* name);
+mydrm_prop_obj_t* mydrm_props_obj(mydrm_props_t* props, uint32_t type, uint32_t obj_id);
+uint32_t mydrm_props_id(mydrm_props_t* props, uint32_t type, uint32_t obj_id, const char* name);
+bool mydrm_props_value(mydrm_props_t* props, uint32_t type, uint32_t obj_id, const char* name, uint64_t* value);
 
 // Sets
 int mydrm_set_crtc(int fd, struct drm_mode_crtc* crtc);
-
-// Free functions
+int mydrm_page_flip(int fd, uint32_t crtc_id, uint32_t fb_id, uint32_t flags, void* user_data);
+int mydrm_dirty_fb(int fd, uint32_t fb_id, struct drm_clip_rect* clips, uint32_t num_clips);
+int mydrm_set_property(int fd, uint32_t obj_id, uint32_t obj_type, uint32_t prop_id, uint64_t value);
+int mydrm_create_blob(int fd, const void* data, uint32_t length, uint32_t* blob_id);
+int mydrm_destroy_blob(int fd, uint32_t blob_id);
+int mydrm_get_gamma(int fd, uint32_t crtc_id, uint32_t size, uint16_t* red, uint16_t* green, uint16_t* blue);
+int mydrm_set_gamma(int fd, uint32_t crtc_id, uint32_t size, const uint16_t* red, const uint16_t* green, const uint16_t* blue);
+
+// Free functions, only for queries made without an arena
 void mydrm_free_res(struct drm_mode_card_res* res);
 void mydrm_free_connector(struct drm_mode_get_connector* conn);
 
@@ -0,0 +1,363 @@
+/*
+ * Property cache, see mydrm_props_t
+ */
+
+#include "mydrm.h"
+
+typedef struct
+{
+    uint32_t id;
+    char name[DRM_PROP_NAME_LEN];
+} mydrm_prop_name_t;
+
+/* Build state, lives in the arena for the duration of mydrm_props_build() */
+typedef struct
+{
+    int fd;
+    mydrm_props_t* props;
+    mydrm_arena_t* arena;
+
+    mydrm_prop_name_t* known;   // prop id -> name, ids are per device
+    uint32_t n_known;
+    uint32_t max_known;
+
+    /* Raw OBJ_GETPROPERTIES results, by object */
+    uint32_t** obj_ids;
+    uint64_t** obj_values;
+    uint32_t* obj_counts;
+} mydrm_props_build_t;
+
+static inline uint32_t mydrm_prop_hash(const char* name, uint32_t seed)
+{
+    uint32_t h = 2166136261u ^ seed;
+
+    while (*name)
+    {
+        h ^= (uint8_t)*name++;
+        h *= 16777619u;
+    }
+
+    return h ^ (h >> 15);
+}
+
+static const char* mydrm_props_name(mydrm_props_build_t* b, uint32_t prop_id)
+{
+    struct drm_mode_get_property prop;
+
+    for (uint32_t i = 0; i < b->n_known; i++)
+        if (b->known[i].id == prop_id)
+            return b->known[i].name;
+
+    if (b->n_known == b->max_known)
+        return NULL;
+
+    /* No values/enums wanted, only the name */
+    memset(&prop, 0, sizeof(struct drm_mode_get_property));
+    prop.prop_id = prop_id;
+
+    b->props->ioctls++;
+    if (mydrm_ioctl(b->fd, DRM_IOCTL_MODE_GETPROPERTY, &prop) == -1)
+        return NULL;
+
+    b->known[b->n_known].id = prop_id;
+    memcpy(b->known[b->n_known].name, prop.name, DRM_PROP_NAME_LEN);
+    b->known[b->n_known].name[DRM_PROP_NAME_LEN - 1] = '\0';
+
+    return b->known[b->n_known++].name;
+}
+
+static int mydrm_props_get(mydrm_props_build_t* b, uint32_t obj, uint32_t obj_id, uint32_t obj_type)
+{
+    struct drm_mode_obj_get_properties req;
+
+retry:
+    memset(&req, 0, sizeof(struct drm_mode_obj_get_properties));
+    req.obj_id = obj_id;
+    req.obj_type = obj_type;
+
+    b->props->ioctls++;
+    if (mydrm_ioctl(b->fd, DRM_IOCTL_MODE_OBJ_GETPROPERTIES, &req) == -1)
+        return -1;
+
+    b->obj_counts[obj] = req.count_props;
+    if (!req.count_props)
+        return 0;
+
+    b->obj_ids[obj] = mydrm_arena_alloc(b->arena, req.count_props * sizeof(uint32_t));
+    b->obj_values[obj] = mydrm_arena_alloc(b->arena, req.count_props * sizeof(uint64_t));
+    if (!b->obj_ids[obj] || !b->obj_values[obj])
+        return -ENOMEM;
+
+    req.props_ptr = (uint64_t)b->obj_ids[obj];
+    req.prop_values_ptr = (uint64_t)b->obj_values[obj];
+
+    b->props->ioctls++;
+    if (mydrm_ioctl(b->fd, DRM_IOCTL_MODE_OBJ_GETPROPERTIES, &req) == -1)
+        return -1;
+
+    if (req.count_props > b->obj_counts[obj])
+        goto retry;
+    b->obj_counts[obj] = req.count_props;
+
+    return 0;
+}
+
+/*
+ * Slot for a name while building, adds it if it's new
+ */
+static int mydrm_props_add_name(mydrm_prop_type_t* t, const char* name)
+{
+    for (uint32_t i = 0; i < t->n_names; i++)
+        if (!strcmp(t->names[i], name))
+            return i;
+
+    if (t->n_names == t->max_names)
+        return -1;
+
+    strcpy(t->names[t->n_names], name);
+
+    return t->n_names++;
+}
+
+/*
+ * Find a seed that puts every name of the type in its own table entry,
+ * doubling the table whenever no seed within the budget works
+ */
+static int mydrm_props_perfect_hash(mydrm_props_build_t* b, mydrm_prop_type_t* t)
+{
+    uint32_t size = 16;
+
+    while (size < t->n_names * 2)
+        size <<= 1;
+
+    for (; size <= MYDRM_PROP_MAX_TABLE; size <<= 1)
+    {
+        if ((t->table = mydrm_arena_alloc(b->arena, size)) == NULL)
+            return -ENOMEM;
+
+        t->mask = size - 1;
+
+        for (uint32_t seed = 1; seed <= 1024; seed++)
+        {
+            uint32_t i;
+
+            memset(t->table, 0, size);
+            for (i = 0; i < t->n_names; i++)
+            {
+                uint8_t* entry = &t->table[mydrm_prop_hash(t->names[i], seed) & t->mask];
+
+                if (*entry)
+                    break;
+                *entry = i + 1;
+            }
+
+            if (i == t->n_names)
+            {
+                t->seed = seed;
+                return 0;
+            }
+        }
+    }
+
+    return -1;
+}
+
+int mydrm_props_build(int fd, mydrm_props_t* props, struct drm_mode_card_res* res, struct drm_mode_get_connector* conns, mydrm_arena_t* arena)
+{
+    struct drm_mode_get_plane_res plane_res;
+    struct drm_set_client_cap client_cap;
+    mydrm_props_build_t b;
+    uint32_t* plane_ids = NULL;
+    uint64_t generation = props->generation;
+    uint32_t per_type[MYDRM_PROP_TYPES] = { 0 };
+    uint32_t n_planes = 0;
+    uint32_t n = 0;
+    int ret;
+
+    memset(props, 0, sizeof(mydrm_props_t));
+    props->generation = generation + 1;
+
+    memset(&b, 0, sizeof(mydrm_props_build_t));
+    b.fd = fd;
+    b.props = props;
+    b.arena = arena;
+
+    /* Primary and cursor planes too, not just overlays */
+    memset(&client_cap, 0, sizeof(struct drm_set_client_cap));
+    client_cap.capability = DRM_CLIENT_CAP_UNIVERSAL_PLANES;
+    client_cap.value = 1;
+    mydrm_ioctl(fd, DRM_IOCTL_SET_CLIENT_CAP, &client_cap);
+
+    memset(&plane_res, 0, sizeof(struct drm_mode_get_plane_res));
+    props->ioctls++;
+    if (mydrm_ioctl(fd, DRM_IOCTL_MODE_GETPLANERESOURCES, &plane_res) == 0 && plane_res.count_planes)
+    {
+        if ((plane_ids = mydrm_arena_alloc(arena, plane_res.count_planes * sizeof(uint32_t))) == NULL)
+            return -ENOMEM;
+
+        plane_res.plane_id_ptr = (uint64_t)plane_ids;
+        props->ioctls++;
+        if (mydrm_ioctl(fd, DRM_IOCTL_MODE_GETPLANERESOURCES, &plane_res) == 0)
+            n_planes = plane_res.count_planes;
+    }
+
+    props->n_objs = res->count_connectors + res->count_crtcs + n_planes;
+    props->objs = mydrm_arena_alloc(arena, props->n_objs * sizeof(mydrm_prop_obj_t));
+    b.obj_ids = mydrm_arena_alloc(arena, props->n_objs * sizeof(uint32_t*));
+    b.obj_values = mydrm_arena_alloc(arena, props->n_objs * sizeof(uint64_t*));
+    b.obj_counts = mydrm_arena_alloc(arena, props->n_objs * sizeof(uint32_t));
+
+    if (props->n_objs && (!props->objs || !b.obj_ids || !b.obj_values || !b.obj_counts))
+        return -ENOMEM;
+
+    /* Raw properties of every object */
+    for (uint32_t i = 0; i < res->count_connectors; i++, n++)
+    {
+        props->objs[n].id = ((uint32_t*)res->connector_id_ptr)[i];
+        props->objs[n].type = MYDRM_PROP_TYPE_CONNECTOR;
+
+        /* GETCONNECTOR already returned them */
+        if (conns && conns[i].connector_id == props->objs[n].id)
+        {
+            b.obj_ids[n] = (uint32_t*)conns[i].props_ptr;
+            b.obj_values[n] = (uint64_t*)conns[i].prop_values_ptr;
+            b.obj_counts[n] = conns[i].count_props;
+        }
+        else if ((ret = mydrm_props_get(&b, n, props->objs[n].id, DRM_MODE_OBJECT_CONNECTOR)))
+            return ret;
+    }
+
+    for (uint32_t i = 0; i < res->count_crtcs; i++, n++)
+    {
+        props->objs[n].id = ((uint32_t*)res->crtc_id_ptr)[i];
+        props->objs[n].type = MYDRM_PROP_TYPE_CRTC;
+
+        if ((ret = mydrm_props_get(&b, n, props->objs[n].id, DRM_MODE_OBJECT_CRTC)))
+            return ret;
+    }
+
+    for (uint32_t i = 0; i < n_planes; i++, n++)
+    {
+        props->objs[n].id = plane_ids[i];
+        props->objs[n].type = MYDRM_PROP_TYPE_PLANE;
+
+        if ((ret = mydrm_props_get(&b, n, props->objs[n].id, DRM_MODE_OBJECT_PLANE)))
+            return ret;
+    }
+
+    /* Sized for the worst case, every property of every object distinct */
+    for (uint32_t o = 0; o < props->n_objs; o++)
+    {
+        per_type[props->objs[o].type] += b.obj_counts[o];
+        b.max_known += b.obj_counts[o];
+    }
+
+    if ((b.known = mydrm_arena_alloc(arena, b.max_known * sizeof(mydrm_prop_name_t))) == NULL)
+        return -ENOMEM;
+
+    for (uint32_t t = 0; t < MYDRM_PROP_TYPES; t++)
+    {
+        if (per_type[t] > MYDRM_PROP_MAX_NAMES)
+            per_type[t] = MYDRM_PROP_MAX_NAMES;
+        if ((props->types[t].names = mydrm_arena_alloc(arena, per_type[t] * DRM_PROP_NAME_LEN)) == NULL)
+            return -ENOMEM;
+        props->types[t].max_names = per_type[t];
+    }
+
+    /* Names per object type */
+    for (uint32_t o = 0; o < props->n_objs; o++)
+    {
+        for (uint32_t p = 0; p < b.obj_counts[o]; p++)
+        {
+            const char* name = mydrm_props_name(&b, b.obj_ids[o][p]);
+
+            if (name)
+                mydrm_props_add_name(&props->types[props->objs[o].type], name);
+        }
+    }
+
+    for (uint32_t t = 0; t < MYDRM_PROP_TYPES; t++)
+    {
+        if ((ret = mydrm_props_perfect_hash(&b, &props->types[t])))
+        {
+            fprintf(stderr, "mydrm: No perfect hash for %u property names\n", props->types[t].n_names);
+            return ret;
+        }
+    }
+
+    /* Each object's IDs and values by slot */
+    for (uint32_t o = 0; o < props->n_objs; o++)
+    {
+        mydrm_prop_obj_t* obj = &props->objs[o];
+        mydrm_prop_type_t* t = &props->types[obj->type];
+
+        obj->prop_ids = mydrm_arena_alloc(arena, (t->n_names + 1) * sizeof(uint32_t));
+        obj->values = mydrm_arena_alloc(arena, (t->n_names + 1) * sizeof(uint64_t));
+        if (!obj->prop_ids || !obj->values)
+            return -ENOMEM;
+
+        for (uint32_t p = 0; p < b.obj_counts[o]; p++)
+        {
+            const char* name = mydrm_props_name(&b, b.obj_ids[o][p]);
+            int slot;
+
+            if (name && (slot = mydrm_props_slot(props, obj->type, name)) != -1)
+            {
+                obj->prop_ids[slot] = b.obj_ids[o][p];
+                obj->values[slot] = b.obj_values[o][p];
+            }
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * Name -> slot, -1 if no object of this type has the property
+ */
+int mydrm_props_slot(mydrm_props_t* props, uint32_t type, const char* name)
+{
+    mydrm_prop_type_t* t = &props->types[type];
+    uint8_t entry;
+
+    if (!t->table)
+        return -1;
+
+    entry = t->table[mydrm_prop_hash(name, t->seed) & t->mask];
+    if (!entry || strcmp(t->names[entry - 1], name))
+        return -1;
+
+    return entry - 1;
+}
+
+mydrm_prop_obj_t* mydrm_props_obj(mydrm_props_t* props, uint32_t type, uint32_t obj_id)
+{
+    for (uint32_t i = 0; i < props->n_objs; i++)
+        if (props->objs[i].id == obj_id && props->objs[i].type == type)
+            return &props->objs[i];
+
+    return NULL;
+}
+
+uint32_t mydrm_props_id(mydrm_props_t* props, uint32_t type, uint32_t obj_id, const char* name)
+{
+    mydrm_prop_obj_t* obj = mydrm_props_obj(props, type, obj_id);
+    int slot = mydrm_props_slot(props, type, name);
+
+    if (!obj || slot == -1)
+        return 0;
+
+    return obj->prop_ids[slot];
+}
+
+bool mydrm_props_value(mydrm_props_t* props, uint32_t type, uint32_t obj_id, const char* name, uint64_t* value)
+{
+    mydrm_prop_obj_t* obj = mydrm_props_obj(props, type, obj_id);
+    int slot = mydrm_props_slot(props, type, name);
+
+    if (!obj || slot == -1 || !obj->prop_ids[slot])
+        return false;
+
+    *value = obj->values[slot];
+    return true;
+}
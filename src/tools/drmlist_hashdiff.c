@@ -0,0 +1,248 @@
+/*
+ * drmlist_hashdiff - Compares two DRMLIST_HASH logs
+ *
+ *  drmlist_hashdiff <golden> <run>
+ *
+ * Frames are matched by sequence number. For every frame whose hash differs
+ * the differing tiles and the rectangle around them are printed (the first
+ * DIFF_MAX_PRINTED), frames in only one log are counted. Exits 0 when every
+ * common frame matches, 1 when some differ, 2 on errors.
+ */
+
+#include "mydrm/mydrm.h"
+
+#define DIFF_MAX_PRINTED 20
+
+typedef struct
+{
+    FILE* f;
+    const char* path;
+    char* line;
+    size_t line_size;
+    unsigned long lineno;
+
+    /* Last header */
+    uint32_t width;
+    uint32_t height;
+    uint32_t tile;
+    uint32_t tiles_x;
+    uint32_t tiles_y;
+
+    /* Last frame */
+    uint64_t seq;
+    uint32_t frame;
+    uint32_t* tiles;
+    size_t n_tiles;
+} hashlog_t;
+
+static int hashlog_open(hashlog_t* log, const char* path)
+{
+    memset(log, 0, sizeof(hashlog_t));
+    log->path = path;
+
+    if ((log->f = fopen(path, "r")) == NULL)
+    {
+        perror(path);
+        return -1;
+    }
+
+    return 0;
+}
+
+/* 1 with the next frame in `log`, 0 at the end, -1 on errors */
+static int hashlog_next(hashlog_t* log)
+{
+    while (getline(&log->line, &log->line_size, log->f) != -1)
+    {
+        char* p = log->line;
+        char* end;
+
+        log->lineno++;
+
+        if (p[0] == '#')
+        {
+            if (sscanf(p, "# crc32c %ux%u tile %u %ux%u", &log->width, &log->height, &log->tile,
+                       &log->tiles_x, &log->tiles_y) != 5)
+                continue;
+
+            if ((size_t)log->tiles_x * log->tiles_y > log->n_tiles)
+            {
+                uint32_t* tiles = realloc(log->tiles, (size_t)log->tiles_x * log->tiles_y * sizeof(uint32_t));
+
+                if (!tiles)
+                {
+                    perror("realloc");
+                    return -1;
+                }
+                log->tiles = tiles;
+                log->n_tiles = (size_t)log->tiles_x * log->tiles_y;
+            }
+            continue;
+        }
+
+        if (p[0] == '\n' || p[0] == '\0')
+            continue;
+
+        if (!log->width)
+        {
+            fprintf(stderr, "%s:%lu: Frame before the first header\n", log->path, log->lineno);
+            return -1;
+        }
+
+        log->seq = strtoull(p, &end, 10);
+        if (end == p)
+            goto malformed;
+        p = end;
+
+        log->frame = strtoul(p, &end, 16);
+        if (end == p)
+            goto malformed;
+        p = end;
+
+        /* Tile 0 logs only the frame hash */
+        if (log->tile)
+        {
+            for (uint32_t i = 0; i < log->tiles_x * log->tiles_y; i++)
+            {
+                log->tiles[i] = strtoul(p, &end, 16);
+                if (end == p)
+                    goto malformed;
+                p = end;
+            }
+        }
+
+        return 1;
+
+malformed:
+        fprintf(stderr, "%s:%lu: Malformed frame line\n", log->path, log->lineno);
+        return -1;
+    }
+
+    return 0;
+}
+
+static void hashlog_close(hashlog_t* log)
+{
+    if (log->f)
+        fclose(log->f);
+    free(log->line);
+    free(log->tiles);
+}
+
+/* Prints the differing tiles of a frame hashed with the same geometry in both logs */
+static void diff_frame(hashlog_t* a, hashlog_t* b)
+{
+    uint32_t x1 = UINT32_MAX, y1 = UINT32_MAX, x2 = 0, y2 = 0;
+    uint32_t changed = 0;
+
+    if (!a->tile)
+    {
+        printf("frame %lu: %08x != %08x (whole frame hashes)\n", a->seq, a->frame, b->frame);
+        return;
+    }
+
+    for (uint32_t ty = 0; ty < a->tiles_y; ty++)
+    {
+        for (uint32_t tx = 0; tx < a->tiles_x; tx++)
+        {
+            uint32_t i = ty * a->tiles_x + tx;
+
+            if (a->tiles[i] == b->tiles[i])
+                continue;
+
+            changed++;
+            if (tx * a->tile < x1)
+                x1 = tx * a->tile;
+            if (ty * a->tile < y1)
+                y1 = ty * a->tile;
+            if ((tx + 1) * a->tile > x2)
+                x2 = (tx + 1) * a->tile;
+            if ((ty + 1) * a->tile > y2)
+                y2 = (ty + 1) * a->tile;
+        }
+    }
+
+    if (x2 > a->width)
+        x2 = a->width;
+    if (y2 > a->height)
+        y2 = a->height;
+
+    if (changed)
+        printf("frame %lu: %u of %u tiles differ, region %u,%u - %u,%u (%ux%u)\n", a->seq, changed,
+                        a->tiles_x * a->tiles_y, x1, y1, x2, y2, x2 - x1, y2 - y1);
+    else
+        printf("frame %lu: %08x != %08x with the same tiles\n", a->seq, a->frame, b->frame);
+}
+
+int main(int argc, const char** argv)
+{
+    hashlog_t a = { 0 }, b = { 0 };
+    uint64_t compared = 0, differ = 0, only_a = 0, only_b = 0;
+    int ra, rb;
+    int ret = 2;
+
+    if (argc < 3)
+    {
+        fprintf(stderr, "Usage: %s <golden> <run>\n", argv[0]);
+        return 2;
+    }
+
+    if (hashlog_open(&a, argv[1]) || hashlog_open(&b, argv[2]))
+        goto out;
+
+    ra = hashlog_next(&a);
+    rb = hashlog_next(&b);
+
+    while (ra == 1 && rb == 1)
+    {
+        if (a.seq < b.seq)
+        {
+            only_a++;
+            ra = hashlog_next(&a);
+            continue;
+        }
+        if (b.seq < a.seq)
+        {
+            only_b++;
+            rb = hashlog_next(&b);
+            continue;
+        }
+
+        compared++;
+
+        if (a.width != b.width || a.height != b.height || a.tile != b.tile)
+        {
+            if (differ++ < DIFF_MAX_PRINTED)
+                printf("frame %lu: %ux%u tile %u != %ux%u tile %u\n", a.seq, a.width, a.height, a.tile,
+                                b.width, b.height, b.tile);
+        }
+        else if (a.frame != b.frame)
+        {
+            if (differ++ < DIFF_MAX_PRINTED)
+                diff_frame(&a, &b);
+        }
+
+        ra = hashlog_next(&a);
+        rb = hashlog_next(&b);
+    }
+
+    for (; ra == 1; ra = hashlog_next(&a))
+        only_a++;
+    for (; rb == 1; rb = hashlog_next(&b))
+        only_b++;
+
+    if (ra == -1 || rb == -1)
+        goto out;
+
+    if (differ > DIFF_MAX_PRINTED)
+        printf("... %lu more\n", differ - DIFF_MAX_PRINTED);
+    printf("%lu frames compared, %lu differ, %lu only in %s, %lu only in %s\n",
+                    compared, differ, only_a, a.path, only_b, b.path);
+
+    ret = differ ? 1 : 0;
+
+out:
+    hashlog_close(&a);
+    hashlog_close(&b);
+    return ret;
+}
@@ -0,0 +1,836 @@
+/*
+ * drmlist_ioctl_trace - Records and replays the DRM device, LD_PRELOAD
+ *
+ *  DRMLIST_IOCTL_RECORD=run.ioctl LD_PRELOAD=./libdrmlist_ioctl_trace.so drmlist HDMI-A 1920x1080
+ *  DRMLIST_IOCTL_REPLAY=run.ioctl LD_PRELOAD=./libdrmlist_ioctl_trace.so drmlist HDMI-A 1920x1080
+ *
+ * Recording interposes open, ioctl, read and close on the files under
+ * /dev/dri (or DRMLIST_PATH) and logs every ioctl with its argument before
+ * and after the call, the arrays it points to, its result and the time it
+ * took, and every read with the events it returned.
+ *
+ * Replaying needs no device: opening it hands out an eventfd, readable while
+ * the next record is a read, so the event loop wakes up for recorded events
+ * as it would for the real ones. Every ioctl must be the next one of the
+ * trace, its result, output arrays and errno are copied back to the caller.
+ * Mappings of the device become anonymous memory, exported PRIME buffers
+ * memfds.
+ *
+ * An ioctl other than the recorded one, or one past the end of the trace, is
+ * a divergence, replay stops there with exit status 3. Arguments that differ
+ * from the recorded ones (modes, framebuffer IDs, damage clips) are reported
+ * and also fail the run at exit, as do records left unreplayed. Runs that end
+ * on their own replay cleanly, e.g. with the mouse replayed from a
+ * DRMLIST_INPUT_RECORD log and DRMLIST_INPUT_REPLAY_EXIT.
+ *
+ * Both modes force the epoll event loop, io_uring reads bypass libc.
+ */
+
+#define _GNU_SOURCE
+#include "drmlist.h"
+
+#include <dlfcn.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/eventfd.h>
+
+#define TRACE_MAGIC     0x4F494C44  // "DLIO"
+#define TRACE_VERSION   1
+#define TRACE_MAX_FDS   8
+#define TRACE_MAX_ARRAYS 4
+#define TRACE_MAX_WARNINGS 16
+#define TRACE_EXIT_DIVERGED 3
+#define TRACE_ALIGN(size) (((size) + 7) & ~(size_t)7)
+
+enum trace_record_type
+{
+    TRACE_OPEN = 1,
+    TRACE_IOCTL = 2,
+    TRACE_READ = 3
+};
+
+typedef struct
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t record_size;       // sizeof(trace_record_t)
+    uint32_t reserved;
+} trace_header_t;
+
+/*
+ * Followed by `size` bytes, padded to 8:
+ *  TRACE_OPEN   the path
+ *  TRACE_IOCTL  the argument before and after the call (_IOC_SIZE bytes each),
+ *               then per array of the request a uint32_t length and the bytes
+ *  TRACE_READ   the bytes read
+ */
+typedef struct
+{
+    uint32_t type;
+    uint32_t size;
+    uint64_t request;           // ioctl request, read length
+    int64_t ret;                // -errno on failure
+    uint64_t ns;                // spent in the call
+} trace_record_t;
+
+_Static_assert(sizeof(trace_record_t) == 32, "trace_record_t is part of the trace format");
+
+/*
+ * Pointers in ioctl arguments
+ */
+enum trace_array_flags
+{
+    TRACE_ARRAY_IN = 1,         // read by the kernel, compared on replay
+    TRACE_ARRAY_OUT = 2,        // written by the kernel, up to the caller's count
+    TRACE_ARRAY_OPAQUE = 3      // only masked, user data or arrays not followed
+};
+
+typedef struct
+{
+    uint16_t ptr;               // offset of the pointer
+    uint16_t count;             // offset of the element count
+    uint8_t count_size;
+    uint8_t flags;
+    uint16_t elem_size;
+} trace_array_t;
+
+typedef struct
+{
+    unsigned long request;
+    const char* name;
+    int n_arrays;
+    trace_array_t arrays[TRACE_MAX_ARRAYS];
+} trace_ioctl_t;
+
+#define ARRAY(type, ptr, count, elem, flags) { offsetof(type, ptr), offsetof(type, count), sizeof(((type*)0)->count), flags, elem }
+#define OPAQUE(type, ptr) { offsetof(type, ptr), 0, 0, TRACE_ARRAY_OPAQUE, 0 }
+
+static const trace_ioctl_t trace_ioctls[] = {
+    { DRM_IOCTL_VERSION, "VERSION", 3, {
+        ARRAY(struct drm_version, name, name_len, 1, TRACE_ARRAY_OUT),
+        ARRAY(struct drm_version, date, date_len, 1, TRACE_ARRAY_OUT),
+        ARRAY(struct drm_version, desc, desc_len, 1, TRACE_ARRAY_OUT) } },
+    { DRM_IOCTL_GET_CAP, "GET_CAP", 0, { } },
+    { DRM_IOCTL_SET_CLIENT_CAP, "SET_CLIENT_CAP", 0, { } },
+    { DRM_IOCTL_SET_MASTER, "SET_MASTER", 0, { } },
+    { DRM_IOCTL_DROP_MASTER, "DROP_MASTER", 0, { } },
+    { DRM_IOCTL_PRIME_HANDLE_TO_FD, "PRIME_HANDLE_TO_FD", 0, { } },
+    { DRM_IOCTL_MODE_GETRESOURCES, "MODE_GETRESOURCES", 4, {
+        ARRAY(struct drm_mode_card_res, fb_id_ptr, count_fbs, 4, TRACE_ARRAY_OUT),
+        ARRAY(struct drm_mode_card_res, crtc_id_ptr, count_crtcs, 4, TRACE_ARRAY_OUT),
+        ARRAY(struct drm_mode_card_res, connector_id_ptr, count_connectors, 4, TRACE_ARRAY_OUT),
+        ARRAY(struct drm_mode_card_res, encoder_id_ptr, count_encoders, 4, TRACE_ARRAY_OUT) } },
+    { DRM_IOCTL_MODE_GETCRTC, "MODE_GETCRTC", 1, {
+        ARRAY(struct drm_mode_crtc, set_connectors_ptr, count_connectors, 4, TRACE_ARRAY_IN) } },
+    { DRM_IOCTL_MODE_SETCRTC, "MODE_SETCRTC", 1, {
+        ARRAY(struct drm_mode_crtc, set_connectors_ptr, count_connectors, 4, TRACE_ARRAY_IN) } },
+    { DRM_IOCTL_MODE_CURSOR, "MODE_CURSOR", 0, { } },
+    { DRM_IOCTL_MODE_GETGAMMA, "MODE_GETGAMMA", 3, {
+        ARRAY(struct drm_mode_crtc_lut, red, gamma_size, 2, TRACE_ARRAY_OUT),
+        ARRAY(struct drm_mode_crtc_lut, green, gamma_size, 2, TRACE_ARRAY_OUT),
+        ARRAY(struct drm_mode_crtc_lut, blue, gamma_size, 2, TRACE_ARRAY_OUT) } },
+    { DRM_IOCTL_MODE_SETGAMMA, "MODE_SETGAMMA", 3, {
+        ARRAY(struct drm_mode_crtc_lut, red, gamma_size, 2, TRACE_ARRAY_IN),
+        ARRAY(struct drm_mode_crtc_lut, green, gamma_size, 2, TRACE_ARRAY_IN),
+        ARRAY(struct drm_mode_crtc_lut, blue, gamma_size, 2, TRACE_ARRAY_IN) } },
+    { DRM_IOCTL_MODE_GETENCODER, "MODE_GETENCODER", 0, { } },
+    { DRM_IOCTL_MODE_GETCONNECTOR, "MODE_GETCONNECTOR", 4, {
+        ARRAY(struct drm_mode_get_connector, encoders_ptr, count_encoders, 4, TRACE_ARRAY_OUT),
+        ARRAY(struct drm_mode_get_connector, modes_ptr, count_modes, sizeof(struct drm_mode_modeinfo), TRACE_ARRAY_OUT),
+        ARRAY(struct drm_mode_get_connector, props_ptr, count_props, 4, TRACE_ARRAY_OUT),
+        ARRAY(struct drm_mode_get_connector, prop_values_ptr, count_props, 8, TRACE_ARRAY_OUT) } },
+    { DRM_IOCTL_MODE_GETPROPERTY, "MODE_GETPROPERTY", 2, {
+        ARRAY(struct drm_mode_get_property, values_ptr, count_values, 8, TRACE_ARRAY_OUT),
+        ARRAY(struct drm_mode_get_property, enum_blob_ptr, count_enum_blobs, sizeof(struct drm_mode_property_enum), TRACE_ARRAY_OUT) } },
+    { DRM_IOCTL_MODE_GETPROPBLOB, "MODE_GETPROPBLOB", 1, {
+        ARRAY(struct drm_mode_get_blob, data, length, 1, TRACE_ARRAY_OUT) } },
+    { DRM_IOCTL_MODE_CREATEPROPBLOB, "MODE_CREATEPROPBLOB", 1, {
+        ARRAY(struct drm_mode_create_blob, data, length, 1, TRACE_ARRAY_IN) } },
+    { DRM_IOCTL_MODE_DESTROYPROPBLOB, "MODE_DESTROYPROPBLOB", 0, { } },
+    { DRM_IOCTL_MODE_ADDFB, "MODE_ADDFB", 0, { } },
+    { DRM_IOCTL_MODE_RMFB, "MODE_RMFB", 0, { } },
+    { DRM_IOCTL_MODE_PAGE_FLIP, "MODE_PAGE_FLIP", 1, {
+        OPAQUE(struct drm_mode_crtc_page_flip, user_data) } },
+    { DRM_IOCTL_MODE_DIRTYFB, "MODE_DIRTYFB", 1, {
+        ARRAY(struct drm_mode_fb_dirty_cmd, clips_ptr, num_clips, sizeof(struct drm_clip_rect), TRACE_ARRAY_IN) } },
+    { DRM_IOCTL_MODE_CREATE_DUMB, "MODE_CREATE_DUMB", 0, { } },
+    { DRM_IOCTL_MODE_MAP_DUMB, "MODE_MAP_DUMB", 0, { } },
+    { DRM_IOCTL_MODE_DESTROY_DUMB, "MODE_DESTROY_DUMB", 0, { } },
+    { DRM_IOCTL_MODE_GETPLANERESOURCES, "MODE_GETPLANERESOURCES", 1, {
+        ARRAY(struct drm_mode_get_plane_res, plane_id_ptr, count_planes, 4, TRACE_ARRAY_OUT) } },
+    { DRM_IOCTL_MODE_GETPLANE, "MODE_GETPLANE", 1, {
+        ARRAY(struct drm_mode_get_plane, format_type_ptr, count_format_types, 4, TRACE_ARRAY_OUT) } },
+    { DRM_IOCTL_MODE_OBJ_GETPROPERTIES, "MODE_OBJ_GETPROPERTIES", 2, {
+        ARRAY(struct drm_mode_obj_get_properties, props_ptr, count_props, 4, TRACE_ARRAY_OUT),
+        ARRAY(struct drm_mode_obj_get_properties, prop_values_ptr, count_props, 8, TRACE_ARRAY_OUT) } },
+    { DRM_IOCTL_MODE_OBJ_SETPROPERTY, "MODE_OBJ_SETPROPERTY", 0, { } },
+    { DRM_IOCTL_MODE_ATOMIC, "MODE_ATOMIC", 4, {
+        OPAQUE(struct drm_mode_atomic, objs_ptr),
+        OPAQUE(struct drm_mode_atomic, count_props_ptr),
+        OPAQUE(struct drm_mode_atomic, props_ptr),
+        OPAQUE(struct drm_mode_atomic, prop_values_ptr) } },
+};
+
+#define TRACE_N_IOCTLS (sizeof(trace_ioctls) / sizeof(trace_ioctls[0]))
+
+/* Requests not in the table are traced by their argument only */
+static const trace_ioctl_t trace_ioctl_unknown = { 0, NULL, 0, { } };
+
+typedef struct
+{
+    uint64_t count;
+    uint64_t ns;
+} trace_cost_t;
+
+static struct
+{
+    int (*open)(const char* path, int flags, ...);
+    int (*openat)(int dir_fd, const char* path, int flags, ...);
+    int (*ioctl)(int fd, unsigned long request, ...);
+    ssize_t (*read)(int fd, void* buf, size_t count);
+    int (*close)(int fd);
+    void* (*mmap)(void* addr, size_t length, int prot, int flags, int fd, off_t offset);
+} real;
+
+static pthread_mutex_t trace_lock = PTHREAD_MUTEX_INITIALIZER;
+static const char* drm_path;
+static int fds[TRACE_MAX_FDS];
+static int n_fds;
+
+/* Recording */
+static FILE* record_file;
+static uint64_t recorded;
+static trace_cost_t costs[TRACE_N_IOCTLS + 1];  // last one for the requests not in the table
+
+/* Replaying */
+static const char* replay_path;
+static uint8_t* replay_map;
+static size_t replay_map_size;
+static const trace_record_t** records;
+static size_t n_records;
+static size_t next_record;
+static uint64_t mismatches;
+static bool ready;                              // the eventfds are readable
+
+static uint64_t trace_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void trace_resolve(void)
+{
+    if (real.ioctl)
+        return;
+
+    real.open = dlsym(RTLD_NEXT, "open");
+    real.openat = dlsym(RTLD_NEXT, "openat");
+    real.read = dlsym(RTLD_NEXT, "read");
+    real.close = dlsym(RTLD_NEXT, "close");
+    real.mmap = dlsym(RTLD_NEXT, "mmap");
+    real.ioctl = dlsym(RTLD_NEXT, "ioctl");
+}
+
+static const trace_ioctl_t* trace_find(unsigned long request)
+{
+    for (size_t i = 0; i < TRACE_N_IOCTLS; i++)
+        if (trace_ioctls[i].request == request)
+            return &trace_ioctls[i];
+
+    return &trace_ioctl_unknown;
+}
+
+static const char* trace_name(unsigned long request, char* buf, size_t size)
+{
+    const trace_ioctl_t* desc = trace_find(request);
+
+    if (desc->name)
+        return desc->name;
+
+    snprintf(buf, size, "ioctl 0x%lx", request);
+    return buf;
+}
+
+static size_t trace_arg_size(unsigned long request)
+{
+    return _IOC_DIR(request) == _IOC_NONE ? 0 : _IOC_SIZE(request);
+}
+
+static uint64_t trace_get(const uint8_t* arg, uint16_t offset, uint8_t size)
+{
+    uint32_t v32;
+    uint64_t v64;
+
+    if (size == 4)
+    {
+        memcpy(&v32, arg + offset, 4);
+        return v32;
+    }
+
+    memcpy(&v64, arg + offset, 8);
+    return v64;
+}
+
+/*
+ * Bytes of an array, the caller's count before the call bounds what the
+ * kernel wrote, its count after the call what it had
+ */
+static size_t trace_array_bytes(const trace_array_t* a, const uint8_t* before, const uint8_t* after)
+{
+    uint64_t in = trace_get(before, a->count, a->count_size);
+    uint64_t out = trace_get(after, a->count, a->count_size);
+
+    if (a->flags == TRACE_ARRAY_OPAQUE || !trace_get(before, a->ptr, 8))
+        return 0;
+
+    return (a->flags == TRACE_ARRAY_OUT && out < in ? out : in) * a->elem_size;
+}
+
+static int trace_fd_index(int fd)
+{
+    for (int i = 0; i < n_fds; i++)
+        if (fds[i] == fd)
+            return i;
+
+    return -1;
+}
+
+static bool trace_is_drm(int fd)
+{
+    bool ret;
+
+    if (fd < 0)
+        return false;
+
+    pthread_mutex_lock(&trace_lock);
+    ret = trace_fd_index(fd) != -1;
+    pthread_mutex_unlock(&trace_lock);
+
+    return ret;
+}
+
+static bool trace_is_drm_path(const char* path)
+{
+    return path && (!strncmp(path, "/dev/dri/", 9) || (drm_path && !strcmp(path, drm_path)));
+}
+
+/*
+ * Recording
+ */
+
+static void record_write(uint32_t type, uint64_t request, int64_t ret, uint64_t ns, uint32_t size)
+{
+    trace_record_t rec = { type, size, request, ret, ns };
+
+    fwrite(&rec, sizeof(trace_record_t), 1, record_file);
+    recorded++;
+}
+
+static void record_pad(uint32_t size)
+{
+    static const uint8_t zero[8];
+
+    fwrite(zero, 1, TRACE_ALIGN(size) - size, record_file);
+}
+
+static void record_open(const char* path, int fd, int err, uint64_t ns)
+{
+    pthread_mutex_lock(&trace_lock);
+
+    record_write(TRACE_OPEN, 0, fd == -1 ? -err : fd, ns, strlen(path) + 1);
+    fwrite(path, 1, strlen(path) + 1, record_file);
+    record_pad(strlen(path) + 1);
+
+    if (fd != -1 && n_fds < TRACE_MAX_FDS)
+        fds[n_fds++] = fd;
+
+    pthread_mutex_unlock(&trace_lock);
+}
+
+static int record_ioctl(int fd, unsigned long request, void* arg)
+{
+    const trace_ioctl_t* desc = trace_find(request);
+    size_t size = arg ? trace_arg_size(request) : 0;
+    uint8_t before[_IOC_SIZEMASK + 1];
+    uint32_t bytes[TRACE_MAX_ARRAYS];
+    uint32_t payload = size * 2;
+    trace_cost_t* cost;
+    uint64_t start, ns;
+    int ret, err;
+
+    memcpy(before, arg, size);
+
+    start = trace_now_ns();
+    ret = real.ioctl(fd, request, arg);
+    err = errno;
+    ns = trace_now_ns() - start;
+
+    for (int i = 0; i < desc->n_arrays; i++)
+        payload += sizeof(uint32_t) + (bytes[i] = size ? trace_array_bytes(&desc->arrays[i], before, arg) : 0);
+
+    pthread_mutex_lock(&trace_lock);
+
+    record_write(TRACE_IOCTL, request, ret == -1 ? -err : ret, ns, payload);
+    fwrite(before, 1, size, record_file);
+    fwrite(arg, 1, size, record_file);
+
+    for (int i = 0; i < desc->n_arrays; i++)
+    {
+        fwrite(&bytes[i], sizeof(uint32_t), 1, record_file);
+        fwrite((const void*)trace_get(before, desc->arrays[i].ptr, 8), 1, bytes[i], record_file);
+    }
+    record_pad(payload);
+
+    cost = &costs[desc->name ? (size_t)(desc - trace_ioctls) : TRACE_N_IOCTLS];
+    cost->count++;
+    cost->ns += ns;
+
+    pthread_mutex_unlock(&trace_lock);
+
+    errno = err;
+    return ret;
+}
+
+static ssize_t record_read(int fd, void* buf, size_t count)
+{
+    uint64_t start = trace_now_ns();
+    ssize_t ret = real.read(fd, buf, count);
+    int err = errno;
+    uint64_t ns = trace_now_ns() - start;
+
+    pthread_mutex_lock(&trace_lock);
+    record_write(TRACE_READ, count, ret == -1 ? -err : ret, ns, ret > 0 ? ret : 0);
+    if (ret > 0)
+    {
+        fwrite(buf, 1, ret, record_file);
+        record_pad(ret);
+    }
+    pthread_mutex_unlock(&trace_lock);
+
+    errno = err;
+    return ret;
+}
+
+/*
+ * Replaying, everything under trace_lock
+ */
+
+static void replay_summary(void)
+{
+    fprintf(stderr, "drmlist_ioctl_trace: replayed %zu of %zu records from %s, %lu argument mismatches\n",
+                    next_record, n_records, replay_path, mismatches);
+}
+
+__attribute__((noreturn)) static void replay_diverged(const char* got)
+{
+    char buf[32];
+    const trace_record_t* rec = next_record < n_records ? records[next_record] : NULL;
+
+    if (!rec)
+        fprintf(stderr, "drmlist_ioctl_trace: replay diverged at record %zu: end of trace, got %s\n", next_record, got);
+    else if (rec->type == TRACE_IOCTL)
+        fprintf(stderr, "drmlist_ioctl_trace: replay diverged at record %zu: expected %s, got %s\n",
+                        next_record, trace_name(rec->request, buf, sizeof(buf)), got);
+    else
+        fprintf(stderr, "drmlist_ioctl_trace: replay diverged at record %zu: expected %s, got %s\n",
+                        next_record, rec->type == TRACE_OPEN ? "open" : "read", got);
+
+    replay_summary();
+    _exit(TRACE_EXIT_DIVERGED);
+}
+
+static void replay_mismatch(const char* what, const char* name)
+{
+    if (mismatches++ < TRACE_MAX_WARNINGS)
+        fprintf(stderr, "drmlist_ioctl_trace: record %zu: %s %s differs from the recording\n", next_record, name, what);
+}
+
+/* Readable eventfds while the next record is a read, the loop waits for it like for the device */
+static void replay_sync_ready(void)
+{
+    bool want = next_record < n_records && records[next_record]->type == TRACE_READ;
+    uint64_t v = 1;
+
+    if (want == ready)
+        return;
+
+    for (int i = 0; i < n_fds; i++)
+    {
+        if ((want ? write(fds[i], &v, sizeof(uint64_t)) : real.read(fds[i], &v, sizeof(uint64_t))) != sizeof(uint64_t))
+            perror("drmlist_ioctl_trace: eventfd");
+    }
+
+    ready = want;
+}
+
+static int replay_load(const char* path)
+{
+    const trace_header_t* header;
+    size_t offset = sizeof(trace_header_t);
+    size_t max_records;
+    struct stat st;
+    int fd;
+
+    if ((fd = real.open(path, O_RDONLY | O_CLOEXEC)) == -1 || fstat(fd, &st) == -1)
+    {
+        perror(path);
+        return -1;
+    }
+
+    replay_map_size = st.st_size;
+    replay_map = real.mmap(NULL, replay_map_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+    real.close(fd);
+
+    if (replay_map == MAP_FAILED)
+    {
+        perror(path);
+        return -1;
+    }
+
+    header = (const trace_header_t*)replay_map;
+    if (replay_map_size < sizeof(trace_header_t) || header->magic != TRACE_MAGIC ||
+        header->version != TRACE_VERSION || header->record_size != sizeof(trace_record_t))
+    {
+        fprintf(stderr, "%s: not a drmlist ioctl trace (version %u)\n", path, TRACE_VERSION);
+        return -1;
+    }
+
+    max_records = replay_map_size / sizeof(trace_record_t);
+    if ((records = malloc(max_records * sizeof(trace_record_t*))) == NULL)
+        return -1;
+
+    while (offset + sizeof(trace_record_t) <= replay_map_size)
+    {
+        const trace_record_t* rec = (const trace_record_t*)(replay_map + offset);
+
+        if (offset + sizeof(trace_record_t) + TRACE_ALIGN(rec->size) > replay_map_size)
+        {
+            fprintf(stderr, "%s: truncated after %zu records\n", path, n_records);
+            break;
+        }
+
+        records[n_records++] = rec;
+        offset += sizeof(trace_record_t) + TRACE_ALIGN(rec->size);
+    }
+
+    return 0;
+}
+
+static int replay_open(const char* path)
+{
+    const trace_record_t* rec;
+    int fd;
+
+    pthread_mutex_lock(&trace_lock);
+
+    if (next_record >= n_records || (rec = records[next_record])->type != TRACE_OPEN)
+        replay_diverged(path);
+
+    if (strcmp((const char*)(rec + 1), path))
+        replay_mismatch("path", path);
+    next_record++;
+
+    if (rec->ret < 0)
+    {
+        pthread_mutex_unlock(&trace_lock);
+        errno = -rec->ret;
+        return -1;
+    }
+
+    /* Stands in for the device, pollable and readable when the trace has events */
+    if ((fd = eventfd(ready ? 1 : 0, EFD_CLOEXEC | EFD_NONBLOCK)) != -1 && n_fds < TRACE_MAX_FDS)
+        fds[n_fds++] = fd;
+
+    replay_sync_ready();
+    pthread_mutex_unlock(&trace_lock);
+
+    return fd;
+}
+
+static int replay_ioctl(unsigned long request, void* arg)
+{
+    const trace_ioctl_t* desc = trace_find(request);
+    size_t size = arg ? trace_arg_size(request) : 0;
+    uint8_t saved[_IOC_SIZEMASK + 1];
+    uint8_t masked[_IOC_SIZEMASK + 1];
+    const trace_record_t* rec;
+    const uint8_t *in, *out, *p;
+    char buf[32];
+    int ret;
+
+    pthread_mutex_lock(&trace_lock);
+
+    if (next_record >= n_records || (rec = records[next_record])->type != TRACE_IOCTL || rec->request != request ||
+        rec->size < size * 2)
+        replay_diverged(trace_name(request, buf, sizeof(buf)));
+
+    in = (const uint8_t*)(rec + 1);
+    out = in + size;
+    p = out + size;
+
+    /* Same argument, but for the pointers */
+    memcpy(saved, arg, size);
+    memcpy(masked, in, size);
+    for (int i = 0; i < desc->n_arrays; i++)
+        memcpy(masked + desc->arrays[i].ptr, saved + desc->arrays[i].ptr, 8);
+    if (memcmp(saved, masked, size))
+        replay_mismatch("argument", trace_name(request, buf, sizeof(buf)));
+
+    /* The kernel's answer, with the caller's pointers */
+    memcpy(arg, out, size);
+    for (int i = 0; i < desc->n_arrays; i++)
+        memcpy((uint8_t*)arg + desc->arrays[i].ptr, saved + desc->arrays[i].ptr, 8);
+
+    for (int i = 0; i < desc->n_arrays; i++)
+    {
+        const trace_array_t* a = &desc->arrays[i];
+        uint8_t* ptr = (uint8_t*)trace_get(saved, a->ptr, 8);
+        size_t cap = trace_get(saved, a->count, a->count_size) * a->elem_size;
+        uint32_t bytes;
+
+        if (a->flags == TRACE_ARRAY_OPAQUE)
+            continue;
+
+        memcpy(&bytes, p, sizeof(uint32_t));
+        p += sizeof(uint32_t);
+
+        if (a->flags == TRACE_ARRAY_IN && (bytes != cap || (bytes && memcmp(ptr, p, bytes))))
+            replay_mismatch("array", trace_name(request, buf, sizeof(buf)));
+        else if (a->flags == TRACE_ARRAY_OUT && ptr)
+            memcpy(ptr, p, bytes < cap ? bytes : cap);
+
+        p += bytes;
+    }
+
+    /* The recorded dma-buf fd means nothing here */
+    if (request == DRM_IOCTL_PRIME_HANDLE_TO_FD && rec->ret == 0)
+        ((struct drm_prime_handle*)arg)->fd = memfd_create("drmlist-prime", MFD_CLOEXEC);
+
+    next_record++;
+    replay_sync_ready();
+    pthread_mutex_unlock(&trace_lock);
+
+    if (rec->ret < 0)
+    {
+        errno = -rec->ret;
+        return -1;
+    }
+
+    ret = rec->ret;
+    return ret;
+}
+
+static ssize_t replay_read(void* buf, size_t count)
+{
+    const trace_record_t* rec;
+    size_t n;
+
+    pthread_mutex_lock(&trace_lock);
+
+    /* Nothing until the program has made the calls recorded before the next event */
+    if (next_record >= n_records || (rec = records[next_record])->type != TRACE_READ)
+    {
+        pthread_mutex_unlock(&trace_lock);
+        errno = EAGAIN;
+        return -1;
+    }
+
+    if (count < rec->size)
+        replay_mismatch("buffer size", "read");
+
+    n = count < rec->size ? count : rec->size;
+    memcpy(buf, rec + 1, n);
+
+    next_record++;
+    replay_sync_ready();
+    pthread_mutex_unlock(&trace_lock);
+
+    if (rec->ret < 0)
+    {
+        errno = -rec->ret;
+        return -1;
+    }
+
+    return n;
+}
+
+/*
+ * Interposed calls
+ */
+
+static int trace_open(int dir_fd, const char* path, int flags, mode_t mode)
+{
+    uint64_t start;
+    int fd;
+
+    if (!trace_is_drm_path(path) || (!record_file && !replay_map))
+        return dir_fd == AT_FDCWD ? real.open(path, flags, mode) : real.openat(dir_fd, path, flags, mode);
+
+    if (replay_map)
+        return replay_open(path);
+
+    start = trace_now_ns();
+    fd = dir_fd == AT_FDCWD ? real.open(path, flags, mode) : real.openat(dir_fd, path, flags, mode);
+    record_open(path, fd, errno, trace_now_ns() - start);
+
+    return fd;
+}
+
+int open(const char* path, int flags, ...)
+{
+    mode_t mode = 0;
+    va_list ap;
+
+    trace_resolve();
+
+    if (flags & (O_CREAT | O_TMPFILE))
+    {
+        va_start(ap, flags);
+        mode = va_arg(ap, mode_t);
+        va_end(ap);
+    }
+
+    return trace_open(AT_FDCWD, path, flags, mode);
+}
+
+int openat(int dir_fd, const char* path, int flags, ...)
+{
+    mode_t mode = 0;
+    va_list ap;
+
+    trace_resolve();
+
+    if (flags & (O_CREAT | O_TMPFILE))
+    {
+        va_start(ap, flags);
+        mode = va_arg(ap, mode_t);
+        va_end(ap);
+    }
+
+    return trace_open(dir_fd, path, flags, mode);
+}
+
+int open64(const char* path, int flags, ...) __attribute__((alias("open")));
+int openat64(int dir_fd, const char* path, int flags, ...) __attribute__((alias("openat")));
+
+int ioctl(int fd, unsigned long request, ...)
+{
+    void* arg;
+    va_list ap;
+
+    trace_resolve();
+
+    va_start(ap, request);
+    arg = va_arg(ap, void*);
+    va_end(ap);
+
+    if (!trace_is_drm(fd))
+        return real.ioctl(fd, request, arg);
+
+    return replay_map ? replay_ioctl(request, arg) : record_ioctl(fd, request, arg);
+}
+
+ssize_t read(int fd, void* buf, size_t count)
+{
+    trace_resolve();
+
+    if (!trace_is_drm(fd))
+        return real.read(fd, buf, count);
+
+    return replay_map ? replay_read(buf, count) : record_read(fd, buf, count);
+}
+
+int close(int fd)
+{
+    int i;
+
+    trace_resolve();
+
+    pthread_mutex_lock(&trace_lock);
+    if (fd >= 0 && (i = trace_fd_index(fd)) != -1)
+        fds[i] = fds[--n_fds];
+    pthread_mutex_unlock(&trace_lock);
+
+    return real.close(fd);
+}
+
+/* Scanout buffers of the stand-in device are plain memory */
+void* mmap(void* addr, size_t length, int prot, int flags, int fd, off_t offset)
+{
+    trace_resolve();
+
+    if (replay_map && trace_is_drm(fd))
+        return real.mmap(addr, length, prot, flags | MAP_ANONYMOUS, -1, 0);
+
+    return real.mmap(addr, length, prot, flags, fd, offset);
+}
+
+void* mmap64(void* addr, size_t length, int prot, int flags, int fd, off_t offset) __attribute__((alias("mmap")));
+
+__attribute__((constructor)) static void trace_init(void)
+{
+    const char* record_path = getenv(ENV_DRMLIST_IOCTL_RECORD);
+    const char* loop = getenv(ENV_DRMLIST_LOOP);
+    trace_header_t header = { TRACE_MAGIC, TRACE_VERSION, sizeof(trace_record_t), 0 };
+
+    trace_resolve();
+
+    drm_path = getenv(ENV_DRMLIST_DRM_PATH);
+    replay_path = getenv(ENV_DRMLIST_IOCTL_REPLAY);
+
+    if (replay_path)
+    {
+        if (replay_load(replay_path))
+            _exit(1);
+
+        fprintf(stderr, "drmlist_ioctl_trace: replaying %zu records from %s\n", n_records, replay_path);
+    }
+    else if (record_path)
+    {
+        if ((record_file = fopen(record_path, "wb")) == NULL)
+        {
+            perror(record_path);
+            _exit(1);
+        }
+
+        fwrite(&header, sizeof(trace_header_t), 1, record_file);
+        fprintf(stderr, "drmlist_ioctl_trace: recording to %s\n", record_path);
+    }
+    else
+        return;
+
+    if (loop && strcmp(loop, "epoll"))
+        fprintf(stderr, "drmlist_ioctl_trace: %s=%s ignored, tracing needs the epoll loop\n", ENV_DRMLIST_LOOP, loop);
+    setenv(ENV_DRMLIST_LOOP, "epoll", 1);
+}
+
+__attribute__((destructor)) static void trace_exit(void)
+{
+    char buf[32];
+
+    if (record_file)
+    {
+        pthread_mutex_lock(&trace_lock);
+        fclose(record_file);
+        record_file = NULL;
+
+        fprintf(stderr, "drmlist_ioctl_trace: %lu records\n%-24s %10s %12s %10s\n", recorded, "ioctl", "count", "total us", "avg us");
+        for (size_t i = 0; i <= TRACE_N_IOCTLS; i++)
+            if (costs[i].count)
+                fprintf(stderr, "%-24s %10lu %12.1f %10.2f\n", i < TRACE_N_IOCTLS ? trace_name(trace_ioctls[i].request, buf, sizeof(buf)) : "other",
+                                costs[i].count, costs[i].ns / 1e3, costs[i].ns / 1e3 / costs[i].count);
+        pthread_mutex_unlock(&trace_lock);
+    }
+
+    if (replay_map)
+    {
+        pthread_mutex_lock(&trace_lock);
+        replay_summary();
+        if (mismatches || next_record != n_records)
+            _exit(TRACE_EXIT_DIVERGED);
+        pthread_mutex_unlock(&trace_lock);
+    }
+}
@@ -0,0 +1,244 @@
+/*
+ * drmlist_producer - Test producer for drmlist's shared-memory ingestion
+ *
+ *  DRMLIST_INGEST=/tmp/drmlist.sock drmlist HDMI-A 1920x1080
+ *  drmlist_producer /tmp/drmlist.sock [frames]
+ *
+ * Renders a moving bar straight into drmlist's scanout buffers and checks the
+ * buffer hand-over protocol along the way.
+ */
+
+#include "drmlist_ingest.h"
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <linux/dma-buf.h>
+#include <time.h>
+
+static int producer_connect(const char* path)
+{
+    struct sockaddr_un addr;
+    int fd;
+
+    if ((fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0)) == -1)
+    {
+        perror("socket");
+        return -1;
+    }
+
+    memset(&addr, 0, sizeof(struct sockaddr_un));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(struct sockaddr_un)) == -1)
+    {
+        char errmsg[PATH_MAX];
+        snprintf(errmsg, PATH_MAX, "Failed to connect to %s", path);
+        perror(errmsg);
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+static int producer_recv_hello(int fd, int* fds, int max_fds)
+{
+    drmlist_ingest_hello_t hello;
+    char cmsg_buf[CMSG_SPACE(sizeof(int) * (2 + DRMLIST_INGEST_MAX_BUFFERS))];
+    struct msghdr msg;
+    struct cmsghdr* cmsg;
+    struct iovec iov;
+    int n_fds;
+
+    iov.iov_base = &hello;
+    iov.iov_len = sizeof(drmlist_ingest_hello_t);
+
+    memset(&msg, 0, sizeof(struct msghdr));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = cmsg_buf;
+    msg.msg_controllen = sizeof(cmsg_buf);
+
+    if (recvmsg(fd, &msg, MSG_CMSG_CLOEXEC) != sizeof(drmlist_ingest_hello_t))
+    {
+        perror("recvmsg hello");
+        return -1;
+    }
+
+    if (hello.magic != DRMLIST_INGEST_MAGIC || hello.version != DRMLIST_INGEST_VERSION)
+    {
+        fprintf(stderr, "Bad hello: magic 0x%x, version %d\n", hello.magic, hello.version);
+        return -1;
+    }
+
+    cmsg = CMSG_FIRSTHDR(&msg);
+    if (!cmsg || cmsg->cmsg_type != SCM_RIGHTS)
+    {
+        fprintf(stderr, "Hello carried no fds\n");
+        return -1;
+    }
+
+    n_fds = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+    if (n_fds != (int)hello.n_fds || n_fds < 3 || n_fds > max_fds)
+    {
+        fprintf(stderr, "Hello announced %d fds, got %d\n", hello.n_fds, n_fds);
+        return -1;
+    }
+
+    memcpy(fds, CMSG_DATA(cmsg), n_fds * sizeof(int));
+    return n_fds;
+}
+
+static void producer_dmabuf_sync(int fd, uint64_t flags)
+{
+    struct dma_buf_sync sync = { .flags = flags };
+
+    if (ioctl(fd, DMA_BUF_IOCTL_SYNC, &sync) == -1)
+        perror("ioctl DMA_BUF_IOCTL_SYNC");
+}
+
+static void producer_render(uint8_t* pixels, drmlist_ingest_ctl_t* ctl, uint64_t frame)
+{
+    uint32_t bar_x = (frame * 8) % ctl->width;
+    uint32_t bar_w = ctl->width / 16;
+
+    for (uint32_t y = 0; y < ctl->height; y++)
+    {
+        uint32_t* row = (uint32_t*)(pixels + (size_t)y * ctl->stride);
+
+        for (uint32_t x = 0; x < ctl->width; x++)
+            row[x] = (x - bar_x < bar_w) ? 0xFFFFFFFF : 0xFF000000 | ((x * 255 / ctl->width) << 16) | (y * 255 / ctl->height);
+    }
+
+    /* Frame number in the first pixel, handy when looking at a capture */
+    ((uint32_t*)pixels)[0] = frame;
+}
+
+int main(int argc, const char** argv)
+{
+    int fds[2 + DRMLIST_INGEST_MAX_BUFFERS];
+    uint8_t* pixels[DRMLIST_INGEST_MAX_BUFFERS];
+    uint64_t submitted_as[DRMLIST_INGEST_MAX_BUFFERS] = { 0 };     // frame number + 1 of the last submission, 0 for none
+    drmlist_ingest_ctl_t* ctl;
+    uint64_t frames = 600;
+    uint64_t submitted = 0;
+    uint64_t errors = 0;
+    uint64_t doorbells = 0;
+    uint64_t start;
+    int sock, n_fds;
+    struct timespec ts;
+
+    if (argc < 2)
+    {
+        fprintf(stderr, "Usage: %s <socket> [frames]\n", argv[0]);
+        return 1;
+    }
+
+    if (argc > 2)
+        frames = strtoull(argv[2], NULL, 10);
+
+    if ((sock = producer_connect(argv[1])) == -1)
+        return 1;
+
+    if ((n_fds = producer_recv_hello(sock, fds, 2 + DRMLIST_INGEST_MAX_BUFFERS)) == -1)
+        return 1;
+
+    ctl = mmap(NULL, sizeof(drmlist_ingest_ctl_t), PROT_READ | PROT_WRITE, MAP_SHARED, fds[0], 0);
+    if (ctl == MAP_FAILED)
+    {
+        perror("mmap ctl");
+        return 1;
+    }
+
+    if (ctl->magic != DRMLIST_INGEST_MAGIC || ctl->n_buffers != (uint32_t)(n_fds - 2) || ctl->format != DRM_FORMAT_XRGB8888)
+    {
+        fprintf(stderr, "Bad ctl page: magic 0x%x, %d buffers for %d fds\n", ctl->magic, ctl->n_buffers, n_fds - 2);
+        return 1;
+    }
+
+    for (uint32_t i = 0; i < ctl->n_buffers; i++)
+    {
+        pixels[i] = mmap(NULL, ctl->size, PROT_READ | PROT_WRITE, MAP_SHARED, fds[2 + i], 0);
+        if (pixels[i] == MAP_FAILED)
+        {
+            perror("mmap dmabuf");
+            return 1;
+        }
+    }
+
+    printf("Connected: %d buffers, %dx%d, stride: %d\n", ctl->n_buffers, ctl->width, ctl->height, ctl->stride);
+
+    start = (clock_gettime(CLOCK_MONOTONIC, &ts), ts.tv_sec * 1000000000ull + ts.tv_nsec);
+
+    while (submitted < frames)
+    {
+        uint32_t idx;
+
+        if (!drmlist_ingest_ring_pop(&ctl->free, &idx))
+        {
+            /* Every buffer is queued or on screen, wait for a flip */
+            usleep(500);
+            continue;
+        }
+
+        if (idx >= ctl->n_buffers)
+        {
+            fprintf(stderr, "Protocol error: got buffer %u of %u\n", idx, ctl->n_buffers);
+            errors++;
+            continue;
+        }
+
+        /*
+         * drmlist hands a frame back once it took a newer one off the ready
+         * ring (dropped, or after the newer one's flip), the ring's tail counts
+         * the frames taken. Before that it's still queued or on screen (or its
+         * flip failed, which drmlist reports).
+         */
+        if (submitted_as[idx] && (int32_t)(atomic_load(&ctl->ready.tail) - (uint32_t)submitted_as[idx]) <= 0)
+        {
+            fprintf(stderr, "Protocol error: got buffer %u back with frame %lu before a newer frame replaced it\n", idx,
+                            submitted_as[idx] - 1);
+            errors++;
+        }
+
+        producer_dmabuf_sync(fds[2 + idx], DMA_BUF_SYNC_START | DMA_BUF_SYNC_WRITE);
+        producer_render(pixels[idx], ctl, submitted);
+        producer_dmabuf_sync(fds[2 + idx], DMA_BUF_SYNC_END | DMA_BUF_SYNC_WRITE);
+
+        while (!drmlist_ingest_ring_push(&ctl->ready, idx))
+            usleep(500);
+        submitted_as[idx] = ++submitted;
+
+        atomic_thread_fence(memory_order_seq_cst);
+        if (atomic_exchange(&ctl->consumer_waiting, 0))
+        {
+            uint64_t one = 1;
+            if (write(fds[1], &one, sizeof(one)) == -1)
+                perror("write doorbell");
+            doorbells++;
+        }
+    }
+
+    /* Let the last frames reach the screen */
+    usleep(100000);
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    double secs = (ts.tv_sec * 1000000000ull + ts.tv_nsec - start) / 1e9;
+    uint64_t presented = atomic_load(&ctl->presented);
+    uint64_t dropped = atomic_load(&ctl->dropped);
+
+    printf("Submitted: %lu, presented: %lu, dropped: %lu, doorbells: %lu, %.1f fps, errors: %lu\n",
+                    submitted, presented, dropped, doorbells, presented / secs, errors);
+
+    if (presented == 0 || presented + dropped > submitted || errors)
+    {
+        fprintf(stderr, "FAILED\n");
+        return 1;
+    }
+
+    printf("OK\n");
+    close(sock);
+
+    return 0;
+}
@@ -0,0 +1,167 @@
+/*
+ * drmlist_stats - Reads drmlist's live stats page
+ *
+ *  drmlist_stats                    every /dev/shm/drmlist-*.stats, once
+ *  drmlist_stats <file> [ms]        one page, every `ms` milliseconds
+ *
+ * Only maps the page and reads it, drmlist never notices.
+ */
+
+#include "drmlist_stats.h"
+
+#include <stddef.h>
+#include <glob.h>
+#include <signal.h>
+#include <time.h>
+
+static int stats_open(const char* path, const drmlist_stats_page_t** page)
+{
+    struct stat st;
+    void* map;
+    int fd;
+
+    if ((fd = open(path, O_RDONLY | O_CLOEXEC)) == -1)
+    {
+        perror(path);
+        return -1;
+    }
+
+    if (fstat(fd, &st) == -1 || st.st_size < (off_t)offsetof(drmlist_stats_page_t, start_ns))
+    {
+        fprintf(stderr, "%s: Not a stats page\n", path);
+        close(fd);
+        return -1;
+    }
+
+    map = mmap(NULL, sizeof(drmlist_stats_page_t), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (map == MAP_FAILED)
+    {
+        perror("mmap");
+        return -1;
+    }
+
+    *page = map;
+
+    if ((*page)->magic != DRMLIST_STATS_MAGIC)
+    {
+        fprintf(stderr, "%s: Bad magic (not initialized yet?)\n", path);
+        munmap(map, sizeof(drmlist_stats_page_t));
+        return -1;
+    }
+
+    if ((*page)->version != DRMLIST_STATS_VERSION || (*page)->size < sizeof(drmlist_stats_page_t))
+    {
+        fprintf(stderr, "%s: Version %u (size %u), expected %u\n", path, (*page)->version, (*page)->size, DRMLIST_STATS_VERSION);
+        munmap(map, sizeof(drmlist_stats_page_t));
+        return -1;
+    }
+
+    return 0;
+}
+
+/*
+ * Consistent copy of the page, see the seqlock in drmlist_stats.h
+ */
+static void stats_read(const drmlist_stats_page_t* page, drmlist_stats_page_t* copy)
+{
+    uint32_t s1, s2;
+
+    for (;;)
+    {
+        s1 = atomic_load_explicit((_Atomic uint32_t*)&page->seq, memory_order_acquire);
+        if (s1 & 1)
+            continue;
+
+        memcpy(copy, (const void*)page, sizeof(drmlist_stats_page_t));
+        atomic_thread_fence(memory_order_acquire);
+
+        s2 = atomic_load_explicit((_Atomic uint32_t*)&page->seq, memory_order_relaxed);
+        if (s1 == s2)
+            return;
+    }
+}
+
+static void stats_print(const char* path, const drmlist_stats_page_t* s)
+{
+    struct timespec ts;
+    uint64_t now;
+    bool alive = kill(s->pid, 0) == 0 || errno == EPERM;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    now = (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+
+    printf("%s: pid %d%s, %ux%u @ %.3fHz, up %.0fs, updated %.0fms ago\n", path, s->pid, alive ? "" : " (gone)",
+                    s->width, s->height, s->refresh_mhz / 1e3, (now - s->start_ns) / 1e9, (now - s->update_ns) / 1e6);
+    printf("\tframes: %lu, fps: %.2f, missed vblanks: %lu\n", s->frames, s->fps_milli / 1e3, s->missed_vblanks);
+    printf("\trender: %.3f ms (avg %.3f, max %.3f)\n", s->render_ns_last / 1e6, s->render_ns_avg / 1e6, s->render_ns_max / 1e6);
+    printf("\tinput: %lu events, %.1f/s\n", s->input_events, s->input_rate_milli / 1e3);
+}
+
+static int stats_once(const char* path)
+{
+    const drmlist_stats_page_t* page;
+    drmlist_stats_page_t copy;
+
+    if (stats_open(path, &page))
+        return 1;
+
+    stats_read(page, &copy);
+    stats_print(path, &copy);
+    munmap((void*)page, sizeof(drmlist_stats_page_t));
+
+    return 0;
+}
+
+int main(int argc, const char** argv)
+{
+    const drmlist_stats_page_t* page;
+    drmlist_stats_page_t copy;
+    struct timespec delay;
+    int interval_ms;
+
+    if (argc < 2)
+    {
+        glob_t g;
+        int ret = 0;
+
+        if (glob(DRMLIST_STATS_DIR "/drmlist-*.stats", 0, NULL, &g))
+        {
+            fprintf(stderr, "No drmlist running (" DRMLIST_STATS_DIR "/drmlist-*.stats)\n");
+            return 1;
+        }
+
+        for (size_t i = 0; i < g.gl_pathc; i++)
+            ret |= stats_once(g.gl_pathv[i]);
+
+        globfree(&g);
+        return ret;
+    }
+
+    if (argc < 3)
+        return stats_once(argv[1]);
+
+    if ((interval_ms = atoi(argv[2])) <= 0)
+        interval_ms = 1000;
+    delay.tv_sec = interval_ms / 1000;
+    delay.tv_nsec = (interval_ms % 1000) * 1000000l;
+
+    if (stats_open(argv[1], &page))
+        return 1;
+
+    for (;;)
+    {
+        stats_read(page, &copy);
+        stats_print(argv[1], &copy);
+
+        if (kill(copy.pid, 0) == -1 && errno == ESRCH)
+            break;
+
+        nanosleep(&delay, NULL);
+    }
+
+    munmap((void*)page, sizeof(drmlist_stats_page_t));
+
+    return 0;
+}